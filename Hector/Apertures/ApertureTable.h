@@ -0,0 +1,79 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef Hector_Apertures_ApertureTable_h
+#define Hector_Apertures_ApertureTable_h
+
+#include "Hector/Apertures/ApertureFwd.h"
+#include "Hector/Utils/Algebra.h"
+
+namespace hector {
+  namespace aperture {
+    /// Flat table of the shape parameters for a list of apertures, for a fast acceptance test of particles positions
+    /// \note Rectangular, elliptic, circular, and rectangular-elliptic shapes are all reduced to the intersection of
+    ///  a rectangle and an ellipse (an infinite size disabling either part), tested without branches or virtual
+    ///  calls. Other aperture implementations fall back to their own Aperture::contains method.
+    /// \warning Shape parameters are copied at construction; any later modification of the apertures is ignored.
+    class ApertureTable {
+    public:
+      /// Acceptance test used for an aperture
+      enum class Shape {
+        none,     ///< No aperture restriction
+        flat,     ///< Intersection of a rectangle and an ellipse
+        generic,  ///< Aperture::contains method of the aperture object
+      };
+
+    public:
+      ApertureTable() = default;
+      /// Build the table for a list of apertures
+      /// \param[in] apertures List of apertures (not owning), a null or invalid aperture accepting all positions
+      explicit ApertureTable(const std::vector<const Aperture*>& apertures);
+
+      /// Number of apertures in the table
+      size_t size() const { return entries_.size(); }
+      /// Acceptance test used for an aperture
+      Shape shape(size_t i) const { return entries_.at(i).shape; }
+      /// Is any position restriction set for an aperture?
+      bool restricted(size_t i) const { return entries_.at(i).shape != Shape::none; }
+
+      /// Check if a position is contained in an aperture
+      bool contains(size_t i, const TwoVector& pos) const;
+      /// Check if a list of positions is contained in an aperture
+      /// \param[in] x Horizontal coordinates of the positions
+      /// \param[in] y Vertical coordinates of the positions
+      /// \param[in] num Number of positions
+      /// \param[out] accepted Acceptance flag for each position (1 if contained, 0 otherwise)
+      /// \note Flags are stored as floating point values for the test to be vectorised along with the coordinates
+      void contains(size_t i, const double* x, const double* y, size_t num, double* accepted) const;
+
+    private:
+      /// Flattened aperture parameters
+      struct Entry {
+        Shape shape;
+        double x, y;            ///< Aperture barycentre
+        double rect_x, rect_y;  ///< Half-sizes of the rectangular part
+        double ell_x, ell_y;    ///< Semi-axes of the elliptic part
+      };
+      std::vector<Entry> entries_;
+      /// Copy of the aperture objects for the generic shapes
+      Apertures generic_;
+    };
+  }  // namespace aperture
+}  // namespace hector
+
+#endif
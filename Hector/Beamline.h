@@ -26,8 +26,11 @@
 #include "Hector/Elements/Marker.h"
 
 namespace hector {
+  class BeamlineBuilder;
   /// A beamline, or collection of optics elements
   class Beamline {
+    friend class BeamlineBuilder;
+
   public:
     /// List of markers in the beamline
     typedef std::map<double, element::Marker> MarkersMap;
@@ -64,20 +67,23 @@ namespace hector {
     const element::Elements& elements() const { return elements_; }
     /// Get the full beamline content (vector of elements)
     element::Elements& elements() { return elements_; }
-    /// Retrieve a beamline element given its name
-    /// \param[in] name Name of the element to be retrieved
-    element::ElementPtr& get(const std::string& name);
-    /// Retrieve a beamline element given its name
+    /// Retrieve the first beamline element whose name contains a given string
     /// \param[in] name Name of the element to be retrieved
     const element::ElementPtr& get(const std::string& name) const;
     /// Retrieve a beamline element given its s-position
     /// \param[in] s s-position of the element (computed wrt the interaction point)
-    element::ElementPtr& get(double s);
-    /// Retrieve a beamline element given its s-position
-    /// \param[in] s s-position of the element (computed wrt the interaction point)
     const element::ElementPtr& get(double s) const;
-    /// Find an element by name
+    /// Find all elements whose name matches a regular expression
     element::Elements find(const std::string&);
+    /// Rebuild the elements lookup index
+    /// \note The index used by get and find is refreshed whenever elements are added, removed, replaced, or modified.
+    ///  It only has to be rebuilt explicitly if existing elements are reordered, or replaced by copies of other
+    ///  elements, in place through elements().
+    void reindex();
+    /// Revision of the beamline content, changed whenever elements are added, removed, replaced, or modified
+    /// \note This revision is tracked independently of the lookup index, and only checked element by element if an
+    ///  element was constructed, or modified while being part of a beamline, since the last call.
+    unsigned long long revision() const;
     /// Number of elements in the beamline
     unsigned short numElements() const { return elements_.size(); }
 
@@ -110,9 +116,27 @@ namespace hector {
     void tiltElementsAfter(double s, const TwoVector& offset);
 
     /// Total propagation matrix of all combined beamline elements
-    Matrix matrix(double eloss, double mp = -1., int qp = 0) const;
+    /// \param[in] eloss Particle energy loss (GeV)
+    /// \param[in] mp Particle mass (GeV)
+    /// \param[in] qp Particle charge (e)
+    /// \param[in] ctx Beam properties and run switches (current run parameters if not specified)
+    Matrix matrix(double eloss,
+                  double mp = -1.,
+                  int qp = 0,
+                  const PropagationContext& ctx = PropagationContext()) const;
 
   private:
+    /// Address and revision of the elements for a given revision of the beamline content
+    struct Stamps;
+    /// Lookup tables for the elements names and s-positions
+    struct Index;
+    /// Lookup index for the current list of elements, built on first use
+    std::shared_ptr<Index> index() const;
+    /// Does an element overlap with another one, starting earlier in the beamline?
+    static bool overlaps(const element::ElementPtr& prev_elem, const element::ElementPtr& elem);
+    /// Shorten an element to the entrance of another one it contains
+    /// \return Remaining part of the element after the contained one, if any
+    static element::ElementPtr split(const element::ElementPtr& prev_elem, const element::ElementPtr& elem);
     /// Copy the list of elements from one beamline to this one
     void setElements(const Beamline& moth_bl);
     /// Beamline maximal length (in m)
@@ -124,6 +148,11 @@ namespace hector {
     element::Elements elements_;
     /// List of markers in the beamline
     MarkersMap markers_;
+    /// Elements stamps for the current beamline revision (atomically replaced, reset on each modification of the
+    ///  elements list)
+    mutable std::shared_ptr<Stamps> stamps_;
+    /// Elements lookup index, built on first use for the current beamline revision (atomically replaced)
+    mutable std::shared_ptr<Index> index_;
   };
 }  // namespace hector
 
@@ -0,0 +1,57 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef Hector_BeamlineBuilder_h
+#define Hector_BeamlineBuilder_h
+
+#include <memory>
+
+#include "Hector/Beamline.h"
+
+namespace hector {
+  /// Bulk constructor of a beamline from an unordered collection of elements
+  /// \note Contrary to successive calls to Beamline::add, which re-sort the full list of elements at each insertion,
+  ///  all elements are collected first, sorted once, and their overlaps are resolved in a single sweep along s.
+  ///  The resulting beamline is identical to the one obtained by adding the elements in increasing s order.
+  class BeamlineBuilder {
+  public:
+    /// Start a new beamline
+    /// \param[in] properties Beamline whose length, interaction point, and markers are copied (not its elements)
+    explicit BeamlineBuilder(const Beamline& properties = Beamline());
+
+    /// Reserve space for a given number of elements
+    void reserve(size_t num_elements) { elements_.reserve(num_elements); }
+    /// Collect a new element to be added to the beamline
+    /// \param[in] elem Element to be added to the beamline
+    void add(const element::ElementPtr& elem);
+    /// Number of elements collected so far
+    size_t size() const { return elements_.size(); }
+
+    /// Sort all collected elements, resolve their overlaps, and produce the beamline
+    /// \note The builder is left empty, and can be reused to produce a beamline with the same properties.
+    std::unique_ptr<Beamline> build();
+
+  private:
+    /// Beamline properties (length, interaction point, markers)
+    const Beamline properties_;
+    /// Collected elements, in their insertion order
+    element::Elements elements_;
+  };
+}  // namespace hector
+
+#endif
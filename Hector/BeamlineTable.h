@@ -0,0 +1,82 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef Hector_BeamlineTable_h
+#define Hector_BeamlineTable_h
+
+#include <string>
+#include <vector>
+
+namespace hector {
+  class Beamline;
+  /// Columnar snapshot of the properties of all elements in a beamline
+  /// \note Each property is stored as a contiguous array of values, indexed as the beamline elements, so that it can
+  ///  be shared without copy with numerical analysis tools (e.g. as NumPy arrays).
+  /// \warning The beamline is not monitored for modifications. Any change in its elements requires a new table.
+  class BeamlineTable {
+  public:
+    /// Floating point properties stored for each element
+    enum Column {
+      s,                 ///< Longitudinal position of the element entrance (in m)
+      length,            ///< Element length (in m)
+      magneticStrength,  ///< Element magnetic strength
+      betaX,             ///< Horizontal beta function (in m)
+      betaY,             ///< Vertical beta function (in m)
+      dispersionX,       ///< Horizontal dispersion (in m)
+      dispersionY,       ///< Vertical dispersion (in m)
+      relativeX,         ///< Horizontal position relative to the beam axis (in m)
+      relativeY,         ///< Vertical position relative to the beam axis (in m)
+      apertureX,         ///< Horizontal position of the aperture barycentre (in m)
+      apertureY,         ///< Vertical position of the aperture barycentre (in m)
+      apertureP1,        ///< First aperture shape parameter (NaN if none)
+      apertureP2,        ///< Second aperture shape parameter (NaN if none)
+      apertureP3,        ///< Third aperture shape parameter (NaN if none)
+      apertureP4,        ///< Fourth aperture shape parameter (NaN if none)
+      numColumns
+    };
+
+  public:
+    /// Build the table from all elements of a beamline
+    explicit BeamlineTable(const Beamline&);
+
+    /// Human-readable name of a column
+    static const char* columnName(Column);
+
+    /// Number of elements in the table
+    size_t size() const { return values_.size() / numColumns; }
+    /// Values of a property for all elements
+    const double* column(Column col) const { return values_.data() + col * size(); }
+    /// Values of a property for all elements
+    double* column(Column col) { return values_.data() + col * size(); }
+    /// Elements names
+    const std::vector<std::string>& names() const { return names_; }
+    /// Elements types
+    const std::vector<int>& types() const { return types_; }
+    /// Elements apertures types (invalid aperture if none)
+    const std::vector<int>& apertureTypes() const { return aperture_types_; }
+
+  private:
+    /// Values of all properties, column after column
+    std::vector<double> values_;
+    std::vector<std::string> names_;
+    std::vector<int> types_;
+    std::vector<int> aperture_types_;
+  };
+}  // namespace hector
+
+#endif
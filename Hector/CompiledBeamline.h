@@ -0,0 +1,123 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef Hector_CompiledBeamline_h
+#define Hector_CompiledBeamline_h
+
+#include <memory>
+#include <shared_mutex>
+#include <vector>
+
+#include "Hector/Apertures/ApertureTable.h"
+#include "Hector/Elements/ElementFwd.h"
+#include "Hector/Elements/MatrixCache.h"
+#include "Hector/PropagationContext.h"
+
+namespace hector {
+  class Beamline;
+  /// Beamline reduced to a sequence of transport segments, each one fusing a run of consecutive elements
+  /// \note Segments are only split where the particles state is needed: around elements whose aperture is checked,
+  ///  and after the elements reaching a user-requested station. For a given particle kinematics, the transfer
+  ///  matrices of all elements in a segment are pre-multiplied into a single matrix.
+  /// \note If the compilation starts inside an element, only its part downstream of the first position is compiled,
+  ///  as a partial-length copy of this element.
+  /// \note A compiled beamline is only valid for the beamline revision it was built from. Any later change in the
+  ///  beamline elements requires a new compilation.
+  class CompiledBeamline {
+  public:
+    /// Run of consecutive beamline elements propagated through at once
+    struct Segment {
+      size_t first;                          ///< Index of the first element in the segment
+      size_t last;                           ///< Index following the one of the last element in the segment
+      double s_begin;                        ///< Longitudinal position of the segment entrance (in m)
+      double s_end;                          ///< Longitudinal position of the segment exit (in m)
+      element::ElementPtr aperture_element;  ///< Single element whose aperture is checked at entrance and exit
+      size_t aperture_id;                    ///< Index of the aperture element in the beamline
+    };
+    /// Fused transfer matrices of all segments, for one particle kinematics
+    typedef std::vector<Matrix> Matrices;
+    /// Maximal number of particle kinematics for which the fused matrices are kept
+    static constexpr size_t max_kinematics = 32;
+
+  public:
+    /// Compile a beamline for a given propagation context
+    /// \param[in] bl Beamline to compile (not owning)
+    /// \param[in] ctx Beam properties and run switches
+    /// \param[in] stations Longitudinal positions (in m) at which the particles state must be available
+    /// \param[in] s_min Longitudinal position of the particles entering the compiled beamline (in m)
+    /// \param[in] s_max Maximal s-coordinate of the last compiled element (in m), or the full beamline if negative
+    CompiledBeamline(const Beamline* bl,
+                     const PropagationContext& ctx = PropagationContext(),
+                     std::vector<double> stations = {},
+                     double s_min = 0.,
+                     double s_max = -1.);
+
+    /// Beamline compiled (not owning)
+    const Beamline* beamline() const { return beamline_; }
+    /// Revision of the beamline content at the compilation
+    unsigned long long revision() const { return revision_; }
+    /// Beam properties and run switches the beamline was compiled for
+    const PropagationContext& context() const { return context_; }
+    /// Longitudinal position of the particles entering the compiled beamline (in m)
+    double sMin() const { return s_min_; }
+    /// Exit s-coordinate of the last compiled element (in m)
+    double sMax() const { return segments_.empty() ? s_min_ : segments_.rbegin()->s_end; }
+
+    /// List of compiled elements
+    const element::Elements& elements() const { return elements_; }
+    /// List of transport segments
+    const std::vector<Segment>& segments() const { return segments_; }
+    /// Apertures checked for the compiled elements, indexed as the elements
+    const aperture::ApertureTable& apertures() const { return apertures_; }
+
+    /// Fused transfer matrices of all segments, computed once per particle kinematics
+    /// \param[in] eloss Particle energy loss (GeV)
+    /// \param[in] mp Particle mass (GeV)
+    /// \param[in] qp Particle charge (e)
+    std::shared_ptr<const Matrices> matrices(double eloss, double mp, int qp) const;
+    /// Fused transfer matrices of all segments for one particle kinematics, if already computed
+    /// \param[in] eloss Particle energy loss (GeV)
+    /// \param[in] mp Particle mass (GeV)
+    /// \param[in] qp Particle charge (e)
+    /// \return Null pointer if the matrices are not (or no longer) stored for this kinematics
+    std::shared_ptr<const Matrices> findMatrices(double eloss, double mp, int qp) const;
+    /// Provide the fused matrices of all segments computed elsewhere (e.g. retrieved from a file) for one kinematics
+    /// \param[in] eloss Particle energy loss (GeV)
+    /// \param[in] mp Particle mass (GeV)
+    /// \param[in] qp Particle charge (e)
+    /// \param[in] mats Fused transfer matrices, one per segment
+    void setMatrices(double eloss, double mp, int qp, std::shared_ptr<const Matrices> mats) const;
+
+  private:
+    const Beamline* beamline_;  // NOT owning
+    const unsigned long long revision_;
+    const PropagationContext context_;
+    const double s_min_;
+    element::Elements elements_;
+    std::vector<Segment> segments_;
+    aperture::ApertureTable apertures_;
+
+    mutable std::shared_mutex mutex_;
+    /// Collection of fused matrices already computed (used as a ring buffer)
+    mutable std::vector<std::pair<element::MatrixCache::Key, std::shared_ptr<const Matrices> > > matrices_;
+    /// Position of the next set of matrices to be replaced once the collection is full
+    mutable size_t next_;
+  };
+}  // namespace hector
+
+#endif
@@ -56,7 +56,7 @@ namespace hector {
          */
       /// \note Numerical sensitivity (~\f$10^{-8}\f$ relative precision on a 64-bit Intel machine) expected with \f$ \frac{r}{E_{\mathrm{b}}} \left(1-\cos{\theta}\right)\f$.
       ///  Using \f$ \cos{2x} = 1-2\sin^{2}{x} \f$ to transform this term (see the variable called "simp")
-      Matrix matrix(double, double mp = -1., int qp = 0) const override;
+      Matrix matrix(double, double mp, int qp, const PropagationContext& ctx) const override;
     };
 
     /// Sector dipole object builder
@@ -93,7 +93,7 @@ namespace hector {
          * \f$
          * assuming \f$\theta = {L\over r}\f$, \f$ {1\over r} \equiv k =  k_{0} \cdot \frac{p_{0}}{p_{0} - \mathrm{d}p} \cdot \frac{q_{\mathrm{part}}}{q_{\mathrm{b}}} \f$
          */
-      Matrix matrix(double, double mp = -1., int qp = 0) const override;
+      Matrix matrix(double, double mp, int qp, const PropagationContext& ctx) const override;
     };
   }  // namespace element
 }  // namespace hector
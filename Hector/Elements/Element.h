@@ -19,19 +19,24 @@
 #ifndef Hector_Elements_Element_h
 #define Hector_Elements_Element_h
 
+#include <atomic>
 #include <iosfwd>
 #include <memory>
 
 #include "Hector/Apertures/Aperture.h"
 #include "Hector/Elements/ElementFwd.h"
 #include "Hector/Elements/ElementType.h"
+#include "Hector/Elements/MatrixCache.h"
 #include "Hector/Utils/Algebra.h"
 
 namespace hector {
+  class Beamline;
   /// Collection of beamline elements
   namespace element {
     /// A generic beamline element object
     class Element {
+      friend class hector::Beamline;
+
     public:
       /// Build a new element
       /// \param[in] type Element type (see element::Type)
@@ -57,35 +62,78 @@ namespace hector {
 
       /// Compute the propagation matrix for this element
       /// \param[in] eloss Particle energy loss in the element (GeV)
-      /// \param[in] mp Particle mass (GeV)
-      /// \param[in] qp Particle charge (e)
-      virtual Matrix matrix(double eloss, double mp = -1., int qp = 0) const = 0;
+      /// \param[in] mp Particle mass (GeV), or a negative value for the beam particles mass
+      /// \param[in] qp Particle charge (e), or 0 for the beam particles charge
+      /// \param[in] ctx Beam properties and run switches
+      virtual Matrix matrix(double eloss, double mp, int qp, const PropagationContext& ctx) const = 0;
+      /// Retrieve the propagation matrix for this element from its cache, computing it if not yet present
+      /// \param[in] eloss Particle energy loss in the element (GeV)
+      /// \param[in] mp Particle mass (GeV), or a negative value for the beam particles mass
+      /// \param[in] qp Particle charge (e), or 0 for the beam particles charge
+      /// \param[in] ctx Beam properties and run switches
+      Matrix cachedMatrix(double eloss, double mp, int qp, const PropagationContext& ctx) const;
+      /// Store a transfer matrix computed elsewhere (e.g. retrieved from a file) into the cache of this element
+      /// \param[in] mat Transfer matrix for this element and particle kinematics
+      /// \param[in] eloss Particle energy loss in the element (GeV)
+      /// \param[in] mp Particle mass (GeV), or a negative value for the beam particles mass
+      /// \param[in] qp Particle charge (e), or 0 for the beam particles charge
+      /// \param[in] ctx Beam properties and run switches
+      void cacheMatrix(const Matrix& mat, double eloss, double mp, int qp, const PropagationContext& ctx) const;
+      /// Collection of transfer matrices already computed for this element
+      const MatrixCache& matrixCache() const { return matrix_cache_; }
+
+      /// Revision of the element properties, increased whenever one of them is modified
+      unsigned long long revision() const { return revision_; }
+      /// Latest revision given to any element (increased by each construction or modification of an element)
+      static unsigned long long lastRevision() { return last_revision_; }
+      /// Counter of the changes possibly affecting a beamline content
+      /// \note Increased by each construction of a new element (which may replace another one in a beamline), and by
+      ///  each modification of an element already part of a beamline. Copies and clones of elements (e.g. the partial
+      ///  elements built along a propagation) do not affect it until they are added to a beamline.
+      static unsigned long long lastBeamlineChange() { return last_beamline_change_; }
 
       /// Set the name of the element
-      void setName(const std::string& name) { name_ = name; }
+      void setName(const std::string& name) {
+        name_ = name;
+        modified();
+      }
       /// Element name
-      const std::string name() const { return name_; }
+      const std::string& name() const { return name_; }
       /// Set the element type
-      void setType(const Type& type) { type_ = type; }
+      void setType(const Type& type) {
+        type_ = type;
+        matrix_cache_.clear();
+        modified();
+      }
       /// Element type
       Type type() const { return type_; }
       /// Human-readable element type
       const std::string typeName() const;
 
       /// Set the longitudinal position of the entrance of the element
-      void setS(double s) { s_ = s; }
+      void setS(double s) {
+        s_ = s;
+        modified();
+      }
       /// Longitudinal position
       double s() const { return s_; }
       /// Offset the longitudinal position by a given distance (in m)
-      void offsetS(double s_offs) { s_ += s_offs; }
+      void offsetS(double s_offs) {
+        s_ += s_offs;
+        modified();
+      }
 
       /// Set the x-y position of the centre of the element
-      void setPosition(const TwoVector& pos) { pos_ = pos; }
+      void setPosition(const TwoVector& pos) {
+        pos_ = pos;
+        modified();
+      }
       /// Change the x-y position of the element
       void offset(const TwoVector& offset) {
         pos_ += offset;
         if (aperture_)
           aperture_->offset(offset);
+        modified();
       }
       /// x-y position of the element at a given s
       TwoVector position() const { return pos_; }
@@ -95,9 +143,15 @@ namespace hector {
       double y() const { return pos_.y(); }
 
       /// Set the horizontal and vertical angles of the element (computed with respect to the s coordinate)
-      void setAngles(const TwoVector& angles) { angles_ = angles; }
+      void setAngles(const TwoVector& angles) {
+        angles_ = angles;
+        modified();
+      }
       /// Change the orientation of the element
-      void tilt(const TwoVector& tilt) { angles_ += tilt; }
+      void tilt(const TwoVector& tilt) {
+        angles_ += tilt;
+        modified();
+      }
       /// Horizontal and vertical tilts of the element (with respect to the s axis)
       TwoVector angles() const { return angles_; }
       /// Horizontal angle
@@ -106,28 +160,45 @@ namespace hector {
       double Ty() const { return angles_.y(); }
 
       /// Set the element length (m)
-      void setLength(double length) { length_ = length; }
+      void setLength(double length) {
+        length_ = length;
+        matrix_cache_.clear();
+        modified();
+      }
       /// Element length (m)
       double length() const { return length_; }
 
       /// Set the element magnetic field strength
       /// \note Strength \f$ k = \frac{e}{p}\frac{\partial B}{\partial x} \f$
-      void setMagneticStrength(double k) { magnetic_strength_ = k; }
+      void setMagneticStrength(double k) {
+        magnetic_strength_ = k;
+        matrix_cache_.clear();
+        modified();
+      }
       /// Magnetic field strength
       double magneticStrength() const { return magnetic_strength_; }
 
       /// Set the beta factor
-      void setBeta(const TwoVector& beta) { beta_ = beta; }
+      void setBeta(const TwoVector& beta) {
+        beta_ = beta;
+        modified();
+      }
       /// Beta factor
       TwoVector beta() const { return beta_; }
 
       /// Set the x-y (horizontal and vertical) dispersions
-      void setDispersion(const TwoVector& disp) { disp_ = disp; }
+      void setDispersion(const TwoVector& disp) {
+        disp_ = disp;
+        modified();
+      }
       /// Horizontal and vertical dispersions
       TwoVector dispersion() const { return disp_; }
 
       /// Set the relative position of the element
-      void setRelativePosition(const TwoVector& pos) { rel_pos_ = pos; };
+      void setRelativePosition(const TwoVector& pos) {
+        rel_pos_ = pos;
+        modified();
+      }
       /// Relative position of the element
       TwoVector relativePosition() const { return rel_pos_; }
 
@@ -139,15 +210,25 @@ namespace hector {
       aperture::Aperture* aperture() const { return aperture_.get(); }
 
       /// Set the parent element if this one is splitted
-      void setParentElement(const ElementPtr& parent) { parent_elem_ = parent; }
+      void setParentElement(const ElementPtr& parent) {
+        parent_elem_ = parent;
+        modified();
+      }
       /// Parent element if this one is splitted
       Element* parentElement() const { return parent_elem_.get(); }
 
       /// Compute the modified field strength of the element for a given energy loss of a particle of given mass and charge
       /// \note \f$ k_e = k \cdot \frac{p}{p-\mathrm{d}p} \cdot \frac{q_{\mathrm{part}}}{q_{\mathrm{b}}} \f$
-      double fieldStrength(double, double = -1., int = 0) const;
+      double fieldStrength(double, double, int, const PropagationContext&) const;
 
     protected:
+      /// Give a new revision to the element once one of its properties is modified
+      void modified() {
+        revision_ = ++last_revision_;
+        if (in_beamline_.load(std::memory_order_relaxed))
+          ++last_beamline_change_;
+      }
+
       /// Element type
       Type type_;
       /// Element name
@@ -175,6 +256,18 @@ namespace hector {
       TwoVector disp_;
       /// Relative position of the element
       TwoVector rel_pos_;
+
+    private:
+      /// Latest revision given to any element
+      static std::atomic<unsigned long long> last_revision_;
+      /// Counter of the changes possibly affecting a beamline content
+      static std::atomic<unsigned long long> last_beamline_change_;
+      /// Revision of the element properties
+      unsigned long long revision_;
+      /// Was this element already registered in a beamline?
+      mutable std::atomic<bool> in_beamline_;
+      /// Transfer matrices already computed for this element
+      mutable MatrixCache matrix_cache_;
     };
 
     /// Sorting methods for the beamline construction (using the s position of each elements)
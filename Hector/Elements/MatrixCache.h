@@ -0,0 +1,110 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef Hector_Elements_MatrixCache_h
+#define Hector_Elements_MatrixCache_h
+
+#include <atomic>
+#include <optional>
+#include <shared_mutex>
+#include <vector>
+
+#include "Hector/PropagationContext.h"
+#include "Hector/Utils/Algebra.h"
+
+namespace hector {
+  namespace element {
+    /// Bounded, thread-safe collection of the transfer matrices already computed for an element
+    /// \note Matrices are indexed by the exact energy loss, mass, and charge of the propagated particle, as well as by
+    ///  the beam properties of the propagation context. A cached matrix is thus always the one computed for these
+    ///  very values, whatever the order in which the kinematics were propagated. As all run parameters affecting the
+    ///  matrices are part of the key, no global state is needed to invalidate the collection.
+    /// \note The matrix of the nominal particle (with the beam mass and charge, and no energy loss) is kept in a
+    ///  dedicated slot, never evicted by other kinematics. As exact keys are never shared by the particles of a beam
+    ///  with smeared momenta, other matrices are no longer stored once the whole collection was renewed several times
+    ///  without being reused, sparing a write lock for each element of each particle.
+    class MatrixCache {
+    public:
+      /// Maximal number of matrices stored for one element
+      static constexpr size_t max_size = 32;
+      /// Number of consecutive retrieval failures after which matrices for other kinematics than the nominal one are
+      ///  no longer stored (until a stored one is reused)
+      static constexpr size_t max_consecutive_misses = 2 * max_size;
+      /// Particle and beam properties used to index a transfer matrix
+      struct Key {
+        /// Build a key from a particle energy loss (GeV), mass (GeV), charge (e), and a propagation context
+        Key(double eloss, double mp, int qp, const PropagationContext& ctx);
+        /// Check if two keys are identical
+        bool operator==(const Key& oth) const {
+          return eloss == oth.eloss && mass == oth.mass && charge == oth.charge && beam_energy == oth.beam_energy &&
+                 beam_mass == oth.beam_mass && beam_charge == oth.beam_charge && flags == oth.flags;
+        }
+        /// Is this the nominal particle (beam mass and charge, without energy loss) for these beam properties?
+        bool nominal() const;
+        double eloss;          ///< Particle energy loss (GeV)
+        double mass;           ///< Particle mass (GeV)
+        int charge;            ///< Particle charge (e)
+        double beam_energy;    ///< Beam energy (GeV)
+        double beam_mass;      ///< Beam particles mass (GeV)
+        int beam_charge;       ///< Beam particles charge (e)
+        unsigned short flags;  ///< Context switches affecting the matrices (relative energy, kickers, dipoles)
+      };
+
+    public:
+      MatrixCache();
+      /// Copy constructor (cached matrices are not transmitted)
+      MatrixCache(const MatrixCache&);
+      /// Assignment operator (cached matrices are not transmitted)
+      MatrixCache& operator=(const MatrixCache&);
+
+      /// Retrieve a matrix from the collection
+      /// \param[in] key Particle and beam properties
+      /// \param[out] mat Cached transfer matrix (if found)
+      /// \return Has the matrix been found in the collection?
+      bool find(const Key& key, Matrix& mat) const;
+      /// Store a new matrix in the collection (dropping the oldest one if the collection is full)
+      /// \note Matrices for other kinematics than the nominal one are not stored after too many consecutive failed
+      ///  retrievals (see max_consecutive_misses)
+      void insert(const Key& key, const Matrix& mat);
+      /// Remove all matrices from the collection
+      void clear();
+
+      /// Number of matrices currently stored
+      size_t size() const;
+      /// Number of successful matrix retrievals
+      unsigned long long hits() const { return hits_.load(std::memory_order_relaxed); }
+      /// Number of failed matrix retrievals
+      unsigned long long misses() const { return misses_.load(std::memory_order_relaxed); }
+
+    private:
+      mutable std::shared_mutex mutex_;
+      /// Matrix of the nominal particle, if already computed
+      std::optional<std::pair<Key, Matrix> > nominal_;
+      /// Collection of key-matrix pairs for all other kinematics (used as a ring buffer)
+      std::vector<std::pair<Key, Matrix> > entries_;
+      /// Position of the next matrix to be replaced once the collection is full
+      size_t next_;
+      mutable std::atomic<unsigned long long> hits_;
+      mutable std::atomic<unsigned long long> misses_;
+      /// Number of failed retrievals since a matrix of the ring buffer was last reused
+      mutable std::atomic<size_t> consecutive_misses_;
+    };
+  }  // namespace element
+}  // namespace hector
+
+#endif
@@ -53,7 +53,7 @@ namespace hector {
          * \f$
          * assuming \f$ k =  k_{0} \cdot \frac{p_{0}}{p_{0} - \mathrm{d}p} \cdot \frac{q_{\mathrm{part}}}{q_{\mathrm{b}}} \f$ and \f$ \omega \equiv \omega(k,L) = L \sqrt{|k|} \f$
          */
-      Matrix matrix(double, double mp = -1., int qp = 0) const override;
+      Matrix matrix(double, double mp, int qp, const PropagationContext& ctx) const override;
     };
 
     /// Vertical quadrupole object builder
@@ -77,7 +77,7 @@ namespace hector {
          * \f$
          * assuming \f$ k =  k_{0} \cdot \frac{p_{0}}{p_{0} - \mathrm{d}p} \cdot \frac{q_{\mathrm{part}}}{q_{\mathrm{b}}} \f$ and \f$ \omega \equiv \omega(k,l) = L \sqrt{|k|} \f$
          */
-      Matrix matrix(double, double mp = -1., int qp = 0) const override;
+      Matrix matrix(double, double mp, int qp, const PropagationContext& ctx) const override;
     };
   }  // namespace element
 }  // namespace hector
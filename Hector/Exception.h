@@ -24,10 +24,26 @@
 #include <string>
 
 #include "Hector/ExceptionType.h"
+#include "Hector/Parameters.h"
 
-#define H_DEBUG hector::Exception(__PRETTY_FUNCTION__, hector::ExceptionType::debug)
-#define H_INFO hector::Exception(__PRETTY_FUNCTION__, hector::ExceptionType::info)
-#define H_WARNING hector::Exception(__PRETTY_FUNCTION__, hector::ExceptionType::warning)
+/// Lowest severity of the log messages compiled in (debugging messages are removed from optimised builds)
+#ifndef HECTOR_LOGGING_FLOOR
+#ifdef NDEBUG
+#define HECTOR_LOGGING_FLOOR info
+#else
+#define HECTOR_LOGGING_FLOOR debug
+#endif
+#endif
+
+/// Log message of a given severity; neither built nor formatted if below the compile-time floor or run threshold
+#define H_LOG(type)                                                                                                    \
+  !(hector::ExceptionType::type >= hector::ExceptionType::HECTOR_LOGGING_FLOOR &&                                      \
+    hector::ExceptionType::type >= hector::Parameters::get().loggingThreshold())                                       \
+      ? (void)0                                                                                                        \
+      : hector::Exception::Voidify() & hector::Exception(__PRETTY_FUNCTION__, hector::ExceptionType::type)
+#define H_DEBUG H_LOG(debug)
+#define H_INFO H_LOG(info)
+#define H_WARNING H_LOG(warning)
 #define H_ERROR hector::Exception(__PRETTY_FUNCTION__, hector::ExceptionType::fatal)
 
 namespace hector {
@@ -46,6 +62,11 @@ namespace hector {
     /// Destruct the exception (and terminate the program execution if fatal)
     ~Exception() noexcept override;
 
+    /// Helper discarding the value of a log message statement
+    struct Voidify {
+      void operator&(const Exception&) const {}
+    };
+
     //----- Overloaded stream operators
 
     /// Generic templated message feeder operator
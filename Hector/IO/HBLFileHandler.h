@@ -19,16 +19,55 @@
 #ifndef Hector_IO_HBLFileHandler_h
 #define Hector_IO_HBLFileHandler_h
 
+#include <iosfwd>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
+
+#include "Hector/PropagationContext.h"
+#include "Hector/Utils/Algebra.h"
 
 namespace hector {
   class Beamline;
+  class CompiledBeamline;
   /// Collection of input/output utilitaries
   namespace io {
     /// An HBL (Hector BeamLine) files handler
+    /// \note Files are written in the compiled version 2 format, holding all elements properties (including the
+    ///  sequenced drifts and the parent elements of split ones) in fixed-size records followed by a names table.
+    ///  Version 1 files can still be parsed.
+    /// \note The transfer matrices of a nominal particle may optionally be embedded in the file, fused through the
+    ///  transport segments between apertures checkpoints, and optionally for each element along with their derivative
+    ///  with respect to the energy loss. The segments matrices can be provided to a compiled version of the parsed
+    ///  beamline, and the elements matrices are put back in the elements matrices caches once parsed, so that no
+    ///  matrix has to be computed for this particle.
     class HBL {
     public:
+      /// Version of the format of the files written
+      static constexpr unsigned short version = 203;
+
+      /// Transfer matrices precomputed for a nominal particle, as stored in the HBL file
+      struct Matrices {
+        PropagationContext context;  ///< Beam properties and run switches the matrices were computed for
+        double eloss;                ///< Energy loss of the nominal particle, as used in the matrices (in GeV)
+        double mass;                 ///< Mass of the nominal particle (in GeV)
+        int charge;                  ///< Charge of the nominal particle (in e)
+        double eloss_step;           ///< Energy loss step used to compute the derivatives (in GeV)
+        std::vector<Matrix> elements;     ///< Transfer matrix of each beamline element (empty if not stored)
+        std::vector<Matrix> derivatives;  ///< Derivative of each element matrix with respect to the energy loss (/GeV)
+        std::vector<std::pair<size_t, size_t> > segments;  ///< Compiled elements range of each transport segment
+        std::shared_ptr<const std::vector<Matrix> > segments_matrices;  ///< Fused transfer matrix of each segment
+
+        /// First-order approximation of an element transfer matrix for another energy loss
+        /// \param[in] i Index of the element in the beamline
+        /// \param[in] eloss Particle energy loss (GeV)
+        Matrix elementMatrix(size_t i, double eloss) const;
+      };
+
+      /// Build a handler without any parsed beamline
+      HBL();
       /// Parse an external HBL file
       HBL(const std::string& filename);
       HBL(const HBL&) {}
@@ -37,15 +76,46 @@ namespace hector {
 
       /// Parse an external HBL file
       void parse(const std::string&);
+      /// Parse the content of an HBL file already in memory
+      /// \note Version 2 records are used in place, and have to be aligned on 8 bytes in memory.
+      void parseContent(std::string_view content);
       /// Write a beamline to an external HBL file
-      static void write(const Beamline*, const std::string& filename);
+      /// \param[in] matrices_ctx Propagation context for which the nominal particle transfer matrices are embedded
+      /// \param[in] element_matrices Also embed the matrix of each element, and its derivative
+      static void write(const Beamline*,
+                        const std::string& filename,
+                        const std::optional<PropagationContext>& matrices_ctx = std::nullopt,
+                        bool element_matrices = true);
+      /// Write a beamline in the HBL format to an output stream
+      /// \param[in] matrices_ctx Propagation context for which the nominal particle transfer matrices are embedded
+      /// \param[in] element_matrices Also embed the matrix of each element, and its derivative
+      static void write(const Beamline*,
+                        std::ostream&,
+                        const std::optional<PropagationContext>& matrices_ctx = std::nullopt,
+                        bool element_matrices = true);
       /// Retrieve the beamline parsed from an external HBL file
       Beamline* beamline() const { return beamline_.get(); };
+      /// Transfer the ownership of the parsed beamline to the caller
+      std::unique_ptr<Beamline> releaseBeamline() { return std::move(beamline_); }
+      /// Transfer matrices retrieved from the file, if any
+      const Matrices* matrices() const { return matrices_.get(); }
+      /// Provide the precomputed transport segments matrices to a compiled version of the parsed beamline
+      /// \return False if the beamline was compiled for another context or with another segmentation
+      bool provideMatrices(const CompiledBeamline&) const;
 
     private:
+      /// Parse the packed elements of a version 1 file
+      void parseV1(std::string_view content);
+      /// Build the beamline from the records of a version 2 file, used in place
+      void parseV2(std::string_view content);
+      /// Retrieve the transfer matrices block of a version 2 file, and seed the elements matrices caches
+      void parseMatrices(std::string_view block, unsigned short file_version);
+      /// Compute the transfer matrices block to be stored in a version 2 file
+      static std::string matricesBlock(const Beamline*, const PropagationContext&, bool element_matrices);
+
       std::unique_ptr<Beamline> beamline_;
+      std::shared_ptr<const Matrices> matrices_;
       static constexpr unsigned long long magic_number = 0x464c4248;
-      static constexpr unsigned short version = 100;
     };
   }  // namespace io
 }  // namespace hector
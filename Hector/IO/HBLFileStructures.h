@@ -19,6 +19,8 @@
 #ifndef Hector_IO_HBLFileStructures_h
 #define Hector_IO_HBLFileStructures_h
 
+#include <cstdint>
+
 namespace hector {
   namespace io {
     /// Common header to HBL files
@@ -90,6 +92,126 @@ namespace hector {
       /// Aperture middle vertical position
       double aperture_y;
     };
+
+    /// Header of the compiled HBL files, followed by the elements records and the names table
+    /// \version 2.0.0
+    /// \note All fields have a fixed width and are stored little-endian at their natural alignment, so that the
+    ///  records can be used in place from a memory-mapped file.
+    struct HBLHeaderV2 {
+      /// HBL file magic number (as for version 1)
+      uint64_t magic;
+      /// HBL file version
+      uint16_t version;
+      /// Size of this header, in bytes
+      uint16_t header_size;
+      /// Byte order marker, as written by the producing host (0x01020304)
+      uint32_t byte_order;
+      /// Number of beamline elements, stored first in the records list
+      uint32_t num_elements;
+      /// Number of records (beamline elements, then parent elements and interaction point if not in the beamline)
+      uint32_t num_records;
+      /// Record index of the interaction point (-1 if none)
+      int32_t interaction_point;
+      /// Size of an element record, in bytes
+      uint32_t record_size;
+      /// Beamline maximal length (in m)
+      double max_length;
+      /// Offset of the first element record in the file, in bytes
+      uint64_t records_offset;
+      /// Offset of the names table in the file, in bytes
+      uint64_t strings_offset;
+      /// Size of the names table, in bytes
+      uint64_t strings_size;
+      /// Offset of the precomputed transfer matrices in the file, in bytes (0 if none)
+      /// \note Since version 2.0.1
+      uint64_t matrices_offset;
+      /// Size of the precomputed transfer matrices block, in bytes
+      /// \note Since version 2.0.1
+      uint64_t matrices_size;
+    };
+    static_assert(sizeof(HBLHeaderV2) == 80, "Unexpected HBL header layout");
+
+    /// An element as stored in version 2 HBL files
+    struct HBLElementV2 {
+      /// Enumerator handling the beamline element type
+      int32_t type;
+      /// Record index of the parent element (-1 if none)
+      int32_t parent;
+      /// Offset of the element name in the names table
+      uint32_t name_offset;
+      /// Length of the element name
+      uint32_t name_size;
+      /// Beamline element \f$s\f$ position
+      double s;
+      /// Beamline element length
+      double length;
+      /// Beamline element magnetic strength
+      double magnetic_strength;
+      /// Horizontal and vertical position of the element
+      double position[2];
+      /// Horizontal and vertical angles of the element
+      double angles[2];
+      /// Horizontal and vertical beta factors
+      double beta[2];
+      /// Horizontal and vertical dispersions
+      double dispersion[2];
+      /// Relative position of the element
+      double relative_position[2];
+      /// Enumerator handling the beamline element aperture type
+      int32_t aperture_type;
+      /// Number of aperture shape parameters
+      uint32_t num_aperture_parameters;
+      /// Aperture shape parameters
+      double aperture_parameters[4];
+      /// Aperture middle horizontal and vertical position
+      double aperture_position[2];
+    };
+    static_assert(sizeof(HBLElementV2) == 176, "Unexpected HBL element record layout");
+
+    /// Header of the block of transfer matrices precomputed for a nominal particle
+    /// \note It is optionally followed by the nominal matrix and its derivative with respect to the energy loss for
+    ///  each beamline element (as column-major 6x6 arrays), then by the segments records, each holding the fused
+    ///  transfer matrix of its elements.
+    struct HBLMatricesHeader {
+      /// Energy of the beam the matrices were computed for (in GeV)
+      double beam_energy;
+      /// Mass of the beam particles (in GeV)
+      double beam_mass;
+      /// Charge of the beam particles (in e)
+      int32_t beam_charge;
+      /// Context switches (relative energy, kickers, dipoles, aperture acceptance)
+      uint32_t flags;
+      /// Energy loss of the nominal particle, as used in the matrices computation (in GeV)
+      double eloss;
+      /// Mass of the nominal particle (in GeV)
+      double mass;
+      /// Charge of the nominal particle (in e)
+      int32_t charge;
+      /// Number of transport segments
+      uint32_t num_segments;
+      /// Step used to compute the matrices derivatives, by forward finite differences (in GeV)
+      double eloss_step;
+      /// Number of beamline elements
+      uint32_t num_elements;
+      /// Are the elements matrices and their derivatives stored? (always the case for version 2.0.1 files)
+      uint32_t element_matrices;
+    };
+    static_assert(sizeof(HBLMatricesHeader) == 64, "Unexpected HBL matrices header layout");
+
+    /// A transport segment between apertures checkpoints, with its fused transfer matrix
+    struct HBLSegment {
+      /// Index of the first element in the segment, in the list of compiled elements
+      uint32_t first;
+      /// Index following the one of the last element in the segment
+      uint32_t last;
+      /// Longitudinal position of the segment entrance (in m)
+      double s_begin;
+      /// Longitudinal position of the segment exit (in m)
+      double s_end;
+      /// Fused transfer matrix (column-major)
+      double matrix[36];
+    };
+    static_assert(sizeof(HBLSegment) == 312, "Unexpected HBL segment record layout");
   }  // namespace io
 }  // namespace hector
 
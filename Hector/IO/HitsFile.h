@@ -0,0 +1,188 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef Hector_IO_HitsFile_h
+#define Hector_IO_HitsFile_h
+
+#include <array>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Hector/IO/HitsFileStructures.h"
+#include "Hector/Utils/MappedFile.h"
+
+namespace hector {
+  class ParticlesBatch;
+  namespace io {
+    /// State of a particle reaching (or lost before) a scoring station
+    struct Hit {
+      unsigned long long particle{0};  ///< Particle identifier
+      unsigned int station{0};         ///< Index of the scoring station
+      int loss_element{-1};            ///< Index of the stopping element in the file names table (-1 if none)
+      double x0{0.}, theta_x0{0.};     ///< Initial horizontal position (in m) and angle (in rad)
+      double y0{0.}, theta_y0{0.};     ///< Initial vertical position (in m) and angle (in rad)
+      double energy0{0.};              ///< Initial energy (in GeV)
+      double x{0.}, theta_x{0.};       ///< Horizontal position (in m) and angle (in rad) at the station (or loss point)
+      double y{0.}, theta_y{0.};       ///< Vertical position (in m) and angle (in rad) at the station (or loss point)
+    };
+
+    /// Columnar view of a chunk of station hits
+    /// \note Uncompressed columns point directly to the file content, and are only valid as long as the reader is.
+    class HitsChunk {
+    public:
+      HitsChunk() = default;
+      HitsChunk(HitsChunk&&) = default;
+      HitsChunk& operator=(HitsChunk&&) = default;
+      HitsChunk(const HitsChunk&) = delete;
+      HitsChunk& operator=(const HitsChunk&) = delete;
+
+      /// Number of hits in the chunk
+      size_t size() const { return num_hits_; }
+      /// Particles identifiers
+      const unsigned long long* particles() const {
+        return static_cast<const unsigned long long*>(columns_[hitParticle]);
+      }
+      /// Scoring stations indices
+      const unsigned int* stations() const { return static_cast<const unsigned int*>(columns_[hitStation]); }
+      /// Indices of the elements stopping the particles (-1 if none)
+      const int* lossElements() const { return static_cast<const int*>(columns_[hitLossElement]); }
+      /// Content of a floating point column (initial or final kinematics)
+      const double* values(HitsColumn col) const { return static_cast<const double*>(columns_.at(col)); }
+      /// Build a hit record from all columns
+      Hit hit(size_t i) const;
+
+    private:
+      friend class HitsReader;
+      /// Number of hits in the chunk
+      size_t num_hits_{0};
+      /// First value of each column
+      std::array<const void*, numHitsColumns> columns_{};
+      /// Decoded content of the compressed columns
+      std::vector<std::vector<unsigned long long> > buffers_;
+    };
+
+    /// Streaming writer of station hits into a chunked columnar binary file
+    /// \note Hits are buffered until a chunk is full, then each column is written (and optionally compressed)
+    ///  separately. Only the chunks offsets and the loss elements names are kept in memory, so that arbitrarily large
+    ///  samples can be dumped.
+    class HitsWriter {
+    public:
+      /// Open a hits file for writing
+      /// \param[in] filename Path to the output file
+      /// \param[in] stations Longitudinal positions of the scoring stations (in m)
+      /// \param[in] compress Deflate the columns content (if zlib is available)
+      /// \param[in] chunk_size Number of hits per chunk
+      explicit HitsWriter(const std::string& filename,
+                          const std::vector<double>& stations = {},
+                          bool compress = false,
+                          size_t chunk_size = 65536);
+      HitsWriter(const HitsWriter&) = delete;
+      HitsWriter& operator=(const HitsWriter&) = delete;
+      /// Complete and close the file if not yet done ; failures are logged, never thrown
+      ~HitsWriter();
+
+      /// Add a single hit
+      void add(const Hit&);
+      /// Add the hits of a batch of particles propagated to a scoring station
+      /// \param[in] station Index of the scoring station
+      /// \param[in] first_particle Identifier of the first particle of the batch (next ones are numbered consecutively)
+      /// \param[in] initial Particles before the propagation
+      /// \param[in] final Same particles, once propagated to the station
+      void add(unsigned int station,
+               unsigned long long first_particle,
+               const ParticlesBatch& initial,
+               const ParticlesBatch& final);
+      /// Index of a loss element in the names table, registered if not yet known
+      int lossElement(const std::string& name);
+      /// Number of hits written so far
+      size_t size() const { return num_hits_; }
+
+      /// Write the last chunk and the footer, and close the file
+      void close();
+
+    private:
+      /// Write all buffered hits as a new chunk
+      /// \return Has the chunk been successfully written?
+      bool flush();
+      /// Write the last chunk and the footer, and close the file
+      /// \return Has the file been successfully completed?
+      bool finish();
+
+      std::ofstream file_;
+      /// Longitudinal positions of the scoring stations (in m)
+      std::vector<double> stations_;
+      /// Encoding of the columns content
+      HitsCodec codec_;
+      /// Number of hits per chunk
+      size_t chunk_size_;
+      /// Number of hits written (or buffered) so far
+      size_t num_hits_{0};
+      /// Buffered content of each column
+      std::array<std::vector<char>, numHitsColumns> columns_;
+      /// Offset of each chunk in the file
+      std::vector<uint64_t> chunks_;
+      /// Loss elements names, in the names table order
+      std::vector<std::string> names_;
+      /// Index of each loss element name in the names table
+      std::unordered_map<std::string, int> names_ids_;
+      /// Reordered bytes of the column being encoded
+      std::vector<char> shuffled_;
+      /// Encoded content of each column
+      std::array<std::vector<char>, numHitsColumns> encoded_;
+    };
+
+    /// Reader of the station hits files, scanning the memory-mapped chunks
+    class HitsReader {
+    public:
+      /// Open and index a hits file
+      explicit HitsReader(const std::string& filename);
+
+      /// Total number of hits in the file
+      size_t size() const { return num_hits_; }
+      /// Number of chunks in the file
+      size_t numChunks() const { return chunks_.size(); }
+      /// Longitudinal positions of the scoring stations (in m)
+      const std::vector<double>& stations() const { return stations_; }
+      /// Names of the elements stopping the particles, indexed as in the hits
+      const std::vector<std::string>& lossElements() const { return names_; }
+
+      /// Columnar view of a chunk (decompressed if needed)
+      HitsChunk chunk(size_t i) const;
+      /// Call a function on all chunks, in the file order
+      void scan(const std::function<void(const HitsChunk&)>&) const;
+      /// Retrieve all hits in the file
+      std::vector<Hit> read() const;
+
+    private:
+      MappedFile file_;
+      /// Total number of hits in the file
+      size_t num_hits_{0};
+      /// Offset of each chunk in the file
+      std::vector<uint64_t> chunks_;
+      /// Longitudinal positions of the scoring stations (in m)
+      std::vector<double> stations_;
+      /// Loss elements names
+      std::vector<std::string> names_;
+    };
+  }  // namespace io
+}  // namespace hector
+
+#endif
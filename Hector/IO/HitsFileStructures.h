@@ -0,0 +1,126 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef Hector_IO_HitsFileStructures_h
+#define Hector_IO_HitsFileStructures_h
+
+#include <cstdint>
+
+namespace hector {
+  namespace io {
+    /// Columns stored in the station hits files, in their order in each chunk
+    enum HitsColumn : uint32_t {
+      hitParticle,     ///< Particle identifier (64-bit unsigned integer)
+      hitStation,      ///< Index of the scoring station (32-bit unsigned integer)
+      hitLossElement,  ///< Index of the element stopping the particle in the names table (32-bit integer, -1 if none)
+      hitX0,           ///< Initial horizontal position (in m)
+      hitThetaX0,      ///< Initial horizontal angle (in rad)
+      hitY0,           ///< Initial vertical position (in m)
+      hitThetaY0,      ///< Initial vertical angle (in rad)
+      hitEnergy0,      ///< Initial energy (in GeV)
+      hitX,            ///< Horizontal position at the station (in m)
+      hitThetaX,       ///< Horizontal angle at the station (in rad)
+      hitY,            ///< Vertical position at the station (in m)
+      hitThetaY,       ///< Vertical angle at the station (in rad)
+      numHitsColumns
+    };
+    /// Size of one value of each column, in bytes
+    constexpr uint32_t hits_column_size[numHitsColumns] = {8, 4, 4, 8, 8, 8, 8, 8, 8, 8, 8, 8};
+
+    /// Encoding of a column content in a chunk
+    enum HitsCodec : uint32_t {
+      hitsRaw = 0,      ///< Values stored as they are in memory
+      hitsDeflate = 1,  ///< Bytes of all values grouped by significance, then deflated (zlib)
+    };
+
+    /// Header of the station hits files, followed by the chunks, the footer and the trailer
+    /// \version 1.0.0
+    /// \note All fields have a fixed width and are stored little-endian at their natural alignment. Each column of a
+    ///  chunk starts on an 8-byte boundary, so that uncompressed columns can be used in place from a memory-mapped
+    ///  file.
+    struct HitsFileHeader {
+      /// Hits file magic number ('HHITS')
+      uint64_t magic;
+      /// Hits file version
+      uint16_t version;
+      /// Size of this header, in bytes
+      uint16_t header_size;
+      /// Byte order marker, as written by the producing host (0x01020304)
+      uint32_t byte_order;
+      /// Number of columns in each chunk
+      uint32_t num_columns;
+      /// Maximal number of hits in a chunk
+      uint32_t chunk_size;
+      /// Encoding requested for the columns (some chunks may still be stored raw if not compressible)
+      uint32_t codec;
+      /// Padding
+      uint32_t reserved;
+    };
+    static_assert(sizeof(HitsFileHeader) == 32, "Unexpected hits file header layout");
+
+    /// A column as stored in a chunk
+    struct HitsColumnRecord {
+      /// Offset of the column content from the chunk header, in bytes
+      uint64_t offset;
+      /// Size of the stored column content, in bytes
+      uint64_t stored_size;
+      /// Encoding of the column content
+      uint32_t codec;
+      /// Padding
+      uint32_t reserved;
+    };
+    static_assert(sizeof(HitsColumnRecord) == 24, "Unexpected hits column record layout");
+
+    /// Header of a chunk of hits, followed by the content of all its columns
+    struct HitsChunkHeader {
+      /// Number of hits in the chunk
+      uint64_t num_hits;
+      /// Total size of the chunk (header included), in bytes
+      uint64_t chunk_size;
+      /// Location and encoding of each column
+      HitsColumnRecord columns[numHitsColumns];
+    };
+    static_assert(sizeof(HitsChunkHeader) == 16 + 24 * numHitsColumns, "Unexpected hits chunk header layout");
+
+    /// Footer of the station hits files, followed by the chunks offsets, the stations positions and the names table
+    struct HitsFileFooter {
+      /// Total number of hits in the file
+      uint64_t num_hits;
+      /// Number of chunks
+      uint64_t num_chunks;
+      /// Number of scoring stations
+      uint64_t num_stations;
+      /// Number of loss elements in the names table
+      uint64_t num_loss_elements;
+      /// Size of the names table (null-terminated names), in bytes
+      uint64_t names_size;
+    };
+    static_assert(sizeof(HitsFileFooter) == 40, "Unexpected hits file footer layout");
+
+    /// Last bytes of the station hits files, locating the footer
+    struct HitsFileTrailer {
+      /// Offset of the footer in the file, in bytes
+      uint64_t footer_offset;
+      /// Hits file magic number (as in the header), to detect truncated files
+      uint64_t magic;
+    };
+    static_assert(sizeof(HitsFileTrailer) == 16, "Unexpected hits file trailer layout");
+  }  // namespace io
+}  // namespace hector
+
+#endif
@@ -19,14 +19,17 @@
 #ifndef Hector_IO_TwissHandler_h
 #define Hector_IO_TwissHandler_h
 
-#include <fstream>
 #include <memory>
-#include <regex>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "Hector/Apertures/ApertureType.h"
 #include "Hector/Elements/ElementFwd.h"
 #include "Hector/Elements/ElementType.h"
+#include "Hector/PropagationContext.h"
+#include "Hector/Utils/Algebra.h"
+#include "Hector/Utils/MappedFile.h"
 #include "Hector/Utils/OrderedParametersMap.h"
 #include "Hector/Utils/UnorderedParametersMap.h"
 
@@ -37,6 +40,15 @@ namespace hector {
   namespace io {
     /// Parsing tool for MAD-X Twiss output files
     /// \note A list of variables stored in Twiss files can be retrieved from http://mad.web.cern.ch/mad/madx.old/Introduction/tables.html
+    /// \note The file is memory-mapped and its element lines are tokenised in place. Only the columns needed to build
+    ///  the beamline elements are converted, through indices bound once from the columns header.
+    /// \note Large files may be parsed on several threads (see Parameters::twissParsingThreads). The element lines
+    ///  are then split into chunks, converted concurrently, and merged in their file order, so that the beamline is
+    ///  identical to the one obtained from a serial parsing.
+    /// \note If a cache directory is set in the run parameters, the header and the raw and sequenced beamlines are
+    ///  stored there as a compiled image, keyed by the file content, the parsing options, and the HBL format version.
+    ///  Later parsings of the same file with the same options are then loaded from this image, unless it is found
+    ///  corrupted, in which case the file is parsed again and the image rewritten.
     class Twiss {
     public:
       /// Class constructor
@@ -44,7 +56,7 @@ namespace hector {
       /// \param[in] ip_name Name of the interaction point
       /// \param[in] min_s Minimal s-coordinate from which the Twiss file must be parsed
       /// \param[in] max_s Maximal s-coordinate at which the Twiss file must be parsed
-      Twiss(std::string filename, std::string ip_name, float max_s = -1., float min_s = 0.);
+      Twiss(std::string filename, std::string ip_name, double max_s = -1., double min_s = 0.);
       /// Copy constructor (without the beamline)
       Twiss(const Twiss&);
       /// Copy constructor
@@ -57,7 +69,7 @@ namespace hector {
       Beamline* rawBeamline() const { return raw_beamline_.get(); }
 
       /// Get a Hector element type from a Twiss element name string
-      static element::Type findElementTypeByName(std::string name);
+      static element::Type findElementTypeByName(std::string_view name);
       /// Get a Hector element type from a Twiss element keyword string
       static element::Type findElementTypeByKeyword(std::string keyword);
       /// Get a Hector element aperture type from a Twiss element apertype string
@@ -68,42 +80,116 @@ namespace hector {
       /// List of all string variables parsed from the Twiss file
       std::map<std::string, std::string> headerStrings() const;
       /// List of all floating-point variables parsed from the Twiss file
-      std::map<std::string, float> headerFloats() const;
+      std::map<std::string, double> headerFloats() const;
+      /// Propagation context matching the beam properties stored in the Twiss file header
+      /// \param[in] ctx Context providing the run switches and any beam property absent from the header
+      PropagationContext context(const PropagationContext& ctx = PropagationContext()) const;
+      /// Copy the beam properties stored in the Twiss file header into the run parameters
+      /// \note The parser never modifies the run parameters by itself, so that several optics may be used side by
+      ///  side. This explicit opt-in is only meant for tools relying on the global run parameters.
+      void applyHeaderParameters() const;
 
     private:
-      /// A collection of values to be propagated through this parser
-      typedef std::vector<std::string> ValuesCollection;
+      /// A collection of values to be propagated through this parser (views on the file content, without quotes)
+      typedef std::vector<std::string_view> ValuesCollection;
       /// Type of content stored in the parameters map
       enum ValueType : short { Unknown = -1, String, Float, Integer };
       /// Human-readable printout of a value type
       friend std::ostream& operator<<(std::ostream&, const ValueType&);
+      /// Position of the element columns used to build the beamline (negative if absent from the file)
+      struct Columns {
+        int name{-1}, keyword{-1}, s{-1}, l{-1};
+        int k0l{-1}, k1l{-1}, hkick{-1}, vkick{-1};
+        int x{-1}, y{-1}, dx{-1}, dy{-1}, betx{-1}, bety{-1};
+        int apertype{-1}, aper_1{-1}, aper_2{-1}, aper_3{-1}, aper_4{-1};
+      };
+
+      /// Compact description of an element line, as needed to build a beamline element
+      struct Record {
+        std::string_view name;         ///< Element name (view on the file content)
+        element::Type type;            ///< Element type
+        double s;                      ///< Longitudinal position, before its offset to the interaction point (in m)
+        double length;                 ///< Element length (in m)
+        double strength;               ///< Integrated strength (k0l, k1l) or kick, depending on the element type
+        TwoVector position;            ///< Relative position of the element
+        TwoVector dispersion;          ///< Dispersion at the element
+        TwoVector beta;                ///< Beta functions at the element
+        aperture::Type aperture_type;  ///< Aperture type
+        double aperture[4];            ///< Aperture parameters (in m)
+      };
 
       void parseHeader();
+      /// An element line converted ahead of the beamline building, e.g. on a worker thread
+      struct Line {
+        /// Outcome of the line conversion
+        enum Status : short {
+          Failed,    ///< Invalid line, to be parsed again on the building thread to report the error
+          Skipped,   ///< Line most likely outside the beamline, only converted on the building thread if needed
+          Ignored,   ///< No element can be built from this line
+          Converted  ///< Line converted into a record
+        };
+        size_t pos;             ///< Offset of the line in the file content
+        Status status;          ///< Outcome of the line conversion
+        bool has_s;             ///< Was the longitudinal position successfully converted?
+        double s;               ///< Longitudinal position (in m)
+        std::string_view name;  ///< Element name (view on the file content)
+        Record record;          ///< Element record, if converted
+      };
+      /// Element lines read and converted one at a time, while the beamline is built
+      class SerialLines;
+      /// Element lines converted beforehand, by chunks on several threads
+      class ConvertedLines;
+
       void parseElementsFields();
+      /// Parse all element lines in a single pass, and build the raw beamline
+      /// \note The position of the lines preceding the interaction point is kept until the latter is found. Only the
+      ///  lines then found to belong to the beamline are converted.
       void parseElements();
-      void findInteractionPoint();
-      element::ElementPtr parseElement(const ValuesCollection&);
+      /// Build the raw beamline from a sequence of element lines
+      template <typename T>
+      void addElements(T& lines);
+      /// Convert all element lines starting in a range of the file content
+      /// \param[in] s_min Minimal longitudinal position of the lines to be converted into records
+      /// \param[in] s_max Maximal longitudinal position of the lines to be converted into records
+      void convertLines(size_t begin, size_t end, double s_min, double s_max, std::vector<Line>& lines) const;
+      /// Split the next non-empty element line into its values
+      /// \param[inout] pos Offset of the line in the file content, moved to the following line
+      /// \return False if the end of the file is reached
+      bool nextElement(size_t& pos, ValuesCollection& values) const;
+      /// Convert the values of an element line into a record
+      /// \param[out] valid If set, a conversion failure is reported here instead of raising an exception
+      /// \return False if no element can be built from this line
+      bool parseRecord(const ValuesCollection&, Record&, bool* valid = nullptr) const;
+      /// Build a beamline element from its record
+      element::ElementPtr buildElement(const Record&) const;
+      /// Numerical value of an element column
+      /// \param[out] valid If set, a conversion failure is reported here instead of raising an exception
+      double value(const ValuesCollection&, int column, const char* column_name, bool* valid = nullptr) const;
+
+      /// Unique description of the file content and of the parsing options, used as a cache key
+      std::string cacheKey(double max_s) const;
+      /// Retrieve the header and beamlines from a cache image
+      /// \return False if the image does not exist, does not match the key, or is corrupted
+      bool loadCache(const std::string& path, const std::string& key);
+      /// Store the header and beamlines into a cache image
+      void writeCache(const std::string& path, const std::string& key) const;
 
       pmap::Ordered<std::string> header_str_;
-      pmap::Ordered<float> header_float_;
+      pmap::Ordered<double> header_float_;
 
       pmap::Unordered<ValueType> elements_fields_;
 
-      std::ifstream in_file_;
-      std::streampos in_file_lastline_;
+      Columns columns_;
+
+      MappedFile in_file_;
+      size_t in_file_lastline_;
 
       std::unique_ptr<Beamline> beamline_;
       std::unique_ptr<Beamline> raw_beamline_;
       element::ElementPtr interaction_point_;
 
       std::string ip_name_;
-      float min_s_;
-
-      static std::regex rgx_typ_, rgx_hdr_, rgx_elm_hdr_;
-      static std::regex rgx_drift_name_, rgx_ip_name_, rgx_monitor_name_;
-      static std::regex rgx_quadrup_name_;
-      static std::regex rgx_sect_dipole_name_, rgx_rect_dipole_name_;
-      static std::regex rgx_rect_coll_name_;
+      double min_s_;
     };
   }  // namespace io
 }  // namespace hector
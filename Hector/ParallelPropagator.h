@@ -0,0 +1,95 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef Hector_ParallelPropagator_h
+#define Hector_ParallelPropagator_h
+
+#include <functional>
+#include <memory>
+
+#include "Hector/Propagator.h"
+
+namespace hector {
+  /// Propagator distributing a collection of particles among a pool of worker threads
+  /// \note Particles are split into chunks, each worker processing its own chunks before stealing the ones of
+  ///  busier workers. The worker threads are spawned once, and reused by all propagations of this object (and of its
+  ///  copies, one propagation at a time). As each particle is propagated independently, and transfer matrices are
+  ///  cached for the exact kinematics they were computed for, its trajectory is identical to the one obtained in a
+  ///  serial propagation, whatever the number of threads.
+  class ParallelPropagator : public Propagator {
+  public:
+    /// Construct the object for a given beamline
+    /// \param[in] num_threads Number of worker threads (0 to use all hardware threads)
+    /// \param[in] chunk_size Number of consecutive particles in a unit of work
+    /// \param[in] ctx Beam properties and run switches (snapshot of the current run parameters if not specified)
+    explicit ParallelPropagator(const Beamline* bl,
+                                unsigned short num_threads = 0,
+                                size_t chunk_size = 64,
+                                const PropagationContext& ctx = PropagationContext());
+
+    using Propagator::propagate;
+    /// Propagate a list of particles up to a given position ; maps all state vectors to the intermediate s-coordinates
+    /// \note Particles stopped in the beamline are flagged (see Particle::stopped) instead of interrupting the
+    ///  propagation of the collection
+    /// \return Number of particles stopped in the beamline
+    size_t propagate(Particles&, double s_max) const;
+    /// Propagate particles given as an array of initial states, and extract their states at a list of stations
+    /// \param[in] num_part Number of particles
+    /// \param[in] states Initial state vectors (x, Tx, y, Ty, E, kick) at s = 0, as a row-major (num_part, 6) array
+    /// \param[in] masses Particles masses (in GeV/c2), or the beam particles mass for all particles if null
+    /// \param[in] charges Particles charges (in e), or the beam particles charge for all particles if null
+    /// \param[in] stations Longitudinal positions at which the particles states are extracted (in m)
+    /// \param[out] stations_states States at each station, as a row-major (num_part, stations, 6) array ; filled
+    ///  with NaN for the stations not reached by a particle
+    /// \param[out] losses Index of the element stopping each particle in the beamline (-1 if none)
+    /// \note As this method only works on plain arrays and does not allocate any object shared with the caller, it
+    ///  may be run while the caller (e.g. the Python interpreter) is doing something else.
+    /// \return Number of particles stopped in the beamline
+    size_t propagate(size_t num_part,
+                     const double* states,
+                     const double* masses,
+                     const int* charges,
+                     const std::vector<double>& stations,
+                     double* stations_states,
+                     int* losses) const;
+
+    /// Set the number of worker threads (0 to use all hardware threads)
+    void setNumThreads(unsigned short num_threads);
+    /// Number of worker threads
+    unsigned short numThreads() const { return num_threads_; }
+    /// Set the number of consecutive particles in a unit of work
+    void setChunkSize(size_t chunk_size);
+    /// Number of consecutive particles in a unit of work
+    size_t chunkSize() const { return chunk_size_; }
+
+  private:
+    /// Distribute ranges of items among the worker threads
+    /// \param[in] num_items Number of items to be processed
+    /// \param[in] process Processing of the items in a range [begin, end), returning the number of stopped particles
+    /// \return Total number of particles stopped
+    size_t dispatch(size_t num_items, const std::function<size_t(size_t, size_t)>& process) const;
+
+    class WorkerPool;
+
+    unsigned short num_threads_;
+    size_t chunk_size_;
+    std::shared_ptr<WorkerPool> pool_;
+  };
+}  // namespace hector
+
+#endif
@@ -20,6 +20,7 @@
 #define Hector_Parameters_h
 
 #include <memory>
+#include <string>
 
 #include "Hector/ExceptionType.h"
 
@@ -37,14 +38,14 @@ namespace hector {
     Parameters();
 
     /// Energy of the primary particles in the beam (in GeV)
-    float beamEnergy() const { return beam_energy_; }
+    double beamEnergy() const { return beam_energy_; }
     /// Set the primary particles energy (in GeV)
-    void setBeamEnergy(float be) { beam_energy_ = be; }
+    void setBeamEnergy(double be) { beam_energy_ = be; }
 
     /// Mass of the primary particles in the beam (in GeV/c2)
-    float beamParticlesMass() const { return beam_particles_mass_; }
+    double beamParticlesMass() const { return beam_particles_mass_; }
     /// Set the primary particles mass (in GeV/c2)
-    void setBeamParticlesMass(float m) { beam_particles_mass_ = m; }
+    void setBeamParticlesMass(double m) { beam_particles_mass_ = m; }
 
     /// Electric charge of the primary particles in the beam (in e)
     int beamParticlesCharge() const { return beam_particles_charge_; }
@@ -77,9 +78,20 @@ namespace hector {
     bool enableDipoles() const { return enable_dipoles_; }
     void setEnableDipoles(bool dip) { enable_dipoles_ = dip; }
 
+    /// Directory where the beamlines parsed from Twiss files are cached (disabled if empty)
+    /// \note Initialised from the HECTOR_TWISS_CACHE environment variable, if set.
+    const std::string& twissCacheDirectory() const { return twiss_cache_dir_; }
+    /// Set the directory where the beamlines parsed from Twiss files are cached (empty to disable the cache)
+    void setTwissCacheDirectory(const std::string& dir) { twiss_cache_dir_ = dir; }
+    /// Number of threads used to parse the elements of large Twiss files (0 to use all hardware threads)
+    /// \note Initialised from the HECTOR_TWISS_THREADS environment variable, if set, or to 1 (serial parsing).
+    unsigned short twissParsingThreads() const { return twiss_parsing_threads_; }
+    /// Set the number of threads used to parse the elements of large Twiss files (0 to use all hardware threads)
+    void setTwissParsingThreads(unsigned short num_threads) { twiss_parsing_threads_ = num_threads; }
+
   private:
-    float beam_energy_;
-    float beam_particles_mass_;
+    double beam_energy_;
+    double beam_particles_mass_;
     int beam_particles_charge_;
     ExceptionType logging_threshold_;
     bool use_relative_energy_;
@@ -87,6 +99,8 @@ namespace hector {
     bool compute_aperture_acceptance_;
     bool enable_kickers_;
     bool enable_dipoles_;
+    std::string twiss_cache_dir_;
+    unsigned short twiss_parsing_threads_;
   };
 }  // namespace hector
 
@@ -20,17 +20,17 @@
 #define Hector_Particle_h
 
 #include <iosfwd>
-#include <map>
 #include <vector>
 
 #include "Hector/Utils/StateVector.h"
+#include "Hector/Utils/Trajectory.h"
 
 namespace hector {
   /// Generic particle model inserted in a beam
   class Particle {
   public:
-    /// Particle trajectory holder ; map of state vectors indexed to the s-position
-    typedef std::map<double, StateVector> PositionsMap;
+    /// Particle trajectory holder ; sorted collection of state vectors indexed to the s-position
+    typedef Trajectory PositionsMap;
     /// Pair of s-position and state vector defining the particle kinematics
     class Position : private std::pair<double, StateVector> {
     public:
@@ -51,23 +51,27 @@ namespace hector {
     };
 
   public:
+    /// Build a beam particle at the origin, for the current run parameters
     Particle();
+    /// Build a beam particle at the origin
+    /// \param[in] ctx Propagation context giving the particle energy, mass, and charge
+    explicit Particle(const PropagationContext& ctx);
     /// Construct a particle according to its first state vector/s-position couple
     /// \param[in] sv0 State vector at initial position \a s0
     /// \param[in] s0 Longitudinal initial position (in m)
     Particle(const StateVector& sv0, double s0 = 0.);
     /// Construct a particle according to its first state vector's 4-momentum
     /// \param[in] mom Initial 4-momentum
-    /// \param[in] charge Electric charge (in units of e)
+    /// \param[in] charge Electric charge (in units of e), or 0 for the beam particles charge of the propagation context
     /// \param[in] pdgid PDG id
-    Particle(const LorentzVector& mom, int charge = 999, int pdgid = 2212);
+    Particle(const LorentzVector& mom, int charge = 0, int pdgid = 2212);
     ~Particle();
 
     /// Build a Particle object from a mass and electric charge
     static Particle fromMassCharge(double mass, int charge);
 
     /// Clear all state vectors (but the initial one)
-    void clear() { positions_.erase(++begin(), end()); }
+    void clear() { positions_.erase(begin() + 1, end()); }
     /// Add a new s-position/state vector couple to the particle's trajectory
     /// \param[in] stopped Has the particle been stopped in the process?
     void addPosition(double s, const StateVector& vec, bool stopped = false) { addPosition(Position(s, vec), stopped); }
@@ -77,7 +81,7 @@ namespace hector {
 
     /// Set the electric charge (in units of e)
     void setCharge(int ch) { charge_ = ch; }
-    /// Electric charge (in units of e)
+    /// Electric charge (in units of e), or 0 for the beam particles charge of the propagation context
     int charge() const { return charge_; }
 
     /// Set the particle's PDG id
@@ -93,6 +97,11 @@ namespace hector {
     /// Reasonable kinematics for the particle?
     bool physical() const { return physical_; }
 
+    /// Set if the particle has been stopped in the beamline
+    void setStopped(bool stopped) { stopped_ = stopped; }
+    /// Has the particle been stopped in the beamline?
+    bool stopped() const { return stopped_; }
+
     /// Print all useful information about a particle
     void dump(std::ostream& os) const;
 
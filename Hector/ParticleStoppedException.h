@@ -40,12 +40,19 @@ namespace hector {
         message_ << " at " << elem->name() << " (" << elem->type() << ")";
       message_ << ".\n";
     }
+    /// Generic templated message feeder operator (preserving the exception type when thrown)
+    template <typename T>
+    inline friend const ParticleStoppedException& operator<<(const ParticleStoppedException& exc, T var) {
+      ParticleStoppedException& nc_except = const_cast<ParticleStoppedException&>(exc);
+      nc_except.message_ << var;
+      return exc;
+    }
     /// Retrieve the beamline element that stopped the particle
     const element::ElementPtr& stoppingElement() const { return elem_; }
 
   private:
     /// Beamline element that stopped the particle
-    const element::ElementPtr& elem_;
+    element::ElementPtr elem_;
   };
 }  // namespace hector
 
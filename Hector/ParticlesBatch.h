@@ -0,0 +1,105 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef Hector_ParticlesBatch_h
+#define Hector_ParticlesBatch_h
+
+#include <vector>
+
+#include "Hector/Elements/ElementFwd.h"
+#include "Hector/Particle.h"
+
+namespace hector {
+  /// Collection of particles propagated together through a beamline
+  /// \note State vectors are stored as a structure of arrays (one column per particle), allowing each element
+  ///  transfer matrix to be applied to all particles sharing the same kinematics in a single matrix product.
+  class ParticlesBatch {
+  public:
+    /// Block of 6-dimensional state vectors, one column per particle
+    typedef Eigen::Matrix<double, 6, Eigen::Dynamic> StatesBlock;
+
+  public:
+    /// Build an empty batch of particles
+    /// \param[in] s0 Longitudinal initial position of all particles (in m)
+    explicit ParticlesBatch(double s0 = 0.);
+    /// Build a batch from the initial state of a collection of particles
+    /// \note All particles are assumed to start from the s-position of the first one
+    explicit ParticlesBatch(const Particles&);
+
+    /// Add a new particle to the batch
+    /// \param[in] sv Initial state vector
+    /// \param[in] charge Electric charge (in units of e)
+    void add(const StateVector& sv, int charge);
+    /// Reserve the memory for a given number of particles
+    void reserve(size_t num_part);
+    /// Number of particles in the batch
+    size_t size() const { return masses_.size(); }
+    /// Number of particles not yet stopped in the beamline
+    size_t numAlive() const;
+
+    /// Set the longitudinal position of all particles (in m)
+    void setS(double s) { s_ = s; }
+    /// Longitudinal position of all particles still alive (in m)
+    double s() const { return s_; }
+
+    /// Block of state vectors for all particles
+    Eigen::Map<const StatesBlock> states() const { return Eigen::Map<const StatesBlock>(states_.data(), 6, size()); }
+    /// Block of state vectors for all particles
+    Eigen::Map<StatesBlock> states() { return Eigen::Map<StatesBlock>(states_.data(), 6, size()); }
+    /// State vector of a particle
+    /// \note For stopped particles, this is the state at the entrance or exit of the stopping element
+    StateVector stateVector(size_t i) const;
+    /// Mass of a particle (in GeV/c2)
+    double mass(size_t i) const { return masses_.at(i); }
+    /// Electric charge of a particle (in units of e)
+    int charge(size_t i) const { return charges_.at(i); }
+
+    /// Flag a particle as stopped in the beamline
+    /// \param[in] i Particle index
+    /// \param[in] elem Element stopping the particle
+    /// \param[in] s Longitudinal position at which the particle was stopped (in m)
+    void stop(size_t i, const element::ElementPtr& elem, double s);
+    /// Has a particle been stopped in the beamline?
+    bool stopped(size_t i) const { return stopping_elements_.at(i) != nullptr; }
+    /// Element stopping a particle (if any)
+    const element::ElementPtr& stoppingElement(size_t i) const { return stopping_elements_.at(i); }
+    /// Longitudinal position at which a particle was stopped (in m)
+    double stoppingS(size_t i) const { return stopping_s_.at(i); }
+    /// Mark all particles as alive
+    void resetStops();
+
+    /// Build a particle object from its current state in the batch
+    Particle particle(size_t i) const;
+
+  private:
+    /// Longitudinal position of all particles still alive
+    double s_;
+    /// State vectors for all particles (6 consecutive components per particle)
+    std::vector<double> states_;
+    /// Particles masses
+    std::vector<double> masses_;
+    /// Particles electric charges
+    std::vector<int> charges_;
+    /// Elements stopping the particles (null for particles still alive)
+    std::vector<element::ElementPtr> stopping_elements_;
+    /// Longitudinal positions at which the particles were stopped
+    std::vector<double> stopping_s_;
+  };
+}  // namespace hector
+
+#endif
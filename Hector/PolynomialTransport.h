@@ -0,0 +1,101 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef Hector_PolynomialTransport_h
+#define Hector_PolynomialTransport_h
+
+#include <atomic>
+
+#include "Hector/Propagator.h"
+
+namespace hector {
+  /// Parametric transport of particles from their initial state to a station
+  /// \note The transverse coordinates at the station are modelled as linear functions of the initial positions and
+  ///  angles, whose coefficients are polynomials in the momentum loss \f$ \xi \f$. They are fitted on a sweep of
+  ///  particles propagated with the exact propagator, and validated on an independent sample.
+  /// \warning The aperture acceptance is not modelled. Particles outside the fitted domain (including the ones whose
+  ///  mass or charge differ from the beam particles ones) are propagated with the exact propagator, and may be
+  ///  stopped in the beamline.
+  class PolynomialTransport {
+  public:
+    /// Range of initial coordinates over which the polynomials are fitted
+    struct Domain {
+      TwoVector pos_min;    ///< Minimal horizontal and vertical positions (in m)
+      TwoVector pos_max;    ///< Maximal horizontal and vertical positions (in m)
+      TwoVector ang_min;    ///< Minimal horizontal and vertical angles (in rad)
+      TwoVector ang_max;    ///< Maximal horizontal and vertical angles (in rad)
+      double xi_min = 0.;   ///< Minimal momentum loss
+      double xi_max = 0.2;  ///< Maximal momentum loss
+    };
+
+  public:
+    /// Fit the transport to a station
+    /// \param[in] prop Exact propagator, used for the training sweep and the fallback
+    /// \param[in] s_station Longitudinal position of the station (in m)
+    /// \param[in] domain Range of initial coordinates (particles starting at s = 0)
+    /// \param[in] xi_order Order of the polynomials in momentum loss
+    /// \param[in] num_training Number of particles in the training sweep
+    PolynomialTransport(const Propagator& prop,
+                        double s_station,
+                        const Domain& domain,
+                        unsigned short xi_order = 4,
+                        size_t num_training = 2000);
+
+    /// Longitudinal position of the station (in m)
+    double station() const { return s_station_; }
+    /// Range of initial coordinates over which the polynomials are fitted
+    const Domain& domain() const { return domain_; }
+    /// Maximal absolute deviation from the exact propagation on the validation sample, for each component
+    const Vector& errorBound() const { return error_bound_; }
+
+    /// Is an initial state inside the fitted domain?
+    /// \note The polynomials are only fitted for the beam particles mass and charge of the propagation context
+    /// \param[in] charge Particle charge (in e), or the beam particles charge if 0
+    bool contains(const StateVector&, int charge = 0) const;
+    /// Evaluate the state vector at the station for a given initial state
+    /// \note No check is performed on the fitted domain
+    StateVector transport(const StateVector&) const;
+    /// Add the state vector at the station to a particle trajectory
+    /// \note Particles outside the fitted domain are propagated with the exact propagator
+    void propagate(Particle&) const;
+    /// Number of particles propagated with the exact propagator for being outside the fitted domain
+    unsigned long long numFallbacks() const { return num_fallbacks_; }
+
+    /// Maximal order of the polynomials in momentum loss
+    static constexpr unsigned short max_xi_order = 10;
+
+  private:
+    /// Number of initial coordinates multiplied by the polynomials in momentum loss (constant, x, x', y, y')
+    static constexpr unsigned short num_terms = 5;
+    /// Monomials of the initial coordinates, with a capacity fixed at compile time to avoid any heap allocation
+    typedef Eigen::Matrix<double, 1, Eigen::Dynamic, Eigen::RowMajor, 1, num_terms*(max_xi_order + 1)> Basis;
+    /// Compute the basis of monomials for a given initial state
+    Basis basis(const StateVector&) const;
+
+    const Propagator propagator_;
+    const double s_station_;
+    const Domain domain_;
+    const unsigned short xi_order_;
+    /// Polynomial coefficients, one column per modelled component (x, x', y, y')
+    Eigen::Matrix<double, Eigen::Dynamic, 4> coefficients_;
+    Vector error_bound_;
+    mutable std::atomic<unsigned long long> num_fallbacks_;
+  };
+}  // namespace hector
+
+#endif
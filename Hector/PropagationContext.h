@@ -0,0 +1,84 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef Hector_PropagationContext_h
+#define Hector_PropagationContext_h
+
+namespace hector {
+  class Parameters;
+  /// Immutable set of run parameters used along the propagation of particles through a beamline
+  /// \note Contrary to the Parameters singleton, several contexts (e.g. with different beam energies, or enabled
+  ///  dipoles/kickers) may be used concurrently in the same process. Modified copies are built using the
+  ///  \a with* methods.
+  class PropagationContext {
+  public:
+    /// Build a context from the current values of the run parameters
+    PropagationContext();
+    /// Build a context from a set of run parameters
+    explicit PropagationContext(const Parameters&);
+
+    /// Check if two contexts are identical
+    bool operator==(const PropagationContext&) const;
+    /// Check if two contexts are different
+    bool operator!=(const PropagationContext& oth) const { return !(*this == oth); }
+
+    /// Energy of the primary particles in the beam (in GeV)
+    double beamEnergy() const { return beam_energy_; }
+    /// Copy of this context with another energy of the primary particles (in GeV)
+    PropagationContext withBeamEnergy(double energy) const;
+    /// Mass of the primary particles in the beam (in GeV/c2)
+    double beamParticlesMass() const { return beam_particles_mass_; }
+    /// Copy of this context with another mass of the primary particles (in GeV/c2)
+    PropagationContext withBeamParticlesMass(double mass) const;
+    /// Electric charge of the primary particles in the beam (in e)
+    int beamParticlesCharge() const { return beam_particles_charge_; }
+    /// Copy of this context with another electric charge of the primary particles (in e)
+    PropagationContext withBeamParticlesCharge(int charge) const;
+
+    /// Do we use the relative energy loss in the path computation through elements?
+    bool useRelativeEnergy() const { return use_relative_energy_; }
+    /// Copy of this context with/without the relative energy loss in the path computation through elements
+    PropagationContext withRelativeEnergy(bool rel) const;
+    /// Account for the acceptance of each single element?
+    bool computeApertureAcceptance() const { return compute_aperture_acceptance_; }
+    /// Copy of this context accounting or not for the acceptance of each single element
+    PropagationContext withApertureAcceptance(bool aper) const;
+    /// Are the kickers enabled?
+    bool enableKickers() const { return enable_kickers_; }
+    /// Copy of this context with enabled/disabled kickers
+    PropagationContext withKickers(bool kck) const;
+    /// Are the dipoles enabled?
+    bool enableDipoles() const { return enable_dipoles_; }
+    /// Copy of this context with enabled/disabled dipoles
+    PropagationContext withDipoles(bool dip) const;
+
+    /// Energy loss of a particle with respect to the beam, as used in the transfer matrices computation (in GeV)
+    double energyLoss(double energy) const { return use_relative_energy_ ? beam_energy_ - energy : energy; }
+
+  private:
+    double beam_energy_;
+    double beam_particles_mass_;
+    int beam_particles_charge_;
+    bool use_relative_energy_;
+    bool compute_aperture_acceptance_;
+    bool enable_kickers_;
+    bool enable_dipoles_;
+  };
+}  // namespace hector
+
+#endif
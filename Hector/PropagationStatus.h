@@ -0,0 +1,39 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef Hector_PropagationStatus_h
+#define Hector_PropagationStatus_h
+
+#include "Hector/Utils/Algebra.h"
+
+namespace hector {
+  /// Compact outcome of the propagation of a particle through a beamline
+  struct PropagationStatus {
+    /// Has the particle been stopped in the beamline?
+    bool stopped() const { return element >= 0; }
+    /// Has the particle survived the propagation?
+    bool survived() const { return element < 0; }
+
+    int element = -1;          ///< Index of the stopping element in the beamline (negative if the particle survived)
+    bool at_entrance = false;  ///< Was the particle stopped at the entrance (or at the exit) of the element?
+    double s = 0.;             ///< Longitudinal position at which the particle was stopped (in m)
+    TwoVector position;        ///< Transverse position at which the particle was stopped (in m)
+  };
+}  // namespace hector
+
+#endif
@@ -20,30 +20,104 @@
 #define Hector_Propagator_h
 
 #include <memory>
+#include <vector>
 
+#include "Hector/Apertures/ApertureTable.h"
+#include "Hector/CompiledBeamline.h"
 #include "Hector/Elements/ElementFwd.h"
 #include "Hector/Particle.h"
+#include "Hector/PropagationContext.h"
+#include "Hector/PropagationStatus.h"
 
 namespace hector {
   class Beamline;
+  class ParticlesBatch;
   /// Main object to propagate particles through a beamline
   class Propagator {
+  public:
+    /// Policy for the recording of the particles trajectories
+    enum class Recording {
+      finalState,   ///< Only the state at the last position reached
+      stations,     ///< States at a sorted list of user-defined s-positions
+      everyElement  ///< States at the exit of all elements traversed
+    };
+
   public:
     /// Construct the object for a given beamline
-    Propagator(const Beamline* bl) : beamline_(bl) {}
+    /// \param[in] bl Beamline to propagate the particles through
+    /// \param[in] ctx Beam properties and run switches (snapshot of the current run parameters if not specified)
+    /// \note The elements apertures are captured at construction, and captured again after any beamline modification
+    Propagator(const Beamline* bl, const PropagationContext& ctx = PropagationContext());
+    Propagator(const Propagator&);
     ~Propagator() {}
 
     const Beamline* beamline() const { return beamline_; }
+    /// Beam properties and run switches used for the propagation
+    const PropagationContext& context() const { return context_; }
+    /// Apertures of all beamline elements in their current state, indexed as the elements
+    std::shared_ptr<const aperture::ApertureTable> apertures() const;
 
-    /// Propagate a particle up to a given position ; maps all state vectors to the intermediate s-coordinates
+    /// Set the policy for the recording of the particles trajectories
+    void setRecording(Recording rec) { recording_ = rec; }
+    /// Policy for the recording of the particles trajectories
+    Recording recording() const { return recording_; }
+    /// Record the particles states only at a list of s-positions (in m)
+    /// \note States inside an element are interpolated as in Particle::stateVectorAt
+    void setStations(std::vector<double> stations);
+    /// List of s-positions at which the particles states are recorded (in m)
+    const std::vector<double>& stations() const { return stations_; }
+
+    /// Propagate a particle up to a given position ; maps the state vectors according to the recording policy
+    /// \note A ParticleStoppedException is thrown if the particle is stopped by an element aperture
     void propagate(Particle&, double) const;
+    /// Propagate a particle up to a given position without raising an exception if it is stopped in the beamline
+    /// \return Propagation outcome, with the stopping element and position if the particle was lost
+    PropagationStatus tryPropagate(Particle&, double s_max) const;
     /// Check whether the particle has stopped inside a part of the beamline
     bool stopped(Particle&, double s_max = -1.) const;
 
-    /// Propagate a list of particle up to a given position ; maps all state vectors to the intermediate s-coordinates
+    /// Propagate a list of particle up to a given position ; maps the state vectors according to the recording policy
     void propagate(Particles&, double s_max) const;
+    /// Propagate a batch of particles up to a given position ; only the state vectors at the last position are kept
+    /// \note Particles stopped by an element aperture are flagged in the batch instead of raising an exception
+    /// \note The beamline is compiled once for a given range, and compiled again only if the range or the beamline
+    ///  content changes, so that the fused matrices are reused from one batch to the next
+    void propagate(ParticlesBatch&, double s_max) const;
+
+    /// Compile the beamline into fused transport segments for this propagator context
+    /// \param[in] stations Longitudinal positions (in m) at which the particles state must be available
+    /// \param[in] s_min Minimal s-coordinate of the first compiled element (in m)
+    /// \param[in] s_max Maximal s-coordinate of the last compiled element (in m), or the full beamline if negative
+    CompiledBeamline compile(const std::vector<double>& stations = {}, double s_min = 0., double s_max = -1.) const;
+    /// Propagate a particle through a compiled beamline ; only maps the state vectors at the segments exits
+    /// \note A ParticleStoppedException is thrown if the particle is stopped by an element aperture
+    void propagate(Particle&, const CompiledBeamline&) const;
+    /// Propagate a particle through a compiled beamline without raising an exception if it is stopped
+    PropagationStatus tryPropagate(Particle&, const CompiledBeamline&) const;
+    /// Propagate a batch of particles through a compiled beamline ; only the last state vectors are kept
+    /// \note Particles stopped by an element aperture are flagged in the batch instead of raising an exception
+    void propagate(ParticlesBatch&, const CompiledBeamline&) const;
 
   private:
+    /// Ensure a compiled beamline matches this propagator beamline and context
+    void checkCompiled(const CompiledBeamline&) const;
+    /// Propagate a particle through one element, checking its aperture and recording the requested states
+    /// \param[inout] pos Particle position at the element entrance, then at its exit
+    /// \param[in] elem_id Index of the element in the beamline
+    /// \param[in] apertures Apertures of all beamline elements
+    /// \param[inout] station Next station to be recorded
+    /// \param[out] status Propagation outcome, filled if the particle is stopped
+    /// \return Has the particle passed through the element?
+    bool traverse(Particle& part,
+                  Particle::Position& pos,
+                  const element::ElementPtr& elem,
+                  size_t elem_id,
+                  const aperture::ApertureTable& apertures,
+                  double eloss,
+                  std::vector<double>::const_iterator& station,
+                  PropagationStatus& status) const;
+    /// Raise the exception associated to a stopped particle
+    void throwStopped(const PropagationStatus&) const;
     /// Extract a particle position at the exit of an element once it enters it
     Particle::Position propagateThrough(const Particle::Position& ini_pos,
                                         const element::ElementPtr& ele,
@@ -51,6 +125,25 @@ namespace hector {
                                         int qp) const;
 
     const Beamline* beamline_;  // NOT owning
+    const PropagationContext context_;
+    /// Apertures of all beamline elements, captured at a given beamline revision
+    struct Apertures {
+      unsigned long long revision;
+      aperture::ApertureTable table;
+    };
+    /// Latest capture of the elements apertures (atomically replaced)
+    mutable std::shared_ptr<const Apertures> apertures_;
+    /// Beamline compiled for a range of batches propagation
+    struct Compiled {
+      Compiled(const Beamline* bl, const PropagationContext& ctx, double s_min, double s_max)
+          : s_min(s_min), s_max(s_max), beamline(bl, ctx, {}, s_min, s_max) {}
+      const double s_min, s_max;
+      const CompiledBeamline beamline;
+    };
+    /// Latest compilation for the batches propagation (atomically replaced)
+    mutable std::shared_ptr<const Compiled> compiled_;
+    Recording recording_;
+    std::vector<double> stations_;
   };
 }  // namespace hector
 
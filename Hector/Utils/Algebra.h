@@ -23,40 +23,48 @@
 #include <array>
 
 namespace hector {
-  /// A generic N-dimensional matrix
-  typedef Eigen::MatrixXf Matrix;
-  /// A generic N-dimensional diagonal matrix
-  typedef Eigen::MatrixXf DiagonalMatrix;
+  /// Six-dimensional square matrix of double-precision floats (e.g. a transfer matrix)
+  typedef Eigen::Matrix<double, 6, 6> Matrix;
+  /// Six-dimensional diagonal matrix of double-precision floats
+  typedef Matrix DiagonalMatrix;
+  /// Six-dimensional column vector of double-precision floats
+  typedef Eigen::Matrix<double, 6, 1> Vector6d;
 
-  /// N-dimensional vector of double-precision floats
-  class Vector : public Eigen::VectorXf {
+  /// Six-dimensional vector of double-precision floats
+  class Vector : public Vector6d {
   public:
-    using Eigen::VectorXf::VectorXf;
-    /// Build a N-vector from its N-dimensional coordinates
-    explicit Vector(const std::initializer_list<double>& vec) : Eigen::VectorXf(vec.size()) {
+    using Vector6d::Vector6d;
+    /// Build a null 6-vector
+    Vector() : Vector6d(Vector6d::Zero()) {}
+    /// Build a 6-vector from its 6-dimensional coordinates
+    explicit Vector(const std::initializer_list<double>& vec) : Vector() {
       unsigned short i = 0;
       for (const auto& c : vec)
         operator()(i++) = c;
     }
   };
   /// Two-vector of double-precision floats
-  class TwoVector : public Eigen::Vector2f {
+  class TwoVector : public Eigen::Vector2d {
   public:
-    using Eigen::Vector2f::Vector2f;
+    using Eigen::Vector2d::Vector2d;
+    /// Build a null two-vector
+    TwoVector() : Eigen::Vector2d(0., 0.) {}
     /// Build a two-vector from its two-dimensional spatial coordinates
-    explicit TwoVector(const std::initializer_list<double>& vec) : Eigen::Vector2f(*vec.begin(), *(vec.begin() + 1)) {}
+    explicit TwoVector(const std::initializer_list<double>& vec) : Eigen::Vector2d(*vec.begin(), *(vec.begin() + 1)) {}
     /// Set the horizontal component
     void setX(double x) { (*this)[0] = x; }
     /// Set the vertical component
     void setY(double y) { (*this)[1] = y; }
   };
   /// Three-vector of double-precision floats
-  class ThreeVector : public Eigen::Vector3f {
+  class ThreeVector : public Eigen::Vector3d {
   public:
-    using Eigen::Vector3f::Vector3f;
+    using Eigen::Vector3d::Vector3d;
+    /// Build a null three-vector
+    ThreeVector() : Eigen::Vector3d(0., 0., 0.) {}
     /// Build a three-vector from its spatial coordinates
     explicit ThreeVector(const std::initializer_list<double>& vec)
-        : Eigen::Vector3f(*vec.begin(), *(vec.begin() + 1), *(vec.begin() + 2)) {}
+        : Eigen::Vector3d(*vec.begin(), *(vec.begin() + 1), *(vec.begin() + 2)) {}
     /// Set the horizontal component
     void setX(double x) { (*this)[0] = x; }
     /// Set the vertical component
@@ -65,13 +73,15 @@ namespace hector {
     void setZ(double z) { (*this)[2] = z; }
   };
   /// Lorentz vector of double-precision floats
-  class LorentzVector : public Eigen::Vector4f {
+  class LorentzVector : public Eigen::Vector4d {
   public:
-    using Eigen::Vector4f::Vector4f;
+    using Eigen::Vector4d::Vector4d;
+    /// Build a null Lorentz vector
+    LorentzVector() : Eigen::Vector4d(0., 0., 0., 0.) {}
     /// Build a Lorentz vector from its spatial and temporal coordinates
-    explicit LorentzVector(const std::array<double, 3>& sp, double t) : Eigen::Vector4f(sp[0], sp[1], sp[2], t) {}
+    explicit LorentzVector(const std::array<double, 3>& sp, double t) : Eigen::Vector4d(sp[0], sp[1], sp[2], t) {}
     /// Build a Lorentz vector from a four-vector containing its spatial and temporal coordinates
-    explicit LorentzVector(const std::array<double, 4> vec) : Eigen::Vector4f(vec[0], vec[1], vec[2], vec[3]) {}
+    explicit LorentzVector(const std::array<double, 4> vec) : Eigen::Vector4d(vec[0], vec[1], vec[2], vec[3]) {}
     /// Set the horizontal momentum component
     void setX(double x) { (*this)[0] = x; }
     /// Set the vertical momentum component
@@ -0,0 +1,76 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef Hector_Utils_Logger_h
+#define Hector_Utils_Logger_h
+
+#include <atomic>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace hector {
+  /// Output of all log messages, either written by the emitting thread or queued for a background writer thread
+  /// \note In the asynchronous mode, messages are pushed to a bounded lock-free queue; an emitting thread only
+  ///  waits if the queue is full. The order of the messages emitted by each thread is preserved.
+  class Logger {
+  public:
+    /// Retrieve this (unique) singleton
+    static Logger& get();
+    /// Write all pending messages and stop the writer thread
+    ~Logger();
+
+    /// Maximal number of messages waiting to be written in the asynchronous mode
+    static constexpr size_t queue_size = 1024;
+
+    /// Set the stream all messages are written to (std::cerr by default)
+    void setOutput(std::ostream& os);
+    /// Write the messages from a background thread?
+    /// \note To be set before the run starts, as for the other run parameters
+    void setAsynchronous(bool async);
+    /// Are the messages written from a background thread?
+    bool asynchronous() const { return async_; }
+
+    /// Write a formatted message, or queue it in the asynchronous mode
+    void write(std::string message);
+    /// Wait for all messages emitted so far to be written
+    void flush();
+
+  private:
+    Logger();
+    /// Background thread writing the queued messages
+    void run();
+
+    /// Queue cell, with a sequence number tracking its state (free or filled) for the current turn of the ring
+    struct Slot {
+      std::atomic<size_t> sequence;
+      std::string message;
+    };
+    std::unique_ptr<Slot[]> slots_;
+    alignas(64) std::atomic<size_t> enqueue_pos_;
+    alignas(64) std::atomic<size_t> dequeue_pos_;
+    alignas(64) std::atomic<size_t> num_written_;
+
+    std::ostream* os_;
+    std::atomic<bool> async_;
+    std::thread writer_;
+  };
+}  // namespace hector
+
+#endif
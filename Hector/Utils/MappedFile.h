@@ -0,0 +1,66 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef Hector_Utils_MappedFile_h
+#define Hector_Utils_MappedFile_h
+
+#include <string>
+#include <string_view>
+
+namespace hector {
+  /// Read-only view of a whole file content, memory-mapped when the system allows it
+  /// \note If the file cannot be mapped (e.g. a pipe), its content is read into an owned buffer instead.
+  class MappedFile {
+  public:
+    MappedFile() = default;
+    /// Map a file in memory
+    /// \param[in] filename Path to the file to map
+    explicit MappedFile(const std::string& filename);
+    MappedFile(MappedFile&&) noexcept;
+    MappedFile& operator=(MappedFile&&) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    /// Was the file successfully opened?
+    bool isOpen() const { return open_; }
+    /// Release the file content
+    void close();
+
+    /// First character of the file content
+    const char* data() const { return data_; }
+    /// Size of the file content, in bytes
+    size_t size() const { return size_; }
+    /// Full file content
+    std::string_view view() const { return std::string_view(data_, size_); }
+
+  private:
+    /// Is the file content memory-mapped (rather than copied into the buffer)?
+    bool mapped_{false};
+    /// Was the file successfully opened?
+    bool open_{false};
+    /// First character of the file content
+    const char* data_{nullptr};
+    /// Size of the file content, in bytes
+    size_t size_{0};
+    /// Fallback copy of the file content, if not mapped
+    std::string buffer_;
+  };
+}  // namespace hector
+
+#endif
@@ -19,6 +19,7 @@
 #ifndef Hector_Utils_StateVector_h
 #define Hector_Utils_StateVector_h
 
+#include "Hector/PropagationContext.h"
 #include "Hector/Utils/Algebra.h"
 
 namespace hector {
@@ -29,8 +30,11 @@ namespace hector {
     enum Components { X = 0, TX = 1, Y = 2, TY = 3, E = 4, K = 5 };
 
   public:
-    /// Build a blank state
+    /// Build a blank state (null coordinates, energy, and mass, with a unit kick)
     StateVector();
+    /// Build a blank state for a beam particle of a propagation context
+    /// \param[in] ctx Propagation context giving the particle energy and mass
+    explicit StateVector(const PropagationContext& ctx);
     //StateVector( const StateVector& sv ) : TwoVector( sv.vector() ), m_( sv.m_ ) {}
     /// Build a state using a 6-component vector and a particle mass
     /// \param[in] vec A 6-component vector
@@ -0,0 +1,78 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef Hector_Utils_Trajectory_h
+#define Hector_Utils_Trajectory_h
+
+#include <utility>
+#include <vector>
+
+#include "Hector/Utils/StateVector.h"
+
+namespace hector {
+  /// Sorted, contiguous collection of state vectors indexed by their s-position
+  /// \note This container mimics the interface of a std::map<double, StateVector>, while storing all records in a
+  ///  single memory block. Positions are usually added in increasing s order, making the insertion a simple append.
+  class Trajectory : private std::vector<std::pair<double, StateVector> > {
+  private:
+    typedef std::vector<std::pair<double, StateVector> > vector;
+
+  public:
+    /// A s-position/state vector record
+    typedef vector::value_type value_type;
+    /// Iterator to a s-position/state vector record
+    typedef vector::iterator iterator;
+    /// Constant iterator to a s-position/state vector record
+    typedef vector::const_iterator const_iterator;
+    /// Reverse iterator to a s-position/state vector record
+    typedef vector::reverse_iterator reverse_iterator;
+    /// Constant reverse iterator to a s-position/state vector record
+    typedef vector::const_reverse_iterator const_reverse_iterator;
+
+    using vector::begin;
+    using vector::capacity;
+    using vector::clear;
+    using vector::empty;
+    using vector::end;
+    using vector::rbegin;
+    using vector::rend;
+    using vector::reserve;
+    using vector::size;
+
+    /// Add a new record, if no state vector is already defined at its s-position
+    /// \return Iterator to the record at this s-position, and a flag set if the record was inserted
+    std::pair<iterator, bool> insert(const value_type& rec);
+    /// Remove a range of records
+    iterator erase(const_iterator first, const_iterator last) { return vector::erase(first, last); }
+
+    /// Find the record at a given s-position
+    iterator find(double s);
+    /// Find the record at a given s-position
+    const_iterator find(double s) const;
+    /// First record at a s-position not smaller than a given one
+    iterator lower_bound(double s);
+    /// First record at a s-position not smaller than a given one
+    const_iterator lower_bound(double s) const;
+    /// First record at a s-position greater than a given one
+    iterator upper_bound(double s);
+    /// First record at a s-position greater than a given one
+    const_iterator upper_bound(double s) const;
+  };
+}  // namespace hector
+
+#endif
@@ -105,6 +105,7 @@ int main(int argc, char* argv[]) {
     if (fn == "")
       continue;
     const hector::io::Twiss parser(fn, ip_name, max_s);
+    parser.applyHeaderParameters();
     //parser.beamline()->offsetElementsAfter( 120., hector::TwoVector( 0.097, 0. ) );
     //parser.beamline()->offsetElementsAfter( 120., hector::TwoVector( +0.097, 0. ) );
     //parser.printInfo();
@@ -21,7 +21,6 @@
 
 #include "Hector/Beamline.h"
 #include "Hector/IO/TwissHandler.h"
-#include "Hector/ParticleStoppedException.h"
 #include "Hector/Propagator.h"
 #include "Hector/Utils/ArgsParser.h"
 #include "Hector/Utils/BeamProducer.h"
@@ -54,6 +53,7 @@ int main(int argc, char* argv[]) {
        {"--beam-width", "beam lateral width at the interaction point (m)", 13.63e-6, &beam_lateral_width_ip},
        {"--particles-energy", "beam particles energy (GeV)", 6500., &particles_energy}});
   hector::io::Twiss parser(twiss_filename, interaction_point, s_pos);
+  parser.applyHeaderParameters();
   parser.printInfo();
 
   //const hector::TwoVector offset( -0.097, 0. );
@@ -67,7 +67,7 @@ int main(int argc, char* argv[]) {
   TH2D hitmap("hitmap", "x (mm)@@y (mm)", 200, -25., 25., 200, -50., 50.);
   //TH2D hitmap( "hitmap", "x (mm)@@y (mm)", 200, -1., 1., 200, -1., 1. );
   //TH2D hitmap( "hitmap", "x (mm)@@y (mm)", 200, 80., 120., 200, -50., 50. );
-  map<float, TH2D*> m_hitmaps;
+  map<double, TH2D*> m_hitmaps;
   if (hitmaps_dist > 0.) {
     double s = 0.;
     while (s <= s_pos) {
@@ -75,6 +75,11 @@ int main(int argc, char* argv[]) {
       s += hitmaps_dist;
     }
   }
+  // only record the particles states at the hitmaps positions, in a single pass through the beamline
+  vector<double> stations = {s_pos};
+  for (const auto& hm : m_hitmaps)
+    stations.emplace_back(hm.first);
+  prop.setStations(stations);
 
   hector::beam::GaussianParticleGun gun;
   //gun.setElimits( particles_energy*0.95, particles_energy );
@@ -93,28 +98,21 @@ int main(int argc, char* argv[]) {
 
     // propagation through the beamline
     hector::Particle p = gun.shoot();
-    try {
-      prop.propagate(p, s_pos);
-      //p.dump();
-      //if ( prop.stopped( p, s_pos ) ) { /*cout << "prout" << endl;*/ num_stopped++; continue; }
+    const auto status = prop.tryPropagate(p, s_pos);
+    if (status.survived()) {
       const hector::TwoVector pos(p.stateVectorAt(s_pos).position() - offset);
       H_INFO << s_pos << " -> " << pos;
       hitmap.Fill(pos.x() * 1.e3, pos.y() * 1.e3);
-    } catch (hector::ParticleStoppedException& pse) {
-      //pse.dump();
-      stopped_at[pse.stoppingElement()]++;
+    } else {
+      stopped_at[parser.beamline()->elements().at(status.element)]++;
       num_stopped++;
     }
-    // propagate at every position step
+    // fill the hitmaps at every position step reached
     for (auto& hm : m_hitmaps) {
-      try {
-        p.clear();
-        prop.propagate(p, hm.first);
-        const hector::TwoVector pos(p.stateVectorAt(hm.first).position() - offset);
-        hm.second->Fill(pos.x(), pos.y());
-      } catch (hector::Exception& e) {
-        continue;
-      }
+      if (hm.first > p.lastS())
+        break;
+      const hector::TwoVector pos(p.stateVectorAt(hm.first).position() - offset);
+      hm.second->Fill(pos.x(), pos.y());
     }
   }
   H_INFO.log([&](auto& log) {
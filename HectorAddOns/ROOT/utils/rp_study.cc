@@ -45,6 +45,7 @@ int main(int argc, char* argv[]) {
                      });
 
   hector::io::Twiss parser(twiss_file, ip_name, max_s);
+  parser.applyHeaderParameters();
   parser.printInfo();
   //parser.beamline()->dump(std::cout);
   //parser.beamline()->offsetElementsAfter(120., hector::TwoVector(-0.097, 0.));
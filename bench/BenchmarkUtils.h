@@ -0,0 +1,191 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef Hector_bench_BenchmarkUtils_h
+#define Hector_bench_BenchmarkUtils_h
+
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <random>
+
+#include "Hector/Apertures/Rectangular.h"
+#include "Hector/Beamline.h"
+#include "Hector/BeamlineBuilder.h"
+#include "Hector/Elements/Drift.h"
+#include "Hector/Elements/Quadrupole.h"
+#include "Hector/IO/TwissHandler.h"
+#include "Hector/Parameters.h"
+#include "Hector/Particle.h"
+#include "Hector/Utils/String.h"
+
+namespace hector {
+  /// Helpers common to all benchmarks
+  namespace bench {
+    /// Build a beamline to be benchmarked
+    /// \param[in] twiss_file Path to a MAD-X Twiss file (a synthetic FODO line is built if empty)
+    /// \param[in] ip Name of the interaction point in the Twiss file
+    /// \param[in] max_s Maximal s-coordinate of the beamline (m)
+    /// \param[in] aperture Half-size of the quadrupoles square apertures in the synthetic line (m, none if negative)
+    inline std::unique_ptr<Beamline> beamline(const std::string& twiss_file,
+                                              const std::string& ip = "IP5",
+                                              double max_s = 250.,
+                                              double aperture = -1.) {
+      if (!twiss_file.empty()) {
+        const io::Twiss twiss(twiss_file, ip, max_s);
+        twiss.applyHeaderParameters();
+        return std::unique_ptr<Beamline>(new Beamline(*twiss.beamline()));
+      }
+      BeamlineBuilder builder{Beamline(max_s)};
+      double s = 0.;
+      for (unsigned short i = 0; s + 10. < max_s; ++i) {  // 2 m drifts and 3 m quadrupoles of alternating polarities
+        builder.add(std::make_shared<element::Drift>("drift" + std::to_string(i), s, 2.));
+        s += 2.;
+        element::ElementPtr quad;
+        if (i % 2 == 0)
+          quad = std::make_shared<element::HorizontalQuadrupole>("quad" + std::to_string(i), s, 3., -1.e-2);
+        else
+          quad = std::make_shared<element::VerticalQuadrupole>("quad" + std::to_string(i), s, 3., +1.e-2);
+        if (aperture > 0.)
+          quad->setAperture(std::make_shared<aperture::Rectangular>(aperture, aperture));
+        builder.add(quad);
+        s += 3.;
+      }
+      return builder.build();
+    }
+
+    /// Write a synthetic MAD-X Twiss file, mimicking the layout and columns of a full-ring LHC optics output
+    /// \param[in] filename Path to the Twiss file to produce
+    /// \param[in] num_elements Number of element lines in the file
+    /// \param[in] ip_fraction Relative position of the interaction point "IP5" along the file
+    inline void twissFile(const std::string& filename, size_t num_elements, double ip_fraction = 0.5) {
+      std::ofstream out(filename);
+      // cell of 10 m: drift, quadrupole, monitor, kicker, dipole, marker, collimator, drift
+      const size_t num_cells = num_elements / 8 + 1;
+      out << "@ NAME             %05s \"TWISS\"\n"
+          << "@ TYPE             %05s \"TWISS\"\n"
+          << "@ SEQUENCE         %05s \"LHCB1\"\n"
+          << "@ PARTICLE         %06s \"PROTON\"\n"
+          << "@ MASS             %le         0.9382720814\n"
+          << "@ CHARGE           %le                    1\n"
+          << "@ ENERGY           %le                 6500\n"
+          << format("@ LENGTH           %%le %20.10g\n", num_cells * 10.)
+          << "@ DATE             %08s \"18/04/17\"\n"
+          << "@ TIME             %08s \"14.44.51\"\n"
+          << "@ ORIGIN           %16s \"5.02.07 Linux 64\"\n";
+      const std::vector<std::string> columns{"NAME",  "KEYWORD", "S",      "L",      "BETX",    "ALFX",   "MUX",
+                                             "BETY",  "ALFY",    "MUY",    "X",      "PX",      "Y",      "PY",
+                                             "DX",    "DPX",     "DY",     "DPY",    "K0L",     "K1L",    "K2L",
+                                             "K3L",   "HKICK",   "VKICK",  "APERTYPE", "APER_1", "APER_2", "APER_3",
+                                             "APER_4"};
+      out << "*";
+      for (const auto& col : columns)
+        out << format(" %18s", col.c_str());
+      out << "\n$";
+      for (const auto& col : columns)
+        out << format(" %18s", (col == "NAME" || col == "KEYWORD" || col == "APERTYPE") ? "%s" : "%le");
+      out << "\n";
+      size_t num_written = 0;
+      for (size_t i = 0; i < num_cells && num_written < num_elements; ++i) {
+        const double s0 = i * 10.;
+        struct Line {
+          std::string name, keyword;
+          double ds, length, k0l, k1l, hkick;
+          std::string apertype;
+          double aper_1, aper_2;
+        };
+        const std::string id = std::to_string(i);
+        const double k1l = (i % 2 == 0) ? 8.e-3 : -8.e-3;
+        std::vector<Line> lines{
+            {"DRIFT_" + std::to_string(2 * i), "DRIFT", 0., 1., 0., 0., 0., "NONE", 0., 0.},
+            {"MQ." + id + "R5.B1", "QUADRUPOLE", 1., 3., 0., k1l, 0., "RECTELLIPSE", 2.e-2, 1.5e-2},
+            {"BPM." + id + "R5.B1", "MONITOR", 4., 0., 0., 0., 0., "NONE", 0., 0.},
+            {"MCBH." + id + "R5.B1", "HKICKER", 4., 0.5, 0., 0., i % 3 == 0 ? 0. : 1.e-6, "NONE", 0., 0.},
+            {"MB.A" + id + "R5.B1", "SBEND", 4.5, 4., 1.e-3, 0., 0., "ELLIPSE", 2.2e-2, 1.8e-2},
+            {"MKR." + id + "R5.B1", "MARKER", 8.5, 0., 0., 0., 0., "NONE", 0., 0.},
+            {"TCP." + id + "R5.B1", "RCOLLIMATOR", 8.5, 1., 0., 0., 0., "RECTANGLE", 4.e-3, 4.e-3},
+            {"DRIFT_" + std::to_string(2 * i + 1), "DRIFT", 9.5, 0.5, 0., 0., 0., "NONE", 0., 0.},
+        };
+        if (i == (size_t)(num_cells * ip_fraction))
+          lines.at(5).name = "IP5";
+        for (const auto& line : lines) {
+          if (num_written++ >= num_elements)
+            break;
+          const double s = s0 + line.ds, phase = 1.e-2 * s;
+          out << format(" %18s %18s %18.10g %18.10g",
+                        ("\"" + line.name + "\"").c_str(),
+                        ("\"" + line.keyword + "\"").c_str(),
+                        s,
+                        line.length)
+              << format(" %18.10g %18.10g %18.10g %18.10g %18.10g %18.10g",
+                        100. + 80. * std::sin(phase),
+                        -1.2 * std::cos(phase),
+                        phase / 6.28,
+                        100. + 80. * std::cos(phase),
+                        1.2 * std::sin(phase),
+                        phase / 6.4)
+              << format(" %18.10g %18.10g %18.10g %18.10g %18.10g %18.10g %18.10g %18.10g",
+                        1.e-4 * std::sin(3. * phase),
+                        1.e-6 * std::cos(3. * phase),
+                        -1.e-4 * std::cos(2. * phase),
+                        1.e-6 * std::sin(2. * phase),
+                        0.5 * std::sin(phase),
+                        1.e-3 * std::cos(phase),
+                        0.,
+                        0.)
+              << format(" %18.10g %18.10g %18.10g %18.10g %18.10g %18.10g",
+                        line.k0l,
+                        line.k1l,
+                        0.,
+                        0.,
+                        line.hkick,
+                        0.)
+              << format(" %18s %18.10g %18.10g %18.10g %18.10g\n",
+                        ("\"" + line.apertype + "\"").c_str(),
+                        line.aper_1,
+                        line.aper_2,
+                        line.aper_1,
+                        line.aper_1);
+        }
+      }
+    }
+
+    /// Generate a collection of beam particles with gaussian-smeared position, angles, and momentum loss
+    /// \param[in] num_part Number of particles to generate
+    /// \param[in] sigma_pos Transverse position spread (m)
+    /// \param[in] sigma_ang Angular spread (rad)
+    /// \param[in] sigma_xi Momentum loss spread
+    inline Particles particles(size_t num_part, double sigma_pos, double sigma_ang, double sigma_xi = 0.) {
+      std::default_random_engine gen(42);
+      std::normal_distribution<double> pos(0., sigma_pos), ang(0., sigma_ang), xi(0., sigma_xi);
+      Particles parts;
+      parts.reserve(num_part);
+      for (size_t i = 0; i < num_part; ++i) {
+        StateVector sv(TwoVector(pos(gen), pos(gen)), TwoVector(ang(gen), ang(gen)));
+        if (sigma_xi > 0.)
+          sv.setXi(std::fabs(xi(gen)));
+        Particle part(StateVector(sv.vector(), Parameters::get().beamParticlesMass()));
+        part.setCharge(Parameters::get().beamParticlesCharge());
+        parts.emplace_back(part);
+      }
+      return parts;
+    }
+  }  // namespace bench
+}  // namespace hector
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <random>
+
+#include "BenchmarkUtils.h"
+#include "Hector/Apertures/ApertureTable.h"
+#include "Hector/ParticlesBatch.h"
+#include "Hector/Propagator.h"
+#include "Hector/Utils/ArgsParser.h"
+#include "Hector/Utils/String.h"
+#include "Hector/Utils/Timer.h"
+
+using namespace std;
+
+/// \file bench_acceptance.cc
+/// Apertures acceptance through the virtual Aperture::contains method and the flattened apertures table
+int main(int argc, char* argv[]) {
+  unsigned int num_part, num_iter;
+  double max_s, aperture;
+  hector::ArgsParser(argc,
+                     argv,
+                     {},
+                     {
+                         {"max-s", "maximal s-coordinate (m)", 250., &max_s},
+                         {"num-part", "number of particles to propagate", 100000, &num_part, 'n'},
+                         {"num-iter", "number of acceptance tests per position", 20, &num_iter},
+                         {"aperture", "half-size of the quadrupoles apertures (m)", 1.e-3, &aperture},
+                     });
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+
+  const auto bl = hector::bench::beamline("", "", max_s, aperture);
+  const hector::Propagator prop(bl.get());
+
+  // acceptance test for a list of transverse positions, in each quadrupole aperture
+  std::default_random_engine gen(42);
+  std::normal_distribution<double> pos(0., aperture);
+  vector<double> xs(num_part), ys(num_part), accepted(num_part);
+  for (size_t j = 0; j < num_part; ++j)
+    xs[j] = pos(gen), ys[j] = pos(gen);
+  const auto apertures = prop.apertures();
+  vector<size_t> ids;
+  for (size_t i = 0; i < bl->elements().size(); ++i)
+    if (apertures->restricted(i))
+      ids.emplace_back(i);
+  const double num_tests = 1. * num_iter * ids.size() * num_part;
+
+  size_t num_in = 0;
+  hector::Timer tmr;
+  for (size_t k = 0; k < num_iter; ++k)
+    for (const auto& i : ids) {
+      const auto* aper = bl->elements().at(i)->aperture();
+      for (size_t j = 0; j < num_part; ++j)
+        num_in += aper->contains(hector::TwoVector(xs[j], ys[j]));
+    }
+  const double virt_time = tmr.elapsed();
+  cout << hector::format("%-16s %12.1f Mtests/s (%zu accepted)\n", "virtual", num_tests / virt_time * 1.e-6, num_in);
+
+  num_in = 0;
+  tmr.reset();
+  for (size_t k = 0; k < num_iter; ++k)
+    for (const auto& i : ids) {
+      apertures->contains(i, xs.data(), ys.data(), num_part, accepted.data());
+      for (size_t j = 0; j < num_part; ++j)
+        num_in += accepted[j] > 0.;
+    }
+  const double table_time = tmr.elapsed();
+  cout << hector::format("%-16s %12.1f Mtests/s (%zu accepted) %8.2f speedup\n",
+                         "table",
+                         num_tests / table_time * 1.e-6,
+                         num_in,
+                         virt_time / table_time);
+
+  // full batch propagation, the apertures being checked at each quadrupole entrance and exit
+  const auto beam = hector::bench::particles(num_part, 5.e-5, 2.e-5);
+  hector::ParticlesBatch batch(beam);
+  tmr.reset();
+  prop.propagate(batch, max_s);
+  const double batch_time = tmr.elapsed();
+  size_t num_stopped = 0;
+  for (size_t i = 0; i < batch.size(); ++i)
+    num_stopped += batch.stopped(i);
+  cout << hector::format("%-16s %12.0f particles/s (%zu stopped)\n", "batch", num_part / batch_time, num_stopped);
+  return 0;
+}
@@ -0,0 +1,114 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+
+#include "Hector/Beamline.h"
+#include "Hector/BeamlineBuilder.h"
+#include "Hector/Elements/Drift.h"
+#include "Hector/Elements/Marker.h"
+#include "Hector/Elements/Quadrupole.h"
+#include "Hector/Parameters.h"
+#include "Hector/Utils/ArgsParser.h"
+#include "Hector/Utils/String.h"
+#include "Hector/Utils/Timer.h"
+
+using namespace std;
+
+/// Synthetic lattice of quadrupoles, each one holding a monitor and a corrector to be split around
+hector::element::Elements lattice(size_t num_elements) {
+  hector::element::Elements out;
+  out.reserve(num_elements);
+  double s = 0.;
+  for (size_t i = 0; out.size() < num_elements; ++i) {
+    const string id = to_string(i);
+    out.emplace_back(std::make_shared<hector::element::HorizontalQuadrupole>("MQ." + id, s, 3., -1.e-2));
+    out.emplace_back(std::make_shared<hector::element::Marker>("BPM." + id, s + 1., 0.));
+    out.emplace_back(std::make_shared<hector::element::VerticalQuadrupole>("MCQ." + id, s + 1.5, 0.5, 1.e-3));
+    out.emplace_back(std::make_shared<hector::element::Drift>("DRIFT." + id, s + 3., 2.));
+    s += 5.;
+  }
+  out.resize(num_elements);
+  return out;
+}
+
+/// \file bench_builder.cc
+/// Construction of a large beamline by successive insertions, and in bulk through the beamline builder
+/// \note Each successive insertion re-sorts the full beamline, hence the former is only timed on a smaller lattice.
+int main(int argc, char* argv[]) {
+  unsigned int num_elements, num_sequential;
+  hector::ArgsParser(argc,
+                     argv,
+                     {},
+                     {
+                         {"num-elements", "number of elements in the lattice", 50000, &num_elements, 'n'},
+                         {"num-sequential", "number of elements inserted one by one", 5000, &num_sequential},
+                     });
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+  hector::Parameters::get().setCorrectBeamlineOverlaps(true);
+  const hector::Beamline properties(num_elements * 5., std::make_shared<hector::element::Marker>("IP5", 0., 0.));
+
+  const auto report = [](const string& name, double time, size_t num_in, size_t num_out) {
+    cout << hector::format("%-32s %10.3f ms %10.1f ns/element (%zu -> %zu elements)\n",
+                           name.c_str(),
+                           time * 1.e3,
+                           time / num_in * 1.e9,
+                           num_in,
+                           num_out);
+  };
+
+  // like-for-like comparison on the smaller lattice
+  double time_sequential = 0., time_bulk = 0.;
+  {
+    const auto elements = lattice(num_sequential);
+    hector::Beamline bl(properties, false);
+    hector::Timer tmr;
+    for (const auto& elem : elements)
+      bl.add(elem);
+    time_sequential = tmr.elapsed();
+    report("successive insertions", time_sequential, num_sequential, bl.elements().size());
+  }
+  {
+    const auto elements = lattice(num_sequential);
+    hector::Timer tmr;
+    hector::BeamlineBuilder builder(properties);
+    builder.reserve(elements.size());
+    for (const auto& elem : elements)
+      builder.add(elem);
+    const auto bl = builder.build();
+    time_bulk = tmr.elapsed();
+    report("bulk construction", time_bulk, num_sequential, bl->elements().size());
+  }
+  cout << hector::format("%-32s %10.1f\n", "speedup", time_sequential / time_bulk);
+
+  // full-size lattice
+  const auto elements = lattice(num_elements);
+  hector::Timer tmr;
+  hector::BeamlineBuilder builder(properties);
+  builder.reserve(elements.size());
+  for (const auto& elem : elements)
+    builder.add(elem);
+  const auto bl = builder.build();
+  report("bulk construction", tmr.elapsed(), num_elements, bl->elements().size());
+
+  tmr.reset();
+  const auto seq = hector::Beamline::sequencedBeamline(bl.get());
+  report("sequencing", tmr.elapsed(), bl->elements().size(), seq->elements().size());
+
+  return 0;
+}
@@ -0,0 +1,83 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+
+#include "BenchmarkUtils.h"
+#include "Hector/ParticleStoppedException.h"
+#include "Hector/ParticlesBatch.h"
+#include "Hector/Propagator.h"
+#include "Hector/Utils/ArgsParser.h"
+#include "Hector/Utils/String.h"
+#include "Hector/Utils/Timer.h"
+
+using namespace std;
+
+/// \file bench_compiled.cc
+/// Element-by-element propagation against the propagation through a beamline compiled into fused segments
+int main(int argc, char* argv[]) {
+  string twiss_file, ip;
+  unsigned int num_part;
+  double max_s, aperture, sigma_xi;
+  hector::ArgsParser(argc,
+                     argv,
+                     {},
+                     {
+                         {"twiss-file", "beamline Twiss file (synthetic line if unset)", "", &twiss_file, 'i'},
+                         {"interaction-point", "name of the interaction point", "IP5", &ip, 'c'},
+                         {"max-s", "maximal s-coordinate (m)", 200., &max_s},
+                         {"num-part", "number of particles to propagate", 100000, &num_part, 'n'},
+                         {"aperture", "quadrupoles aperture in the synthetic line (m)", -1., &aperture},
+                         {"sigma-xi", "momentum loss spread (single kinematics if null)", 0., &sigma_xi},
+                     });
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+
+  const auto bl = hector::bench::beamline(twiss_file, ip, max_s, aperture);
+  const auto beam = hector::bench::particles(num_part, 5.e-5, 2.e-5, sigma_xi);
+
+  const hector::Propagator prop(bl.get());
+  hector::Timer tmr;
+  const auto cbl = prop.compile({}, beam.begin()->firstS(), max_s);
+  cout << "Beamline with " << cbl.elements().size() << " element(s) compiled into " << cbl.segments().size()
+       << " segment(s) in " << tmr.elapsed() * 1.e3 << " ms.\n";
+
+  auto run = [&](const string& name, auto&& propagate) {
+    auto parts = beam;
+    size_t num_stopped = 0;
+    hector::Timer tmr_run;
+    for (auto& part : parts)
+      try {
+        propagate(part);
+      } catch (const hector::ParticleStoppedException&) {
+        ++num_stopped;
+      }
+    cout << hector::format(
+        "%-20s %16.0f particles/s %10zu stopped\n", name.c_str(), num_part / tmr_run.elapsed(), num_stopped);
+  };
+  run("element-by-element", [&](hector::Particle& part) { prop.propagate(part, max_s); });
+  run("compiled", [&](hector::Particle& part) { prop.propagate(part, cbl); });
+
+  hector::ParticlesBatch batch(beam);
+  tmr.reset();
+  prop.propagate(batch, cbl);
+  cout << hector::format("%-20s %16.0f particles/s %10zu stopped\n",
+                         "compiled batch",
+                         num_part / tmr.elapsed(),
+                         batch.size() - batch.numAlive());
+  return 0;
+}
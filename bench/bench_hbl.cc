@@ -0,0 +1,121 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "BenchmarkUtils.h"
+#include "Hector/Beamline.h"
+#include "Hector/CompiledBeamline.h"
+#include "Hector/IO/HBLFileHandler.h"
+#include "Hector/IO/TwissHandler.h"
+#include "Hector/Propagator.h"
+#include "Hector/Utils/ArgsParser.h"
+#include "Hector/Utils/String.h"
+#include "Hector/Utils/Timer.h"
+
+using namespace std;
+
+/// \file bench_hbl.cc
+/// Loading time of a beamline from its compiled HBL file, compared to the parsing of the MAD-X Twiss file, and time
+/// until a nominal particle can be propagated, with and without the transfer matrices embedded in the HBL file
+int main(int argc, char* argv[]) {
+  string twiss_file, ip;
+  unsigned int num_elements, num_repeat;
+  double max_s;
+  hector::ArgsParser(argc,
+                     argv,
+                     {},
+                     {
+                         {"twiss-file", "MAD-X Twiss file (synthetic one if empty)", "", &twiss_file, 'i'},
+                         {"ip-name", "name of the interaction point", "IP5", &ip, 'c'},
+                         {"num-elements", "number of elements in the synthetic Twiss file", 25000, &num_elements, 'n'},
+                         {"max-s", "maximal s-coordinate (m)", 10000., &max_s},
+                         {"num-repeat", "number of parsings of each file", 10, &num_repeat},
+                     });
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+
+  const bool synthetic = twiss_file.empty();
+  if (synthetic) {
+    twiss_file = "bench_hbl.tfs";
+    hector::bench::twissFile(twiss_file, num_elements);
+  }
+  const string hbl_file = "bench_hbl.hbl", hbl_mats_file = "bench_hbl_matrices.hbl";
+
+  size_t num_twiss = 0, num_hbl = 0;
+  hector::Timer tmr;
+  for (size_t i = 0; i < num_repeat; ++i) {
+    hector::io::Twiss twiss(twiss_file, ip, max_s);
+    num_twiss = twiss.beamline()->elements().size();
+    if (i == 0) {
+      twiss.applyHeaderParameters();
+      hector::io::HBL::write(twiss.beamline(), hbl_file);
+      hector::io::HBL::write(twiss.beamline(), hbl_mats_file, hector::PropagationContext());
+    }
+  }
+  const double time_twiss = tmr.elapsed() / num_repeat;
+  tmr.reset();
+  for (size_t i = 0; i < num_repeat; ++i)
+    num_hbl = hector::io::HBL(hbl_file).beamline()->elements().size();
+  const double time_hbl = tmr.elapsed() / num_repeat;
+
+  // load and compile the beamline, then retrieve the fused matrices needed to propagate a nominal particle
+  const auto first_track = [](const string& filename) {
+    const hector::io::HBL hbl(filename);
+    const hector::Propagator prop(hbl.beamline());
+    const auto cbl = prop.compile();
+    hbl.provideMatrices(cbl);
+    const auto& ctx = cbl.context();
+    return *cbl.matrices(ctx.energyLoss(ctx.beamEnergy()), ctx.beamParticlesMass(), ctx.beamParticlesCharge());
+  };
+  auto last = first_track(hbl_file), last_mats = last;
+  tmr.reset();
+  for (size_t i = 0; i < num_repeat; ++i)
+    last = first_track(hbl_file);
+  const double time_track = tmr.elapsed() / num_repeat;
+  tmr.reset();
+  for (size_t i = 0; i < num_repeat; ++i)
+    last_mats = first_track(hbl_mats_file);
+  const double time_track_mats = tmr.elapsed() / num_repeat;
+
+  const double hbl_size = std::ifstream(hbl_file, std::ios::ate | std::ios::binary).tellg();
+  const double hbl_mats_size = std::ifstream(hbl_mats_file, std::ios::ate | std::ios::binary).tellg();
+  std::remove(hbl_file.c_str());
+  std::remove(hbl_mats_file.c_str());
+  if (synthetic)
+    std::remove(twiss_file.c_str());
+
+  cout << hector::format("%zu sequenced elements, %.1f kB HBL file (%.1f kB with matrices)\n",
+                         num_twiss,
+                         hbl_size * 1.e-3,
+                         hbl_mats_size * 1.e-3)
+       << hector::format("%-20s %12.1f us/file\n", "Twiss parsing", time_twiss * 1.e6)
+       << hector::format(
+              "%-20s %12.1f us/file %10.1f speedup\n", "HBL loading", time_hbl * 1.e6, time_twiss / time_hbl)
+       << hector::format("%-20s %12.1f us/file\n", "HBL to first track", time_track * 1.e6)
+       << hector::format("%-20s %12.1f us/file %10.1f speedup\n",
+                         "  with matrices",
+                         time_track_mats * 1.e6,
+                         time_track / time_track_mats);
+  if (num_hbl != num_twiss)
+    cerr << "Number of elements differs between the Twiss and HBL files." << endl;
+  if (last != last_mats)
+    cerr << "Fused transfer matrices differ with the embedded matrices." << endl;
+  return num_hbl != num_twiss || last != last_mats;
+}
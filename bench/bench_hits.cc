@@ -0,0 +1,167 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+#include "BenchmarkUtils.h"
+#include "Hector/IO/HitsFile.h"
+#include "Hector/ParticlesBatch.h"
+#include "Hector/Propagator.h"
+#include "Hector/Utils/ArgsParser.h"
+#include "Hector/Utils/String.h"
+#include "Hector/Utils/Timer.h"
+
+using namespace std;
+
+/// \file bench_hits.cc
+/// Writing and scanning throughputs of the columnar station hits files (raw and compressed), compared to a text dump
+/// of the same hits and to the propagation of the particles to the stations
+int main(int argc, char* argv[]) {
+  string twiss_file, ip;
+  unsigned int num_part, chunk_size;
+  vector<double> stations;
+  hector::ArgsParser(argc,
+                     argv,
+                     {},
+                     {
+                         {"twiss-file", "MAD-X Twiss file (synthetic FODO line if empty)", "", &twiss_file, 'i'},
+                         {"ip-name", "name of the interaction point", "IP5", &ip, 'c'},
+                         {"num-part", "number of particles propagated to each station", 200000, &num_part, 'n'},
+                         {"stations", "s-coordinates of the scoring stations (m)", {100., 200.}, &stations},
+                         {"chunk-size", "number of hits per chunk", 65536, &chunk_size},
+                     });
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+
+  const auto bl = hector::bench::beamline(twiss_file, ip, stations.back() + 1., 2.e-3);
+  const hector::Propagator prop(bl.get());
+  const hector::ParticlesBatch initial(hector::bench::particles(num_part, 5.e-4, 5.e-5));
+  vector<hector::ParticlesBatch> finals;
+  hector::Timer tmr;
+  for (const auto& station : stations) {
+    finals.emplace_back(initial);
+    prop.propagate(finals.back(), station);
+  }
+  const double time_prop = tmr.elapsed();
+  const double num_hits = num_part * stations.size();
+
+  const string raw_file = "bench_hits.hits", zip_file = "bench_hits_deflate.hits", text_file = "bench_hits.txt";
+  const auto write = [&](const string& filename, bool compress) {
+    hector::io::HitsWriter writer(filename, stations, compress, chunk_size);
+    for (unsigned int i = 0; i < stations.size(); ++i)
+      writer.add(i, 0, initial, finals.at(i));
+  };
+  tmr.reset();
+  write(raw_file, false);
+  const double time_write = tmr.elapsed();
+  tmr.reset();
+  write(zip_file, true);
+  const double time_write_zip = tmr.elapsed();
+  tmr.reset();
+  {
+    ofstream out(text_file);
+    for (unsigned int i = 0; i < stations.size(); ++i) {
+      const auto states0 = initial.states();
+      const auto states = as_const(finals.at(i)).states();
+      for (size_t j = 0; j < num_part; ++j)
+        out << hector::format("%zu %u %s %.17g %.17g %.17g %.17g %.17g %.17g %.17g %.17g %.17g\n",
+                              j,
+                              i,
+                              finals.at(i).stopped(j) ? finals.at(i).stoppingElement(j)->name().c_str() : "-",
+                              states0(0, j),
+                              states0(1, j),
+                              states0(2, j),
+                              states0(3, j),
+                              states0(4, j),
+                              states(0, j),
+                              states(1, j),
+                              states(2, j),
+                              states(3, j));
+    }
+  }
+  const double time_write_text = tmr.elapsed();
+
+  // re-analysis: mean horizontal position of the particles reaching the last station
+  const auto scan = [&](const string& filename, double& time) {
+    tmr.reset();
+    const hector::io::HitsReader reader(filename);
+    double sum_x = 0.;
+    size_t num_x = 0;
+    reader.scan([&](const hector::io::HitsChunk& chunk) {
+      const unsigned int* stat = chunk.stations();
+      const int* loss = chunk.lossElements();
+      const double* x = chunk.values(hector::io::hitX);
+      for (size_t i = 0; i < chunk.size(); ++i)
+        if (stat[i] == stations.size() - 1 && loss[i] < 0) {
+          sum_x += x[i];
+          ++num_x;
+        }
+    });
+    time = tmr.elapsed();
+    return sum_x / num_x;
+  };
+  double time_scan, time_scan_zip, time_scan_text;
+  const double mean_x = scan(raw_file, time_scan), mean_x_zip = scan(zip_file, time_scan_zip);
+  tmr.reset();
+  double mean_x_text = 0.;
+  {
+    ifstream in(text_file);
+    string loss;
+    size_t id, num_x = 0;
+    unsigned int stat;
+    double vals[9];
+    while (in >> id >> stat >> loss >> vals[0] >> vals[1] >> vals[2] >> vals[3] >> vals[4] >> vals[5] >> vals[6] >>
+           vals[7] >> vals[8])
+      if (stat == stations.size() - 1 && loss == "-") {
+        mean_x_text += vals[5];
+        ++num_x;
+      }
+    mean_x_text /= num_x;
+  }
+  time_scan_text = tmr.elapsed();
+
+  const auto size = [](const string& filename) {
+    return (double)std::ifstream(filename, std::ios::ate | std::ios::binary).tellg();
+  };
+  const double raw_size = size(raw_file), zip_size = size(zip_file), text_size = size(text_file);
+  for (const auto& filename : {raw_file, zip_file, text_file})
+    std::remove(filename.c_str());
+
+  cout << hector::format("%.0f hits (%u particles, %zu stations), %zu surviving to the last station\n",
+                         num_hits,
+                         num_part,
+                         stations.size(),
+                         finals.back().numAlive())
+       << hector::format("%-22s %10.1f Mhits/s\n", "propagation", num_hits / time_prop * 1.e-6);
+  for (const auto& res : vector<tuple<string, double, double, double> >{
+           {"columnar (raw)", raw_size, time_write, time_scan},
+           {"columnar (deflate)", zip_size, time_write_zip, time_scan_zip},
+           {"text", text_size, time_write_text, time_scan_text}})
+    cout << hector::format("%-22s %10.1f B/hit %10.1f Mhits/s written %10.1f Mhits/s scanned\n",
+                           get<0>(res).c_str(),
+                           get<1>(res) / num_hits,
+                           num_hits / get<2>(res) * 1.e-6,
+                           num_hits / get<3>(res) * 1.e-6);
+  if (mean_x != mean_x_zip || fabs(mean_x - mean_x_text) > 1.e-12) {
+    cerr << "Scanned hits differ between the output formats." << endl;
+    return 1;
+  }
+  return 0;
+}
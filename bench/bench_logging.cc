@@ -0,0 +1,83 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "Hector/Exception.h"
+#include "Hector/Parameters.h"
+#include "Hector/Utils/ArgsParser.h"
+#include "Hector/Utils/Logger.h"
+#include "Hector/Utils/String.h"
+#include "Hector/Utils/Timer.h"
+
+using namespace std;
+
+/// \file bench_logging.cc
+/// Cost of filtered log statements, and of the synchronous and asynchronous writing of messages
+/// \note Messages are written to the standard error stream, to be redirected (e.g. bench_logging 2>/dev/null)
+int main(int argc, char* argv[]) {
+  unsigned int num_messages, num_threads;
+  hector::ArgsParser(argc,
+                     argv,
+                     {},
+                     {
+                         {"num-messages", "number of log statements per thread", 1000000, &num_messages, 'n'},
+                         {"num-threads", "number of threads emitting messages", 4, &num_threads, 't'},
+                     });
+  auto& params = hector::Parameters::get();
+
+  // statements below the run threshold
+  params.setLoggingThreshold(hector::ExceptionType::warning);
+  hector::Timer tmr;
+  for (size_t i = 0; i < num_messages; ++i)
+    hector::Exception(__PRETTY_FUNCTION__, hector::ExceptionType::info) << "Filtered message " << i << ".";
+  const double eager_time = tmr.elapsed();
+  tmr.reset();
+  for (size_t i = 0; i < num_messages; ++i)
+    H_INFO << "Filtered message " << i << ".";
+  const double lazy_time = tmr.elapsed();
+  cout << hector::format("%-24s %10.2f ns/statement\n", "filtered (eager)", eager_time / num_messages * 1.e9)
+       << hector::format("%-24s %10.2f ns/statement\n", "filtered (lazy)", lazy_time / num_messages * 1.e9);
+
+  // messages written by concurrent threads
+  params.setLoggingThreshold(hector::ExceptionType::info);
+  const size_t num_logged = num_messages / 10;
+  for (const bool async : {false, true}) {
+    hector::Logger::get().setAsynchronous(async);
+    vector<thread> threads;
+    tmr.reset();
+    for (size_t i = 0; i < num_threads; ++i)
+      threads.emplace_back([num_logged]() {
+        for (size_t j = 0; j < num_logged; ++j)
+          H_INFO << "Logged message " << j << ".";
+      });
+    for (auto& thr : threads)
+      thr.join();
+    const double emit_time = tmr.elapsed();
+    hector::Logger::get().flush();
+    const double total_time = tmr.elapsed();
+    cout << hector::format("%-24s %10.2f ns/message emitted, %10.2f ns/message written\n",
+                           async ? "asynchronous" : "synchronous",
+                           emit_time / num_threads / num_logged * 1.e9,
+                           total_time / num_threads / num_logged * 1.e9);
+  }
+  hector::Logger::get().setAsynchronous(false);
+  return 0;
+}
@@ -0,0 +1,114 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <random>
+#include <regex>
+
+#include "BenchmarkUtils.h"
+#include "Hector/Utils/ArgsParser.h"
+#include "Hector/Utils/String.h"
+#include "Hector/Utils/Timer.h"
+
+using namespace std;
+
+/// \file bench_lookup.cc
+/// Elements lookup by name, s-position, and regular expression, compared to a scan of the full beamline
+int main(int argc, char* argv[]) {
+  unsigned int num_queries;
+  double max_s;
+  hector::ArgsParser(argc,
+                     argv,
+                     {},
+                     {
+                         {"max-s", "maximal s-coordinate (m)", 5000., &max_s},
+                         {"num-queries", "number of lookups of each type", 10000, &num_queries, 'n'},
+                     });
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+
+  const auto bl = hector::bench::beamline("", "", max_s);
+  const auto& elements = bl->elements();
+  cout << "Beamline with " << elements.size() << " elements\n";
+
+  std::default_random_engine gen(42);
+  std::uniform_int_distribution<size_t> elem_id(0, elements.size() - 1);
+  std::uniform_real_distribution<double> flat(0., bl->length());
+  vector<string> names;
+  vector<double> positions;
+  for (size_t i = 0; i < num_queries; ++i) {
+    names.emplace_back(elements.at(elem_id(gen))->name());
+    positions.emplace_back(flat(gen));
+  }
+  const size_t num_patterns = std::max<size_t>(num_queries / 100, 1);
+
+  const auto report = [](const string& name, double time_scan, double time_index, size_t num) {
+    cout << hector::format("%-20s %12.1f ns/query (scan) %12.1f ns/query (index) %10.1f speedup\n",
+                           name.c_str(),
+                           time_scan / num * 1.e9,
+                           time_index / num * 1.e9,
+                           time_scan / time_index);
+  };
+
+  // by name
+  size_t check = 0;
+  hector::Timer tmr;
+  for (const auto& name : names)
+    for (const auto& elem : elements) {
+      const std::string elem_name = elem->name();  // copied as in the former accessor
+      if (elem_name.find(name) != string::npos) {
+        check += elem->s() > 0.;
+        break;
+      }
+    }
+  double time_scan = tmr.elapsed();
+  tmr.reset();
+  for (const auto& name : names)
+    check -= bl->get(name)->s() > 0.;
+  report("name", time_scan, tmr.elapsed(), num_queries);
+
+  // by s-position
+  tmr.reset();
+  for (const auto& pos : positions)
+    for (const auto& elem : elements)
+      if (elem->s() <= pos && elem->s() + elem->length() >= pos) {
+        check += elem->s() > 0.;
+        break;
+      }
+  time_scan = tmr.elapsed();
+  tmr.reset();
+  for (const auto& pos : positions)
+    check -= bl->get(pos)->s() > 0.;
+  report("s-position", time_scan, tmr.elapsed(), num_queries);
+
+  // by regular expression
+  tmr.reset();
+  for (size_t i = 0; i < num_patterns; ++i) {
+    const std::regex rgx("^quad[0-9]*5$");
+    for (const auto& elem : elements)
+      check += std::regex_search(elem->name(), rgx);
+  }
+  time_scan = tmr.elapsed();
+  tmr.reset();
+  for (size_t i = 0; i < num_patterns; ++i)
+    check -= bl->find("^quad[0-9]*5$").size();
+  report("regex", time_scan, tmr.elapsed(), num_patterns);
+
+  if (check != 0)
+    cerr << "Lookup results differ between the scan and the index." << endl;
+  return check != 0;
+}
@@ -0,0 +1,98 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <iostream>
+
+#include "BenchmarkUtils.h"
+#include "Hector/ParticleStoppedException.h"
+#include "Hector/Propagator.h"
+#include "Hector/Utils/ArgsParser.h"
+#include "Hector/Utils/String.h"
+#include "Hector/Utils/Timer.h"
+
+using namespace std;
+
+/// \file bench_losses.cc
+/// Cost of the exceptions-based loss reporting against the propagation status, in a loss-dominated configuration
+int main(int argc, char* argv[]) {
+  unsigned int num_part;
+  double max_s, loss_rate;
+  hector::ArgsParser(argc,
+                     argv,
+                     {},
+                     {
+                         {"max-s", "maximal s-coordinate (m)", 250., &max_s},
+                         {"num-part", "number of particles to propagate", 100000, &num_part, 'n'},
+                         {"loss-rate", "fraction of particles stopped in the beamline", 0.9, &loss_rate},
+                     });
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+
+  const auto beam = hector::bench::particles(num_part, 5.e-5, 2.e-5, 0.05);
+
+  // find the quadrupoles aperture stopping the requested fraction of particles
+  double aperture = 0.;
+  {
+    const auto bl = hector::bench::beamline("", "", max_s);
+    const hector::Propagator prop(bl.get());
+    vector<double> max_extent;
+    for (size_t i = 0; i < std::min<size_t>(num_part, 10000); ++i) {
+      auto part = beam[i];
+      prop.propagate(part, max_s);
+      double extent = 0.;
+      for (const auto& pos : part)
+        extent = std::max(extent, pos.second.position().cwiseAbs().maxCoeff());
+      max_extent.emplace_back(extent);
+    }
+    const size_t quantile = (1. - loss_rate) * (max_extent.size() - 1);
+    std::nth_element(max_extent.begin(), max_extent.begin() + quantile, max_extent.end());
+    aperture = max_extent.at(quantile);
+  }
+  const auto bl = hector::bench::beamline("", "", max_s, aperture);
+  const hector::Propagator prop(bl.get());
+  cout << "Quadrupoles aperture: " << aperture * 1.e3 << " mm\n";
+
+  auto parts = beam;
+  size_t num_stopped = 0;
+  hector::Timer tmr;
+  for (auto& part : parts)
+    try {
+      prop.propagate(part, max_s);
+    } catch (const hector::ParticleStoppedException&) {
+      ++num_stopped;
+    }
+  const double exc_time = tmr.elapsed();
+  cout << hector::format("%-12s %16.0f particles/s %8.1f%% stopped\n",
+                         "exceptions",
+                         num_part / exc_time,
+                         100. * num_stopped / num_part);
+
+  parts = beam;
+  num_stopped = 0;
+  tmr.reset();
+  for (auto& part : parts)
+    if (prop.tryPropagate(part, max_s).stopped())
+      ++num_stopped;
+  const double status_time = tmr.elapsed();
+  cout << hector::format("%-12s %16.0f particles/s %8.1f%% stopped %8.2f speedup\n",
+                         "status",
+                         num_part / status_time,
+                         100. * num_stopped / num_part,
+                         exc_time / status_time);
+  return 0;
+}
@@ -0,0 +1,86 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <random>
+#include <regex>
+
+#include "Hector/Beamline.h"
+#include "Hector/IO/TwissHandler.h"
+#include "Hector/Parameters.h"
+#include "Hector/Utils/ArgsParser.h"
+#include "Hector/Utils/String.h"
+#include "Hector/Utils/Timer.h"
+
+using namespace std;
+
+/// \file bench_names.cc
+/// Classification of Twiss elements from their name, compared to the regular expressions formerly used
+int main(int argc, char* argv[]) {
+  unsigned int num_names;
+  hector::ArgsParser(argc, argv, {}, {{"num-names", "number of names to classify", 1000000, &num_names, 'n'}});
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+
+  const vector<string> templates{"DRIFT_%d",    "MQ.%dR5.B1",  "MQXA.1R5",   "MQML.%dL5.B2", "MB.A%dR5.B1",
+                                 "MBXW.A4R5",   "BPM.%dR5.B1", "BPMSW.1L5",  "TCL.%dR5.B1",  "TCTPH.4L5.B1",
+                                 "MCBH.%dR5.B1", "MKR.%dR5.B1", "E.DS.R5.B1", "IP5"};
+  std::default_random_engine gen(42);
+  std::uniform_int_distribution<size_t> tmpl(0, templates.size() - 1), cell(1, 40);
+  vector<string> names;
+  names.reserve(num_names);
+  for (size_t i = 0; i < num_names; ++i)
+    names.emplace_back(hector::format(templates.at(tmpl(gen)).c_str(), (int)cell(gen)));
+
+  hector::Timer tmr;
+  const vector<pair<regex, hector::element::Type> > patterns{
+      {regex("DRIFT\\_[0-9]+"), hector::element::aDrift},
+      {regex("M[B,Q]\\w+\\d?\\.\\w?\\d[L,R]\\d(\\.B[1,2])?"), hector::element::aGenericQuadrupole},
+      {regex("MB\\.[A-Z][0-9]{1,2}[L,R][0-9]\\.B[1,2]"), hector::element::aSectorDipole},
+      {regex("MB[A-Z0-9]{2,3}\\.*[B,R][0-9]"), hector::element::aRectangularDipole},
+      {regex("IP[0-9]"), hector::element::aMarker},
+      {regex("BPM.+"), hector::element::aMonitor},
+      {regex("T[C,A].*\\.\\d[L,R]\\d\\.?(B[1-9])?"), hector::element::aRectangularCollimator}};
+  const double time_compile = tmr.elapsed();
+
+  size_t check = 0;
+  tmr.reset();
+  for (const auto& name : names)
+    for (const auto& pattern : patterns)
+      if (regex_match(name, pattern.first)) {
+        check += pattern.second;
+        break;
+      }
+  const double time_regex = tmr.elapsed();
+  tmr.reset();
+  for (const auto& name : names) {
+    const auto type = hector::io::Twiss::findElementTypeByName(name);
+    if (type != hector::element::anInvalidElement)
+      check -= type;
+  }
+  const double time_matchers = tmr.elapsed();
+
+  cout << hector::format("%-20s %12.1f us (once)\n", "regex construction", time_compile * 1.e6)
+       << hector::format("%-20s %12.1f ns/name\n", "std::regex", time_regex / num_names * 1.e9)
+       << hector::format("%-20s %12.1f ns/name %10.1f speedup\n",
+                         "matchers",
+                         time_matchers / num_names * 1.e9,
+                         time_regex / time_matchers);
+  if (check != 0)
+    cerr << "Classification differs between the regular expressions and the matchers." << endl;
+  return check != 0;
+}
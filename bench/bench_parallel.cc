@@ -0,0 +1,78 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+
+#include "BenchmarkUtils.h"
+#include "Hector/ParallelPropagator.h"
+#include "Hector/Utils/ArgsParser.h"
+#include "Hector/Utils/String.h"
+#include "Hector/Utils/Timer.h"
+
+using namespace std;
+
+/// \file bench_parallel.cc
+/// Scaling of the parallel propagation of a collection of particles with the number of worker threads
+int main(int argc, char* argv[]) {
+  string twiss_file, ip;
+  unsigned int num_part, max_threads, chunk_size;
+  double max_s, aperture;
+  hector::ArgsParser(argc,
+                     argv,
+                     {},
+                     {
+                         {"twiss-file", "beamline Twiss file (synthetic line if unset)", "", &twiss_file, 'i'},
+                         {"interaction-point", "name of the interaction point", "IP5", &ip, 'c'},
+                         {"max-s", "maximal s-coordinate (m)", 200., &max_s},
+                         {"num-part", "number of particles to propagate", 200000, &num_part, 'n'},
+                         {"max-threads", "maximal number of worker threads", 64, &max_threads, 't'},
+                         {"chunk-size", "number of particles in a unit of work", 64, &chunk_size},
+                         {"aperture", "quadrupoles aperture in the synthetic line (m)", 1.e-3, &aperture},
+                     });
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+
+  const auto bl = hector::bench::beamline(twiss_file, ip, max_s, aperture);
+  const auto beam = hector::bench::particles(num_part, 5.e-5, 2.e-5, 0.05);
+
+  hector::Particles reference;
+  double ref_time = 0.;
+  cout << hector::format("%8s %16s %10s %10s %10s\n", "threads", "particles/s", "speedup", "stopped", "identical");
+  for (unsigned short num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+    hector::ParallelPropagator prop(bl.get(), num_threads, chunk_size);
+    auto parts = beam;
+    hector::Timer tmr;
+    const size_t num_stopped = prop.propagate(parts, max_s);
+    const double time = tmr.elapsed();
+    bool identical = true;
+    if (num_threads == 1) {
+      reference = parts;
+      ref_time = time;
+    } else
+      for (size_t i = 0; i < parts.size() && identical; ++i)
+        identical = parts[i].stopped() == reference[i].stopped() &&
+                    parts[i].lastS() == reference[i].lastS() &&
+                    parts[i].lastStateVector().vector() == reference[i].lastStateVector().vector();
+    cout << hector::format("%8d %16.0f %10.2f %10zu %10s\n",
+                           num_threads,
+                           num_part / time,
+                           ref_time / time,
+                           num_stopped,
+                           identical ? "yes" : "NO");
+  }
+  return 0;
+}
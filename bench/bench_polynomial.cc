@@ -0,0 +1,79 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+
+#include "BenchmarkUtils.h"
+#include "Hector/PolynomialTransport.h"
+#include "Hector/Utils/ArgsParser.h"
+#include "Hector/Utils/String.h"
+#include "Hector/Utils/Timer.h"
+
+using namespace std;
+
+/// \file bench_polynomial.cc
+/// Exact propagation against the parametric transport of particles to a station
+int main(int argc, char* argv[]) {
+  string twiss_file, ip;
+  unsigned int num_part, xi_order, num_training;
+  double max_s, station;
+  hector::ArgsParser(argc,
+                     argv,
+                     {},
+                     {
+                         {"twiss-file", "beamline Twiss file (synthetic line if unset)", "", &twiss_file, 'i'},
+                         {"interaction-point", "name of the interaction point", "IP5", &ip, 'c'},
+                         {"max-s", "maximal s-coordinate (m)", 250., &max_s},
+                         {"station", "s-coordinate of the station (m)", 200., &station, 's'},
+                         {"num-part", "number of particles to propagate", 100000, &num_part, 'n'},
+                         {"xi-order", "order of the polynomials in momentum loss", 6, &xi_order},
+                         {"num-training", "number of particles in the training sweep", 2000, &num_training},
+                     });
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+
+  const auto bl = hector::bench::beamline(twiss_file, ip, max_s);
+  const auto beam = hector::bench::particles(num_part, 5.e-5, 2.e-5, 0.05);
+
+  const hector::Propagator prop(bl.get());
+  hector::PolynomialTransport::Domain domain;
+  domain.pos_min = hector::TwoVector(-5.e-4, -5.e-4);
+  domain.pos_max = hector::TwoVector(+5.e-4, +5.e-4);
+  domain.ang_min = hector::TwoVector(-2.e-4, -2.e-4);
+  domain.ang_max = hector::TwoVector(+2.e-4, +2.e-4);
+  domain.xi_max = 0.25;
+  hector::Timer tmr;
+  const hector::PolynomialTransport poly(prop, station, domain, xi_order, num_training);
+  cout << "Transport fitted in " << tmr.elapsed() << " s, maximal deviation on the validation sample:\n\t"
+       << poly.errorBound().transpose() << "\n";
+
+  auto parts = beam;
+  tmr.reset();
+  for (auto& part : parts)
+    prop.propagate(part, station);
+  cout << hector::format("%-12s %16.0f particles/s\n", "exact", num_part / tmr.elapsed());
+
+  parts = beam;
+  tmr.reset();
+  for (auto& part : parts)
+    poly.propagate(part);
+  cout << hector::format("%-12s %16.0f particles/s %10llu fallbacks\n",
+                         "polynomial",
+                         num_part / tmr.elapsed(),
+                         poly.numFallbacks());
+  return 0;
+}
@@ -0,0 +1,136 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <new>
+
+#include "BenchmarkUtils.h"
+#include "Hector/Propagator.h"
+#include "Hector/Utils/ArgsParser.h"
+#include "Hector/Utils/String.h"
+#include "Hector/Utils/Timer.h"
+
+using namespace std;
+
+namespace {
+  size_t allocated = 0;    ///< Heap memory currently allocated (in bytes)
+  size_t allocations = 0;  ///< Number of heap allocations performed
+}  // namespace
+
+// count the heap memory allocated by the trajectories containers
+void* operator new(size_t size) {
+  auto* ptr = static_cast<size_t*>(std::malloc(size + sizeof(max_align_t)));
+  if (!ptr)
+    throw std::bad_alloc();
+  *ptr = size;
+  allocated += size;
+  ++allocations;
+  return reinterpret_cast<char*>(ptr) + sizeof(max_align_t);
+}
+void operator delete(void* ptr) noexcept {
+  if (!ptr)
+    return;
+  auto* base = reinterpret_cast<size_t*>(static_cast<char*>(ptr) - sizeof(max_align_t));
+  allocated -= *base;
+  std::free(base);
+}
+void operator delete(void* ptr, size_t) noexcept { operator delete(ptr); }
+
+/// Interpolated state vector lookup in a map-based trajectory, as performed before the flat storage
+hector::StateVector mapStateVectorAt(const map<double, hector::StateVector>& traj, double s) {
+  const auto pos_s = traj.find(s);
+  if (pos_s != traj.end())
+    return pos_s->second;
+  const auto upper_it = traj.upper_bound(s), lower_it = std::prev(traj.upper_bound(s));
+  hector::StateVector out(lower_it->second);
+  out.setPosition(lower_it->second.position() + ((s - lower_it->first) / (upper_it->first - lower_it->first)) *
+                                                    (upper_it->second.position() - lower_it->second.position()));
+  return out;
+}
+
+/// \file bench_trajectory.cc
+/// Memory footprint and lookup latency of the flat trajectory storage, compared to a map-based storage
+int main(int argc, char* argv[]) {
+  unsigned int num_part, num_lookups;
+  double max_s;
+  hector::ArgsParser(argc,
+                     argv,
+                     {},
+                     {
+                         {"max-s", "maximal s-coordinate (m)", 250., &max_s},
+                         {"num-part", "number of particles to propagate", 10000, &num_part, 'n'},
+                         {"num-lookups", "number of state vector lookups per particle", 100, &num_lookups},
+                     });
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+
+  const auto bl = hector::bench::beamline("", "", max_s);
+  auto parts = hector::bench::particles(num_part, 5.e-5, 2.e-5);
+  const hector::Propagator prop(bl.get());
+  for (auto& part : parts)
+    prop.propagate(part, max_s);
+  const double last_s = parts.begin()->lastS();
+  const auto num_pos = std::distance(parts.begin()->begin(), parts.begin()->end());
+
+  size_t mem_before = allocated, allocs_before = allocations;
+  vector<hector::Particle::PositionsMap> flat;
+  flat.reserve(num_part);
+  for (const auto& part : parts) {
+    flat.emplace_back();
+    flat.rbegin()->reserve(num_pos);
+    for (const auto& pos : part)
+      flat.rbegin()->insert(pos);
+  }
+  const double flat_mem = double(allocated - mem_before - flat.capacity() * sizeof(flat[0])) / num_part,
+               flat_allocs = double(allocations - allocs_before - 1) / num_part;
+  mem_before = allocated;
+  allocs_before = allocations;
+  vector<map<double, hector::StateVector> > tree(num_part);
+  for (size_t i = 0; i < num_part; ++i)
+    for (const auto& pos : parts[i])
+      tree[i].insert(pos);
+  const double tree_mem = double(allocated - mem_before - tree.capacity() * sizeof(tree[0])) / num_part,
+               tree_allocs = double(allocations - allocs_before - 1) / num_part;
+
+  vector<double> lookups;
+  std::default_random_engine gen(42);
+  std::uniform_real_distribution<double> flat_s(0., last_s);
+  for (size_t i = 0; i < num_lookups; ++i)
+    lookups.emplace_back(flat_s(gen));
+
+  double sum = 0.;
+  hector::Timer tmr;
+  for (const auto& part : parts)
+    for (const auto& s : lookups)
+      sum += part.stateVectorAt(s).position().x();
+  const double flat_time = tmr.elapsed();
+  tmr.reset();
+  for (const auto& traj : tree)
+    for (const auto& s : lookups)
+      sum -= mapStateVectorAt(traj, s).position().x();
+  const double tree_time = tmr.elapsed();
+
+  cout << num_pos << " positions per trajectory (checksum: " << sum << ")\n"
+       << hector::format("%-8s %16s %16s %16s\n", "storage", "bytes/particle", "allocs/particle", "ns/lookup")
+       << hector::format(
+              "%-8s %16.0f %16.1f %16.1f\n", "map", tree_mem, tree_allocs, tree_time * 1.e9 / num_part / num_lookups)
+       << hector::format(
+              "%-8s %16.0f %16.1f %16.1f\n", "flat", flat_mem, flat_allocs, flat_time * 1.e9 / num_part / num_lookups);
+  return 0;
+}
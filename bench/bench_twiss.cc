@@ -0,0 +1,107 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "BenchmarkUtils.h"
+#include "Hector/Apertures/Aperture.h"
+#include "Hector/Beamline.h"
+#include "Hector/Elements/Element.h"
+#include "Hector/IO/TwissHandler.h"
+#include "Hector/Utils/ArgsParser.h"
+#include "Hector/Utils/String.h"
+#include "Hector/Utils/Timer.h"
+
+using namespace std;
+
+/// \file bench_twiss.cc
+/// Parsing time of a full-ring MAD-X Twiss file into a beamline, for several numbers of parsing threads
+int main(int argc, char* argv[]) {
+  string twiss_file, ip, cache_dir;
+  unsigned int num_elements, num_repeat;
+  double ip_fraction;
+  vector<int> num_threads;
+  hector::ArgsParser(argc,
+                     argv,
+                     {},
+                     {
+                         {"twiss-file", "MAD-X Twiss file (synthetic one if empty)", "", &twiss_file, 'i'},
+                         {"ip-name", "name of the interaction point", "IP5", &ip, 'c'},
+                         {"num-elements", "number of elements in the synthetic Twiss file", 25000, &num_elements, 'n'},
+                         {"ip-fraction", "relative position of the IP in the synthetic file", 0.5, &ip_fraction},
+                         {"num-repeat", "number of parsings of the file", 10, &num_repeat},
+                         {"cache-dir", "beamlines cache directory (timing the cached loads if set)", "", &cache_dir},
+                         {"num-threads", "numbers of parsing threads (0 for all hardware threads)", {1}, &num_threads},
+                     });
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+
+  const bool synthetic = twiss_file.empty();
+  if (synthetic) {
+    twiss_file = "bench_twiss.tfs";
+    hector::bench::twissFile(twiss_file, num_elements, ip_fraction);
+  }
+  const double file_size = std::ifstream(twiss_file, std::ios::ate | std::ios::binary).tellg();
+  if (!cache_dir.empty()) {  // populate the cache before the timed parsings
+    hector::Parameters::get().setTwissCacheDirectory(cache_dir);
+    hector::io::Twiss(twiss_file, ip);
+  }
+
+  cout << hector::format("%.1f MB file\n", file_size * 1.e-6);
+  double ref_time = 0.;
+  for (const auto threads : num_threads) {
+    hector::Parameters::get().setTwissParsingThreads(threads);
+    size_t num_parsed = 0, num_sequenced = 0;
+    std::string summary;
+    hector::Timer tmr;
+    for (size_t i = 0; i < num_repeat; ++i) {
+      hector::io::Twiss twiss(twiss_file, ip);
+      num_parsed = twiss.rawBeamline()->elements().size();
+      num_sequenced = twiss.beamline()->elements().size();
+      if (i == 0)  // digest of the parsed beamline, to be compared between implementations
+        for (const auto& elem : *twiss.rawBeamline())
+          summary += hector::format("%s:%d:%.12g:%.12g:%.12g:%.12g:%.12g:%d;",
+                                    elem->name().c_str(),
+                                    (int)elem->type(),
+                                    elem->s(),
+                                    elem->length(),
+                                    elem->magneticStrength(),
+                                    elem->beta().x(),
+                                    elem->relativePosition().y(),
+                                    elem->aperture() ? (int)elem->aperture()->type() : -1);
+    }
+    const double time = tmr.elapsed() / num_repeat;
+    if (ref_time == 0.)
+      ref_time = time;
+
+    cout << hector::format("%2d thread(s): %zu elements parsed, %zu after sequencing (digest %016zx)\n",
+                           threads,
+                           num_parsed,
+                           num_sequenced,
+                           std::hash<std::string>()(summary))
+         << hector::format("%14s %10.2f ms/file %10.1f MB/s %8.2f speedup\n",
+                           "",
+                           time * 1.e3,
+                           file_size / time * 1.e-6,
+                           ref_time / time);
+  }
+  if (synthetic)
+    std::remove(twiss_file.c_str());
+  return 0;
+}
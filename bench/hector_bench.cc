@@ -0,0 +1,378 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+
+#include "BenchmarkUtils.h"
+#include "Hector/Apertures/Circular.h"
+#include "Hector/Apertures/RectElliptic.h"
+#include "Hector/CompiledBeamline.h"
+#include "Hector/Elements/Collimator.h"
+#include "Hector/Elements/Dipole.h"
+#include "Hector/Elements/Kicker.h"
+#include "Hector/ParticlesBatch.h"
+#include "Hector/Propagator.h"
+#include "Hector/Utils/ArgsParser.h"
+#include "Hector/Utils/BeamProducer.h"
+#include "Hector/Utils/String.h"
+#include "Hector/Utils/Timer.h"
+
+using namespace std;
+
+//----- allocations counting (process-wide replacement of the global allocation functions)
+
+namespace {
+  std::atomic<size_t> num_allocations{0}, num_allocated_bytes{0};
+  void* allocate(size_t size) {
+    num_allocations.fetch_add(1, std::memory_order_relaxed);
+    num_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size > 0 ? size : 1))
+      return ptr;
+    throw std::bad_alloc();
+  }
+  void* allocate(size_t size, std::align_val_t align) {
+    num_allocations.fetch_add(1, std::memory_order_relaxed);
+    num_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    const size_t alignment = static_cast<size_t>(align);
+    if (void* ptr = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment))
+      return ptr;
+    throw std::bad_alloc();
+  }
+}  // namespace
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void* operator new(size_t size, std::align_val_t align) { return allocate(size, align); }
+void* operator new[](size_t size, std::align_val_t align) { return allocate(size, align); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+namespace {
+  /// Prevent the compiler from discarding the computation of a value
+  template <typename T>
+  inline void keep(const T& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+  }
+
+  /// Collection of microbenchmarks, timed by samples of repeated calls
+  class Suite {
+  public:
+    /// Timing outcome of a microbenchmark
+    struct Result {
+      string name;
+      size_t items_per_call;     ///< Number of items (particles, positions...) processed in each call
+      size_t num_calls;          ///< Total number of calls timed
+      double time;               ///< Total time of all calls (in s)
+      vector<double> latencies;  ///< Mean duration of a call in each sample (in s), sorted
+      double allocations;        ///< Mean number of allocations per call
+      double allocated_bytes;    ///< Mean number of bytes allocated per call
+      /// Number of items processed per second
+      double throughput() const { return items_per_call * num_calls / time; }
+      /// Latency percentile (in s)
+      double latency(double quantile) const { return latencies.at(quantile * (latencies.size() - 1) + 0.5); }
+    };
+
+    /// Build the suite
+    /// \param[in] filter Only run the benchmarks whose name contains this string
+    /// \param[in] num_samples Number of timed samples per benchmark
+    /// \param[in] min_sample_time Minimal duration of a sample (in s), fixing its number of calls
+    Suite(const string& filter, size_t num_samples, double min_sample_time)
+        : filter_(filter), num_samples_(std::max<size_t>(num_samples, 1)), min_sample_time_(min_sample_time) {}
+
+    /// Time a function
+    /// \param[in] name Benchmark name, as "group.function/variant"
+    /// \param[in] func Function to be called repeatedly
+    /// \param[in] items_per_call Number of items processed in each call
+    template <typename F>
+    void run(const string& name, F&& func, size_t items_per_call = 1) {
+      if (!filter_.empty() && name.find(filter_) == string::npos)
+        return;
+      func();  // warm-up (caches filling, lazy initialisations)
+      // calibrate the number of calls in a sample for it to last at least the minimal sample time
+      size_t calls_per_sample = 1;
+      for (hector::Timer tmr;; calls_per_sample *= 2) {
+        tmr.reset();
+        for (size_t i = 0; i < calls_per_sample; ++i)
+          func();
+        if (tmr.elapsed() >= min_sample_time_ || calls_per_sample >= (1ul << 30))
+          break;
+      }
+      Result res{name, items_per_call, num_samples_ * calls_per_sample, 0., {}, 0., 0.};
+      res.latencies.reserve(num_samples_);
+      const size_t allocs = num_allocations, alloc_bytes = num_allocated_bytes;
+      hector::Timer tmr;
+      for (size_t i = 0; i < num_samples_; ++i) {
+        tmr.reset();
+        for (size_t j = 0; j < calls_per_sample; ++j)
+          func();
+        const double time = tmr.elapsed();
+        res.time += time;
+        res.latencies.emplace_back(time / calls_per_sample);
+      }
+      res.allocations = (double)(num_allocations - allocs) / res.num_calls;
+      res.allocated_bytes = (double)(num_allocated_bytes - alloc_bytes) / res.num_calls;
+      std::sort(res.latencies.begin(), res.latencies.end());
+      results_.emplace_back(res);
+      cerr << hector::format("%-40s %12.4g items/s\n", name.c_str(), res.throughput());
+    }
+    /// Timing outcome of all benchmarks run
+    const vector<Result>& results() const { return results_; }
+
+    /// Write all results as a JSON document
+    void writeJSON(ostream& os) const {
+      os << "{\n  \"samples\": " << num_samples_ << ",\n  \"min_sample_time\": " << min_sample_time_
+         << ",\n  \"results\": [";
+      for (size_t i = 0; i < results_.size(); ++i) {
+        const auto& res = results_.at(i);
+        os << (i > 0 ? "," : "") << "\n    "
+           << hector::format(
+                  "{\"name\": \"%s\", \"items_per_call\": %zu, \"calls\": %zu, \"throughput\": %.6g, "
+                  "\"latency_ns\": {\"min\": %.6g, \"p50\": %.6g, \"p90\": %.6g, \"p99\": %.6g, \"max\": %.6g}, "
+                  "\"allocations_per_call\": %.6g, \"allocated_bytes_per_call\": %.6g}",
+                  res.name.c_str(),
+                  res.items_per_call,
+                  res.num_calls,
+                  res.throughput(),
+                  res.latencies.front() * 1.e9,
+                  res.latency(0.5) * 1.e9,
+                  res.latency(0.9) * 1.e9,
+                  res.latency(0.99) * 1.e9,
+                  res.latencies.back() * 1.e9,
+                  res.allocations,
+                  res.allocated_bytes);
+      }
+      os << "\n  ]\n}\n";
+    }
+    /// Write all results as comma-separated values, one line per benchmark
+    void writeCSV(ostream& os) const {
+      os << "name,items_per_call,calls,throughput,latency_min_ns,latency_p50_ns,latency_p90_ns,latency_p99_ns,"
+            "latency_max_ns,allocations_per_call,allocated_bytes_per_call\n";
+      for (const auto& res : results_)
+        os << hector::format("%s,%zu,%zu,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g\n",
+                             res.name.c_str(),
+                             res.items_per_call,
+                             res.num_calls,
+                             res.throughput(),
+                             res.latencies.front() * 1.e9,
+                             res.latency(0.5) * 1.e9,
+                             res.latency(0.9) * 1.e9,
+                             res.latency(0.99) * 1.e9,
+                             res.latencies.back() * 1.e9,
+                             res.allocations,
+                             res.allocated_bytes);
+    }
+    /// Write all results as a human-readable table
+    void writeText(ostream& os) const {
+      os << hector::format("%-40s %12s %10s %10s %10s %10s %10s\n",
+                           "benchmark",
+                           "items/s",
+                           "p50 (ns)",
+                           "p90 (ns)",
+                           "p99 (ns)",
+                           "allocs",
+                           "bytes");
+      for (const auto& res : results_)
+        os << hector::format("%-40s %12.4g %10.4g %10.4g %10.4g %10.3g %10.4g\n",
+                             res.name.c_str(),
+                             res.throughput(),
+                             res.latency(0.5) * 1.e9,
+                             res.latency(0.9) * 1.e9,
+                             res.latency(0.99) * 1.e9,
+                             res.allocations,
+                             res.allocated_bytes);
+    }
+
+  private:
+    const string filter_;
+    const size_t num_samples_;
+    const double min_sample_time_;
+    vector<Result> results_;
+  };
+}  // namespace
+
+/// \file hector_bench.cc
+/// Microbenchmarks of the propagation kernels and of their building blocks (elements matrices, apertures, beamline
+/// lookups, beam producers), reporting the throughput, latency percentiles and number of allocations of each
+/// kernel in a machine-readable form to be compared between releases
+int main(int argc, char* argv[]) {
+  string twiss_file, ip, filter, output_format, output_file;
+  unsigned int num_samples, num_part;
+  double max_s, min_sample_time;
+  hector::ArgsParser(argc,
+                     argv,
+                     {},
+                     {
+                         {"twiss-file", "MAD-X Twiss file (synthetic FODO line if empty)", "", &twiss_file, 'i'},
+                         {"ip-name", "name of the interaction point", "IP5", &ip, 'c'},
+                         {"max-s", "maximal s-coordinate (m)", 250., &max_s},
+                         {"filter", "only run the benchmarks whose name contains this string", "", &filter, 'f'},
+                         {"samples", "number of timed samples per benchmark", 100, &num_samples, 'n'},
+                         {"min-sample-time", "minimal duration of a sample (s)", 2.e-3, &min_sample_time},
+                         {"num-part", "number of particles in a propagated batch", 1000, &num_part},
+                         {"format", "output format (json, csv, or text)", "json", &output_format},
+                         {"output", "output file (standard output if empty)", "", &output_file, 'o'},
+                     });
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+  if (output_format != "json" && output_format != "csv" && output_format != "text") {
+    cerr << "Invalid output format: " << output_format << "." << endl;
+    return 1;
+  }
+
+  Suite suite(filter, num_samples, min_sample_time);
+  const hector::PropagationContext ctx;
+  const double mass = ctx.beamParticlesMass(), eloss = 0.01 * ctx.beamEnergy();
+  const int charge = ctx.beamParticlesCharge();
+
+  //----- elements matrices (computed from scratch, and retrieved from the elements caches)
+
+  const vector<hector::element::ElementPtr> elements = {
+      std::make_shared<hector::element::Drift>("drift", 0., 2.),
+      std::make_shared<hector::element::Marker>("marker", 0., 0.),
+      std::make_shared<hector::element::RectangularDipole>("rectangularDipole", 0., 10., 1.e-3),
+      std::make_shared<hector::element::SectorDipole>("sectorDipole", 0., 10., 1.e-3),
+      std::make_shared<hector::element::HorizontalQuadrupole>("horizontalQuadrupole", 0., 3., -1.e-2),
+      std::make_shared<hector::element::VerticalQuadrupole>("verticalQuadrupole", 0., 3., 1.e-2),
+      std::make_shared<hector::element::HorizontalKicker>("horizontalKicker", 0., 1., 1.e-6),
+      std::make_shared<hector::element::VerticalKicker>("verticalKicker", 0., 1., 1.e-6),
+      std::make_shared<hector::element::Collimator>("collimator", 0., 1.),
+  };
+  for (const auto& elem : elements)
+    suite.run("element.matrix/" + elem->name(), [&] { keep(elem->matrix(eloss, mass, charge, ctx)); });
+  for (const auto& elem : elements)
+    suite.run("element.cachedMatrix/" + elem->name(), [&] { keep(elem->cachedMatrix(eloss, mass, charge, ctx)); });
+
+  //----- propagation
+
+  const auto bl = hector::bench::beamline(twiss_file, ip, max_s, 5.e-3);
+  const hector::Propagator prop(bl.get(), ctx);
+  const auto cbl = prop.compile();
+  // nominal kinematics, for the transfer matrices to be retrieved from the caches as in a steady-state propagation
+  const auto parts = hector::bench::particles(std::max(num_part, 1u), 5.e-5, 1.e-6);
+  size_t id = 0;
+  suite.run("propagator.propagate/single", [&] {
+    auto part = parts[id++ % parts.size()];
+    keep(prop.tryPropagate(part, max_s));
+  });
+  suite.run("propagator.propagate/compiled", [&] {
+    auto part = parts[id++ % parts.size()];
+    keep(prop.tryPropagate(part, cbl));
+  });
+  const hector::ParticlesBatch batch(parts);
+  suite.run(
+      "propagator.propagate/batch",
+      [&] {
+        auto copy = batch;
+        prop.propagate(copy, cbl);
+        keep(copy);
+      },
+      batch.size());
+  // smeared momentum loss, every particle requiring its own transfer matrices
+  const hector::ParticlesBatch smeared_batch(hector::bench::particles(std::max(num_part, 1u), 5.e-5, 1.e-6, 1.e-3));
+  suite.run(
+      "propagator.propagate/batch-smeared",
+      [&] {
+        auto copy = smeared_batch;
+        prop.propagate(copy, cbl);
+        keep(copy);
+      },
+      smeared_batch.size());
+
+  //----- trajectories interpolation
+
+  auto traj = parts.front();
+  prop.tryPropagate(traj, max_s);
+  const double traj_length = traj.lastS() - traj.firstS();
+  suite.run("particle.stateVectorAt", [&] {
+    keep(traj.stateVectorAt(traj.firstS() + (id++ % 997) / 997. * traj_length));
+  });
+
+  //----- apertures
+
+  const vector<pair<string, hector::aperture::AperturePtr> > apertures = {
+      {"rectangular", std::make_shared<hector::aperture::Rectangular>(2.e-2, 1.5e-2)},
+      {"elliptic", std::make_shared<hector::aperture::Elliptic>(2.e-2, 1.5e-2)},
+      {"circular", std::make_shared<hector::aperture::Circular>(2.e-2)},
+      {"rectElliptic", std::make_shared<hector::aperture::RectElliptic>(2.e-2, 1.5e-2, 2.2e-2, 1.8e-2)},
+  };
+  vector<hector::TwoVector> positions;
+  {
+    std::default_random_engine gen(42);
+    std::normal_distribution<double> pos(0., 1.5e-2);
+    for (size_t i = 0; i < 1024; ++i)
+      positions.emplace_back(pos(gen), pos(gen));
+  }
+  for (const auto& aper : apertures)
+    suite.run("aperture.contains/" + aper.first,
+              [&] { keep(aper.second->contains(positions[id++ % positions.size()])); });
+
+  //----- beamline lookups
+
+  vector<string> names;
+  for (const auto& elem : bl->elements())
+    names.emplace_back(elem->name());
+  suite.run("beamline.get/name", [&] { keep(bl->get(names[id++ % names.size()])); });
+  suite.run("beamline.get/s", [&] { keep(bl->get((id++ % 997) / 997. * bl->length())); });
+  auto mutable_bl = *bl;  // Beamline::find is not constant
+  const string pattern = names.at(names.size() / 2).substr(0, 4) + ".*";
+  suite.run("beamline.find/regex", [&] { keep(mutable_bl.find(pattern)); });
+
+  //----- beam producers
+
+  hector::beam::GaussianParticleGun gaussian_gun;
+  gaussian_gun.smearX(0., 1.e-5);
+  gaussian_gun.smearTx(0., 1.e-5);
+  gaussian_gun.smearEnergy(ctx.beamEnergy(), 1.);
+  suite.run("beam.shoot/gaussian", [&] { keep(gaussian_gun.shoot()); });
+  hector::beam::FlatParticleGun flat_gun;
+  flat_gun.setXlimits(-1.e-4, 1.e-4);
+  flat_gun.setElimits(0.9 * ctx.beamEnergy(), ctx.beamEnergy());
+  suite.run("beam.shoot/flat", [&] { keep(flat_gun.shoot()); });
+  const unsigned short num_scan = 10000;
+  auto scanner = std::make_unique<hector::beam::Xscanner>(num_scan, ctx.beamEnergy(), -1.e-3, 1.e-3);
+  size_t num_scanned = 0;
+  suite.run("beam.shoot/xscanner", [&] {
+    if (num_scanned++ % num_scan == 0)  // start a new scan once the previous one is complete
+      scanner = std::make_unique<hector::beam::Xscanner>(num_scan, ctx.beamEnergy(), -1.e-3, 1.e-3);
+    keep(scanner->shoot());
+  });
+
+  //----- output
+
+  ofstream file;
+  if (!output_file.empty())
+    file.open(output_file);
+  ostream& os = output_file.empty() ? cout : file;
+  if (output_format == "json")
+    suite.writeJSON(os);
+  else if (output_format == "csv")
+    suite.writeCSV(os);
+  else
+    suite.writeText(os);
+  return 0;
+}
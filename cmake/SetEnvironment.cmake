@@ -34,6 +34,10 @@ endif()
 
 include_directories(${EIGEN3_INCLUDE_DIR})
 
+#----- threads for the parallel propagation
+
+find_package(Threads REQUIRED)
+
 #----- Pythia 8 for physics samples generation and/or LHE files parsing
 
 if(LXPLUS)
@@ -45,6 +49,10 @@ find_library(PYTHIA8 pythia8 HINTS ${PYTHIA8_DIRS} PATH_SUFFIXES lib)
 find_path(PYTHIA8_INCLUDE NAMES Pythia8/Pythia.h HINTS ${PYTHIA8_DIRS} PATH_SUFFIXES include include/Pythia8 include/pythia8)
 find_library(LHAPDF LHAPDF)
 
+#----- zlib for the compression of output files
+
+find_package(ZLIB)
+
 #----- HepMC for I/O
 
 find_library(HEPMC_LIB HepMC)
@@ -56,7 +64,8 @@ find_package(PythonInterp 3)
 if(PYTHONINTERP_FOUND)
   find_package(PythonLibs 3)
   # stupid workaround for different behaviour between Fedora's and CC8's Boost CMake bindings
-  find_package(Boost OPTIONAL_COMPONENTS python${PYTHON_VERSION_MAJOR} python${PYTHON_VERSION_MAJOR}${PYTHON_VERSION_MINOR})
+  find_package(Boost OPTIONAL_COMPONENTS python${PYTHON_VERSION_MAJOR} python${PYTHON_VERSION_MAJOR}${PYTHON_VERSION_MINOR}
+                                         numpy${PYTHON_VERSION_MAJOR}${PYTHON_VERSION_MINOR})
   if(NOT ${Boost_python${PYTHON_VERSION_MAJOR}_FOUND})
     if (NOT ${Boost_python${PYTHON_VERSION_MAJOR}${PYTHON_VERSION_MINOR}_FOUND})
       message(FATAL_ERROR "Boost Python binding not found")
@@ -3,6 +3,7 @@
 #include "Hector/Parameters.h"
 
 #include "Hector/Propagator.h"
+#include "Hector/PropagationContext.h"
 #include "Hector/Particle.h"
 
 #include "Hector/Beamline.h"
@@ -23,15 +24,20 @@
 #include "Hector/IO/TwissHandler.h"
 #include "Hector/IO/HBLFileHandler.h"
 
+#include "Hector/BeamlineTable.h"
+#include "Hector/ParallelPropagator.h"
+
 #include "Hector/Utils/BeamProducer.h"
 #include "Hector/Utils/StateVector.h"
 
 #include <CLHEP/Matrix/Matrix.h>
 #include <CLHEP/Random/RandGauss.h>
 
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <sstream>
+#include <utility>
 #include <time.h>
 
 #include <boost/version.hpp>
@@ -55,6 +61,7 @@ namespace boost {
 #endif
 
 #include <boost/python.hpp>
+#include <boost/python/numpy.hpp>
 #include <datetime.h>
 
 //----- SOME OVERLOADED FUNCTIONS/METHODS HELPERS
@@ -67,6 +74,7 @@ BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(element_matrix, matrix, 1, 3)
 
 namespace {
   namespace py = boost::python;
+  namespace np = boost::python::numpy;
 
   std::string dump_particle(const hector::Particle& part) {
     std::ostringstream os;
@@ -86,8 +94,8 @@ namespace {
     return out;
   }
   //--- helper python <-> C++ converters
-  template <class T, class U>
-  py::dict to_python_dict(std::map<T, U>& map) {
+  template <class T, class U, class M = std::map<T, U> >
+  py::dict to_python_dict(M& map) {
     py::dict dictionary;
     for (auto& it : map)
       dictionary[it.first] = it.second;
@@ -126,7 +134,7 @@ namespace {
 
   py::dict twiss_parser_header(hector::io::Twiss& parser) {
     py::dict out = to_python_dict_c<std::string, std::string>(parser.headerStrings());
-    out.update(to_python_dict_c<std::string, float>(parser.headerFloats()));
+    out.update(to_python_dict_c<std::string, double>(parser.headerFloats()));
     if (out.has_key("timestamp")) {
       time_t dt = static_cast<long>(py::extract<float>(out.get("timestamp")));
       std::tm tm;
@@ -138,6 +146,121 @@ namespace {
     return out;
   }
 
+  hector::PropagationContext twiss_parser_context(const hector::io::Twiss& parser) { return parser.context(); }
+
+  //--- helper batch propagation of NumPy arrays
+
+  /// Release the Python global interpreter lock while in scope
+  class ReleaseGIL {
+  public:
+    ReleaseGIL() : state_(PyEval_SaveThread()) {}
+    ~ReleaseGIL() { PyEval_RestoreThread(state_); }
+
+  private:
+    PyThreadState* state_;
+  };
+  /// Convert an object into a C-contiguous NumPy array of a given type and dimension, or raise a ValueError
+  template <typename T>
+  np::ndarray to_contiguous_array(const py::object& obj, int ndim, long num_rows, long num_cols, const char* name) {
+    const auto arr = np::from_object(obj, np::dtype::get_builtin<T>(), ndim, ndim, np::ndarray::C_CONTIGUOUS);
+    if (arr.shape(0) != num_rows || (ndim > 1 && arr.shape(1) != num_cols)) {
+      PyErr_SetString(PyExc_ValueError, (std::string("Invalid shape for the ") + name + " array").c_str());
+      py::throw_error_already_set();
+    }
+    return arr;
+  }
+  /// Propagate a (N, 6) array of initial states to a list of stations without holding the interpreter lock
+  /// \return a tuple of the (N, stations, 6) array of states at the stations (NaN if not reached), and the (N,) array
+  ///  of stopping elements indices (-1 if none)
+  py::tuple propagate_array(const hector::Propagator& prop,
+                            const py::object& states,
+                            const py::list& stations,
+                            const py::object& masses,
+                            const py::object& charges,
+                            unsigned short num_threads) {
+    const auto in = np::from_object(states, np::dtype::get_builtin<double>(), 2, 2, np::ndarray::C_CONTIGUOUS);
+    const long num_part = in.shape(0);
+    if (in.shape(1) != 6) {
+      PyErr_SetString(PyExc_ValueError, "Initial states must be given as a (N, 6) array");
+      py::throw_error_already_set();
+    }
+    std::unique_ptr<np::ndarray> in_masses, in_charges;
+    if (!masses.is_none())
+      in_masses.reset(new np::ndarray(to_contiguous_array<double>(masses, 1, num_part, 1, "masses")));
+    if (!charges.is_none())
+      in_charges.reset(new np::ndarray(to_contiguous_array<int>(charges, 1, num_part, 1, "charges")));
+    const std::vector<double> s_stations{py::stl_input_iterator<double>(stations), py::stl_input_iterator<double>()};
+
+    auto out = np::zeros(py::make_tuple(num_part, s_stations.size(), 6), np::dtype::get_builtin<double>());
+    auto losses = np::empty(py::make_tuple(num_part), np::dtype::get_builtin<int>());
+    const hector::ParallelPropagator parallel(prop.beamline(), num_threads, 64, prop.context());
+    {
+      const ReleaseGIL nogil;  // only plain buffers are accessed from here
+      parallel.propagate(num_part,
+                         reinterpret_cast<const double*>(in.get_data()),
+                         in_masses ? reinterpret_cast<const double*>(in_masses->get_data()) : nullptr,
+                         in_charges ? reinterpret_cast<const int*>(in_charges->get_data()) : nullptr,
+                         s_stations,
+                         reinterpret_cast<double*>(out.get_data()),
+                         reinterpret_cast<int*>(losses.get_data()));
+    }
+    return py::make_tuple(out, losses);
+  }
+
+  //--- helper zero-copy NumPy views
+
+  /// View a block of values owned by a Python object as a NumPy array, without copy
+  /// \note The array keeps the owner alive ; it is read-only if the values are constant
+  template <typename T>
+  np::ndarray array_view(T* data, const py::tuple& shape, const py::tuple& strides, const py::object& owner) {
+    if (!data)
+      return np::empty(shape, np::dtype::get_builtin<typename std::remove_const<T>::type>());
+    return np::from_data(
+        data, np::dtype::get_builtin<typename std::remove_const<T>::type>(), shape, strides, owner);
+  }
+  /// s-positions of all records in a particle trajectory
+  /// \note Records are copied, as they are reallocated whenever the trajectory is modified (e.g. by a propagation)
+  np::ndarray particle_trajectory_s(hector::Particle& part) {
+    const auto& traj = part.positions();
+    auto out = np::empty(py::make_tuple(traj.size()), np::dtype::get_builtin<double>());
+    auto* data = reinterpret_cast<double*>(out.get_data());
+    for (const auto& rec : traj)
+      *data++ = rec.first;
+    return out;
+  }
+  /// State vectors of all records in a particle trajectory, as a (records, 6) array
+  /// \note Records are copied, as they are reallocated whenever the trajectory is modified (e.g. by a propagation)
+  np::ndarray particle_trajectory_states(hector::Particle& part) {
+    const auto& traj = part.positions();
+    auto out = np::empty(py::make_tuple(traj.size(), 6), np::dtype::get_builtin<double>());
+    auto* data = reinterpret_cast<double*>(out.get_data());
+    for (const auto& rec : traj)
+      data = std::copy_n(rec.second.vector().data(), 6, data);
+    return out;
+  }
+  /// Column of a beamline table, as a writable view
+  template <hector::BeamlineTable::Column C>
+  np::ndarray table_column(const py::object& self) {
+    auto& table = py::extract<hector::BeamlineTable&>(self)();
+    return array_view(table.column(C), py::make_tuple(table.size()), py::make_tuple(sizeof(double)), self);
+  }
+  template <size_t... I>
+  void add_table_columns(py::class_<hector::BeamlineTable>& cls, std::index_sequence<I...>) {
+    (cls.add_property(hector::BeamlineTable::columnName((hector::BeamlineTable::Column)I),
+                      &table_column<(hector::BeamlineTable::Column)I>),
+     ...);
+  }
+  np::ndarray table_types(const py::object& self) {
+    const auto& types = py::extract<hector::BeamlineTable&>(self)().types();
+    return array_view(types.data(), py::make_tuple(types.size()), py::make_tuple(sizeof(int)), self);
+  }
+  np::ndarray table_aperture_types(const py::object& self) {
+    const auto& types = py::extract<hector::BeamlineTable&>(self)().apertureTypes();
+    return array_view(types.data(), py::make_tuple(types.size()), py::make_tuple(sizeof(int)), self);
+  }
+  py::list table_names(const hector::BeamlineTable& table) { return to_python_list_c(table.names()); }
+  hector::BeamlineTable beamline_table(const hector::Beamline& bl) { return hector::BeamlineTable(bl); }
+
   PyObject *except_type = nullptr, *ps_except_type = nullptr;
 
   void translate_exception(const hector::Exception& e) {
@@ -188,6 +311,8 @@ namespace {
 //----- AND HERE COMES THE MODULE
 
 BOOST_PYTHON_MODULE(pyhector) {
+  np::initialize();
+
   //----- GENERAL HELPERS
 
   py::class_<hector::TwoVector>("TwoVector", "A generic 2-vector for planar coordinates")
@@ -300,6 +425,34 @@ BOOST_PYTHON_MODULE(pyhector) {
       .add_property("enableKickers", &hector::Parameters::enableKickers, &hector::Parameters::setEnableKickers)
       .add_property("enableDipoles", &hector::Parameters::enableDipoles, &hector::Parameters::setEnableDipoles);
 
+  py::class_<hector::PropagationContext>(
+      "PropagationContext",
+      "Immutable set of run parameters used along a propagation (built from the current run parameters by default)",
+      py::init<>())
+      .def(py::init<const hector::Parameters&>())
+      .add_property("beamEnergy", &hector::PropagationContext::beamEnergy, "Beam energy (in GeV)")
+      .add_property(
+          "beamParticlesMass", &hector::PropagationContext::beamParticlesMass, "Beam particles mass (in GeV/c2)")
+      .add_property(
+          "beamParticlesCharge", &hector::PropagationContext::beamParticlesCharge, "Beam particles charge (in e)")
+      .add_property("useRelativeEnergy", &hector::PropagationContext::useRelativeEnergy)
+      .add_property("computeApertureAcceptance", &hector::PropagationContext::computeApertureAcceptance)
+      .add_property("enableKickers", &hector::PropagationContext::enableKickers)
+      .add_property("enableDipoles", &hector::PropagationContext::enableDipoles)
+      .def("withBeamEnergy", &hector::PropagationContext::withBeamEnergy, "Copy with another beam energy (in GeV)")
+      .def("withBeamParticlesMass",
+           &hector::PropagationContext::withBeamParticlesMass,
+           "Copy with another beam particles mass (in GeV/c2)")
+      .def("withBeamParticlesCharge",
+           &hector::PropagationContext::withBeamParticlesCharge,
+           "Copy with another beam particles charge (in e)")
+      .def("withRelativeEnergy", &hector::PropagationContext::withRelativeEnergy)
+      .def("withApertureAcceptance", &hector::PropagationContext::withApertureAcceptance)
+      .def("withKickers", &hector::PropagationContext::withKickers)
+      .def("withDipoles", &hector::PropagationContext::withDipoles)
+      .def(py::self == py::self)
+      .def(py::self != py::self);
+
   //----- BEAM PROPERTIES
 
   py::class_<hector::StateVector>("StateVector")
@@ -338,6 +491,10 @@ BOOST_PYTHON_MODULE(pyhector) {
       .def("momentumAt", &hector::Particle::momentumAt)
       .def("stateVectorAt", &hector::Particle::stateVectorAt)
       .add_property("positions", particle_positions)
+      .add_property("trajectoryS", particle_trajectory_s, "s-positions of the trajectory records (in metres)")
+      .add_property("trajectoryStates",
+                    particle_trajectory_states,
+                    "State vectors of the trajectory records, as a (records, 6) NumPy array")
       .def("addPosition", addPosition_pos, particle_add_position_pos_overloads())
       .def("addPosition", addPosition_vec, particle_add_position_vec_overloads());
 
@@ -525,13 +682,29 @@ BOOST_PYTHON_MODULE(pyhector) {
            "Get a beamline element by its s-position",
            py::args("element s-position"))
       .def("offsetElementsAfter", &hector::Beamline::offsetElementsAfter)
-      .def("find", beamline_found_elements);
+      .def("find", beamline_found_elements)
+      .add_property("table", beamline_table, "Columnar snapshot of the elements properties");
+
+  py::class_<hector::BeamlineTable> table(
+      "BeamlineTable",
+      "Columnar snapshot of the elements properties, each column being exposed as a NumPy view without copy",
+      py::init<const hector::Beamline&>());
+  table.add_property("names", table_names, "Elements names")
+      .add_property("types", table_types, "Elements types")
+      .add_property("apertureTypes", table_aperture_types, "Elements apertures types");
+  add_table_columns(table, std::make_index_sequence<hector::BeamlineTable::numColumns>());
 
   //----- PROPAGATOR
 
   void (hector::Propagator::*propagate_single)(hector::Particle&, double) const = &hector::Propagator::propagate;
   void (hector::Propagator::*propagate_multi)(hector::Particles&, double) const = &hector::Propagator::propagate;
   py::class_<hector::Propagator>("Propagator", "Beamline propagation helper class", py::init<const hector::Beamline*>())
+      .def(py::init<const hector::Beamline*, const hector::PropagationContext&>(
+          py::args("beamline", "context"), "Build a propagator with a given set of run parameters"))
+      .add_property(
+          "context",
+          py::make_function(&hector::Propagator::context, py::return_value_policy<py::copy_const_reference>()),
+          "Run parameters used along the propagation")
       .def("propagate",
            propagate_single,
            "Propagate a single particle into the beamline",
@@ -539,7 +712,17 @@ BOOST_PYTHON_MODULE(pyhector) {
       .def("propagate",
            propagate_multi,
            "Propagate a collection of particles into the beamline",
-           py::args("particles object collection", "maximal s-position for the propagation"));
+           py::args("particles object collection", "maximal s-position for the propagation"))
+      .def("propagateArray",
+           propagate_array,
+           (py::arg("states"),
+            py::arg("stations"),
+            py::arg("masses") = py::object(),
+            py::arg("charges") = py::object(),
+            py::arg("num_threads") = 1),
+           "Propagate a (N, 6) array of initial states (x, Tx, y, Ty, E, kick) to a list of s-positions, on several "
+           "threads and without holding the interpreter lock ; returns the (N, stations, 6) array of states at the "
+           "stations (NaN if not reached) and the (N,) array of stopping elements indices (-1 if none)");
 
   //----- I/O HANDLERS
 
@@ -549,7 +732,11 @@ BOOST_PYTHON_MODULE(pyhector) {
           "beamline",
           py::make_function(&hector::io::Twiss::beamline, py::return_value_policy<py::reference_existing_object>()),
           "Beamline object parsed from the Twiss file")
-      .add_property("header", twiss_parser_header);
+      .add_property("header", twiss_parser_header)
+      .add_property("context", twiss_parser_context, "Propagation context matching the Twiss file header")
+      .def("applyHeaderParameters",
+           &hector::io::Twiss::applyHeaderParameters,
+           "Copy the beam properties of the Twiss file header into the run parameters");
 
   py::class_<hector::io::HBL>("HBLparser", "A HBL files parser", py::init<const char*>())
       .add_property(
@@ -0,0 +1,84 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <limits>
+#include <typeinfo>
+
+#include "Hector/Apertures/ApertureTable.h"
+#include "Hector/Apertures/Circular.h"
+#include "Hector/Apertures/RectElliptic.h"
+#include "Hector/Apertures/Rectangular.h"
+
+namespace hector {
+  namespace aperture {
+    ApertureTable::ApertureTable(const std::vector<const Aperture*>& apertures) {
+      static constexpr double inf = std::numeric_limits<double>::infinity();
+      entries_.reserve(apertures.size());
+      generic_.reserve(apertures.size());
+      for (const auto& aper : apertures) {
+        Entry entry{Shape::none, 0., 0., inf, inf, inf, inf};
+        generic_.emplace_back();
+        if (aper && aper->type() != anInvalidAperture) {
+          const auto& type = typeid(*aper);
+          entry.shape = Shape::flat;
+          entry.x = aper->x();
+          entry.y = aper->y();
+          if (type == typeid(Rectangular))
+            entry.rect_x = aper->p(0), entry.rect_y = aper->p(1);
+          else if (type == typeid(Elliptic) || type == typeid(Circular))
+            entry.ell_x = aper->p(0), entry.ell_y = aper->p(1);
+          else if (type == typeid(RectElliptic)) {
+            entry.rect_x = aper->p(0), entry.rect_y = aper->p(1);
+            entry.ell_x = aper->p(2), entry.ell_y = aper->p(3);
+          } else {
+            entry.shape = Shape::generic;
+            *generic_.rbegin() = aper->clone();
+          }
+        }
+        entries_.emplace_back(entry);
+      }
+    }
+
+    bool ApertureTable::contains(size_t i, const TwoVector& pos) const {
+      const auto& entry = entries_.at(i);
+      if (entry.shape == Shape::generic)
+        return generic_.at(i)->contains(pos);
+      const double dx = pos.x() - entry.x, dy = pos.y() - entry.y;
+      const double ex = dx / entry.ell_x, ey = dy / entry.ell_y;
+      return (std::fabs(dx) < entry.rect_x) & (std::fabs(dy) < entry.rect_y) & (ex * ex + ey * ey < 1.);
+    }
+
+    void ApertureTable::contains(size_t i, const double* x, const double* y, size_t num, double* accepted) const {
+      const auto& entry = entries_.at(i);
+      if (entry.shape == Shape::generic) {
+        for (size_t j = 0; j < num; ++j)
+          accepted[j] = generic_.at(i)->contains(TwoVector(x[j], y[j])) ? 1. : 0.;
+        return;
+      }
+      const double cx = entry.x, cy = entry.y, rx = entry.rect_x, ry = entry.rect_y;
+      const double ell_x = entry.ell_x, ell_y = entry.ell_y;
+      for (size_t j = 0; j < num; ++j) {
+        const double dx = x[j] - cx, dy = y[j] - cy;
+        const double ex = dx / ell_x, ey = dy / ell_y;
+        const bool in = (std::fabs(dx) < rx) & (std::fabs(dy) < ry) & (ex * ex + ey * ey < 1.);
+        accepted[j] = in ? 1. : 0.;
+      }
+    }
+  }  // namespace aperture
+}  // namespace hector
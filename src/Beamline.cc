@@ -17,11 +17,16 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <mutex>
 #include <regex>
 #include <sstream>
+#include <string_view>
+#include <unordered_map>
 
 #include "Hector/Beamline.h"
+#include "Hector/BeamlineBuilder.h"
 #include "Hector/Elements/Drift.h"
 #include "Hector/Exception.h"
 #include "Hector/Parameters.h"
@@ -29,6 +34,140 @@
 #include "Hector/Utils/String.h"
 
 namespace hector {
+  struct Beamline::Stamps {
+    explicit Stamps(const element::Elements& elements);
+    /// Are the stamps still describing a list of elements?
+    /// \note Elements are only compared one by one if any element was constructed, or modified while being part of a
+    ///  beamline, since the last check
+    bool matches(const element::Elements& elements) const;
+
+    /// Revision of the beamline content described by these stamps
+    const unsigned long long revision;
+    /// Latest revision given to a beamline content
+    static std::atomic<unsigned long long> last_revision;
+    /// Address and revision of each element at the stamps construction
+    std::vector<std::pair<const element::Element*, unsigned long long> > elements;
+    /// Latest beamline change counter value for which the stamps were found to match the elements list
+    mutable std::atomic<unsigned long long> checked;
+  };
+
+  std::atomic<unsigned long long> Beamline::Stamps::last_revision(0);
+
+  Beamline::Stamps::Stamps(const element::Elements& elems)
+      : revision(++last_revision), checked(element::Element::lastBeamlineChange()) {
+    elements.reserve(elems.size());
+    for (const auto& elem : elems) {
+      elem->in_beamline_ = true;  // any later modification is now reported
+      elements.emplace_back(elem.get(), elem->revision());
+    }
+  }
+
+  bool Beamline::Stamps::matches(const element::Elements& elems) const {
+    if (elems.size() != elements.size())
+      return false;
+    const auto last = element::Element::lastBeamlineChange();
+    if (checked == last)  // no element constructed or modified in a beamline since the last check
+      return true;
+    for (size_t i = 0; i < elements.size(); ++i)
+      if (elems[i].get() != elements[i].first || elems[i]->revision() != elements[i].second)
+        return false;
+    checked = last;
+    return true;
+  }
+
+  struct Beamline::Index {
+    Index(const element::Elements& elements, unsigned long long revision);
+    /// Position of the first element whose name contains a string (number of elements if none)
+    size_t byName(const std::string& name) const;
+    /// Position of the first element covering a s-position (number of elements if none)
+    size_t byS(double s) const;
+    /// Position of the first element whose name contains a string, from the suffixes table
+    size_t search(const std::string_view& name) const;
+    /// Suffix of an element name
+    std::string_view suffix(const std::pair<size_t, size_t>& sfx) const {
+      return std::string_view(names[sfx.first]).substr(sfx.second);
+    }
+
+    const size_t size;
+    /// Revision of the beamline content described by this index
+    const unsigned long long revision;
+    std::vector<std::string> names;
+    /// All names suffixes, as (element, offset) pairs sorted lexicographically
+    std::vector<std::pair<size_t, size_t> > suffixes;
+    /// Result of the name lookup for each full element name
+    std::unordered_map<std::string, size_t> by_name;
+    /// Are the elements sorted in s?
+    bool sorted;
+    std::vector<double> s_begin, s_end;
+    /// Maximal exit s-position of all elements up to each element
+    std::vector<double> max_s_end;
+
+    /// Maximal number of regular expressions for which the find results are kept
+    static constexpr size_t max_patterns = 16;
+    std::mutex found_mutex;
+    /// Elements matching each regular expression already searched
+    std::vector<std::pair<std::string, std::vector<size_t> > > found;
+  };
+
+  Beamline::Index::Index(const element::Elements& elements, unsigned long long revision)
+      : size(elements.size()), revision(revision), sorted(true) {
+    names.reserve(size);
+    s_begin.reserve(size);
+    s_end.reserve(size);
+    max_s_end.reserve(size);
+    for (size_t i = 0; i < size; ++i) {
+      const auto& elem = elements.at(i);
+      names.emplace_back(elem->name());
+      s_begin.emplace_back(elem->s());
+      s_end.emplace_back(elem->s() + elem->length());
+      max_s_end.emplace_back(i == 0 ? s_end.at(i) : std::max(max_s_end.at(i - 1), s_end.at(i)));
+      if (i > 0 && s_begin.at(i) < s_begin.at(i - 1))
+        sorted = false;
+      for (size_t j = 0; j < names.at(i).size(); ++j)
+        suffixes.emplace_back(i, j);
+    }
+    std::sort(suffixes.begin(), suffixes.end(), [this](const auto& lhs, const auto& rhs) {
+      const auto lhs_sfx = suffix(lhs), rhs_sfx = suffix(rhs);
+      return lhs_sfx < rhs_sfx || (lhs_sfx == rhs_sfx && lhs.first < rhs.first);
+    });
+    for (const auto& name : names)
+      if (by_name.count(name) == 0)
+        by_name[name] = search(name);
+  }
+
+  size_t Beamline::Index::byName(const std::string& name) const {
+    if (name.empty())
+      return 0;
+    const auto it = by_name.find(name);
+    if (it != by_name.end())
+      return it->second;
+    return search(name);
+  }
+
+  size_t Beamline::Index::search(const std::string_view& name) const {
+    // all suffixes starting with the name are contiguous in the table
+    auto it = std::lower_bound(suffixes.begin(), suffixes.end(), name, [this](const auto& sfx, const auto& name) {
+      return suffix(sfx) < name;
+    });
+    size_t first = size;
+    for (; it != suffixes.end() && suffix(*it).substr(0, name.size()) == name; ++it)
+      first = std::min(first, it->first);
+    return first;
+  }
+
+  size_t Beamline::Index::byS(double s) const {
+    if (!sorted) {
+      for (size_t i = 0; i < size; ++i)
+        if (s_begin.at(i) <= s && s_end.at(i) >= s)
+          return i;
+      return size;
+    }
+    // among the elements starting before s, the first one ending after s
+    const size_t num_before = std::upper_bound(s_begin.begin(), s_begin.end(), s) - s_begin.begin();
+    const size_t first = std::lower_bound(max_s_end.begin(), max_s_end.begin() + num_before, s) - max_s_end.begin();
+    return first < num_before ? first : size;
+  }
+
   Beamline::Beamline() : max_length_(0.) {}
 
   Beamline::Beamline(const Beamline& rhs, bool copy_elements)
@@ -47,7 +186,36 @@ namespace hector {
     markers_.clear();
   }
 
-  void Beamline::clear() { elements_.clear(); }
+  void Beamline::clear() {
+    elements_.clear();
+    reindex();
+  }
+
+  void Beamline::reindex() {
+    std::atomic_store(&stamps_, std::shared_ptr<Stamps>());
+    std::atomic_store(&index_, std::shared_ptr<Index>());
+  }
+
+  unsigned long long Beamline::revision() const {
+    auto stamps = std::atomic_load(&stamps_);
+    while (!stamps || !stamps->matches(elements_)) {
+      // only one revision is kept if several threads find the content modified
+      auto fresh = std::make_shared<Stamps>(elements_);
+      if (std::atomic_compare_exchange_strong(&stamps_, &stamps, fresh))
+        return fresh->revision;
+    }
+    return stamps->revision;
+  }
+
+  std::shared_ptr<Beamline::Index> Beamline::index() const {
+    const auto revision = this->revision();
+    auto index = std::atomic_load(&index_);
+    if (!index || index->revision != revision) {
+      index = std::make_shared<Index>(elements_, revision);
+      std::atomic_store(&index_, index);
+    }
+    return index;
+  }
 
   void Beamline::addMarker(const element::Marker& marker) {
     markers_.insert(std::pair<double, element::Marker>(marker.s(), marker));
@@ -68,44 +236,14 @@ namespace hector {
         already_added = true;
         break;
       }
-
       if (prev_elem->s() > elem->s())
         break;
-      if (prev_elem->s() + prev_elem->length() <= elem->s())
-        continue;
-      if (prev_elem->length() == 0)
-        continue;
-      if (prev_elem->s() == elem->s() && elem->length() == 0)
+      if (!overlaps(prev_elem, elem))
         continue;
 
-      if (!Parameters::get().correctBeamlineOverlaps())
-        throw H_ERROR << "Elements overlap with \"" << prev_elem->name() << "\" "
-                      << "detected while adding \"" << elem->name() << "\"!";
-
       // from that point on, an overlap is detected
       // reduce or separate that element in two sub-parts
-
-      H_DEBUG << elem->name() << " (" << elem->type() << ") is inside " << prev_elem->name() << " ("
-              << prev_elem->type() << ")\n\t"
-              << "Hector will fix the overlap by splitting the earlier.";
-      const double prev_length = prev_elem->length();
-
-      element::ElementPtr next_elem = nullptr;
-      // check if one needs to add an extra piece to the previous element
-      if (elem->s() + elem->length() < prev_elem->s() + prev_elem->length()) {
-        const std::string prev_name = prev_elem->name();
-        prev_elem->setName(format("%s/1", prev_name.c_str()));
-        next_elem = prev_elem->clone();
-        next_elem->setName(format("%s/2", prev_name.c_str()));
-        next_elem->setS(elem->s() + elem->length());
-        next_elem->setLength(prev_length - elem->length());
-        next_elem->setBeta(elem->beta());
-        next_elem->setDispersion(elem->dispersion());
-        next_elem->setRelativePosition(elem->relativePosition());
-        next_elem->setParentElement(prev_elem);
-      }
-
-      prev_elem->setLength(elem->s() - prev_elem->s());
+      const auto next_elem = split(prev_elem, elem);
 
       elements_.push_back(elem);
       already_added = true;
@@ -121,66 +259,98 @@ namespace hector {
 
     // sort all beamline elements according to their s-position
     std::sort(elements_.begin(), elements_.end(), element::ElementsSorter());
+    reindex();
   }
 
-  const element::ElementPtr& Beamline::get(const std::string& name) const {
-    for (const auto& elem : elements_)
-      if (elem->name().find(name) != std::string::npos)
-        return elem;
-    H_WARNING << "Beamline element \"" << name << "\" not found.";
-    return *elements_.end();
+  bool Beamline::overlaps(const element::ElementPtr& prev_elem, const element::ElementPtr& elem) {
+    if (prev_elem->s() > elem->s())
+      return false;
+    if (prev_elem->s() + prev_elem->length() <= elem->s())
+      return false;
+    if (prev_elem->length() == 0)
+      return false;
+    if (prev_elem->s() == elem->s() && elem->length() == 0)
+      return false;
+    return true;
   }
 
-  element::ElementPtr& Beamline::get(const std::string& name) {
-    for (auto& elem : elements_)
-      if (elem->name().find(name) != std::string::npos)
-        return elem;
+  element::ElementPtr Beamline::split(const element::ElementPtr& prev_elem, const element::ElementPtr& elem) {
+    if (!Parameters::get().correctBeamlineOverlaps())
+      throw H_ERROR << "Elements overlap with \"" << prev_elem->name() << "\" "
+                    << "detected while adding \"" << elem->name() << "\"!";
+
+    H_DEBUG << elem->name() << " (" << elem->type() << ") is inside " << prev_elem->name() << " ("
+            << prev_elem->type() << ")\n\t"
+            << "Hector will fix the overlap by splitting the earlier.";
+    const double prev_end = prev_elem->s() + prev_elem->length(), elem_end = elem->s() + elem->length();
+
+    element::ElementPtr next_elem = nullptr;
+    // check if one needs to add an extra piece to the previous element
+    if (elem_end < prev_end) {
+      const std::string prev_name = prev_elem->name();
+      prev_elem->setName(format("%s/1", prev_name.c_str()));
+      next_elem = prev_elem->clone();
+      next_elem->setName(format("%s/2", prev_name.c_str()));
+      next_elem->setS(elem_end);
+      next_elem->setLength(prev_end - elem_end);
+      next_elem->setBeta(elem->beta());
+      next_elem->setDispersion(elem->dispersion());
+      next_elem->setRelativePosition(elem->relativePosition());
+      next_elem->setParentElement(prev_elem);
+    }
+    prev_elem->setLength(elem->s() - prev_elem->s());
+    return next_elem;
+  }
+
+  const element::ElementPtr& Beamline::get(const std::string& name) const {
+    const size_t id = index()->byName(name);
+    if (id < elements_.size())
+      return elements_[id];
     H_WARNING << "Beamline element \"" << name << "\" not found.";
     return *elements_.end();
   }
 
   const element::ElementPtr& Beamline::get(double s) const {
-    for (const auto& elem : elements_) {
-      if (elem->s() > s)
-        continue;
-      if (elem->s() <= s && elem->s() + elem->length() >= s)
-        return elem;
-    }
+    const size_t id = index()->byS(s);
+    if (id < elements_.size())
+      return elements_[id];
     H_WARNING << "Beamline has no element at s=" << s << ".";
     return *elements_.end();
   }
 
-  element::ElementPtr& Beamline::get(double s) {
-    for (auto& elem : elements_) {
-      if (elem->s() > s)
-        continue;
-      if (elem->s() <= s && elem->s() + elem->length() >= s)
-        return elem;
-    }
-    return *elements_.end();
-  }
-
   element::Elements Beamline::find(const std::string& regex) {
-    try {
-      std::regex rgx_search(regex);
-      std::cmatch m;
-      element::Elements out;
-      for (auto& elem : elements_)
-        if (std::regex_search(elem->name().c_str(), m, rgx_search))
-          out.emplace_back(elem);
-      return out;
-    } catch (const std::regex_error& e) {
-      throw H_ERROR << "Invalid regular expression required:\n\t" << regex << "\n\tError code: " << e.code() << ".";
+    const auto index = this->index();
+    std::lock_guard<std::mutex> lock(index->found_mutex);
+    auto it = std::find_if(
+        index->found.begin(), index->found.end(), [&regex](const auto& pattern) { return pattern.first == regex; });
+    if (it == index->found.end()) {  // first search for this pattern
+      std::vector<size_t> ids;
+      try {
+        const std::regex rgx_search(regex);
+        for (size_t i = 0; i < index->size; ++i)
+          if (std::regex_search(index->names.at(i), rgx_search))
+            ids.emplace_back(i);
+      } catch (const std::regex_error& e) {
+        throw H_ERROR << "Invalid regular expression required:\n\t" << regex << "\n\tError code: " << e.code() << ".";
+      }
+      if (index->found.size() >= Index::max_patterns)
+        index->found.erase(index->found.begin());
+      it = index->found.insert(index->found.end(), std::make_pair(regex, ids));
     }
+    element::Elements out;
+    out.reserve(it->second.size());
+    for (const auto& id : it->second)
+      out.emplace_back(elements_.at(id));
+    return out;
   }
 
-  Matrix Beamline::matrix(double eloss, double mp, int qp) const {
-    Matrix out = DiagonalMatrix(6, 1);
+  Matrix Beamline::matrix(double eloss, double mp, int qp, const PropagationContext& ctx) const {
+    Matrix out = DiagonalMatrix::Identity();
 
     for (const auto& elem : elements_) {
-      const auto& mat = elem->matrix(eloss, mp, qp);
-      H_INFO << "Multiplication by transfer matrix of element \"" << elem->name() << "\".\n"
-             << " value: " << mat;
+      const auto mat = elem->cachedMatrix(eloss, mp, qp, ctx);
+      H_DEBUG << "Multiplication by transfer matrix of element \"" << elem->name() << "\".\n"
+              << " value: " << mat;
       out = out * mat;
     }
 
@@ -228,7 +398,8 @@ namespace hector {
     // add the drifts between optical elements
     double pos = 0.;
     // brand new beamline to populate
-    std::unique_ptr<Beamline> tmp(new Beamline(*beamline, false));
+    BeamlineBuilder builder(*beamline);
+    builder.reserve(2 * beamline->elements().size());
 
     // convert all empty spaces into drifts
     for (const auto& elemPtr : *beamline) {
@@ -239,24 +410,14 @@ namespace hector {
       const double drift_length = elemPtr->s() - pos;
       try {
         if (drift_length > 0.)
-          tmp->add(std::make_shared<element::Drift>(format("drift:%.4E", pos).c_str(), pos, drift_length));
-        tmp->add(elemPtr);
+          builder.add(std::make_shared<element::Drift>(format("drift:%.4E", pos).c_str(), pos, drift_length));
+        builder.add(elemPtr);
       } catch (const Exception& e) {
         e.dump(std::cerr);
       }
       pos = elemPtr->s() + elemPtr->length();
     }
-    // add the last drift
-    const double drift_length = tmp->length() - pos;
-    if (drift_length > 0) {
-      try {
-        tmp->add(std::make_shared<element::Drift>(format("drift:%.4E", pos).c_str(), pos, drift_length));
-      } catch (const Exception& e) {
-        e.dump(std::cerr);
-      }
-    }
-
-    return tmp;
+    return builder.build();
   }
 
   void Beamline::setElements(const Beamline& moth_bl) {
@@ -0,0 +1,91 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "Hector/BeamlineBuilder.h"
+#include "Hector/Elements/Element.h"
+#include "Hector/Exception.h"
+
+namespace hector {
+  BeamlineBuilder::BeamlineBuilder(const Beamline& properties) : properties_(properties, false) {}
+
+  void BeamlineBuilder::add(const element::ElementPtr& elem) {
+    const double new_size = elem->s() + elem->length();
+    if (new_size > properties_.max_length_ && properties_.max_length_ < 0.)
+      throw H_ERROR << "Element " << elem->name() << " is too far away for this beamline!\n"
+                    << "\tBeamline length: " << properties_.max_length_ << " m, this element: " << new_size << " m.";
+    elements_.emplace_back(elem);
+  }
+
+  std::unique_ptr<Beamline> BeamlineBuilder::build() {
+    // strict ordering along s, then along the exit position
+    const auto by_position = [](const element::ElementPtr& lhs, const element::ElementPtr& rhs) {
+      if (lhs->s() != rhs->s())
+        return lhs->s() < rhs->s();
+      return lhs->s() + lhs->length() < rhs->s() + rhs->length();
+    };
+    std::stable_sort(elements_.begin(), elements_.end(), by_position);
+
+    std::unique_ptr<Beamline> bl(new Beamline(properties_, false));
+    auto& out = bl->elements_;
+    out.reserve(elements_.size() + elements_.size() / 4);
+
+    std::unordered_set<std::string> names;
+    names.reserve(elements_.size());
+    // elements (or remaining parts of split elements) still open at the current s-position, sorted as in the beamline
+    element::Elements open;
+    for (const auto& elem : elements_) {
+      // first check if the element is already present in the beamline
+      if (!names.insert(elem->name()).second)
+        continue;
+      // forget all elements closed before this one
+      open.erase(std::remove_if(open.begin(),
+                                open.end(),
+                                [&elem](const element::ElementPtr& prev_elem) {
+                                  return prev_elem->s() + prev_elem->length() <= elem->s();
+                                }),
+                 open.end());
+      // only the first overlapping element is split, as in the sequential insertion
+      element::ElementPtr next_elem = nullptr;
+      for (const auto& prev_elem : open) {
+        if (prev_elem->s() > elem->s())
+          break;
+        if (!Beamline::overlaps(prev_elem, elem))
+          continue;
+        next_elem = Beamline::split(prev_elem, elem);
+        break;
+      }
+      out.emplace_back(elem);
+      for (const auto& new_elem : {elem, next_elem}) {
+        if (!new_elem || new_elem->length() == 0.)
+          continue;
+        open.insert(std::upper_bound(open.begin(), open.end(), new_elem, by_position), new_elem);
+      }
+      if (next_elem)
+        out.emplace_back(next_elem);
+    }
+    elements_.clear();
+
+    // sort all beamline elements according to their s-position
+    std::stable_sort(out.begin(), out.end(), by_position);
+    bl->reindex();
+    return bl;
+  }
+}  // namespace hector
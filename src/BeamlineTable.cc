@@ -0,0 +1,97 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <limits>
+
+#include "Hector/Apertures/Aperture.h"
+#include "Hector/Beamline.h"
+#include "Hector/BeamlineTable.h"
+#include "Hector/Elements/Element.h"
+#include "Hector/Exception.h"
+
+namespace hector {
+  BeamlineTable::BeamlineTable(const Beamline& bl) {
+    const auto& elements = bl.elements();
+    const size_t num_elements = elements.size();
+    values_.assign(numColumns * num_elements, std::numeric_limits<double>::quiet_NaN());
+    names_.reserve(num_elements);
+    types_.reserve(num_elements);
+    aperture_types_.reserve(num_elements);
+    for (size_t i = 0; i < num_elements; ++i) {
+      const auto& elem = elements.at(i);
+      names_.emplace_back(elem->name());
+      types_.emplace_back(elem->type());
+      column(s)[i] = elem->s();
+      column(length)[i] = elem->length();
+      column(magneticStrength)[i] = elem->magneticStrength();
+      column(betaX)[i] = elem->beta().x();
+      column(betaY)[i] = elem->beta().y();
+      column(dispersionX)[i] = elem->dispersion().x();
+      column(dispersionY)[i] = elem->dispersion().y();
+      column(relativeX)[i] = elem->relativePosition().x();
+      column(relativeY)[i] = elem->relativePosition().y();
+      const auto& aper = elem->aperture();
+      aperture_types_.emplace_back(aper ? aper->type() : aperture::anInvalidAperture);
+      if (!aper)
+        continue;
+      column(apertureX)[i] = aper->x();
+      column(apertureY)[i] = aper->y();
+      const auto& params = aper->parameters();
+      for (size_t j = 0; j < params.size() && j < 4; ++j)
+        column((Column)(apertureP1 + j))[i] = params.at(j);
+    }
+  }
+
+  const char* BeamlineTable::columnName(Column col) {
+    switch (col) {
+      case s:
+        return "s";
+      case length:
+        return "length";
+      case magneticStrength:
+        return "magneticStrength";
+      case betaX:
+        return "betaX";
+      case betaY:
+        return "betaY";
+      case dispersionX:
+        return "dispersionX";
+      case dispersionY:
+        return "dispersionY";
+      case relativeX:
+        return "relativeX";
+      case relativeY:
+        return "relativeY";
+      case apertureX:
+        return "apertureX";
+      case apertureY:
+        return "apertureY";
+      case apertureP1:
+        return "apertureP1";
+      case apertureP2:
+        return "apertureP2";
+      case apertureP3:
+        return "apertureP3";
+      case apertureP4:
+        return "apertureP4";
+      case numColumns:
+        break;
+    }
+    throw H_ERROR << "Invalid beamline table column: " << (int)col << ".";
+  }
+}  // namespace hector
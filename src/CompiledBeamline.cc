@@ -0,0 +1,120 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <mutex>
+
+#include "Hector/Beamline.h"
+#include "Hector/CompiledBeamline.h"
+#include "Hector/Elements/Element.h"
+#include "Hector/Exception.h"
+
+namespace hector {
+  CompiledBeamline::CompiledBeamline(
+      const Beamline* bl, const PropagationContext& ctx, std::vector<double> stations, double s_min, double s_max)
+      : beamline_(bl), revision_(bl->revision()), context_(ctx), s_min_(s_min), next_(0) {
+    std::sort(stations.begin(), stations.end());
+    auto station = std::upper_bound(stations.begin(), stations.end(), s_min);
+    bool open = false;  // can the last segment be extended?
+    std::vector<const aperture::Aperture*> apertures;
+    for (size_t elem_id = 0; elem_id < beamline_->elements().size(); ++elem_id) {
+      const auto& elem = beamline_->elements().at(elem_id);
+      auto compiled = elem;
+      if (elem->s() < s_min) {
+        if (elem->s() + elem->length() <= s_min)
+          continue;
+        // path starting inside this element: build a temporary element mimicking its downstream part
+        compiled = elem->clone();
+        compiled->setS(s_min);
+        compiled->setLength(elem->s() + elem->length() - s_min);
+      } else if (elem_id == 0)  // as in the element-by-element propagation, only traversed if starting inside
+        continue;
+      if (s_max >= 0. && elem->s() > s_max)
+        break;
+      const size_t id = elements_.size();
+      const double s_begin = compiled->s(), s_end = s_begin + compiled->length();
+      elements_.emplace_back(compiled);
+      const auto& aper = elem->aperture();
+      const bool check_aper =
+          context_.computeApertureAcceptance() && aper && aper->type() != aperture::anInvalidAperture;
+      apertures.emplace_back(check_aper ? aper : nullptr);
+      if (check_aper) {
+        segments_.emplace_back(Segment{id, id + 1, s_begin, s_end, elem, elem_id});
+        open = false;
+      } else if (open) {
+        auto& seg = *segments_.rbegin();
+        seg.last = id + 1;
+        seg.s_end = s_end;
+      } else {
+        segments_.emplace_back(Segment{id, id + 1, s_begin, s_end, nullptr, 0});
+        open = true;
+      }
+      // close the segment once a station is reached
+      if (station != stations.end() && *station <= s_end) {
+        station = std::upper_bound(station, stations.end(), s_end);
+        open = false;
+      }
+    }
+    apertures_ = aperture::ApertureTable(apertures);
+    matrices_.reserve(max_kinematics);
+  }
+
+  std::shared_ptr<const CompiledBeamline::Matrices> CompiledBeamline::matrices(double eloss, double mp, int qp) const {
+    if (auto found = findMatrices(eloss, mp, qp))
+      return found;
+    auto mats = std::make_shared<Matrices>();
+    mats->reserve(segments_.size());
+    for (const auto& seg : segments_) {
+      Matrix mat = elements_.at(seg.first)->cachedMatrix(eloss, mp, qp, context_);
+      for (size_t i = seg.first + 1; i < seg.last; ++i)
+        mat = elements_.at(i)->cachedMatrix(eloss, mp, qp, context_) * mat;
+      mats->emplace_back(mat);
+    }
+    setMatrices(eloss, mp, qp, mats);
+    return mats;
+  }
+
+  std::shared_ptr<const CompiledBeamline::Matrices> CompiledBeamline::findMatrices(double eloss,
+                                                                                   double mp,
+                                                                                   int qp) const {
+    const element::MatrixCache::Key key(eloss, mp, qp, context_);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    for (const auto& entry : matrices_)
+      if (entry.first == key)
+        return entry.second;
+    return nullptr;
+  }
+
+  void CompiledBeamline::setMatrices(double eloss, double mp, int qp, std::shared_ptr<const Matrices> mats) const {
+    if (!mats || mats->size() != segments_.size())
+      throw H_ERROR << "Invalid number of fused matrices provided for " << segments_.size() << " segments.";
+    const element::MatrixCache::Key key(eloss, mp, qp, context_);
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    for (auto& entry : matrices_)
+      if (entry.first == key) {
+        entry.second = mats;
+        return;
+      }
+    if (matrices_.size() < max_kinematics)
+      matrices_.emplace_back(key, mats);
+    else {
+      matrices_[next_] = std::make_pair(key, mats);
+      next_ = (next_ + 1) % max_kinematics;
+    }
+  }
+}  // namespace hector
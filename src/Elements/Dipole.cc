@@ -19,18 +19,17 @@
 #include "Hector/Elements/Dipole.h"
 #include "Hector/Elements/Drift.h"
 #include "Hector/Exception.h"
-#include "Hector/Parameters.h"
 #include "Hector/Utils/StateVector.h"
 
 namespace hector {
   namespace element {
-    Matrix SectorDipole::matrix(double eloss, double mp, int qp) const {
+    Matrix SectorDipole::matrix(double eloss, double mp, int qp, const PropagationContext& ctx) const {
       Matrix mat = Drift::genericMatrix(length_);
 
-      if (!Parameters::get().enableDipoles())
+      if (!ctx.enableDipoles())
         return mat;
 
-      const double ke = fieldStrength(eloss, mp, qp);
+      const double ke = fieldStrength(eloss, mp, qp, ctx);
       if (ke == 0.) {  // simple drift matrix
         H_DEBUG << "Sector dipole " << name_ << " has no effect. Treating it as a drift.";
         return mat;
@@ -38,13 +37,13 @@ namespace hector {
 
       const double radius = 1. / ke;
       const double theta = length_ * ke, s_theta = sin(theta), c_theta = cos(theta);
-      const double inv_energy = 1. / Parameters::get().beamEnergy();
+      const double inv_energy = 1. / ctx.beamEnergy();
 
       mat(StateVector::X, StateVector::X) = c_theta;
       mat(StateVector::X, StateVector::TX) = s_theta * radius;
       mat(StateVector::TX, StateVector::X) = s_theta * (-ke);
       mat(StateVector::TX, StateVector::TX) = c_theta;
-      if (Parameters::get().useRelativeEnergy()) {
+      if (ctx.useRelativeEnergy()) {
         const double simp = 2. * radius * pow(sin(theta * 0.5), 2) * inv_energy;
         // numerically stable version of ( r/E₀ )*( 1-cos θ )
         mat(StateVector::X, StateVector::E) = simp;
@@ -53,13 +52,13 @@ namespace hector {
       return mat;
     }
 
-    Matrix RectangularDipole::matrix(double eloss, double mp, int qp) const {
+    Matrix RectangularDipole::matrix(double eloss, double mp, int qp, const PropagationContext& ctx) const {
       Matrix mat = Drift::genericMatrix(length_);
 
-      if (!Parameters::get().enableDipoles())
+      if (!ctx.enableDipoles())
         return mat;
 
-      const double ke = fieldStrength(eloss, mp, qp);
+      const double ke = fieldStrength(eloss, mp, qp, ctx);
       if (ke == 0.) {  // simple drift matrix
         H_DEBUG << "Rectangular dipole " << name_ << " has no effect. Treating it as a drift.";
         return mat;
@@ -68,7 +67,7 @@ namespace hector {
       const double radius = 1. / ke;
       const double theta = length_ * ke, s_theta = sin(theta), c_theta = cos(theta);
       //std::cout << name_ << "|" << eloss << "|" << radius << "|" << ke << "|" << theta << "|" << s_theta << "|" << c_theta << std::endl;
-      const double inv_energy = 1. / Parameters::get().beamEnergy();
+      const double inv_energy = 1. / ctx.beamEnergy();
       // numerically stable version of ( r/E₀ )*( 1-cos θ )
       const double simp = 2. * radius * pow(sin(theta * 0.5), 2) * inv_energy;
 
@@ -79,8 +78,8 @@ namespace hector {
       mat(StateVector::X, StateVector::E) = simp;
       mat(StateVector::TX, StateVector::E) = s_theta * inv_energy;
 
-      if (Parameters::get().useRelativeEnergy()) {
-        Matrix ef_matrix = DiagonalMatrix(6, 1);
+      if (ctx.useRelativeEnergy()) {
+        Matrix ef_matrix = DiagonalMatrix::Identity();
         const double t_theta_half_ke = ke * tan(theta * 0.5);
         ef_matrix(StateVector::TX, StateVector::X) = +t_theta_half_ke;
         ef_matrix(StateVector::TY, StateVector::Y) = -t_theta_half_ke;
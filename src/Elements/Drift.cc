@@ -17,7 +17,6 @@
  */
 
 #include "Hector/Elements/Drift.h"
-#include "Hector/Parameters.h"
 #include "Hector/Utils/StateVector.h"
 
 namespace hector {
@@ -27,10 +26,10 @@ namespace hector {
     Drift::Drift(const std::string& name, const Type& type, double spos, double length)
         : Element(type, name, spos, length) {}
 
-    Matrix Drift::matrix(double, double, int) const { return genericMatrix(length_); }
+    Matrix Drift::matrix(double, double, int, const PropagationContext&) const { return genericMatrix(length_); }
 
     Matrix Drift::genericMatrix(double length) {
-      Matrix mat = DiagonalMatrix(6, 1);
+      Matrix mat = DiagonalMatrix::Identity();
       mat(StateVector::X, StateVector::TX) = length;
       mat(StateVector::Y, StateVector::TY) = length;
       return mat;
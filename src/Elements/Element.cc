@@ -20,13 +20,23 @@
 
 #include "Hector/Elements/Element.h"
 #include "Hector/Exception.h"
-#include "Hector/Parameters.h"
 #include "Hector/Utils/String.h"
 
 namespace hector {
   namespace element {
+    std::atomic<unsigned long long> Element::last_revision_(0);
+    std::atomic<unsigned long long> Element::last_beamline_change_(0);
+
     Element::Element(const Type& type, const std::string& name, double spos, double length)
-        : type_(type), name_(name), length_(length), magnetic_strength_(0.), s_(spos) {}
+        : type_(type),
+          name_(name),
+          length_(length),
+          magnetic_strength_(0.),
+          s_(spos),
+          revision_(++last_revision_),
+          in_beamline_(false) {
+      ++last_beamline_change_;
+    }
 
     Element::Element(Element& rhs)
         : type_(rhs.type_),
@@ -39,7 +49,9 @@ namespace hector {
           s_(rhs.s_),
           beta_(rhs.beta_),
           disp_(rhs.disp_),
-          rel_pos_(rhs.rel_pos_) {}
+          rel_pos_(rhs.rel_pos_),
+          revision_(++last_revision_),
+          in_beamline_(false) {}
 
     Element::Element(const Element& rhs)
         : type_(rhs.type_),
@@ -52,7 +64,9 @@ namespace hector {
           s_(rhs.s_),
           beta_(rhs.beta_),
           disp_(rhs.disp_),
-          rel_pos_(rhs.rel_pos_) {}
+          rel_pos_(rhs.rel_pos_),
+          revision_(++last_revision_),
+          in_beamline_(false) {}
 
     bool Element::operator==(const Element& rhs) const {
       if (type_ != rhs.type_)
@@ -76,15 +90,40 @@ namespace hector {
       return true;
     }
 
-    void Element::setAperture(const aperture::AperturePtr& apert) { aperture_ = apert; }
+    void Element::setAperture(const aperture::AperturePtr& apert) {
+      aperture_ = apert;
+      modified();
+    }
 
     void Element::setAperture(aperture::Aperture* apert) { setAperture(aperture::AperturePtr(apert)); }
 
-    double Element::fieldStrength(double e_loss, double mp, int qp) const {
+    Matrix Element::cachedMatrix(double eloss, double mp, int qp, const PropagationContext& ctx) const {
+      if (mp < 0.)
+        mp = ctx.beamParticlesMass();
+      if (qp == 0)
+        qp = ctx.beamParticlesCharge();
+      const MatrixCache::Key key(eloss, mp, qp, ctx);
+      Matrix mat;
+      if (matrix_cache_.find(key, mat))
+        return mat;
+      mat = matrix(eloss, mp, qp, ctx);
+      matrix_cache_.insert(key, mat);
+      return mat;
+    }
+
+    void Element::cacheMatrix(const Matrix& mat, double eloss, double mp, int qp, const PropagationContext& ctx) const {
+      if (mp < 0.)
+        mp = ctx.beamParticlesMass();
+      if (qp == 0)
+        qp = ctx.beamParticlesCharge();
+      matrix_cache_.insert(MatrixCache::Key(eloss, mp, qp, ctx), mat);
+    }
+
+    double Element::fieldStrength(double e_loss, double mp, int qp, const PropagationContext& ctx) const {
       if (mp < 0.)
-        mp = Parameters::get().beamParticlesMass();
+        mp = ctx.beamParticlesMass();
       if (qp == 0)
-        qp = Parameters::get().beamParticlesCharge();
+        qp = ctx.beamParticlesCharge();
       // only act on charged particles
       if (qp == 0)
         return 0.;
@@ -94,19 +133,18 @@ namespace hector {
 
       double p_bal = 1.;
       if (e_loss > 0.) {
-        const double e_ini = Parameters::get().beamEnergy(), mp0 = Parameters::get().beamParticlesMass(),
-                     e_out = e_ini - e_loss;
+        const double e_ini = ctx.beamEnergy(), mp0 = ctx.beamParticlesMass(), e_out = e_ini - e_loss;
         const double p_ini = sqrt((e_ini - mp0) * (e_ini + mp0)),  // e_ini^2 - p_ini^2 = mp0^2
             p_out = sqrt((e_out - mp) * (e_out + mp));             // e_out^2 - p_out^2 = mp^2
 
         if (p_out == 0)
-          throw H_WARNING << "Invalid particle momentum.";
+          throw Exception(__PRETTY_FUNCTION__, ExceptionType::warning) << "Invalid particle momentum.";
 
         p_bal = p_ini / p_out;
       }
 
       // reweight the field strength by the particle charge and momentum
-      return magnetic_strength_ * p_bal * (qp / Parameters::get().beamParticlesCharge());
+      return magnetic_strength_ * p_bal * (qp / ctx.beamParticlesCharge());
     }
 
     const std::string Element::typeName() const {
@@ -18,18 +18,17 @@
 
 #include "Hector/Elements/Drift.h"
 #include "Hector/Elements/Kicker.h"
-#include "Hector/Parameters.h"
 #include "Hector/Utils/StateVector.h"
 
 namespace hector {
   namespace element {
-    Matrix HorizontalKicker::matrix(double eloss, double mp, int qp) const {
+    Matrix HorizontalKicker::matrix(double eloss, double mp, int qp, const PropagationContext& ctx) const {
       Matrix mat = Drift::genericMatrix(length_);
 
-      if (!Parameters::get().enableKickers())
+      if (!ctx.enableKickers())
         return mat;
 
-      const double ke = -fieldStrength(eloss, mp, qp);
+      const double ke = -fieldStrength(eloss, mp, qp, ctx);
       if (ke == 0.)
         return mat;
 
@@ -38,13 +37,13 @@ namespace hector {
       return mat;
     }
 
-    Matrix VerticalKicker::matrix(double eloss, double mp, int qp) const {
+    Matrix VerticalKicker::matrix(double eloss, double mp, int qp, const PropagationContext& ctx) const {
       Matrix mat = Drift::genericMatrix(length_);
 
-      if (!Parameters::get().enableKickers())
+      if (!ctx.enableKickers())
         return mat;
 
-      const double ke = -fieldStrength(eloss, mp, qp);
+      const double ke = -fieldStrength(eloss, mp, qp, ctx);
       if (ke == 0.)
         return mat;
 
@@ -0,0 +1,107 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <mutex>
+
+#include "Hector/Elements/MatrixCache.h"
+
+namespace hector {
+  namespace element {
+    MatrixCache::Key::Key(double eloss, double mp, int qp, const PropagationContext& ctx)
+        : eloss(eloss),
+          mass(mp),
+          charge(qp),
+          beam_energy(ctx.beamEnergy()),
+          beam_mass(ctx.beamParticlesMass()),
+          beam_charge(ctx.beamParticlesCharge()),
+          flags(ctx.useRelativeEnergy() | ctx.enableKickers() << 1 | ctx.enableDipoles() << 2) {}
+
+    bool MatrixCache::Key::nominal() const {
+      return mass == beam_mass && charge == beam_charge && eloss == ((flags & 0x1) ? 0. : beam_energy);
+    }
+
+    MatrixCache::MatrixCache() : next_(0), hits_(0), misses_(0), consecutive_misses_(0) {}
+
+    MatrixCache::MatrixCache(const MatrixCache&) : MatrixCache() {}
+
+    MatrixCache& MatrixCache::operator=(const MatrixCache&) {
+      clear();
+      return *this;
+    }
+
+    bool MatrixCache::find(const Key& key, Matrix& mat) const {
+      {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        if (key.nominal()) {
+          if (nominal_ && nominal_->first == key) {
+            mat = nominal_->second;
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+          }
+        } else
+          for (const auto& entry : entries_)
+            if (entry.first == key) {
+              mat = entry.second;
+              hits_.fetch_add(1, std::memory_order_relaxed);
+              if (consecutive_misses_.load(std::memory_order_relaxed) > 0)
+                consecutive_misses_.store(0, std::memory_order_relaxed);
+              return true;
+            }
+      }
+      misses_.fetch_add(1, std::memory_order_relaxed);
+      if (!key.nominal())
+        consecutive_misses_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    void MatrixCache::insert(const Key& key, const Matrix& mat) {
+      if (key.nominal()) {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        nominal_.emplace(key, mat);
+        return;
+      }
+      // stored matrices are never reused (e.g. smeared beam), spare the write lock
+      if (consecutive_misses_.load(std::memory_order_relaxed) >= max_consecutive_misses)
+        return;
+      std::unique_lock<std::shared_mutex> lock(mutex_);
+      for (const auto& entry : entries_)
+        if (entry.first == key)  // already inserted by another thread
+          return;
+      if (entries_.size() < max_size - 1) {
+        // grown on demand, as most elements only ever see a few kinematics besides the nominal one
+        entries_.emplace_back(key, mat);
+        return;
+      }
+      entries_[next_] = std::make_pair(key, mat);
+      next_ = (next_ + 1) % entries_.size();
+    }
+
+    void MatrixCache::clear() {
+      std::unique_lock<std::shared_mutex> lock(mutex_);
+      nominal_.reset();
+      entries_.clear();
+      next_ = 0;
+      consecutive_misses_ = 0;
+    }
+
+    size_t MatrixCache::size() const {
+      std::shared_lock<std::shared_mutex> lock(mutex_);
+      return entries_.size() + (nominal_ ? 1 : 0);
+    }
+  }  // namespace element
+}  // namespace hector
@@ -23,10 +23,10 @@
 
 namespace hector {
   namespace element {
-    Matrix HorizontalQuadrupole::matrix(double eloss, double mp, int qp) const {
+    Matrix HorizontalQuadrupole::matrix(double eloss, double mp, int qp, const PropagationContext& ctx) const {
       Matrix mat = Drift::genericMatrix(length_);
 
-      const double ke = fieldStrength(eloss, mp, qp);  // should be negative
+      const double ke = fieldStrength(eloss, mp, qp, ctx);  // should be negative
       if (ke > 0.)
         throw H_ERROR << "Magnetic strength for horizontal quadrupole " << name_ << " should be negative!\n\t"
                       << "Value = " << ke << ".";
@@ -52,10 +52,10 @@ namespace hector {
       return mat;
     }
 
-    Matrix VerticalQuadrupole::matrix(double eloss, double mp, int qp) const {
+    Matrix VerticalQuadrupole::matrix(double eloss, double mp, int qp, const PropagationContext& ctx) const {
       Matrix mat = Drift::genericMatrix(length_);
 
-      const double ke = fieldStrength(eloss, mp, qp);
+      const double ke = fieldStrength(eloss, mp, qp, ctx);
       if (ke < 0.)
         throw H_ERROR << "Magnetic strength for vertical quadrupole " << name_ << " should be positive!\n\t"
                       << "Value = " << ke << ".";
@@ -22,6 +22,7 @@
 
 #include "Hector/Exception.h"
 #include "Hector/Parameters.h"
+#include "Hector/Utils/Logger.h"
 #include "Hector/Utils/String.h"
 
 namespace hector {
@@ -32,9 +33,15 @@ namespace hector {
       : message_(rhs.message_.str()), from_(rhs.from_), type_(rhs.type_), error_num_(rhs.error_num_) {}
 
   Exception::~Exception() noexcept {
-    dump(std::cerr);
-    if (type_ == ExceptionType::fatal)
+    if (type_ >= Parameters::get().loggingThreshold()) {
+      std::ostringstream os;
+      dump(os);
+      Logger::get().write(os.str());
+    }
+    if (type_ == ExceptionType::fatal) {
+      Logger::get().flush();
       exit(error_num_);  // we stop the execution of this process on fatal exception
+    }
   }
 
   const std::string Exception::typeString() const {
@@ -16,14 +16,18 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <cstddef>
+#include <cstring>
 #include <fstream>
-#include <sstream>
+#include <unordered_map>
 
 #include "Hector/Apertures/Circular.h"
 #include "Hector/Apertures/Elliptic.h"
 #include "Hector/Apertures/RectElliptic.h"
 #include "Hector/Apertures/Rectangular.h"
 #include "Hector/Beamline.h"
+#include "Hector/BeamlineBuilder.h"
+#include "Hector/CompiledBeamline.h"
 #include "Hector/Elements/Collimator.h"
 #include "Hector/Elements/Dipole.h"
 #include "Hector/Elements/Drift.h"
@@ -33,30 +37,53 @@
 #include "Hector/IO/HBLFileHandler.h"
 #include "Hector/IO/HBLFileStructures.h"
 #include "Hector/Parameters.h"
+#include "Hector/Utils/MappedFile.h"
 
 namespace hector {
   namespace io {
+    HBL::HBL() : beamline_(new Beamline) {}
+
     HBL::HBL(const std::string& filename) : beamline_(new Beamline) { parse(filename); }
 
-    HBL::HBL(HBL& rhs) : beamline_(std::move(rhs.beamline_)) {}
+    HBL::HBL(HBL& rhs) : beamline_(std::move(rhs.beamline_)), matrices_(std::move(rhs.matrices_)) {}
 
     void HBL::parse(const std::string& filename) {
-      std::ifstream file(filename, std::ios::binary | std::ios::in);
-      if (!file.is_open())
+      const MappedFile file(filename);
+      if (!file.isOpen())
         throw H_ERROR << "Impossible to open file \"" << filename << "\" for reading!";
+      if (file.size() < sizeof(HBLHeader) || std::memcmp(file.data(), &magic_number, sizeof(magic_number)) != 0)
+        throw H_ERROR << "Invalid magic number retrieved for file \"" << filename << "\"!";
+      parseContent(file.view());
+    }
 
+    void HBL::parseContent(std::string_view content) {
+      // both versions share the magic number and version fields
       HBLHeader hdr;
-      file.read(reinterpret_cast<char*>(&hdr), sizeof(HBLHeader));
+      if (content.size() < sizeof(HBLHeader))
+        throw H_ERROR << "HBL content is too short to hold its header!";
+      std::memcpy(&hdr, content.data(), sizeof(HBLHeader));
       if (hdr.magic != magic_number)
-        throw H_ERROR << "Invalid magic number retrieved for file \"" << filename << "\"!";
+        throw H_ERROR << "Invalid magic number retrieved for HBL content!";
 
       if (hdr.version > version)
         throw H_ERROR << "Version " << hdr.version << " is not (yet) supported! Currently peaking at " << version
                       << "!";
+      if (hdr.version >= 200)
+        parseV2(content);
+      else
+        parseV1(content);
+    }
 
+    void HBL::parseV1(std::string_view content) {
+      HBLHeader hdr;
+      std::memcpy(&hdr, content.data(), sizeof(HBLHeader));
+
+      BeamlineBuilder builder;
+      builder.reserve(hdr.num_elements);
       HBLElement el;
       element::ElementPtr elem;
-      while (file.read(reinterpret_cast<char*>(&el), sizeof(HBLElement))) {
+      for (size_t pos = sizeof(HBLHeader); pos + sizeof(HBLElement) <= content.size(); pos += sizeof(HBLElement)) {
+        std::memcpy(static_cast<void*>(&el), content.data() + pos, sizeof(HBLElement));
         if (Parameters::get().loggingThreshold() > ExceptionType::warning)
           H_INFO << "Retrieved a " << (element::Type)el.element_type << " element\n\t"
                  << "with name " << el.element_name << "\n\tat s=" << el.element_s << " m\n\t"
@@ -142,46 +169,384 @@ namespace hector {
             throw H_ERROR << "Invalid aperture type: " << (int)el.aperture_type << ".";
         }
         if (elem)
-          beamline_->add(elem);
+          builder.add(elem);
       }
+      beamline_ = builder.build();
       if (beamline_->numElements() != hdr.num_elements)
         throw H_ERROR << "Expecting " << hdr.num_elements << " elements, retrieved " << beamline_->numElements() << "!";
     }
 
-    void HBL::write(const Beamline* bl, const std::string& filename) {
+    namespace {
+      constexpr uint32_t byte_order_marker = 0x01020304;
+      /// Size of the header of version 2.0.0 files, without the matrices block location
+      constexpr size_t header_size_v200 = offsetof(HBLHeaderV2, matrices_offset);
+      /// Size of a 6x6 matrix as stored in the file
+      constexpr size_t matrix_size = sizeof(double) * 36;
+      /// Size of the header of the transfer matrices block of version 2.0.2 files (only followed by the segments
+      ///  records), without the derivatives step, and with the number of elements in place of this step
+      constexpr size_t matrices_header_size_v202 = 56;
+      /// Relative step on the beam energy used to compute the matrices derivatives
+      constexpr double eloss_rel_step = 1.e-6;
+
+      /// Build an element (without its parent) from its version 2 record
+      element::ElementPtr buildElement(const HBLElementV2& rec, const std::string& name) {
+        element::ElementPtr elem;
+        const auto type = (element::Type)rec.type;
+        switch (type) {
+          case element::aMarker:
+            elem = std::make_shared<element::Marker>(name, rec.s, rec.length);
+            break;
+          case element::aDrift:
+          case element::aMonitor:
+          case element::anInstrument:
+            elem = std::make_shared<element::Drift>(name, type, rec.s, rec.length);
+            break;
+          case element::aRectangularDipole:
+            elem = std::make_shared<element::RectangularDipole>(name, rec.s, rec.length, rec.magnetic_strength);
+            break;
+          case element::aSectorDipole:
+            elem = std::make_shared<element::SectorDipole>(name, rec.s, rec.length, rec.magnetic_strength);
+            break;
+          case element::aVerticalQuadrupole:
+            elem = std::make_shared<element::VerticalQuadrupole>(name, rec.s, rec.length, rec.magnetic_strength);
+            break;
+          case element::anHorizontalQuadrupole:
+            elem = std::make_shared<element::HorizontalQuadrupole>(name, rec.s, rec.length, rec.magnetic_strength);
+            break;
+          case element::aVerticalKicker:
+            elem = std::make_shared<element::VerticalKicker>(name, rec.s, rec.length, rec.magnetic_strength);
+            break;
+          case element::anHorizontalKicker:
+            elem = std::make_shared<element::HorizontalKicker>(name, rec.s, rec.length, rec.magnetic_strength);
+            break;
+          case element::aRectangularCollimator:
+          case element::anEllipticalCollimator:
+          case element::aCircularCollimator:
+          case element::aCollimator:
+            elem = std::make_shared<element::Collimator>(name, rec.s, rec.length);
+            break;
+          default:
+            throw H_ERROR << "Invalid element type: " << rec.type << ".";
+        }
+        elem->setPosition(TwoVector(rec.position[0], rec.position[1]));
+        elem->setAngles(TwoVector(rec.angles[0], rec.angles[1]));
+        elem->setBeta(TwoVector(rec.beta[0], rec.beta[1]));
+        elem->setDispersion(TwoVector(rec.dispersion[0], rec.dispersion[1]));
+        elem->setRelativePosition(TwoVector(rec.relative_position[0], rec.relative_position[1]));
+
+        const auto& par = rec.aperture_parameters;
+        const TwoVector pos(rec.aperture_position[0], rec.aperture_position[1]);
+        switch ((aperture::Type)rec.aperture_type) {
+          case aperture::anInvalidAperture:
+            break;
+          case aperture::aRectangularAperture:
+            elem->setAperture(std::make_shared<aperture::Rectangular>(par[0], par[1], pos));
+            break;
+          case aperture::anEllipticAperture:
+            elem->setAperture(std::make_shared<aperture::Elliptic>(par[0], par[1], pos));
+            break;
+          case aperture::aCircularAperture:
+            elem->setAperture(std::make_shared<aperture::Circular>(par[0], pos));
+            break;
+          case aperture::aRectEllipticAperture:
+            elem->setAperture(std::make_shared<aperture::RectElliptic>(par[0], par[1], par[2], par[3], pos));
+            break;
+          case aperture::aRectCircularAperture:
+            elem->setAperture(std::make_shared<aperture::RectElliptic>(par[0], par[1], par[2], par[2], pos));
+            break;
+          default:
+            throw H_ERROR << "Invalid aperture type: " << rec.aperture_type << ".";
+        }
+        return elem;
+      }
+    }  // namespace
+
+    void HBL::parseV2(std::string_view content) {
+      if (content.size() < header_size_v200)
+        throw H_ERROR << "HBL file is too short to hold its header!";
+      // version 2.0.0 headers do not hold the matrices block location
+      HBLHeaderV2 hdr{};
+      std::memcpy(&hdr, content.data(), header_size_v200);
+      const size_t header_size = hdr.version > 200 ? sizeof(HBLHeaderV2) : header_size_v200;
+      if (hdr.byte_order != byte_order_marker)
+        throw H_ERROR << "HBL file was written with a different byte order than the one of this host!";
+      if (hdr.header_size != header_size || content.size() < header_size ||
+          hdr.record_size != sizeof(HBLElementV2))
+        throw H_ERROR << "Invalid header (" << hdr.header_size << " bytes) or record (" << hdr.record_size
+                      << " bytes) size in HBL file!";
+      if (hdr.num_elements > hdr.num_records ||
+          (reinterpret_cast<uintptr_t>(content.data()) + hdr.records_offset) % alignof(HBLElementV2) != 0 ||
+          hdr.records_offset + (uint64_t)hdr.num_records * sizeof(HBLElementV2) > content.size() ||
+          hdr.strings_offset + hdr.strings_size > content.size())
+        throw H_ERROR << "HBL file seems corrupted: its content does not match the sizes advertised in its header!";
+
+      std::memcpy(&hdr, content.data(), header_size);
+      if (hdr.matrices_offset > 0 &&
+          (hdr.matrices_offset % alignof(double) != 0 || hdr.matrices_offset + hdr.matrices_size > content.size()))
+        throw H_ERROR << "HBL file seems corrupted: invalid location for the transfer matrices block!";
+
+      const auto* records = reinterpret_cast<const HBLElementV2*>(content.data() + hdr.records_offset);
+      const char* strings = content.data() + hdr.strings_offset;
+      element::Elements elements(hdr.num_records);
+      for (size_t i = 0; i < hdr.num_records; ++i) {
+        const auto& rec = records[i];
+        if ((uint64_t)rec.name_offset + rec.name_size > hdr.strings_size)
+          throw H_ERROR << "HBL file seems corrupted: name of element " << i << " is out of the names table!";
+        elements[i] = buildElement(rec, std::string(strings + rec.name_offset, rec.name_size));
+      }
+      for (size_t i = 0; i < hdr.num_records; ++i) {
+        const auto parent = records[i].parent;
+        if (parent < 0)
+          continue;
+        if ((uint32_t)parent >= hdr.num_records)
+          throw H_ERROR << "HBL file seems corrupted: invalid parent index for element " << i << "!";
+        elements[i]->setParentElement(elements[parent]);
+      }
+      if (hdr.interaction_point >= (int32_t)hdr.num_records)
+        throw H_ERROR << "HBL file seems corrupted: invalid interaction point index!";
+
+      // elements are stored as sequenced in the beamline, they can be added as is
+      beamline_.reset(new Beamline);
+      beamline_->setLength(hdr.max_length);
+      if (hdr.interaction_point >= 0)
+        beamline_->setInteractionPoint(elements[hdr.interaction_point]);
+      elements.resize(hdr.num_elements);
+      beamline_->elements() = std::move(elements);
+      beamline_->reindex();
+
+      matrices_.reset();
+      if (hdr.matrices_offset > 0)
+        parseMatrices(content.substr(hdr.matrices_offset, hdr.matrices_size), hdr.version);
+    }
+
+    void HBL::parseMatrices(std::string_view block, unsigned short file_version) {
+      HBLMatricesHeader mhdr{};
+      const size_t header_size = file_version == 202 ? matrices_header_size_v202 : sizeof(HBLMatricesHeader);
+      if (block.size() < header_size)
+        throw H_ERROR << "HBL file seems corrupted: transfer matrices block is too short to hold its header!";
+      if (file_version == 202) {
+        std::memcpy(&mhdr, block.data(), offsetof(HBLMatricesHeader, eloss_step));
+        std::memcpy(&mhdr.num_elements, block.data() + offsetof(HBLMatricesHeader, eloss_step), sizeof(uint32_t));
+      } else
+        std::memcpy(&mhdr, block.data(), sizeof(HBLMatricesHeader));
+      // elements matrices are always stored in version 2.0.1 files, and never in version 2.0.2 ones
+      const bool element_matrices = file_version == 201 || (file_version > 202 && mhdr.element_matrices != 0);
+      if (mhdr.num_elements != beamline_->elements().size() ||
+          block.size() != header_size + (element_matrices ? 2 * matrix_size * mhdr.num_elements : 0) +
+                              sizeof(HBLSegment) * mhdr.num_segments)
+        throw H_ERROR << "HBL file seems corrupted: transfer matrices block does not match the beamline!";
+
+      auto mats = std::make_shared<Matrices>();
+      mats->context = PropagationContext()
+                          .withBeamEnergy(mhdr.beam_energy)
+                          .withBeamParticlesMass(mhdr.beam_mass)
+                          .withBeamParticlesCharge(mhdr.beam_charge)
+                          .withRelativeEnergy(mhdr.flags & 0x1)
+                          .withKickers(mhdr.flags & 0x2)
+                          .withDipoles(mhdr.flags & 0x4)
+                          .withApertureAcceptance(mhdr.flags & 0x8);
+      mats->eloss = mhdr.eloss;
+      mats->mass = mhdr.mass;
+      mats->charge = mhdr.charge;
+      mats->eloss_step = mhdr.eloss_step;
+      const char* ptr = block.data() + header_size;
+      if (element_matrices) {
+        const auto read_matrix = [&ptr]() -> Matrix {
+          Matrix mat;
+          std::memcpy(mat.data(), ptr, matrix_size);
+          ptr += matrix_size;
+          return mat;
+        };
+        mats->elements.reserve(mhdr.num_elements);
+        mats->derivatives.reserve(mhdr.num_elements);
+        for (size_t i = 0; i < mhdr.num_elements; ++i) {
+          mats->elements.emplace_back(read_matrix());
+          mats->derivatives.emplace_back(read_matrix());
+        }
+      }
+      auto segments_matrices = std::make_shared<std::vector<Matrix> >();
+      mats->segments.reserve(mhdr.num_segments);
+      segments_matrices->reserve(mhdr.num_segments);
+      uint32_t range[2];
+      for (size_t i = 0; i < mhdr.num_segments; ++i, ptr += sizeof(HBLSegment)) {
+        std::memcpy(range, ptr + offsetof(HBLSegment, first), sizeof(range));
+        mats->segments.emplace_back(range[0], range[1]);
+        segments_matrices->emplace_back(Eigen::Map<const Matrix>(
+            reinterpret_cast<const double*>(ptr + offsetof(HBLSegment, matrix))));  // block is aligned on doubles
+      }
+      mats->segments_matrices = std::move(segments_matrices);
+      // seed the elements caches, no matrix has to be computed for the nominal particle
+      const auto& elements = beamline_->elements();
+      for (size_t i = 0; i < mats->elements.size(); ++i)
+        elements[i]->cacheMatrix(mats->elements[i], mats->eloss, mats->mass, mats->charge, mats->context);
+      matrices_ = std::move(mats);
+    }
+
+    bool HBL::provideMatrices(const CompiledBeamline& cbl) const {
+      if (!matrices_ || cbl.context() != matrices_->context ||
+          cbl.segments().size() != matrices_->segments.size())
+        return false;
+      for (size_t i = 0; i < matrices_->segments.size(); ++i)
+        if (cbl.segments()[i].first != matrices_->segments[i].first ||
+            cbl.segments()[i].last != matrices_->segments[i].second)
+          return false;
+      cbl.setMatrices(matrices_->eloss, matrices_->mass, matrices_->charge, matrices_->segments_matrices);
+      return true;
+    }
+
+    Matrix HBL::Matrices::elementMatrix(size_t i, double eloss) const {
+      return elements.at(i) + derivatives.at(i) * (eloss - this->eloss);
+    }
+
+    void HBL::write(const Beamline* bl,
+                    const std::string& filename,
+                    const std::optional<PropagationContext>& matrices_ctx,
+                    bool element_matrices) {
       std::ofstream file(filename, std::ios::binary | std::ios::out);
-      {  // start by writing the file header
-        HBLHeader hdr;
-        hdr.magic = magic_number;
-        hdr.version = version;
-        hdr.num_elements = bl->numElements();
-        file.write(reinterpret_cast<char*>(&hdr), sizeof(HBLHeader));
+      if (!file.is_open())
+        throw H_ERROR << "Impossible to open file \"" << filename << "\" for writing!";
+      write(bl, file, matrices_ctx, element_matrices);
+    }
+
+    void HBL::write(const Beamline* bl,
+                    std::ostream& os,
+                    const std::optional<PropagationContext>& matrices_ctx,
+                    bool element_matrices) {
+      if (!bl)
+        throw H_ERROR << "Invalid beamline to write!";
+      {
+        const uint32_t marker = byte_order_marker;
+        if (*reinterpret_cast<const unsigned char*>(&marker) != 0x04)
+          throw H_ERROR << "HBL files can only be written from little-endian hosts!";
       }
-      {  // then add all individual elements
-        for (const auto& elem : *bl) {
-          HBLElement el;
-          el.element_type = elem->type();
-          if (!elem->name().empty())
-            elem->name().copy(el.element_name, sizeof(el.element_name));
-          el.element_s = elem->s();
-          el.element_length = elem->length();
-          el.element_magnetic_strength = elem->magneticStrength();
-          if (elem->aperture()) {
-            el.aperture_type = elem->aperture()->type();
-            if (elem->aperture()->parameters().size() > 0)
-              el.aperture_p1 = elem->aperture()->p(0);
-            if (elem->aperture()->parameters().size() > 1)
-              el.aperture_p2 = elem->aperture()->p(1);
-            if (elem->aperture()->parameters().size() > 2)
-              el.aperture_p3 = elem->aperture()->p(2);
-            if (elem->aperture()->parameters().size() > 3)
-              el.aperture_p4 = elem->aperture()->p(3);
-            el.aperture_x = elem->aperture()->x();
-            el.aperture_y = elem->aperture()->y();
-          }
-          file.write(reinterpret_cast<char*>(&el), sizeof(HBLElement));
+      // beamline elements first, then the elements only referenced as parents or interaction point
+      std::vector<const element::Element*> elements;
+      std::unordered_map<const element::Element*, int32_t> indices;
+      const auto index = [&elements, &indices](const element::Element* elem) -> int32_t {
+        if (!elem)
+          return -1;
+        const auto it = indices.find(elem);
+        if (it != indices.end())
+          return it->second;
+        elements.emplace_back(elem);
+        return indices[elem] = elements.size() - 1;
+      };
+      for (const auto& elem : *bl) {
+        indices.emplace(elem.get(), elements.size());
+        elements.emplace_back(elem.get());
+      }
+
+      HBLHeaderV2 hdr{};
+      hdr.magic = magic_number;
+      hdr.version = version;
+      hdr.header_size = sizeof(HBLHeaderV2);
+      hdr.byte_order = byte_order_marker;
+      hdr.num_elements = bl->elements().size();
+      hdr.interaction_point = index(bl->interactionPoint().get());
+      hdr.record_size = sizeof(HBLElementV2);
+      hdr.max_length = bl->maxLength();
+
+      std::vector<HBLElementV2> records;
+      records.reserve(elements.size());
+      std::string strings;
+      // the list of elements grows while the parents are indexed
+      for (size_t i = 0; i < elements.size(); ++i) {
+        const auto* elem = elements[i];
+        HBLElementV2 rec{};
+        rec.type = elem->type();
+        rec.parent = index(elem->parentElement());
+        rec.name_offset = strings.size();
+        rec.name_size = elem->name().size();
+        strings += elem->name();
+        rec.s = elem->s();
+        rec.length = elem->length();
+        rec.magnetic_strength = elem->magneticStrength();
+        rec.position[0] = elem->x(), rec.position[1] = elem->y();
+        rec.angles[0] = elem->Tx(), rec.angles[1] = elem->Ty();
+        rec.beta[0] = elem->beta().x(), rec.beta[1] = elem->beta().y();
+        rec.dispersion[0] = elem->dispersion().x(), rec.dispersion[1] = elem->dispersion().y();
+        rec.relative_position[0] = elem->relativePosition().x();
+        rec.relative_position[1] = elem->relativePosition().y();
+        rec.aperture_type = aperture::anInvalidAperture;
+        if (const auto* aper = elem->aperture()) {
+          rec.aperture_type = aper->type();
+          rec.num_aperture_parameters = std::min<size_t>(aper->parameters().size(), 4);
+          for (size_t j = 0; j < rec.num_aperture_parameters; ++j)
+            rec.aperture_parameters[j] = aper->p(j);
+          rec.aperture_position[0] = aper->x(), rec.aperture_position[1] = aper->y();
         }
+        records.emplace_back(rec);
+      }
+      hdr.num_records = records.size();
+      hdr.records_offset = sizeof(HBLHeaderV2);
+      hdr.strings_offset = hdr.records_offset + records.size() * sizeof(HBLElementV2);
+      hdr.strings_size = strings.size();
+
+      std::string matrices;
+      if (matrices_ctx)
+        matrices = matricesBlock(bl, *matrices_ctx, element_matrices);
+      const size_t padding =
+          matrices.empty() ? 0 : (alignof(double) - strings.size() % alignof(double)) % alignof(double);
+      if (!matrices.empty()) {
+        hdr.matrices_offset = hdr.strings_offset + strings.size() + padding;
+        hdr.matrices_size = matrices.size();
+      }
+
+      os.write(reinterpret_cast<const char*>(&hdr), sizeof(HBLHeaderV2));
+      os.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(HBLElementV2));
+      os.write(strings.data(), strings.size());
+      os.write(std::string(padding, '\0').data(), padding);
+      os.write(matrices.data(), matrices.size());
+    }
+
+    std::string HBL::matricesBlock(const Beamline* bl, const PropagationContext& ctx, bool element_matrices) {
+      HBLMatricesHeader mhdr{};
+      mhdr.beam_energy = ctx.beamEnergy();
+      mhdr.beam_mass = ctx.beamParticlesMass();
+      mhdr.beam_charge = ctx.beamParticlesCharge();
+      mhdr.flags = ctx.useRelativeEnergy() | ctx.enableKickers() << 1 | ctx.enableDipoles() << 2 |
+                   ctx.computeApertureAcceptance() << 3;
+      mhdr.eloss = ctx.energyLoss(ctx.beamEnergy());
+      mhdr.mass = ctx.beamParticlesMass();
+      mhdr.charge = ctx.beamParticlesCharge();
+      mhdr.eloss_step = eloss_rel_step * ctx.beamEnergy();
+      mhdr.num_elements = bl->elements().size();
+      mhdr.element_matrices = element_matrices;
+
+      const CompiledBeamline cbl(bl, ctx);
+      const auto& segments = cbl.segments();
+      const auto segments_matrices = cbl.matrices(mhdr.eloss, mhdr.mass, mhdr.charge);
+      mhdr.num_segments = segments.size();
+
+      std::string block;
+      block.reserve(sizeof(HBLMatricesHeader) + (element_matrices ? 2 * matrix_size * mhdr.num_elements : 0) +
+                    sizeof(HBLSegment) * mhdr.num_segments);
+      block.append(reinterpret_cast<const char*>(&mhdr), sizeof(HBLMatricesHeader));
+      const auto append_matrix = [&block](const Matrix& mat) {
+        block.append(reinterpret_cast<const char*>(mat.data()), matrix_size);
+      };
+      const double h = mhdr.eloss_step;
+      for (const auto& elem : *bl) {
+        if (!element_matrices)
+          break;
+        const auto nominal = elem->matrix(mhdr.eloss, mhdr.mass, mhdr.charge, ctx);
+        append_matrix(nominal);
+        // derivative with respect to the energy loss, by second-order forward finite differences
+        // (the nominal energy loss is usually null, and negative losses are not allowed)
+        append_matrix((4. * elem->matrix(mhdr.eloss + h, mhdr.mass, mhdr.charge, ctx) -
+                       elem->matrix(mhdr.eloss + 2. * h, mhdr.mass, mhdr.charge, ctx) - 3. * nominal) /
+                      (2. * h));
+      }
+      for (size_t i = 0; i < segments.size(); ++i) {
+        HBLSegment seg{};
+        seg.first = segments[i].first;
+        seg.last = segments[i].last;
+        seg.s_begin = segments[i].s_begin;
+        seg.s_end = segments[i].s_end;
+        std::memcpy(seg.matrix, segments_matrices->at(i).data(), matrix_size);
+        block.append(reinterpret_cast<const char*>(&seg), sizeof(HBLSegment));
       }
+      return block;
     }
   }  // namespace io
 }  // namespace hector
@@ -0,0 +1,389 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <limits>
+
+#ifdef ZLIB
+#include <zlib.h>
+#endif
+
+#include "Hector/Elements/Element.h"
+#include "Hector/Exception.h"
+#include "Hector/IO/HitsFile.h"
+#include "Hector/ParticlesBatch.h"
+
+namespace hector {
+  namespace io {
+    namespace {
+      constexpr uint64_t hits_magic = 0x5354494848ull;  // 'HHITS'
+      constexpr uint16_t hits_version = 100;
+      constexpr uint32_t hits_byte_order = 0x01020304;
+
+      template <typename T>
+      void append(std::vector<char>& col, const T& value) {
+        const size_t size = col.size();
+        col.resize(size + sizeof(T));
+        std::memcpy(col.data() + size, &value, sizeof(T));
+      }
+
+      size_t padding(size_t size) { return (8 - size % 8) % 8; }
+
+      /// Group the bytes of all values by significance, so that slowly varying values are compressed efficiently
+      void shuffle(const char* in, size_t num_values, size_t width, char* out) {
+        for (size_t i = 0; i < num_values; ++i)
+          for (size_t b = 0; b < width; ++b)
+            out[b * num_values + i] = in[i * width + b];
+      }
+
+      /// Restore the values from their bytes grouped by significance
+      void unshuffle(const char* in, size_t num_values, size_t width, char* out) {
+        for (size_t b = 0; b < width; ++b)
+          for (size_t i = 0; i < num_values; ++i)
+            out[i * width + b] = in[b * num_values + i];
+      }
+    }  // namespace
+
+    Hit HitsChunk::hit(size_t i) const {
+      Hit hit;
+      hit.particle = particles()[i];
+      hit.station = stations()[i];
+      hit.loss_element = lossElements()[i];
+      hit.x0 = values(hitX0)[i];
+      hit.theta_x0 = values(hitThetaX0)[i];
+      hit.y0 = values(hitY0)[i];
+      hit.theta_y0 = values(hitThetaY0)[i];
+      hit.energy0 = values(hitEnergy0)[i];
+      hit.x = values(hitX)[i];
+      hit.theta_x = values(hitThetaX)[i];
+      hit.y = values(hitY)[i];
+      hit.theta_y = values(hitThetaY)[i];
+      return hit;
+    }
+
+    //----- writer
+
+    HitsWriter::HitsWriter(const std::string& filename,
+                           const std::vector<double>& stations,
+                           bool compress,
+                           size_t chunk_size)
+        : file_(filename, std::ios::binary | std::ios::trunc),
+          stations_(stations),
+          codec_(hitsRaw),
+          chunk_size_(chunk_size) {
+      if (!file_.is_open())
+        throw H_ERROR << "Impossible to open file \"" << filename << "\" for writing!";
+      if (chunk_size_ == 0 || chunk_size_ > std::numeric_limits<uint32_t>::max())
+        throw H_ERROR << "Invalid number of hits per chunk: " << chunk_size_ << ".";
+      if (compress) {
+#ifdef ZLIB
+        codec_ = hitsDeflate;
+#else
+        H_WARNING << "Hector was built without zlib support. Hits file \"" << filename << "\" will not be compressed.";
+#endif
+      }
+      for (unsigned short i = 0; i < numHitsColumns; ++i)
+        columns_[i].reserve(chunk_size_ * hits_column_size[i]);
+
+      HitsFileHeader hdr{};
+      hdr.magic = hits_magic;
+      hdr.version = hits_version;
+      hdr.header_size = sizeof(HitsFileHeader);
+      hdr.byte_order = hits_byte_order;
+      hdr.num_columns = numHitsColumns;
+      hdr.chunk_size = chunk_size_;
+      hdr.codec = codec_;
+      file_.write(reinterpret_cast<const char*>(&hdr), sizeof(HitsFileHeader));
+    }
+
+    HitsWriter::~HitsWriter() {
+      // fatal errors terminate the process, and exceptions must not escape a destructor
+      try {
+        if (!finish())
+          H_WARNING << "Failed to complete the hits file. Its last chunks or footer may be missing.";
+      } catch (const std::exception& exc) {
+        H_WARNING << "Failed to complete the hits file: " << exc.what();
+      }
+    }
+
+    void HitsWriter::add(const Hit& hit) {
+      if (!file_.is_open())
+        throw H_ERROR << "Hits file is already closed!";
+      append(columns_[hitParticle], static_cast<uint64_t>(hit.particle));
+      append(columns_[hitStation], static_cast<uint32_t>(hit.station));
+      append(columns_[hitLossElement], static_cast<int32_t>(hit.loss_element));
+      append(columns_[hitX0], hit.x0);
+      append(columns_[hitThetaX0], hit.theta_x0);
+      append(columns_[hitY0], hit.y0);
+      append(columns_[hitThetaY0], hit.theta_y0);
+      append(columns_[hitEnergy0], hit.energy0);
+      append(columns_[hitX], hit.x);
+      append(columns_[hitThetaX], hit.theta_x);
+      append(columns_[hitY], hit.y);
+      append(columns_[hitThetaY], hit.theta_y);
+      if (++num_hits_ % chunk_size_ == 0 && !flush())
+        throw H_ERROR << "Failed to write a chunk of " << chunk_size_ << " hits!";
+    }
+
+    void HitsWriter::add(unsigned int station,
+                         unsigned long long first_particle,
+                         const ParticlesBatch& initial,
+                         const ParticlesBatch& final) {
+      if (initial.size() != final.size())
+        throw H_ERROR << "Initial and final batches have different sizes: " << initial.size()
+                      << " != " << final.size() << ".";
+      Hit hit;
+      hit.station = station;
+      std::unordered_map<const element::Element*, int> loss_ids;  // avoids hashing the names of all lost particles
+      const auto states0 = initial.states();
+      const auto states = final.states();
+      for (size_t i = 0; i < final.size(); ++i) {
+        hit.particle = first_particle + i;
+        hit.loss_element = -1;
+        if (final.stopped(i)) {
+          const auto& elem = final.stoppingElement(i);
+          const auto it = loss_ids.find(elem.get());
+          hit.loss_element = it != loss_ids.end() ? it->second : (loss_ids[elem.get()] = lossElement(elem->name()));
+        }
+        hit.x0 = states0(StateVector::X, i);
+        hit.theta_x0 = states0(StateVector::TX, i);
+        hit.y0 = states0(StateVector::Y, i);
+        hit.theta_y0 = states0(StateVector::TY, i);
+        hit.energy0 = states0(StateVector::E, i);
+        hit.x = states(StateVector::X, i);
+        hit.theta_x = states(StateVector::TX, i);
+        hit.y = states(StateVector::Y, i);
+        hit.theta_y = states(StateVector::TY, i);
+        add(hit);
+      }
+    }
+
+    int HitsWriter::lossElement(const std::string& name) {
+      const auto it = names_ids_.find(name);
+      if (it != names_ids_.end())
+        return it->second;
+      const int id = names_.size();
+      names_.emplace_back(name);
+      names_ids_[name] = id;
+      return id;
+    }
+
+    bool HitsWriter::flush() {
+      const size_t num_hits = columns_[hitParticle].size() / hits_column_size[hitParticle];
+      if (num_hits == 0)
+        return true;
+
+      HitsChunkHeader hdr{};
+      hdr.num_hits = num_hits;
+      uint64_t offset = sizeof(HitsChunkHeader);
+      std::array<const std::vector<char>*, numHitsColumns> contents;
+      for (unsigned short i = 0; i < numHitsColumns; ++i) {
+        auto& rec = hdr.columns[i];
+        contents[i] = &columns_[i];
+        rec.codec = hitsRaw;
+#ifdef ZLIB
+        if (codec_ == hitsDeflate) {
+          const auto& raw = columns_[i];
+          shuffled_.resize(raw.size());
+          shuffle(raw.data(), num_hits, hits_column_size[i], shuffled_.data());
+          auto& enc = encoded_[i];
+          uLongf enc_size = compressBound(raw.size());
+          enc.resize(enc_size);
+          if (compress2(reinterpret_cast<Bytef*>(enc.data()),
+                        &enc_size,
+                        reinterpret_cast<const Bytef*>(shuffled_.data()),
+                        raw.size(),
+                        Z_BEST_SPEED) == Z_OK &&
+              enc_size < raw.size()) {
+            enc.resize(enc_size);
+            contents[i] = &enc;
+            rec.codec = hitsDeflate;
+          }
+        }
+#endif
+        rec.offset = offset;
+        rec.stored_size = contents[i]->size();
+        offset += rec.stored_size + padding(rec.stored_size);
+      }
+      hdr.chunk_size = offset;
+
+      chunks_.emplace_back(file_.tellp());
+      file_.write(reinterpret_cast<const char*>(&hdr), sizeof(HitsChunkHeader));
+      static const char zeros[8] = {0};
+      for (const auto* content : contents) {
+        file_.write(content->data(), content->size());
+        file_.write(zeros, padding(content->size()));
+      }
+      for (auto& col : columns_)
+        col.clear();
+      return static_cast<bool>(file_);
+    }
+
+    void HitsWriter::close() {
+      if (!finish())
+        throw H_ERROR << "Failed to write the last hits chunk or the file footer!";
+    }
+
+    bool HitsWriter::finish() {
+      if (!file_.is_open())
+        return true;
+      if (!flush()) {
+        file_.close();
+        return false;
+      }
+
+      HitsFileFooter footer{};
+      footer.num_hits = num_hits_;
+      footer.num_chunks = chunks_.size();
+      footer.num_stations = stations_.size();
+      footer.num_loss_elements = names_.size();
+      for (const auto& name : names_)
+        footer.names_size += name.size() + 1;
+      HitsFileTrailer trailer{};
+      trailer.footer_offset = file_.tellp();
+      trailer.magic = hits_magic;
+
+      file_.write(reinterpret_cast<const char*>(&footer), sizeof(HitsFileFooter));
+      file_.write(reinterpret_cast<const char*>(chunks_.data()), chunks_.size() * sizeof(uint64_t));
+      file_.write(reinterpret_cast<const char*>(stations_.data()), stations_.size() * sizeof(double));
+      for (const auto& name : names_)
+        file_.write(name.c_str(), name.size() + 1);
+      file_.write(reinterpret_cast<const char*>(&trailer), sizeof(HitsFileTrailer));
+      const bool written = static_cast<bool>(file_);
+      file_.close();
+      return written && file_;
+    }
+
+    //----- reader
+
+    HitsReader::HitsReader(const std::string& filename) : file_(filename) {
+      if (!file_.isOpen())
+        throw H_ERROR << "Impossible to open file \"" << filename << "\" for reading!";
+      HitsFileHeader hdr;
+      HitsFileTrailer trailer;
+      if (file_.size() < sizeof(HitsFileHeader) + sizeof(HitsFileFooter) + sizeof(HitsFileTrailer))
+        throw H_ERROR << "Hits file \"" << filename << "\" is too short to hold its header and footer!";
+      std::memcpy(&hdr, file_.data(), sizeof(HitsFileHeader));
+      std::memcpy(&trailer, file_.data() + file_.size() - sizeof(HitsFileTrailer), sizeof(HitsFileTrailer));
+      if (hdr.magic != hits_magic)
+        throw H_ERROR << "Invalid magic number retrieved for file \"" << filename << "\"!";
+      if (trailer.magic != hits_magic)
+        throw H_ERROR << "Hits file \"" << filename << "\" is truncated or was not closed properly!";
+      if (hdr.version > hits_version)
+        throw H_ERROR << "Version " << hdr.version << " is not (yet) supported! Currently peaking at " << hits_version
+                      << "!";
+      if (hdr.byte_order != hits_byte_order)
+        throw H_ERROR << "Hits file \"" << filename << "\" was written with a different byte order!";
+      if (hdr.num_columns != numHitsColumns)
+        throw H_ERROR << "Invalid number of columns in hits file \"" << filename << "\": " << hdr.num_columns << ".";
+
+      const uint64_t footer_end = file_.size() - sizeof(HitsFileTrailer);
+      if (trailer.footer_offset < hdr.header_size || trailer.footer_offset + sizeof(HitsFileFooter) > footer_end)
+        throw H_ERROR << "Invalid footer location in hits file \"" << filename << "\"!";
+      HitsFileFooter footer;
+      const char* pos = file_.data() + trailer.footer_offset;
+      std::memcpy(&footer, pos, sizeof(HitsFileFooter));
+      pos += sizeof(HitsFileFooter);
+      if (trailer.footer_offset + sizeof(HitsFileFooter) + footer.num_chunks * sizeof(uint64_t) +
+              footer.num_stations * sizeof(double) + footer.names_size !=
+          footer_end)
+        throw H_ERROR << "Inconsistent footer size in hits file \"" << filename << "\"!";
+
+      num_hits_ = footer.num_hits;
+      chunks_.resize(footer.num_chunks);
+      std::memcpy(chunks_.data(), pos, footer.num_chunks * sizeof(uint64_t));
+      pos += footer.num_chunks * sizeof(uint64_t);
+      stations_.resize(footer.num_stations);
+      std::memcpy(stations_.data(), pos, footer.num_stations * sizeof(double));
+      pos += footer.num_stations * sizeof(double);
+      const char* names_end = pos + footer.names_size;
+      while (pos < names_end) {
+        const size_t len = strnlen(pos, names_end - pos);
+        names_.emplace_back(pos, len);
+        pos += len + 1;
+      }
+      if (names_.size() != footer.num_loss_elements)
+        throw H_ERROR << "Invalid loss elements names table in hits file \"" << filename << "\"!";
+      for (const auto& offset : chunks_)
+        if (offset < hdr.header_size || offset + sizeof(HitsChunkHeader) > trailer.footer_offset)
+          throw H_ERROR << "Invalid chunk location in hits file \"" << filename << "\"!";
+    }
+
+    HitsChunk HitsReader::chunk(size_t i) const {
+      const uint64_t offset = chunks_.at(i);
+      HitsChunkHeader hdr;
+      std::memcpy(&hdr, file_.data() + offset, sizeof(HitsChunkHeader));
+      if (offset + hdr.chunk_size > file_.size())
+        throw H_ERROR << "Chunk " << i << " exceeds the hits file size!";
+
+      HitsChunk chunk;
+      chunk.num_hits_ = hdr.num_hits;
+      for (unsigned short j = 0; j < numHitsColumns; ++j) {
+        const auto& rec = hdr.columns[j];
+        const size_t raw_size = hdr.num_hits * hits_column_size[j];
+        if (rec.offset % 8 != 0 || rec.offset + rec.stored_size > hdr.chunk_size)
+          throw H_ERROR << "Invalid location of column " << j << " in chunk " << i << "!";
+        const char* content = file_.data() + offset + rec.offset;
+        switch (rec.codec) {
+          case hitsRaw:
+            if (rec.stored_size != raw_size)
+              throw H_ERROR << "Invalid size of column " << j << " in chunk " << i << ": " << rec.stored_size
+                            << " != " << raw_size << ".";
+            chunk.columns_[j] = content;
+            break;
+          case hitsDeflate: {
+#ifdef ZLIB
+            std::vector<char> shuffled(raw_size);
+            uLongf size = raw_size;
+            if (uncompress(reinterpret_cast<Bytef*>(shuffled.data()),
+                           &size,
+                           reinterpret_cast<const Bytef*>(content),
+                           rec.stored_size) != Z_OK ||
+                size != raw_size)
+              throw H_ERROR << "Failed to decompress column " << j << " in chunk " << i << "!";
+            chunk.buffers_.emplace_back((raw_size + 7) / 8);
+            char* values = reinterpret_cast<char*>(chunk.buffers_.back().data());
+            unshuffle(shuffled.data(), hdr.num_hits, hits_column_size[j], values);
+            chunk.columns_[j] = values;
+#else
+            throw H_ERROR << "Hector was built without zlib support. Compressed hits files cannot be read.";
+#endif
+          } break;
+          default:
+            throw H_ERROR << "Invalid encoding of column " << j << " in chunk " << i << ": " << rec.codec << ".";
+        }
+      }
+      return chunk;
+    }
+
+    void HitsReader::scan(const std::function<void(const HitsChunk&)>& func) const {
+      for (size_t i = 0; i < chunks_.size(); ++i)
+        func(chunk(i));
+    }
+
+    std::vector<Hit> HitsReader::read() const {
+      std::vector<Hit> hits;
+      hits.reserve(num_hits_);
+      scan([&hits](const HitsChunk& chunk) {
+        for (size_t i = 0; i < chunk.size(); ++i)
+          hits.emplace_back(chunk.hit(i));
+      });
+      return hits;
+    }
+  }  // namespace io
+}  // namespace hector
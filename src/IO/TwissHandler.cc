@@ -16,14 +16,26 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <cstdio>
 #include <ctime>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+#include <unistd.h>
 
 #include "Hector/Apertures/Circular.h"
 #include "Hector/Apertures/Elliptic.h"
 #include "Hector/Apertures/RectElliptic.h"
 #include "Hector/Apertures/Rectangular.h"
 #include "Hector/Beamline.h"
+#include "Hector/BeamlineBuilder.h"
 #include "Hector/Elements/Collimator.h"
 #include "Hector/Elements/Dipole.h"
 #include "Hector/Elements/ElementFwd.h"
@@ -31,6 +43,7 @@
 #include "Hector/Elements/Marker.h"
 #include "Hector/Elements/Quadrupole.h"
 #include "Hector/Exception.h"
+#include "Hector/IO/HBLFileHandler.h"
 #include "Hector/IO/TwissHandler.h"
 #include "Hector/Parameters.h"
 #include "Hector/Utils/String.h"
@@ -42,26 +55,118 @@ namespace hector {
     template const std::string Unordered<io::Twiss::ValueType>::key( const size_t i ) const;
   }*/
   namespace io {
-    std::regex Twiss::rgx_typ_("^\\%[0-9]{0,}(s|le)$");
-    std::regex Twiss::rgx_hdr_("^\\@ (\\w+) +\\%([0-9]+s|le) +\\\"?([^\"\\n]+)");
-    std::regex Twiss::rgx_elm_hdr_("^\\s{0,}([\\*\\$])(.+)");
-    std::regex Twiss::rgx_drift_name_("DRIFT\\_[0-9]+");
-    std::regex Twiss::rgx_quadrup_name_("M[B,Q]\\w+\\d?\\.\\w?\\d[L,R]\\d(\\.B[1,2])?");
-    std::regex Twiss::rgx_sect_dipole_name_("MB\\.[A-Z][0-9]{1,2}[L,R][0-9]\\.B[1,2]");
-    std::regex Twiss::rgx_rect_dipole_name_("MB[A-Z0-9]{2,3}\\.*[B,R][0-9]");
-    std::regex Twiss::rgx_ip_name_("IP[0-9]");
-    std::regex Twiss::rgx_monitor_name_("BPM.+");
-    std::regex Twiss::rgx_rect_coll_name_("T[C,A].*\\.\\d[L,R]\\d\\.?(B[1-9])?");
-
-    Twiss::Twiss(std::string filename, std::string ip_name, float max_s, float min_s)
+    namespace {
+      inline bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f'; }
+
+      /// Extract the next line of a file content (without its end-of-line characters), moving the offset after it
+      std::string_view nextLine(std::string_view content, size_t& pos) {
+        const size_t begin = pos, end = std::min(content.find('\n', pos), content.size());
+        pos = end + 1;
+        auto line = content.substr(begin, end - begin);
+        while (!line.empty() && line.back() == '\r')
+          line.remove_suffix(1);
+        return line;
+      }
+
+      /// Remove the leading and trailing blanks, then quotes, of a value (as the trim function)
+      std::string_view strip(std::string_view str) {
+        while (!str.empty() && isBlank(str.front()))
+          str.remove_prefix(1);
+        while (!str.empty() && isBlank(str.back()))
+          str.remove_suffix(1);
+        while (!str.empty() && str.front() == '"')
+          str.remove_prefix(1);
+        while (!str.empty() && str.back() == '"')
+          str.remove_suffix(1);
+        return str;
+      }
+
+      /// Split a line into its blank-separated values, keeping quoted strings as a single value (without quotes)
+      /// \note Columns being padded with spaces, the line is scanned by words of 8 characters whenever possible.
+      template <typename T>
+      void tokenise(std::string_view line, T& values) {
+        static constexpr uint64_t ones = 0x0101010101010101ull, spaces = 0x20 * ones, highs = 0x80 * ones;
+        const auto word = [](const char* ptr) {
+          uint64_t out;
+          std::memcpy(&out, ptr, sizeof(out));
+          return out;
+        };
+        values.clear();
+        const char *it = line.data(), *end = line.data() + line.size();
+        while (true) {
+          while (end - it >= 8 && word(it) == spaces)
+            it += 8;
+          while (it != end && isBlank(*it))
+            ++it;
+          if (it == end)
+            return;
+          if (*it == '"') {
+            const char* begin = ++it;
+            while (it != end && *it != '"')
+              ++it;
+            values.emplace_back(begin, it - begin);
+            if (it != end)
+              ++it;
+            continue;
+          }
+          const char* begin = it;
+          // skip the words without any character below or equal to a space (all blanks are)
+          while (end - it >= 8) {
+            const uint64_t wrd = word(it);
+            if (((wrd - 0x21 * ones) & ~wrd & highs) != 0)
+              break;
+            it += 8;
+          }
+          while (it != end && !isBlank(*it))
+            ++it;
+          values.emplace_back(begin, it - begin);
+        }
+      }
+
+      /// Convert a value into a floating-point number
+      bool toDouble(std::string_view str, double& out) {
+        str = strip(str);
+        if (!str.empty() && str.front() == '+')
+          str.remove_prefix(1);
+        const auto res = std::from_chars(str.data(), str.data() + str.size(), out);
+        return res.ec == std::errc() && res.ptr == str.data() + str.size();
+      }
+    }  // namespace
+
+    Twiss::Twiss(std::string filename, std::string ip_name, double max_s, double min_s)
         : in_file_(filename), ip_name_(ip_name), min_s_(min_s) {
-      if (!in_file_.is_open())
+      if (!in_file_.isOpen())
         throw H_ERROR << "Failed to open the Twiss file \"" << filename << "\"\n\tPlease check the path!";
+
+      std::string cache_path, cache_key;
+      if (const auto& cache_dir = Parameters::get().twissCacheDirectory(); !cache_dir.empty()) {
+        cache_key = cacheKey(max_s);
+        const auto image_name = format("twiss_%016zx.hbc", std::hash<std::string>()(cache_key));
+        cache_path = (std::filesystem::path(cache_dir) / image_name).string();
+        if (loadCache(cache_path, cache_key)) {
+          H_DEBUG << "Beamline retrieved from the cache image \"" << cache_path << "\".";
+          in_file_.close();
+          return;
+        }
+      }
       parseHeader();
 
       raw_beamline_ = std::unique_ptr<Beamline>(new Beamline(max_s - min_s));
       if (max_s < 0. && header_float_.hasKey("length"))
         raw_beamline_->setLength(header_float_.get("length"));
+
+      parseElementsFields();
+
+      // then parse all elements, and identify the interaction point
+      parseElements();
+
+      beamline_ = Beamline::sequencedBeamline(raw_beamline_.get());
+      in_file_.close();
+      if (!cache_path.empty())
+        writeCache(cache_path, cache_key);
+    }
+
+    void Twiss::applyHeaderParameters() const {
       if (header_float_.hasKey("energy") && Parameters::get().beamEnergy() != header_float_.get("energy")) {
         Parameters::get().setBeamEnergy(header_float_.get("energy"));
         H_WARNING << "Beam energy changed to " << Parameters::get().beamEnergy()
@@ -78,16 +183,6 @@ namespace hector {
         H_WARNING << "Beam particles charge changed to " << Parameters::get().beamParticlesCharge()
                   << " e to match Twiss optics parameters.";
       }
-
-      parseElementsFields();
-
-      // start by identifying the interaction point
-      findInteractionPoint();
-
-      // then parse all elements
-      parseElements();
-
-      beamline_ = Beamline::sequencedBeamline(raw_beamline_.get());
     }
 
     Twiss::Twiss(const Twiss& rhs)
@@ -141,31 +236,48 @@ namespace hector {
 
     std::map<std::string, std::string> Twiss::headerStrings() const { return header_str_.asMap(); }
 
-    std::map<std::string, float> Twiss::headerFloats() const { return header_float_.asMap(); }
+    std::map<std::string, double> Twiss::headerFloats() const { return header_float_.asMap(); }
+
+    PropagationContext Twiss::context(const PropagationContext& ctx) const {
+      PropagationContext out(ctx);
+      if (header_float_.hasKey("energy"))
+        out = out.withBeamEnergy(header_float_.get("energy"));
+      if (header_float_.hasKey("mass"))
+        out = out.withBeamParticlesMass(header_float_.get("mass"));
+      if (header_float_.hasKey("charge"))
+        out = out.withBeamParticlesCharge(static_cast<int>(header_float_.get("charge")));
+      return out;
+    }
 
     void Twiss::parseHeader() {
-      if (!in_file_.is_open())
+      if (!in_file_.isOpen())
         throw H_ERROR << "Twiss file is not opened nor ready for parsing!";
-      std::string line;
-      while (!in_file_.eof()) {
-        std::getline(in_file_, line);
-
-        try {
-          std::smatch match;
-          if (!std::regex_search(line, match, rgx_hdr_))
-            break;
-
-          const std::string key = lowercase(match.str(1));
-          if (match.str(2) == "le")
-            header_float_.add(key, std::stod(match.str(3)));
-          else
-            header_str_.add(key, match.str(3));
-
-          // keep track of the last line read in the file
-          in_file_lastline_ = in_file_.tellg();
-        } catch (std::regex_error& e) {
-          throw H_ERROR << "Error at line " << in_file_.tellg() << " while parsing the header!\n\t" << e.what();
-        }
+      const auto content = in_file_.view();
+      size_t pos = 0;
+      in_file_lastline_ = 0;
+      // header lines are in the form "@ KEY %type value"
+      while (pos < content.size()) {
+        auto line = nextLine(content, pos);
+        if (line.size() < 2 || line[0] != '@' || line[1] != ' ')
+          break;
+        std::vector<std::string_view> tokens;
+        tokenise(line.substr(1), tokens);
+        if (tokens.size() < 3 || tokens.at(1).empty() || tokens.at(1).front() != '%')
+          break;
+        const std::string key = lowercase(std::string(tokens.at(0)));
+        // the value spans from the type until the end of the line, without its quotes
+        const auto value = strip(line.substr(tokens.at(1).data() + tokens.at(1).size() - line.data()));
+        if (tokens.at(1) == "%le") {
+          double val;
+          if (!toDouble(value, val))
+            throw H_ERROR << "Invalid numerical value \"" << value << "\" for the header key \"" << key << "\"!";
+          header_float_.add(key, val);
+        } else if (tokens.at(1).back() == 's')
+          header_str_.add(key, std::string(value));
+        else
+          break;
+        // keep track of the last line read in the file
+        in_file_lastline_ = pos;
       }
       // parse the Twiss file production timestamp
       if (header_str_.hasKey("date")) {
@@ -176,191 +288,447 @@ namespace hector {
         if (strptime((date + " " + time + " CET").c_str(), "%d/%m/%y %H.%M.%S %z", &tm) == nullptr) {
           if (mktime(&tm) < 0)
             tm.tm_year += 100;  // strong assumption that the Twiss file has been produced after 1970...
-          header_float_.add("timestamp", float(mktime(&tm)));
+          header_float_.add("timestamp", double(mktime(&tm)));
         }
       }
     }
 
     void Twiss::parseElementsFields() {
-      if (!in_file_.is_open())
+      if (!in_file_.isOpen())
         throw H_ERROR << "Twiss file is not opened nor ready for parsing!";
-      std::string line;
-
-      in_file_.seekg(in_file_lastline_);
-      std::vector<std::string> list_names, list_types;
-
-      while (!in_file_.eof()) {
-        std::getline(in_file_, line);
-
-        try {
-          std::smatch match;
-          if (!std::regex_search(line, match, rgx_elm_hdr_))
-            break;
+      const auto content = in_file_.view();
+      std::vector<std::string_view> list_names, list_types;
 
-          std::string field;
-          std::stringstream str(match.str(2));
-          switch (match.str(1)[0]) {
-            case '*':
-              while (str >> field)
-                list_names.emplace_back(lowercase(field));
-              break;  // field names
-            case '$':
-              while (str >> field)
-                list_types.emplace_back(field);
-              break;  // field types
-            default:
-              break;
-          }
-          in_file_lastline_ = in_file_.tellg();
-        } catch (std::regex_error& e) {
-          throw H_ERROR << "Error at line " << in_file_.tellg() << " while parsing elements fields!\n\t" << e.what();
-        }
+      size_t pos = in_file_lastline_;
+      while (pos < content.size()) {
+        auto line = nextLine(content, pos);
+        while (!line.empty() && isBlank(line.front()))
+          line.remove_prefix(1);
+        if (line.empty())
+          break;
+        if (line.front() == '*')  // field names
+          tokenise(line.substr(1), list_names);
+        else if (line.front() == '$')  // field types
+          tokenise(line.substr(1), list_types);
+        else
+          break;
+        in_file_lastline_ = pos;
       }
 
       // perform the matching name <-> data type
-      bool has_lists_matching = (list_names.size() == list_types.size());
+      const bool has_lists_matching = (list_names.size() == list_types.size());
       for (size_t i = 0; i < list_names.size(); i++) {
         ValueType type = Unknown;
-        try {
-          std::smatch match;
-          if (has_lists_matching && std::regex_search(list_types.at(i), match, rgx_typ_)) {
-            if (match.str(1) == "le")
+        if (has_lists_matching) {
+          auto type_str = list_types.at(i);
+          if (!type_str.empty() && type_str.front() == '%') {
+            type_str.remove_prefix(1);
+            while (!type_str.empty() && type_str.front() >= '0' && type_str.front() <= '9')
+              type_str.remove_prefix(1);
+            if (type_str == "le")
               type = Float;
-            else if (match.str(1) == "s")
+            else if (type_str == "s")
               type = String;
           }
-          elements_fields_.add(list_names.at(i), type);
-        } catch (std::regex_error& e) {
-          throw H_ERROR << "Error while performing the matching name-data!\n\t" << e.what();
         }
+        const std::string name = lowercase(std::string(list_names.at(i)));
+        elements_fields_.add(name, type);
       }
-    }
 
-    void Twiss::findInteractionPoint() {
-      if (!in_file_.is_open())
-        throw H_ERROR << "Twiss file is not opened nor ready for parsing!";
-      std::string line;
-      in_file_.seekg(in_file_lastline_);
+      // bind the columns used to build the elements
+      const auto column = [this](const std::string& name, ValueType type) -> int {
+        if (!elements_fields_.hasKey(name))
+          return -1;
+        const size_t id = elements_fields_.id(name);
+        if (elements_fields_.value(id) != type)
+          throw H_ERROR << "Twiss file predicts an unexpected type (" << elements_fields_.value(id)
+                        << ") for the optics element parameter \"" << name << "\".";
+        return id;
+      };
+      columns_.name = column("name", String);
+      columns_.keyword = column("keyword", String);
+      columns_.apertype = column("apertype", String);
+      columns_.s = column("s", Float);
+      columns_.l = column("l", Float);
+      columns_.k0l = column("k0l", Float);
+      columns_.k1l = column("k1l", Float);
+      columns_.hkick = column("hkick", Float);
+      columns_.vkick = column("vkick", Float);
+      columns_.x = column("x", Float);
+      columns_.y = column("y", Float);
+      columns_.dx = column("dx", Float);
+      columns_.dy = column("dy", Float);
+      columns_.betx = column("betx", Float);
+      columns_.bety = column("bety", Float);
+      columns_.aper_1 = column("aper_1", Float);
+      columns_.aper_2 = column("aper_2", Float);
+      columns_.aper_3 = column("aper_3", Float);
+      columns_.aper_4 = column("aper_4", Float);
+      if (columns_.name < 0)
+        throw H_ERROR << "Twiss file does not hold the elements name!";
+      for (size_t i = 0; i < elements_fields_.size(); ++i)
+        if (elements_fields_.value(i) == Unknown)
+          throw H_ERROR << "Twiss file predicts an unknown-type optics element parameter:\n\t"
+                        << " (" << elements_fields_.key(i) << ").";
+    }
 
-      while (!in_file_.eof()) {
-        std::getline(in_file_, line);
-        std::stringstream str(trim(line));
-        if (str.str().length() == 0)
+    bool Twiss::nextElement(size_t& pos, ValuesCollection& values) const {
+      const auto content = in_file_.view();
+      while (pos < content.size()) {
+        tokenise(nextLine(content, pos), values);
+        if (values.empty())
           continue;
-        std::string buffer;
-        ValuesCollection values;
-        while (str >> buffer)
-          values.push_back(buffer);
         // first check if the "correct" number of element properties is parsed
         if (values.size() != elements_fields_.size())
           throw H_ERROR << "Twiss file seems corrupted!\n\t"
-                        << "Element " << trim(values.at(0)) << " at line " << in_file_.tellg() << " has "
-                        << values.size() << " fields"
+                        << "Element " << strip(values.at(0)) << " has " << values.size() << " fields"
                         << " when " << elements_fields_.size() << " are expected.";
-        try {
-          auto elem = parseElement(values);
-          if (!elem || elem->name() != ip_name_)
-            continue;
-          interaction_point_ = elem;
-          raw_beamline_->setInteractionPoint(elem);
-          break;
-        } catch (Exception& e) {
-          e.dump(std::cerr);
-          throw H_ERROR << "Failed to retrieve the interaction point with name=\"" << ip_name_ << "\".";
-        }
+        return true;
+      }
+      return false;
+    }
+
+    double Twiss::value(const ValuesCollection& values, int column, const char* column_name, bool* valid) const {
+      double out;
+      if (column >= 0 && toDouble(values[column], out))
+        return out;
+      if (valid) {
+        *valid = false;
+        return 0.;
       }
+      if (column < 0)
+        throw H_ERROR << "Twiss file does not hold the \"" << column_name << "\" optics element parameter!";
+      throw H_ERROR << "Invalid numerical value \"" << values[column] << "\" for the \"" << column_name
+                    << "\" parameter of element " << strip(values[columns_.name]) << ".";
     }
 
+    class Twiss::SerialLines {
+    public:
+      explicit SerialLines(const Twiss& twiss) : twiss_(twiss), pos_(twiss.in_file_lastline_) {
+        values_.reserve(twiss.elements_fields_.size());
+      }
+      /// Move to the next element line
+      /// \param[out] id Line identifier, to convert it again later on
+      bool next(size_t& id) {
+        id = pos_;
+        return twiss_.nextElement(pos_, values_);
+      }
+      /// Name of the current element
+      std::string_view name() const { return strip(values_[twiss_.columns_.name]); }
+      /// Longitudinal position of the current element
+      double s() const { return twiss_.value(values_, twiss_.columns_.s, "s"); }
+      /// Convert the current element line into a record
+      bool record(Record& rec) const { return twiss_.parseRecord(values_, rec); }
+      /// Convert an element line already read into a record
+      bool record(size_t id, Record& rec) {
+        return twiss_.nextElement(id, values_) && twiss_.parseRecord(values_, rec);
+      }
+
+    private:
+      const Twiss& twiss_;
+      size_t pos_;
+      ValuesCollection values_;
+    };
+
+    /// \note Lines which failed to be converted are parsed again, to raise the same errors as a serial parsing.
+    class Twiss::ConvertedLines {
+    public:
+      ConvertedLines(const Twiss& twiss, std::vector<std::vector<Line> >& chunks)
+          : twiss_(twiss), chunks_(chunks), offsets_{0}, chunk_(0), index_(0), current_(nullptr) {
+        for (const auto& chunk : chunks_)
+          offsets_.emplace_back(offsets_.back() + chunk.size());
+      }
+      /// Move to the next element line
+      /// \param[out] id Line identifier, to convert it again later on
+      bool next(size_t& id) {
+        while (chunk_ < chunks_.size() && index_ == chunks_[chunk_].size())
+          ++chunk_, index_ = 0;
+        if (chunk_ == chunks_.size())
+          return false;
+        id = offsets_[chunk_] + index_;
+        current_ = &chunks_[chunk_][index_++];
+        return true;
+      }
+      /// Name of the current element
+      std::string_view name() {
+        if (current_->status == Line::Failed)
+          return strip(values(*current_)[twiss_.columns_.name]);
+        return current_->name;
+      }
+      /// Longitudinal position of the current element
+      double s() { return current_->has_s ? current_->s : twiss_.value(values(*current_), twiss_.columns_.s, "s"); }
+      /// Convert the current element line into a record
+      bool record(Record& rec) { return record(*current_, rec); }
+      /// Convert an element line already read into a record
+      bool record(size_t id, Record& rec) {
+        const size_t chunk = std::upper_bound(offsets_.begin(), offsets_.end(), id) - offsets_.begin() - 1;
+        return record(chunks_[chunk][id - offsets_[chunk]], rec);
+      }
+
+    private:
+      bool record(const Line& line, Record& rec) {
+        switch (line.status) {
+          case Line::Converted:
+            rec = line.record;
+            return true;
+          case Line::Ignored:
+            return false;
+          case Line::Failed:
+          case Line::Skipped:
+          default:
+            return twiss_.parseRecord(values(line), rec);
+        }
+      }
+      /// Values of a line, parsed again
+      const ValuesCollection& values(const Line& line) {
+        size_t pos = line.pos;
+        twiss_.nextElement(pos, values_);
+        return values_;
+      }
+
+      const Twiss& twiss_;
+      std::vector<std::vector<Line> >& chunks_;
+      std::vector<size_t> offsets_;
+      size_t chunk_, index_;
+      const Line* current_;
+      ValuesCollection values_;
+    };
+
     void Twiss::parseElements() {
-      if (!in_file_.is_open())
+      if (!in_file_.isOpen())
         throw H_ERROR << "Twiss file is not opened nor ready for parsing!";
-      // parse the optics elements and their characteristics
-      std::string line;
+      static constexpr size_t min_chunk_size = 1 << 18;  // only split the files worth it
+      const auto content = in_file_.view();
+      const size_t begin = std::min(in_file_lastline_, content.size());
+      size_t num_threads = Parameters::get().twissParsingThreads();
+      if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+      const size_t num_chunks = std::min(num_threads, (content.size() - begin) / min_chunk_size);
+      if (num_chunks <= 1) {
+        SerialLines lines(*this);
+        addElements(lines);
+        return;
+      }
+      // split the element lines into chunks of similar sizes, at lines boundaries
+      std::vector<size_t> bounds{begin};
+      for (size_t i = 1; i < num_chunks; ++i) {
+        const size_t pos = content.find('\n', begin + (content.size() - begin) * i / num_chunks);
+        bounds.emplace_back(std::max(std::min(pos, content.size() - 1) + 1, bounds.back()));
+      }
+      bounds.emplace_back(content.size());
 
-      if (!interaction_point_)
-        throw H_ERROR << "Interaction point \"" << ip_name_ << "\" has not been found in the beamline!";
+      // only convert the lines most likely belonging to the beamline, from a first guess of the interaction point
+      // position (the lines skipped on this basis are still converted later on if needed)
+      double s_min = -std::numeric_limits<double>::infinity(), s_max = std::numeric_limits<double>::infinity();
+      const std::string quoted_ip = '"' + ip_name_ + '"';
+      ValuesCollection values;
+      for (size_t pos = content.find(quoted_ip, begin); pos != std::string_view::npos;
+           pos = content.find(quoted_ip, pos + 1)) {
+        size_t line_pos = content.rfind('\n', pos);
+        line_pos = (line_pos == std::string_view::npos || line_pos < begin) ? begin : line_pos + 1;
+        tokenise(nextLine(content, line_pos), values);
+        bool valid = values.size() == elements_fields_.size();
+        if (!valid || strip(values[columns_.name]) != ip_name_)
+          continue;
+        const double ip_s = value(values, columns_.s, "s", &valid);
+        if (valid) {
+          s_min = ip_s + min_s_;
+          s_max = ip_s + raw_beamline_->maxLength();
+        }
+        break;
+      }
 
-      in_file_.seekg(in_file_lastline_);  // return to the first element line
+      std::vector<std::vector<Line> > chunks(num_chunks);
+      {
+        std::vector<std::thread> threads;
+        threads.reserve(num_chunks - 1);
+        for (size_t i = 1; i < num_chunks; ++i)
+          threads.emplace_back([&, i] { convertLines(bounds[i], bounds[i + 1], s_min, s_max, chunks[i]); });
+        convertLines(bounds[0], bounds[1], s_min, s_max, chunks[0]);
+        for (auto& thr : threads)
+          thr.join();
+      }
+      H_DEBUG << "Element lines converted by chunks on " << num_chunks << " threads.";
+      ConvertedLines lines(*this, chunks);
+      addElements(lines);
+    }
 
-      bool has_next_element = false;
-      while (!in_file_.eof()) {  // retrieve the next line from the Twiss file
-        std::getline(in_file_, line);
-        std::stringstream str(trim(line));
-        if (str.str().empty())
+    void Twiss::convertLines(size_t begin, size_t end, double s_min, double s_max, std::vector<Line>& lines) const {
+      const auto content = in_file_.view();
+      ValuesCollection values;
+      values.reserve(elements_fields_.size());
+      Line line;
+      for (size_t pos = begin; pos < end;) {
+        line.pos = pos;
+        tokenise(nextLine(content, pos), values);
+        if (values.empty())
           continue;
+        if (lines.empty())  // assume all lines are of similar lengths
+          lines.reserve((end - begin) / (pos - line.pos) + 1);
+        line.status = Line::Failed;
+        line.has_s = false;
+        // no error may be raised from this thread, the line will be parsed again if needed
+        if (values.size() == elements_fields_.size()) {
+          bool valid = true;
+          line.name = strip(values[columns_.name]);
+          line.s = value(values, columns_.s, "s", &valid);
+          line.has_s = valid;
+          if (valid && (line.s < s_min || line.s > s_max))
+            line.status = Line::Skipped;
+          else {
+            const bool converted = parseRecord(values, line.record, &valid);
+            if (valid)
+              line.status = converted ? Line::Converted : Line::Ignored;
+          }
+        }
+        lines.emplace_back(line);
+      }
+    }
 
-        // extract the list of properties
-        std::string buffer;
-        ValuesCollection values;
-        while (str >> buffer)
-          values.emplace_back(buffer);
-        auto elem = parseElement(values);
-        if (!elem || elem->type() == element::aDrift)
-          continue;
+    template <typename T>
+    void Twiss::addElements(T& lines) {
+      BeamlineBuilder builder(*raw_beamline_);
+      bool has_next_element = false, finished = false;
+      // build and add an element, once the interaction point position is known
+      const auto add_element = [&](const Record& rec) {
+        if (rec.type == element::aDrift)
+          return;
+        // skip the elements upstream from the beamline before building them
+        if (rec.s - interaction_point_->s() < min_s_)
+          return;
+        auto elem = buildElement(rec);
+        if (!elem || elem->type() == element::aDrift)  // also catches the collimators, built as drifts
+          return;
         elem->offsetS(-interaction_point_->s());
-        if (elem->s() < min_s_)
-          continue;
         if (elem->s() + elem->length() > raw_beamline_->maxLength()) {
           if (has_next_element) {
             H_INFO << "Finished to parse the beamline";
-            break;
+            finished = true;
+            return;
           }
           if (elem->type() != element::anInstrument && elem->type() != element::aDrift)
             has_next_element = true;
         }
-        raw_beamline_->add(elem);
-        //break;  // finished to parse
+        builder.add(elem);
+      };
+
+      // longitudinal position and identifier of the lines preceding the interaction point, until it is found
+      std::vector<std::pair<double, size_t> > upstream;
+      Record rec;
+      // retrieve the next line from the Twiss file
+      for (size_t id; !finished && lines.next(id);) {
+        if (interaction_point_) {
+          if (lines.record(rec))
+            add_element(rec);
+          continue;
+        }
+        if (lines.name() != ip_name_ || !lines.record(rec)) {
+          upstream.emplace_back(lines.s(), id);
+          continue;
+        }
+        try {
+          interaction_point_ = buildElement(rec);
+        } catch (Exception& e) {
+          e.dump(std::cerr);
+          throw H_ERROR << "Failed to retrieve the interaction point with name=\"" << ip_name_ << "\".";
+        }
+        if (!interaction_point_) {
+          upstream.emplace_back(rec.s, id);
+          continue;
+        }
+        const Record ip_rec = rec;
+        // only convert the preceding lines belonging to the beamline
+        for (const auto& up_line : upstream) {
+          if (up_line.first - interaction_point_->s() < min_s_)
+            continue;
+          if (lines.record(up_line.second, rec))
+            add_element(rec);
+          if (finished)
+            break;
+        }
+        upstream = std::vector<std::pair<double, size_t> >();
+        if (!finished)
+          add_element(ip_rec);
       }
+      if (!interaction_point_)
+        throw H_ERROR << "Interaction point \"" << ip_name_ << "\" has not been found in the beamline!";
       interaction_point_->setS(0.);  // by convention
-      raw_beamline_->add(interaction_point_);
+      builder.add(interaction_point_);
+      raw_beamline_ = builder.build();
+      raw_beamline_->setInteractionPoint(interaction_point_);
     }
 
-    element::ElementPtr Twiss::parseElement(const ValuesCollection& values) {
-      // first check if the "correct" number of element properties is parsed
-      if (values.size() != elements_fields_.size())
-        throw H_ERROR << "Twiss file seems corrupted!\n\t"
-                      << "Element " << trim(values.at(0)) << " has " << values.size() << " fields"
-                      << " when " << elements_fields_.size() << " are expected.";
-
-      // then perform the 3-fold matching key <-> value <-> value type
-      pmap::Ordered<float> elem_map_floats;
-      pmap::Ordered<std::string> elem_map_str;
-      for (size_t i = 0; i < values.size(); i++) {
-        const std::string key = elements_fields_.key(i), value = values.at(i);
-        const ValueType type = elements_fields_.value(i);
-        switch (type) {
-          case String:
-            elem_map_str.add(key, value);
-            break;
-          case Float:
-            elem_map_floats.add(key, std::stod(value));
-            break;
-          case Unknown:
-          default: {
-            throw H_ERROR << "Twiss file predicts an unknown-type optics element parameter:\n\t"
-                          << " (" << elements_fields_.key(i) << ") for " << trim(values.at(0)) << ".";
-          } break;
-        }
+    bool Twiss::parseRecord(const ValuesCollection& values, Record& rec, bool* valid) const {
+      rec.name = strip(values[columns_.name]);
+      // convert the element type from string to object
+      rec.type = (columns_.keyword >= 0)
+                     ? findElementTypeByKeyword(lowercase(std::string(strip(values[columns_.keyword]))))
+                     : findElementTypeByName(rec.name);
+      switch (rec.type) {
+        case element::aGenericQuadrupole:
+          rec.strength = value(values, columns_.k1l, "k1l", valid);
+          break;
+        case element::aRectangularDipole:
+        case element::aSectorDipole:
+          rec.strength = value(values, columns_.k0l, "k0l", valid);
+          break;
+        case element::anHorizontalKicker:
+          rec.strength = value(values, columns_.hkick, "hkick", valid);
+          break;
+        case element::aVerticalKicker:
+          rec.strength = value(values, columns_.vkick, "vkick", valid);
+          break;
+        case element::aRectangularCollimator:
+        case element::anEllipticalCollimator:
+        case element::aCircularCollimator:
+        case element::aCollimator:
+        case element::aMarker:
+        case element::anInstrument:
+        case element::aMonitor:
+        case element::aDrift:
+          rec.strength = 0.;
+          break;
+        default:  // no element can be built
+          return false;
       }
+      rec.s = value(values, columns_.s, "s", valid);
+      // drifts are recomputed from the elements positions, only the interaction point needs its optics
+      if (rec.type == element::aDrift && rec.name != ip_name_)
+        return true;
+      rec.length = value(values, columns_.l, "l", valid);
+      rec.position = TwoVector(value(values, columns_.x, "x", valid), value(values, columns_.y, "y", valid));
+      rec.dispersion = TwoVector(value(values, columns_.dx, "dx", valid), value(values, columns_.dy, "dy", valid));
+      rec.beta = TwoVector(value(values, columns_.betx, "betx", valid), value(values, columns_.bety, "bety", valid));
 
-      const std::string name = trim(elem_map_str.get("name"));
-      const float s = elem_map_floats.get("s"), length = elem_map_floats.get("l");
+      // associate the aperture type to the element
+      rec.aperture_type = aperture::anInvalidAperture;
+      if (columns_.apertype >= 0) {
+        rec.aperture_type = findApertureTypeByApertype(lowercase(std::string(strip(values[columns_.apertype]))));
+        rec.aperture[0] = value(values, columns_.aper_1, "aper_1", valid);
+        rec.aperture[1] = value(values, columns_.aper_2, "aper_2", valid);
+        if (rec.aperture_type == aperture::aRectEllipticAperture ||
+            rec.aperture_type == aperture::aRectCircularAperture)
+          rec.aperture[2] = value(values, columns_.aper_3, "aper_3", valid);
+        if (rec.aperture_type == aperture::aRectEllipticAperture)
+          rec.aperture[3] = value(values, columns_.aper_4, "aper_4", valid);
+      }
+      return true;
+    }
 
-      // convert the element type from string to object
-      const element::Type elemtype = (elem_map_str.hasKey("keyword"))
-                                         ? findElementTypeByKeyword(lowercase(trim(elem_map_str.get("keyword"))))
-                                         : findElementTypeByName(name);
+    element::ElementPtr Twiss::buildElement(const Record& rec) const {
+      const std::string name(rec.name);
+      const double s = rec.s, length = rec.length;
 
       element::ElementPtr elem;
 
       try {
         // create the element
-        switch (elemtype) {
+        switch (rec.type) {
           case element::aGenericQuadrupole: {
             if (length <= 0.)
               throw H_ERROR << "Trying to add a quadrupole with invalid length (l=" << length << " m).";
 
-            const double k1l = elem_map_floats.get("k1l");
+            const double k1l = rec.strength;
             const double mag_str_k = -k1l / length;
             if (k1l > 0)
               elem.reset(new element::HorizontalQuadrupole(name, s, length, mag_str_k));
@@ -369,30 +737,27 @@ namespace hector {
           } break;
           case element::aRectangularDipole:
           case element::aSectorDipole: {
-            const double k0l = elem_map_floats.get("k0l");
+            const double k0l = rec.strength;
             if (length <= 0.)
               throw H_ERROR << "Trying to add a dipole with invalid length (l=" << length << " m).";
             if (k0l == 0.)
               throw H_ERROR << "Trying to add a dipole (" << name << ") with k0l=" << k0l << ".";
 
             const double mag_strength = k0l / length;
-            //            std::cout << name << "|" << s << "|" << mag_strength << std::endl;
-            if (elemtype == element::aRectangularDipole)
+            if (rec.type == element::aRectangularDipole)
               elem.reset(new element::RectangularDipole(name, s, length, mag_strength));
-            if (elemtype == element::aSectorDipole)
+            if (rec.type == element::aSectorDipole)
               elem.reset(new element::SectorDipole(name, s, length, mag_strength));
           } break;
           case element::anHorizontalKicker: {
-            const double hkick = elem_map_floats.get("hkick");
-            if (hkick == 0.)
+            if (rec.strength == 0.)
               return 0;
-            elem.reset(new element::HorizontalKicker(name, s, length, hkick));
+            elem.reset(new element::HorizontalKicker(name, s, length, rec.strength));
           } break;
           case element::aVerticalKicker: {
-            const double vkick = elem_map_floats.get("vkick");
-            if (vkick == 0.)
+            if (rec.strength == 0.)
               return 0;
-            elem.reset(new element::VerticalKicker(name, s, length, vkick));
+            elem.reset(new element::VerticalKicker(name, s, length, rec.strength));
           } break;
           case element::aRectangularCollimator:
           case element::anEllipticalCollimator:
@@ -406,7 +771,7 @@ namespace hector {
           case element::anInstrument:
           case element::aMonitor:
           case element::aDrift:
-            elem.reset(new element::Drift(name, elemtype, s, length));
+            elem.reset(new element::Drift(name, rec.type, s, length));
             break;
           default:
             break;
@@ -416,67 +781,172 @@ namespace hector {
         if (!elem)
           return elem;
 
-        const TwoVector env_pos(elem_map_floats.get("x"), elem_map_floats.get("y"));
-
+        const TwoVector& env_pos = rec.position;
         elem->setRelativePosition(env_pos);
-        elem->setDispersion(TwoVector(elem_map_floats.get("dx"), elem_map_floats.get("dy")));
-        elem->setBeta(TwoVector(elem_map_floats.get("betx"), elem_map_floats.get("bety")));
-
-        // associate the aperture type to the element
-        if (elem_map_str.hasKey("apertype")) {
-          const std::string aper_type = lowercase(trim(elem_map_str.get("apertype")));
-          const aperture::Type apertype = findApertureTypeByApertype(aper_type);
-          const double aper_1 = elem_map_floats.get("aper_1");
-          const double aper_2 = elem_map_floats.get("aper_2");
-          // MAD-X provides it in m
-          switch (apertype) {
-            case aperture::aCircularAperture:
-              elem->setAperture(std::make_shared<aperture::Circular>(aper_1, env_pos));
-              break;
-            case aperture::aRectangularAperture:
-              elem->setAperture(std::make_shared<aperture::Rectangular>(aper_1, aper_2, env_pos));
-              break;
-            case aperture::anEllipticAperture:
-              elem->setAperture(std::make_shared<aperture::Elliptic>(aper_1, aper_2, env_pos));
-              break;
-            case aperture::aRectEllipticAperture: {
-              const double aper_3 = elem_map_floats.get("aper_3");
-              const double aper_4 = elem_map_floats.get("aper_4");
-              elem->setAperture(std::make_shared<aperture::RectElliptic>(aper_1, aper_2, aper_3, aper_4, env_pos));
-            } break;
-            case aperture::aRectCircularAperture: {
-              const double aper_3 = elem_map_floats.get("aper_3");
-              elem->setAperture(std::make_shared<aperture::RectElliptic>(aper_1, aper_2, aper_3, aper_3, env_pos));
-            } break;
-            default:
-              break;
-          }
-        }
+        elem->setDispersion(rec.dispersion);
+        elem->setBeta(rec.beta);
 
+        // MAD-X provides the aperture parameters in m
+        const auto& aper = rec.aperture;
+        switch (rec.aperture_type) {
+          case aperture::aCircularAperture:
+            elem->setAperture(std::make_shared<aperture::Circular>(aper[0], env_pos));
+            break;
+          case aperture::aRectangularAperture:
+            elem->setAperture(std::make_shared<aperture::Rectangular>(aper[0], aper[1], env_pos));
+            break;
+          case aperture::anEllipticAperture:
+            elem->setAperture(std::make_shared<aperture::Elliptic>(aper[0], aper[1], env_pos));
+            break;
+          case aperture::aRectEllipticAperture:
+            elem->setAperture(std::make_shared<aperture::RectElliptic>(aper[0], aper[1], aper[2], aper[3], env_pos));
+            break;
+          case aperture::aRectCircularAperture:
+            elem->setAperture(std::make_shared<aperture::RectElliptic>(aper[0], aper[1], aper[2], aper[2], env_pos));
+            break;
+          default:
+            break;
+        }
       } catch (const Exception& e) {
         e.dump(std::cerr);
       }
       return elem;
     }
 
-    element::Type Twiss::findElementTypeByName(std::string name) {
-      try {
-        if (std::regex_match(name, rgx_drift_name_))
-          return element::aDrift;
-        if (std::regex_match(name, rgx_quadrup_name_))
-          return element::aGenericQuadrupole;
-        if (std::regex_match(name, rgx_sect_dipole_name_))
-          return element::aSectorDipole;
-        if (std::regex_match(name, rgx_rect_dipole_name_))
-          return element::aRectangularDipole;
-        if (std::regex_match(name, rgx_ip_name_))
-          return element::aMarker;
-        if (std::regex_match(name, rgx_monitor_name_))
-          return element::aMonitor;
-        if (std::regex_match(name, rgx_rect_coll_name_))
-          return element::aRectangularCollimator;
-      } catch (std::regex_error& e) {
-        throw H_ERROR << "Error while retrieving the element type!\n\t" << e.what();
+    namespace {
+      /// Hand-written equivalents of the regular expressions formerly used to classify elements from their name
+      /// \note All patterns are fully matched, and character classes such as [L,R] also accept the comma.
+      namespace names {
+        inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+        inline bool isUpper(char c) { return c >= 'A' && c <= 'Z'; }
+        inline bool isWord(char c) { return isDigit(c) || isUpper(c) || (c >= 'a' && c <= 'z') || c == '_'; }
+        inline bool isAnyOf(char c, std::string_view chars) { return chars.find(c) != std::string_view::npos; }
+        /// Equivalent to .* (any character but a line terminator)
+        inline bool isAny(std::string_view str) {
+          return std::none_of(str.begin(), str.end(), [](char c) { return c == '\n' || c == '\r'; });
+        }
+        inline bool startsWith(std::string_view str, std::string_view prefix) {
+          return str.substr(0, prefix.size()) == prefix;
+        }
+
+        /// DRIFT\_[0-9]+
+        bool isDrift(std::string_view name) {
+          if (name.size() <= 6 || !startsWith(name, "DRIFT_"))
+            return false;
+          for (size_t i = 6; i < name.size(); ++i)
+            if (!isDigit(name[i]))
+              return false;
+          return true;
+        }
+        /// \w?\d[L,R]\d, as found at the end of quadrupoles and collimators names
+        bool isPosition(std::string_view str) {
+          if (str.size() == 4) {
+            if (!isWord(str[0]))
+              return false;
+            str.remove_prefix(1);
+          }
+          return str.size() == 3 && isDigit(str[0]) && isAnyOf(str[1], "L,R") && isDigit(str[2]);
+        }
+        /// M[B,Q]\w+\d?\.\w?\d[L,R]\d(\.B[1,2])?
+        bool isQuadrupole(std::string_view name) {
+          if (name.size() < 7 || name[0] != 'M' || !isAnyOf(name[1], "B,Q"))
+            return false;
+          size_t i = 2;  // \w+\d? is equivalent to \w+, as the digits are word characters
+          while (i < name.size() && isWord(name[i]))
+            ++i;
+          if (i == 2 || i == name.size() || name[i] != '.')
+            return false;
+          auto pos = name.substr(i + 1);
+          if (pos.size() > 3 && pos[pos.size() - 3] == '.' && pos[pos.size() - 2] == 'B' &&
+              isAnyOf(pos.back(), "1,2"))
+            pos.remove_suffix(3);
+          return isPosition(pos);
+        }
+        /// MB\.[A-Z][0-9]{1,2}[L,R][0-9]\.B[1,2]
+        bool isSectorDipole(std::string_view name) {
+          if ((name.size() != 10 && name.size() != 11) || !startsWith(name, "MB.") || !isUpper(name[3]))
+            return false;
+          const size_t i = name.size() - 5;  // first character after the [0-9]{1,2} part
+          if (!isDigit(name[4]) || (i == 6 && !isDigit(name[5])))
+            return false;
+          return isAnyOf(name[i], "L,R") && isDigit(name[i + 1]) && name[i + 2] == '.' && name[i + 3] == 'B' &&
+                 isAnyOf(name[i + 4], "1,2");
+        }
+        /// MB[A-Z0-9]{2,3}\.*[B,R][0-9]
+        bool isRectangularDipole(std::string_view name) {
+          if (name.size() < 6 || !startsWith(name, "MB") || !isDigit(name.back()) ||
+              !isAnyOf(name[name.size() - 2], "B,R"))
+            return false;
+          auto core = name.substr(2, name.size() - 4);
+          while (!core.empty() && core.back() == '.')
+            core.remove_suffix(1);
+          if (core.size() != 2 && core.size() != 3)
+            return false;
+          for (const auto& c : core)
+            if (!isDigit(c) && !isUpper(c))
+              return false;
+          return true;
+        }
+        /// IP[0-9]
+        bool isInteractionPoint(std::string_view name) {
+          return name.size() == 3 && name[0] == 'I' && name[1] == 'P' && isDigit(name[2]);
+        }
+        /// BPM.+
+        bool isMonitor(std::string_view name) {
+          return name.size() > 3 && startsWith(name, "BPM") && isAny(name.substr(3));
+        }
+        /// T[C,A].*\.\d[L,R]\d\.?(B[1-9])?
+        bool isRectangularCollimator(std::string_view name) {
+          if (name.size() < 6 || name[0] != 'T' || !isAnyOf(name[1], "C,A"))
+            return false;
+          // try all possible endings: nothing, "\.", "B[1-9]", or "\.B[1-9]"
+          const auto is_beam = [](std::string_view str) { return str[0] == 'B' && str[1] >= '1' && str[1] <= '9'; };
+          for (size_t suffix = 0; suffix <= 3 && name.size() >= 6 + suffix; ++suffix) {
+            const auto end = name.substr(name.size() - suffix);
+            if ((suffix == 1 && end[0] != '.') || (suffix == 2 && !is_beam(end)) ||
+                (suffix == 3 && (end[0] != '.' || !is_beam(end.substr(1)))))
+              continue;
+            const auto core = name.substr(0, name.size() - suffix);
+            const size_t i = core.size() - 4;  // the trailing \.\d[L,R]\d part
+            if (core[i] == '.' && isPosition(core.substr(i + 1)) && isAny(core.substr(2, i - 2)))
+              return true;
+          }
+          return false;
+        }
+      }  // namespace names
+    }  // namespace
+
+    element::Type Twiss::findElementTypeByName(std::string_view name) {
+      if (name.empty())
+        return element::anInvalidElement;
+      // all patterns start with a different character, except for the dipoles and quadrupoles
+      switch (name[0]) {
+        case 'D':
+          if (names::isDrift(name))
+            return element::aDrift;
+          break;
+        case 'M':
+          if (names::isQuadrupole(name))
+            return element::aGenericQuadrupole;
+          if (names::isSectorDipole(name))
+            return element::aSectorDipole;
+          if (names::isRectangularDipole(name))
+            return element::aRectangularDipole;
+          break;
+        case 'I':
+          if (names::isInteractionPoint(name))
+            return element::aMarker;
+          break;
+        case 'B':
+          if (names::isMonitor(name))
+            return element::aMonitor;
+          break;
+        case 'T':
+          if (names::isRectangularCollimator(name))
+            return element::aRectangularCollimator;
+          break;
+        default:
+          break;
       }
       return element::anInvalidElement;
     }
@@ -537,6 +1007,191 @@ namespace hector {
       return aperture::anInvalidAperture;
     }
 
+    namespace {
+      constexpr uint64_t cache_magic = 0x3143424857544348ull;  // "HCTWHBC1"
+
+      /// Fast, non-cryptographic 64-bit hash of a buffer, processed by words of 8 bytes on four independent lanes
+      uint64_t contentHash(std::string_view content) {
+        static constexpr uint64_t k0 = 0x9e3779b97f4a7c15ull, k1 = 0xbf58476d1ce4e5b9ull, k2 = 0x94d049bb133111ebull;
+        const auto mix = [](uint64_t h, uint64_t word) {
+          h ^= word * k1;
+          return ((h << 31) | (h >> 33)) * k2;
+        };
+        const auto word = [](const char* ptr) {
+          uint64_t out;
+          std::memcpy(&out, ptr, sizeof(out));
+          return out;
+        };
+        uint64_t lanes[4] = {k0, k0 + 1, k0 + 2, k0 + 3};
+        const char *it = content.data(), *end = content.data() + content.size();
+        for (; end - it >= 32; it += 32)
+          for (size_t i = 0; i < 4; ++i)
+            lanes[i] = mix(lanes[i], word(it + 8 * i));
+        uint64_t h = content.size();
+        for (const auto& lane : lanes)
+          h = mix(h, lane);
+        for (; end - it >= 8; it += 8)
+          h = mix(h, word(it));
+        if (it != end) {
+          uint64_t tail = 0;
+          std::memcpy(&tail, it, end - it);
+          h = mix(h, tail);
+        }
+        h ^= h >> 32;
+        return h * k2;
+      }
+
+      /// Sequential writer of the cache image fields
+      struct CacheWriter {
+        explicit CacheWriter(std::ostream& os) : os(os) {}
+        template <typename T>
+        void write(const T& value) {
+          os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+        void write(const std::string& str) {
+          write<uint64_t>(str.size());
+          os.write(str.data(), str.size());
+        }
+        /// Pad the image to the next 8-byte boundary
+        void align() {
+          static constexpr char padding[8] = {0};
+          if (const auto pos = (size_t)os.tellp(); pos % 8 != 0)
+            os.write(padding, 8 - pos % 8);
+        }
+        std::ostream& os;
+      };
+
+      /// Sequential reader of the cache image fields, failing on truncated images
+      struct CacheReader {
+        explicit CacheReader(std::string_view content) : content(content) {}
+        template <typename T>
+        bool read(T& value) {
+          if (content.size() - pos < sizeof(T))
+            return false;
+          std::memcpy(&value, content.data() + pos, sizeof(T));
+          pos += sizeof(T);
+          return true;
+        }
+        bool read(std::string_view& str) {
+          uint64_t size;
+          if (!read(size) || content.size() - pos < size)
+            return false;
+          str = content.substr(pos, size);
+          pos += size;
+          return true;
+        }
+        void align() { pos = std::min(content.size(), (pos + 7) / 8 * 8); }
+        std::string_view content;
+        size_t pos{0};
+      };
+    }  // namespace
+
+    std::string Twiss::cacheKey(double max_s) const {
+      static constexpr unsigned short cache_version = 2;
+      return format("content=%016llx:%zu|ip=%s|min_s=%.17g|max_s=%.17g|overlaps=%d|hbl=%d|v%d",
+                    (unsigned long long)contentHash(in_file_.view()),
+                    in_file_.size(),
+                    ip_name_.c_str(),
+                    min_s_,
+                    max_s,
+                    Parameters::get().correctBeamlineOverlaps(),
+                    HBL::version,
+                    cache_version);
+    }
+
+    bool Twiss::loadCache(const std::string& path, const std::string& key) {
+      const MappedFile file(path);
+      if (!file.isOpen())
+        return false;
+      CacheReader reader(file.view());
+      uint64_t magic, num_entries;
+      std::string_view entry_key, str, value;
+      if (!reader.read(magic) || magic != cache_magic || !reader.read(entry_key) || entry_key != key)
+        return false;
+      // header of the Twiss file
+      pmap::Ordered<std::string> header_str;
+      pmap::Ordered<double> header_float;
+      if (!reader.read(num_entries))
+        return false;
+      for (size_t i = 0; i < num_entries; ++i) {
+        if (!reader.read(str) || !reader.read(value))
+          return false;
+        header_str.add(std::string(str), std::string(value));
+      }
+      if (!reader.read(num_entries))
+        return false;
+      for (size_t i = 0; i < num_entries; ++i) {
+        double val;
+        if (!reader.read(str) || !reader.read(val))
+          return false;
+        header_float.add(std::string(str), val);
+      }
+      // raw and sequenced beamlines, as compiled HBL images ; as any parsing error is fatal, their content is checked
+      // against its hash beforehand, so that a corrupted image is parsed again from the Twiss file instead
+      std::string_view raw_image, seq_image;
+      uint64_t raw_hash, seq_hash;
+      reader.align();
+      if (!reader.read(raw_hash) || !reader.read(raw_image) || contentHash(raw_image) != raw_hash)
+        return false;
+      reader.align();
+      if (!reader.read(seq_hash) || !reader.read(seq_image) || contentHash(seq_image) != seq_hash)
+        return false;
+      if (raw_image.empty() || seq_image.empty())
+        return false;
+      HBL raw_hbl, seq_hbl;
+      raw_hbl.parseContent(raw_image);
+      seq_hbl.parseContent(seq_image);
+
+      header_str_ = header_str;
+      header_float_ = header_float;
+      raw_beamline_ = raw_hbl.releaseBeamline();
+      beamline_ = seq_hbl.releaseBeamline();
+      interaction_point_ = raw_beamline_->interactionPoint();
+      return true;
+    }
+
+    void Twiss::writeCache(const std::string& path, const std::string& key) const {
+      // written to a process-specific file first, then moved in place to be seen complete by concurrent jobs
+      const auto tmp_path = path + ".tmp" + std::to_string(getpid());
+      std::error_code err;
+      std::filesystem::create_directories(std::filesystem::path(path).parent_path(), err);
+      {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::out);
+        if (!file.is_open()) {
+          H_WARNING << "Failed to create the Twiss cache image \"" << tmp_path << "\".";
+          return;
+        }
+        CacheWriter writer(file);
+        writer.write(cache_magic);
+        writer.write(key);
+        const auto header_str = header_str_.asMap();
+        writer.write<uint64_t>(header_str.size());
+        for (const auto& entry : header_str)
+          writer.write(entry.first), writer.write(entry.second);
+        const auto header_float = header_float_.asMap();
+        writer.write<uint64_t>(header_float.size());
+        for (const auto& entry : header_float)
+          writer.write(entry.first), writer.write(entry.second);
+        for (const auto* bl : {raw_beamline_.get(), beamline_.get()}) {
+          std::ostringstream image;
+          HBL::write(bl, image);
+          const auto content = image.str();
+          writer.align();
+          writer.write(contentHash(content));
+          writer.write(content);
+        }
+        if (!file) {
+          H_WARNING << "Failed to write the Twiss cache image \"" << tmp_path << "\".";
+          std::remove(tmp_path.c_str());
+          return;
+        }
+      }
+      if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        H_WARNING << "Failed to move the Twiss cache image to \"" << path << "\".";
+        std::remove(tmp_path.c_str());
+      }
+    }
+
     std::ostream& operator<<(std::ostream& os, const io::Twiss::ValueType& type) {
       switch (type) {
         case io::Twiss::Unknown:
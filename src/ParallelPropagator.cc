@@ -0,0 +1,248 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+#include "Hector/Exception.h"
+#include "Hector/ParallelPropagator.h"
+
+namespace hector {
+  namespace {
+    /// Collection of chunks of work owned by one worker, and stolen by the others once idle
+    class WorkQueue {
+    public:
+      /// Add a chunk to the collection
+      void push(size_t chunk) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        chunks_.emplace_back(chunk);
+      }
+      /// Retrieve the next chunk to be processed by the owner of this collection
+      bool pop(size_t& chunk) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (chunks_.empty())
+          return false;
+        chunk = chunks_.front();
+        chunks_.pop_front();
+        return true;
+      }
+      /// Retrieve the last chunk of this collection for another worker
+      bool steal(size_t& chunk) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (chunks_.empty())
+          return false;
+        chunk = chunks_.back();
+        chunks_.pop_back();
+        return true;
+      }
+
+    private:
+      std::mutex mutex_;
+      std::deque<size_t> chunks_;
+    };
+  }  // namespace
+
+  /// Collection of helper threads kept alive between two propagations, and woken up for each of them
+  class ParallelPropagator::WorkerPool {
+  public:
+    /// Spawn the helper threads, the calling thread acting as the first worker
+    explicit WorkerPool(size_t num_workers)
+        : job_(nullptr), num_workers_(0), generation_(0), pending_(0), stop_(false) {
+      for (size_t i = 1; i < num_workers; ++i)
+        threads_.emplace_back(&WorkerPool::loop, this, i);
+    }
+    ~WorkerPool() {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      wake_.notify_all();
+      for (auto& thr : threads_)
+        thr.join();
+    }
+    /// Run a job on a given number of workers, and wait for all of them to complete it
+    /// \param[in] num_workers Number of workers involved (including the calling thread)
+    /// \param[in] job Work of each worker, given its index ; expected not to throw
+    void run(size_t num_workers, const std::function<void(size_t)>& job) {
+      std::lock_guard<std::mutex> run_lock(run_mutex_);  // one job at a time
+      num_workers = std::min(num_workers, threads_.size() + 1);
+      if (num_workers > 1) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = &job;
+        num_workers_ = num_workers;
+        pending_ = num_workers - 1;
+        ++generation_;
+        wake_.notify_all();
+      }
+      job(0);
+      if (num_workers > 1) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return pending_ == 0; });
+        job_ = nullptr;
+      }
+    }
+
+  private:
+    /// Wait for the jobs to be run, and process them as a given worker
+    void loop(size_t id) {
+      size_t generation = 0;
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (true) {
+        wake_.wait(lock, [this, &generation] { return stop_ || generation_ != generation; });
+        if (stop_)
+          return;
+        generation = generation_;
+        if (id >= num_workers_)  // not needed for this job
+          continue;
+        const auto* job = job_;
+        lock.unlock();
+        (*job)(id);
+        lock.lock();
+        if (--pending_ == 0)
+          done_.notify_one();
+      }
+    }
+
+    std::mutex run_mutex_;
+    std::mutex mutex_;
+    std::condition_variable wake_, done_;
+    const std::function<void(size_t)>* job_;  ///< Job currently being run
+    size_t num_workers_;                      ///< Number of workers involved in the current job
+    size_t generation_;                       ///< Number of jobs run so far
+    size_t pending_;                          ///< Number of helper threads still processing the current job
+    bool stop_;
+    std::vector<std::thread> threads_;
+  };
+
+  ParallelPropagator::ParallelPropagator(const Beamline* bl,
+                                         unsigned short num_threads,
+                                         size_t chunk_size,
+                                         const PropagationContext& ctx)
+      : Propagator(bl, ctx), num_threads_(0), chunk_size_(0) {
+    setNumThreads(num_threads);
+    setChunkSize(chunk_size);
+  }
+
+  void ParallelPropagator::setNumThreads(unsigned short num_threads) {
+    num_threads_ = (num_threads > 0) ? num_threads : std::max(1u, std::thread::hardware_concurrency());
+    pool_ = std::make_shared<WorkerPool>(num_threads_);
+  }
+
+  void ParallelPropagator::setChunkSize(size_t chunk_size) { chunk_size_ = std::max<size_t>(1, chunk_size); }
+
+  size_t ParallelPropagator::propagate(Particles& beam, double s_max) const {
+    return dispatch(beam.size(), [this, &beam, &s_max](size_t begin, size_t end) {
+      size_t num_stopped = 0;
+      for (size_t i = begin; i < end; ++i)
+        if (tryPropagate(beam[i], s_max).stopped())
+          ++num_stopped;
+      return num_stopped;
+    });
+  }
+
+  size_t ParallelPropagator::propagate(size_t num_part,
+                                       const double* states,
+                                       const double* masses,
+                                       const int* charges,
+                                       const std::vector<double>& stations,
+                                       double* stations_states,
+                                       int* losses) const {
+    const size_t num_stations = stations.size();
+    if (num_stations == 0)
+      throw H_ERROR << "At least one station is required to extract the particles states.";
+    Propagator recorder(*this);
+    recorder.setStations(stations);
+    const double s_max = recorder.stations().back(), mass = context().beamParticlesMass();
+    const int charge = context().beamParticlesCharge();
+
+    return dispatch(num_part, [&](size_t begin, size_t end) {
+      size_t num_stopped = 0;
+      for (size_t i = begin; i < end; ++i) {
+        Particle part(StateVector(Vector(Eigen::Map<const Vector6d>(states + 6 * i)), masses ? masses[i] : mass));
+        part.setCharge(charges ? charges[i] : charge);
+        const auto status = recorder.tryPropagate(part, s_max);
+        losses[i] = status.element;
+        if (status.stopped())
+          ++num_stopped;
+        for (size_t j = 0; j < num_stations; ++j) {
+          Eigen::Map<Vector6d> out(stations_states + 6 * (i * num_stations + j));
+          const auto it = part.positions().find(stations[j]);
+          if (it != part.positions().end())
+            out = it->second.vector();
+          else
+            out.setConstant(std::numeric_limits<double>::quiet_NaN());
+        }
+      }
+      return num_stopped;
+    });
+  }
+
+  size_t ParallelPropagator::dispatch(size_t num_items, const std::function<size_t(size_t, size_t)>& process) const {
+    const size_t num_chunks = (num_items + chunk_size_ - 1) / chunk_size_;
+    const size_t num_workers = std::min<size_t>(num_threads_, num_chunks);
+    if (num_workers == 0)
+      return 0;
+
+    // distribute contiguous ranges of chunks to each worker
+    std::vector<WorkQueue> queues(num_workers);
+    for (size_t i = 0; i < num_chunks; ++i)
+      queues[i * num_workers / num_chunks].push(i);
+
+    std::atomic<size_t> num_stopped(0);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto process_chunk = [&](size_t chunk) {
+      num_stopped += process(chunk * chunk_size_, std::min(num_items, (chunk + 1) * chunk_size_));
+    };
+    auto worker = [&](size_t id) {
+      try {
+        size_t chunk;
+        while (true) {
+          if (queues[id].pop(chunk)) {
+            process_chunk(chunk);
+            continue;
+          }
+          bool stolen = false;
+          for (size_t j = 1; j < num_workers && !stolen; ++j)
+            stolen = queues[(id + j) % num_workers].steal(chunk);
+          if (!stolen)
+            break;  // no work left in any queue
+          process_chunk(chunk);
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error)
+          error = std::current_exception();
+      }
+    };
+
+    if (num_workers == 1)
+      worker(0);
+    else
+      pool_->run(num_workers, worker);
+    if (error)
+      std::rethrow_exception(error);
+    return num_stopped;
+  }
+}  // namespace hector
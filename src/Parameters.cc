@@ -16,6 +16,8 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <cstdlib>
+
 #include "Hector/Parameters.h"
 
 namespace hector {
@@ -28,7 +30,13 @@ namespace hector {
         correct_beamline_overlaps_(true),
         compute_aperture_acceptance_(true),
         enable_kickers_(false),
-        enable_dipoles_(true) {}
+        enable_dipoles_(true),
+        twiss_parsing_threads_(1) {
+    if (const char* cache_dir = std::getenv("HECTOR_TWISS_CACHE"))
+      twiss_cache_dir_ = cache_dir;
+    if (const char* num_threads = std::getenv("HECTOR_TWISS_THREADS"))
+      twiss_parsing_threads_ = std::strtoul(num_threads, nullptr, 10);
+  }
 
   Parameters& Parameters::get() {
     static Parameters params;
@@ -16,20 +16,27 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <iterator>
+
 #include "Hector/Exception.h"
-#include "Hector/Parameters.h"
 #include "Hector/Particle.h"
+#include "Hector/PropagationContext.h"
 #include "Hector/Utils/String.h"
 
 namespace hector {
-  Particle::Particle() : charge_(0), pdgId_(0), physical_(true), stopped_(false) { addPosition(0., StateVector()); }
+  Particle::Particle() : Particle(PropagationContext()) {}
+
+  Particle::Particle(const PropagationContext& ctx)
+      : charge_(ctx.beamParticlesCharge()), pdgId_(0), physical_(true), stopped_(false) {
+    addPosition(0., StateVector(ctx));
+  }
 
   Particle::Particle(const StateVector& sv0, double s0) : charge_(0), pdgId_(0), physical_(true), stopped_(false) {
     addPosition(s0, sv0);
   }
 
   Particle::Particle(const LorentzVector& mom, int charge, int pdgid)
-      : charge_(charge == 999 ? Parameters::get().beamParticlesCharge() : charge),
+      : charge_(charge),
         pdgId_(pdgid),
         physical_(true),
         stopped_(false) {
@@ -39,7 +46,7 @@ namespace hector {
   Particle::~Particle() {}
 
   Particle Particle::fromMassCharge(double mass, int charge) {
-    Particle p(StateVector(Vector(6, 0), mass));
+    Particle p(StateVector(Vector(), mass));
     p.setCharge(charge);
     return p;
   }
@@ -54,14 +61,12 @@ namespace hector {
   }
 
   StateVector Particle::stateVectorAt(double s) const {
-    const auto& pos_s = positions_.find(s);
-    if (pos_s != positions_.end())
-      return pos_s->second;
-
-    const auto &lower_it = --positions_.upper_bound(s), upper_it = positions_.upper_bound(s);
-
-    if (lower_it == positions_.end() || upper_it->first < lower_it->first)
+    const auto upper_it = positions_.lower_bound(s);
+    if (upper_it != positions_.end() && upper_it->first == s)
+      return upper_it->second;
+    if (upper_it == positions_.begin() || upper_it == positions_.end())
       throw H_ERROR << "Impossible to interpolate the position at s = " << s << " m.";
+    const auto lower_it = std::prev(upper_it);
 
     //PrintInfo( Form( "Interpolating for s = %.2f between %.2f and %.2f", s, lower_it->first, upper_it->first ) );
 
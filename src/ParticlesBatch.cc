@@ -0,0 +1,77 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "Hector/Exception.h"
+#include "Hector/ParticlesBatch.h"
+
+namespace hector {
+  ParticlesBatch::ParticlesBatch(double s0) : s_(s0) {}
+
+  ParticlesBatch::ParticlesBatch(const Particles& parts)
+      : ParticlesBatch(parts.empty() ? 0. : parts.begin()->firstS()) {
+    reserve(parts.size());
+    for (const auto& part : parts) {
+      if (part.firstS() != s_)
+        H_WARNING << "Particle starting at s = " << part.firstS() << " m is propagated from the batch position"
+                  << " s = " << s_ << " m.";
+      add(part.firstStateVector(), part.charge());
+    }
+  }
+
+  void ParticlesBatch::reserve(size_t num_part) {
+    states_.reserve(6 * num_part);
+    masses_.reserve(num_part);
+    charges_.reserve(num_part);
+    stopping_elements_.reserve(num_part);
+    stopping_s_.reserve(num_part);
+  }
+
+  void ParticlesBatch::add(const StateVector& sv, int charge) {
+    states_.insert(states_.end(), sv.vector().data(), sv.vector().data() + 6);
+    masses_.emplace_back(sv.m());
+    charges_.emplace_back(charge);
+    stopping_elements_.emplace_back(nullptr);
+    stopping_s_.emplace_back(-1.);
+  }
+
+  size_t ParticlesBatch::numAlive() const {
+    return std::count(stopping_elements_.begin(), stopping_elements_.end(), nullptr);
+  }
+
+  void ParticlesBatch::stop(size_t i, const element::ElementPtr& elem, double s) {
+    stopping_elements_.at(i) = elem;
+    stopping_s_.at(i) = s;
+  }
+
+  void ParticlesBatch::resetStops() {
+    std::fill(stopping_elements_.begin(), stopping_elements_.end(), nullptr);
+    std::fill(stopping_s_.begin(), stopping_s_.end(), -1.);
+  }
+
+  StateVector ParticlesBatch::stateVector(size_t i) const {
+    return StateVector(Vector(states().col(i)), masses_.at(i));
+  }
+
+  Particle ParticlesBatch::particle(size_t i) const {
+    Particle part(stateVector(i), stopped(i) ? stopping_s_.at(i) : s_);
+    part.setCharge(charges_.at(i));
+    return part;
+  }
+}  // namespace hector
@@ -0,0 +1,140 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <random>
+
+#include "Hector/Exception.h"
+#include "Hector/PolynomialTransport.h"
+#include "Hector/Utils/Kinematics.h"
+
+namespace hector {
+  namespace {
+    /// Map a coordinate onto [-1, 1] given its range
+    double normalise(double val, double min, double max) {
+      return max > min ? (2. * val - min - max) / (max - min) : val - min;
+    }
+  }  // namespace
+
+  PolynomialTransport::PolynomialTransport(
+      const Propagator& prop, double s_station, const Domain& domain, unsigned short xi_order, size_t num_training)
+      : propagator_(prop),
+        s_station_(s_station),
+        domain_(domain),
+        xi_order_(xi_order),
+        error_bound_(Vector::Zero()),
+        num_fallbacks_(0) {
+    if (xi_order_ > max_xi_order)
+      throw H_ERROR << "Polynomials order " << xi_order_ << " exceeds the maximal order " << max_xi_order << ".";
+    const size_t num_coeff = num_terms * (xi_order_ + 1);
+    if (num_training < 2 * num_coeff)
+      throw H_ERROR << "At least " << 2 * num_coeff << " training particles are required for " << num_coeff
+                    << " coefficients.";
+
+    // apertures are not modelled ; the sweep only probes the transport through the elements
+    const Propagator exact(prop.beamline(), prop.context().withApertureAcceptance(false));
+    const auto& ctx = exact.context();
+    std::mt19937_64 gen(42);
+    std::uniform_real_distribution<double> flat(0., 1.);
+    auto sweep = [&](size_t num_part,
+                     Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>& inputs,
+                     Eigen::Matrix<double, Eigen::Dynamic, 4>& outputs) {
+      inputs.resize(num_part, num_coeff);
+      outputs.resize(num_part, 4);
+      for (size_t i = 0; i < num_part; ++i) {
+        const TwoVector pos(domain_.pos_min.x() + flat(gen) * (domain_.pos_max.x() - domain_.pos_min.x()),
+                            domain_.pos_min.y() + flat(gen) * (domain_.pos_max.y() - domain_.pos_min.y())),
+            ang(domain_.ang_min.x() + flat(gen) * (domain_.ang_max.x() - domain_.ang_min.x()),
+                domain_.ang_min.y() + flat(gen) * (domain_.ang_max.y() - domain_.ang_min.y()));
+        const double xi = domain_.xi_min + flat(gen) * (domain_.xi_max - domain_.xi_min);
+        const StateVector sv(pos, ang, xi_to_e(xi, ctx.beamEnergy()));
+        Particle part(StateVector(sv.vector(), ctx.beamParticlesMass()), 0.);
+        part.setCharge(ctx.beamParticlesCharge());
+        exact.propagate(part, s_station_);
+        const Vector out = part.stateVectorAt(s_station_).vector();
+        inputs.row(i) = basis(part.firstStateVector());
+        outputs.row(i) << out[StateVector::X], out[StateVector::TX], out[StateVector::Y], out[StateVector::TY];
+      }
+    };
+
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> inputs;
+    Eigen::Matrix<double, Eigen::Dynamic, 4> outputs;
+    sweep(num_training, inputs, outputs);
+    coefficients_ = inputs.colPivHouseholderQr().solve(outputs);
+
+    // validation on an independent sample
+    sweep(std::max<size_t>(num_training / 2, 100), inputs, outputs);
+    const Eigen::Matrix<double, 1, 4> max_dev = (inputs * coefficients_ - outputs).cwiseAbs().colwise().maxCoeff();
+    error_bound_[StateVector::X] = max_dev(0);
+    error_bound_[StateVector::TX] = max_dev(1);
+    error_bound_[StateVector::Y] = max_dev(2);
+    error_bound_[StateVector::TY] = max_dev(3);
+    H_INFO << "Transport to s = " << s_station_ << " m fitted with " << num_coeff << " coefficients per component.\n\t"
+           << "Maximal deviation on the validation sample: " << error_bound_.transpose() << ".";
+  }
+
+  bool PolynomialTransport::contains(const StateVector& sv, int charge) const {
+    const auto& ctx = propagator_.context();
+    // the transfer matrices (and thus the fitted coefficients) depend on the particle rigidity
+    if (sv.m() != ctx.beamParticlesMass() || (charge != 0 && charge != ctx.beamParticlesCharge()))
+      return false;
+    const auto pos = sv.position(), ang = sv.angles();
+    const double xi = e_to_xi(sv.energy(), ctx.beamEnergy());
+    return pos.x() >= domain_.pos_min.x() && pos.x() <= domain_.pos_max.x() && pos.y() >= domain_.pos_min.y() &&
+           pos.y() <= domain_.pos_max.y() && ang.x() >= domain_.ang_min.x() && ang.x() <= domain_.ang_max.x() &&
+           ang.y() >= domain_.ang_min.y() && ang.y() <= domain_.ang_max.y() && xi >= domain_.xi_min &&
+           xi <= domain_.xi_max;
+  }
+
+  PolynomialTransport::Basis PolynomialTransport::basis(const StateVector& sv) const {
+    const auto& vec = sv.vector();
+    const double terms[num_terms] = {1.,
+                                     normalise(vec[StateVector::X], domain_.pos_min.x(), domain_.pos_max.x()),
+                                     normalise(vec[StateVector::TX], domain_.ang_min.x(), domain_.ang_max.x()),
+                                     normalise(vec[StateVector::Y], domain_.pos_min.y(), domain_.pos_max.y()),
+                                     normalise(vec[StateVector::TY], domain_.ang_min.y(), domain_.ang_max.y())};
+    const double xi =
+        normalise(e_to_xi(sv.energy(), propagator_.context().beamEnergy()), domain_.xi_min, domain_.xi_max);
+    Basis out(num_terms * (xi_order_ + 1));
+    for (unsigned short j = 0; j < num_terms; ++j) {
+      double mon = terms[j];
+      for (unsigned short k = 0; k <= xi_order_; ++k, mon *= xi)
+        out[j * (xi_order_ + 1) + k] = mon;
+    }
+    return out;
+  }
+
+  StateVector PolynomialTransport::transport(const StateVector& sv) const {
+    const Eigen::Matrix<double, 1, 4> res = basis(sv) * coefficients_;
+    Vector out(sv.vector());
+    out[StateVector::X] = res(0);
+    out[StateVector::TX] = res(1);
+    out[StateVector::Y] = res(2);
+    out[StateVector::TY] = res(3);
+    return StateVector(out, sv.m());
+  }
+
+  void PolynomialTransport::propagate(Particle& part) const {
+    if (part.firstS() != 0. || !contains(part.firstStateVector(), part.charge())) {
+      ++num_fallbacks_;
+      propagator_.propagate(part, s_station_);
+      return;
+    }
+    part.clear();
+    part.addPosition(s_station_, transport(part.firstStateVector()));
+  }
+}  // namespace hector
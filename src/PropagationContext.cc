@@ -0,0 +1,82 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Hector/Parameters.h"
+#include "Hector/PropagationContext.h"
+
+namespace hector {
+  PropagationContext::PropagationContext() : PropagationContext(Parameters::get()) {}
+
+  PropagationContext::PropagationContext(const Parameters& params)
+      : beam_energy_(params.beamEnergy()),
+        beam_particles_mass_(params.beamParticlesMass()),
+        beam_particles_charge_(params.beamParticlesCharge()),
+        use_relative_energy_(params.useRelativeEnergy()),
+        compute_aperture_acceptance_(params.computeApertureAcceptance()),
+        enable_kickers_(params.enableKickers()),
+        enable_dipoles_(params.enableDipoles()) {}
+
+  bool PropagationContext::operator==(const PropagationContext& oth) const {
+    return beam_energy_ == oth.beam_energy_ && beam_particles_mass_ == oth.beam_particles_mass_ &&
+           beam_particles_charge_ == oth.beam_particles_charge_ && use_relative_energy_ == oth.use_relative_energy_ &&
+           compute_aperture_acceptance_ == oth.compute_aperture_acceptance_ &&
+           enable_kickers_ == oth.enable_kickers_ && enable_dipoles_ == oth.enable_dipoles_;
+  }
+
+  PropagationContext PropagationContext::withBeamEnergy(double energy) const {
+    PropagationContext ctx(*this);
+    ctx.beam_energy_ = energy;
+    return ctx;
+  }
+
+  PropagationContext PropagationContext::withBeamParticlesMass(double mass) const {
+    PropagationContext ctx(*this);
+    ctx.beam_particles_mass_ = mass;
+    return ctx;
+  }
+
+  PropagationContext PropagationContext::withBeamParticlesCharge(int charge) const {
+    PropagationContext ctx(*this);
+    ctx.beam_particles_charge_ = charge;
+    return ctx;
+  }
+
+  PropagationContext PropagationContext::withRelativeEnergy(bool rel) const {
+    PropagationContext ctx(*this);
+    ctx.use_relative_energy_ = rel;
+    return ctx;
+  }
+
+  PropagationContext PropagationContext::withApertureAcceptance(bool aper) const {
+    PropagationContext ctx(*this);
+    ctx.compute_aperture_acceptance_ = aper;
+    return ctx;
+  }
+
+  PropagationContext PropagationContext::withKickers(bool kck) const {
+    PropagationContext ctx(*this);
+    ctx.enable_kickers_ = kck;
+    return ctx;
+  }
+
+  PropagationContext PropagationContext::withDipoles(bool dip) const {
+    PropagationContext ctx(*this);
+    ctx.enable_dipoles_ = dip;
+    return ctx;
+  }
+}  // namespace hector
@@ -16,113 +16,208 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <atomic>
 #include <sstream>
+#include <tuple>
 
 #include "Hector/Beamline.h"
 #include "Hector/Elements/Element.h"
 #include "Hector/Exception.h"
 #include "Hector/Parameters.h"
 #include "Hector/ParticleStoppedException.h"
+#include "Hector/ParticlesBatch.h"
 #include "Hector/Propagator.h"
 
 namespace hector {
+  Propagator::Propagator(const Beamline* bl, const PropagationContext& ctx)
+      : beamline_(bl), context_(ctx), recording_(Recording::everyElement) {
+    apertures();
+  }
+
+  Propagator::Propagator(const Propagator& oth)
+      : beamline_(oth.beamline_),
+        context_(oth.context_),
+        apertures_(std::atomic_load(&oth.apertures_)),
+        compiled_(std::atomic_load(&oth.compiled_)),
+        recording_(oth.recording_),
+        stations_(oth.stations_) {}
+
+  std::shared_ptr<const aperture::ApertureTable> Propagator::apertures() const {
+    auto apertures = std::atomic_load(&apertures_);
+    const auto revision = beamline_->revision();
+    if (!apertures || apertures->revision != revision) {  // beamline modified since the last capture
+      std::vector<const aperture::Aperture*> apers;
+      for (const auto& elem : beamline_->elements())
+        apers.emplace_back(elem->aperture());
+      apertures = std::make_shared<const Apertures>(Apertures{revision, aperture::ApertureTable(apers)});
+      std::atomic_store(&apertures_, apertures);
+    }
+    return std::shared_ptr<const aperture::ApertureTable>(apertures, &apertures->table);
+  }
+
+  void Propagator::setStations(std::vector<double> stations) {
+    std::sort(stations.begin(), stations.end());
+    stations_ = stations;
+    recording_ = Recording::stations;
+  }
+
   void Propagator::propagate(Particle& part, double s_max) const {
+    const auto status = tryPropagate(part, s_max);
+    if (status.stopped())
+      throwStopped(status);
+  }
+
+  PropagationStatus Propagator::tryPropagate(Particle& part, double s_max) const {
+    PropagationStatus status;
     part.clear();
 
-    const double energy_loss = (Parameters::get().useRelativeEnergy())
-                                   ? Parameters::get().beamEnergy() - part.lastStateVector().energy()
-                                   : part.lastStateVector().energy();
+    const double energy_loss = context_.energyLoss(part.lastStateVector().energy());
 
     const double first_s = part.firstS();
 
-    if (beamline_->elements().size() < 2) {
-      H_WARNING << "Insufficiant number of beamline elements for propagation: " << beamline_->elements().size();
-      return;
+    const auto& elements = beamline_->elements();
+    if (elements.size() < 2) {
+      H_WARNING << "Insufficiant number of beamline elements for propagation: " << elements.size();
+      return status;
     }
-    try {
-      for (auto it = beamline_->begin() + 1; it != beamline_->end(); ++it) {
-        // extract the previous and the current element in the beamline
-        const auto prev_elem = *(it - 1), elem = *it;
-        if (elem->s() > s_max)
+    const auto apertures = this->apertures();
+    if (recording_ == Recording::everyElement)
+      part.positions().reserve(elements.size() + 1);
+    auto station = std::upper_bound(stations_.cbegin(), stations_.cend(), first_s);
+    Particle::Position pos(*part.begin());
+    for (size_t id = 1; id < elements.size() && status.survived(); ++id) {
+      // extract the previous and the current element in the beamline
+      const auto &prev_elem = elements[id - 1], &elem = elements[id];
+      if (elem->s() > s_max)
+        break;
+
+      // between two elements
+      if (first_s > prev_elem->s() && first_s < elem->s()) {
+        switch (prev_elem->type()) {
+          case element::aDrift:
+            H_INFO << "Path starts inside drift " << prev_elem->name() << ".";
+            break;
+          default:
+            H_INFO << "Path starts inside element " << prev_elem->name() << ".";
+            break;
+        }
+
+        // build a temporary element mimicking the drift effect
+        auto elem_tmp = prev_elem->clone();
+        elem_tmp->setS(first_s);
+        elem_tmp->setLength(elem->s() - first_s);
+        if (!traverse(part, pos, elem_tmp, id - 1, *apertures, energy_loss, station, status))
           break;
+      }
+      // before one element
+      if (first_s <= elem->s())
+        traverse(part, pos, elem, id, *apertures, energy_loss, station, status);
+    }
+    if (recording_ == Recording::finalState && pos.s() > first_s)
+      part.addPosition(pos);
+    part.setStopped(status.stopped());
+    return status;
+  }
+
+  bool Propagator::traverse(Particle& part,
+                            Particle::Position& pos,
+                            const element::ElementPtr& elem,
+                            size_t elem_id,
+                            const aperture::ApertureTable& apertures,
+                            double eloss,
+                            std::vector<double>::const_iterator& station,
+                            PropagationStatus& status) const {
+    const bool check_aper = context_.computeApertureAcceptance() && apertures.restricted(elem_id);
 
-        const Particle::Position in_pos(*part.rbegin());
+    const TwoVector pos_in(pos.stateVector().position());
+    if (check_aper && !apertures.contains(elem_id, pos_in)) {
+      status.element = elem_id;
+      status.at_entrance = true;
+      status.s = elem->s();
+      status.position = pos_in;
+      return false;
+    }
 
-        // initialise the outwards position
-        Particle::Position out_pos(-1., StateVector());
+    const auto out_pos = propagateThrough(pos, elem, eloss, part.charge());
 
-        // between two elements
-        if (first_s > prev_elem->s() && first_s < elem->s()) {
-          switch (prev_elem->type()) {
-            case element::aDrift:
-              H_INFO << "Path starts inside drift " << prev_elem->name() << ".";
-              break;
-            default:
-              H_INFO << "Path starts inside element " << prev_elem->name() << ".";
-              break;
+    switch (recording_) {
+      case Recording::everyElement:
+        part.addPosition(out_pos);
+        break;
+      case Recording::stations:
+        // interpolate the position for all stations reached in this element
+        for (; station != stations_.cend() && *station <= out_pos.s(); ++station) {
+          if (*station == out_pos.s()) {
+            part.addPosition(out_pos);
+            continue;
           }
-
-          // build a temporary element mimicking the drift effect
-          auto elem_tmp = prev_elem->clone();
-          elem_tmp->setS(first_s);
-          elem_tmp->setLength(elem->s() - first_s);
-          out_pos = propagateThrough(in_pos, elem_tmp, energy_loss, part.charge());
+          StateVector sv(pos.stateVector());
+          sv.setPosition(pos_in + (*station - pos.s()) / (out_pos.s() - pos.s()) *
+                                      (out_pos.stateVector().position() - pos_in));
+          part.addPosition(*station, sv);
         }
-        // before one element
-        if (first_s <= elem->s())
-          out_pos = propagateThrough(in_pos, elem, energy_loss, part.charge());
-
-        if (out_pos.s() < 0.)
-          continue;  // no new point to add to the particle's trajectory
-
-        part.addPosition(out_pos.s(), out_pos.stateVector());
-
-        if (!Parameters::get().computeApertureAcceptance())
-          continue;
-
-        const auto& aper = prev_elem->aperture();
-        if (!aper || aper->type() != aperture::anInvalidAperture)
-          continue;
-
-        const TwoVector pos_prev_elem(part.stateVectorAt(prev_elem->s()).position());
-        if (!aper->contains(pos_prev_elem))
-          throw ParticleStoppedException(__PRETTY_FUNCTION__, ExceptionType::warning, prev_elem)
-              << "Entering at " << pos_prev_elem << ", s = " << prev_elem->s() << " m\n\t"
-              << "Aperture centre at " << aper->position() << "\n\t"
-              << "Distance to aperture centre: " << hector::TwoVector(aper->position() - pos_prev_elem).norm() * 1.e2
-              << " cm.";
-        // has passed through the element?
-        //std::cout << prev_elem->s()+prev_elem->length() << "\t" << part.stateVectorAt( prev_elem->s()+prev_elem->length() ).position() << std::endl;
-        if (!aper->contains(part.stateVectorAt(prev_elem->s() + prev_elem->length()).position()))
-          throw ParticleStoppedException(__PRETTY_FUNCTION__, ExceptionType::warning, prev_elem)
-              << "Did not pass aperture " << aper->type() << ".";
-      }
-    } catch (const ParticleStoppedException&) {
-      throw;
-    } catch (const Exception&) {
-      throw;
+        break;
+      case Recording::finalState:
+        break;
+    }
+    pos = out_pos;
+
+    const TwoVector pos_out(pos.stateVector().position());
+    if (check_aper && !apertures.contains(elem_id, pos_out)) {
+      status.element = elem_id;
+      status.at_entrance = false;
+      status.s = pos.s();
+      status.position = pos_out;
+      return false;
     }
+    return true;
+  }
 
-    // finish by sorting all positions according to their s-coordinate
-    //part.sortPositions();
+  void Propagator::throwStopped(const PropagationStatus& status) const {
+    const auto& elem = beamline_->elements().at(status.element);
+    const auto& aper = elem->aperture();
+    if (status.at_entrance)
+      throw ParticleStoppedException(__PRETTY_FUNCTION__, ExceptionType::warning, elem)
+          << "Entering at " << status.position << ", s = " << status.s << " m\n\t"
+          << "Aperture centre at " << aper->position() << "\n\t"
+          << "Distance to aperture centre: " << hector::TwoVector(aper->position() - status.position).norm() * 1.e2
+          << " cm.";
+    throw ParticleStoppedException(__PRETTY_FUNCTION__, ExceptionType::warning, elem)
+        << "Did not pass aperture " << aper->type() << ".";
   }
 
   bool Propagator::stopped(Particle& part, double s_max) const {
-    for (auto it = beamline_->begin() + 1; it != beamline_->end(); ++it) {
-      // extract the previous and the current element in the beamline
-      const auto prev_elem = *(it - 1), elem = *it;
+    // single pass along the trajectory, as the elements boundaries are visited with increasing s
+    auto upper_it = part.begin();  // first trajectory point not before the last position visited
+    const auto position_at = [&part, &upper_it](double s) -> TwoVector {
+      if (upper_it != part.begin() && std::prev(upper_it)->first >= s)  // overlapping elements
+        upper_it = part.begin();
+      while (upper_it != part.end() && upper_it->first < s)
+        ++upper_it;
+      if (upper_it != part.end() && upper_it->first == s)
+        return upper_it->second.position();
+      if (upper_it == part.begin() || upper_it == part.end())
+        return part.stateVectorAt(s).position();  // raises the interpolation error
+      const auto lower_it = std::prev(upper_it);
+      const TwoVector &in = lower_it->second.position(), &out = upper_it->second.position();
+      return in + ((s - lower_it->first) / (upper_it->first - lower_it->first)) * (out - in);
+    };
+    const auto& elements = beamline_->elements();
+    const auto apertures = this->apertures();
+    for (size_t id = 1; id < elements.size(); ++id) {
+      // check the aperture of the previous element in the beamline
+      const auto &prev_elem = elements[id - 1], &elem = elements[id];
       if (s_max > 0 && elem->s() > s_max)
         return false;
-
-      const auto& aper = prev_elem->aperture();
-      if (aper && aper->type() != aperture::anInvalidAperture) {
-        // has passed the element entrance?
-        if (!aper->contains(part.stateVectorAt(prev_elem->s()).position()))
-          return true;
-        // has passed through the element?
-        if (!aper->contains(part.stateVectorAt(prev_elem->s() + prev_elem->length()).position()))
-          return true;
-      }
+      if (!apertures->restricted(id - 1))
+        continue;
+      // has passed the element entrance?
+      if (!apertures->contains(id - 1, position_at(prev_elem->s())))
+        return true;
+      // has passed through the element?
+      if (!apertures->contains(id - 1, position_at(prev_elem->s() + prev_elem->length())))
+        return true;
     }
     return false;
   }
@@ -134,20 +229,18 @@ namespace hector {
     try {
       //const StateVector shift( elem->relativePosition(), elem->angles(), 0., 0. );
       //const StateVector shift( elem->relativePosition(), TwoVector(), 0., 0. );
-      const StateVector shift(TwoVector(), TwoVector(), 0., 0.);
+      //const Vector prop = elem->cachedMatrix(...) * (ini_pos.stateVector().vector() - shift.vector()) + shift.vector();
       const Vector prop =
-          elem->matrix(eloss, ini_pos.stateVector().m(), qp) * (ini_pos.stateVector().vector() - shift.vector()) +
-          shift.vector();
-
-      if (Parameters::get().loggingThreshold() >= ExceptionType::debug)
-        H_DEBUG << "Propagating particle of mass " << ini_pos.stateVector().m() << " GeV"
-                << " and state vector at s = " << ini_pos.s() << " m:" << ini_pos.stateVector().vector().transpose()
-                << "\t"
-                << "through " << elem->type() << " element \"" << elem->name() << "\" "
-                << "at s = " << elem->s() << " m, "
-                << "of length " << elem->length() << " m,\n\t"
-                << "and with transfer matrix:" << elem->matrix(eloss, ini_pos.stateVector().m(), qp) << "\t"
-                << "Resulting state vector:" << prop.transpose();
+          elem->cachedMatrix(eloss, ini_pos.stateVector().m(), qp, context_) * ini_pos.stateVector().vector();
+
+      H_DEBUG << "Propagating particle of mass " << ini_pos.stateVector().m() << " GeV"
+              << " and state vector at s = " << ini_pos.s() << " m:" << ini_pos.stateVector().vector().transpose()
+              << "\t"
+              << "through " << elem->type() << " element \"" << elem->name() << "\" "
+              << "at s = " << elem->s() << " m, "
+              << "of length " << elem->length() << " m,\n\t"
+              << "and with transfer matrix:" << elem->matrix(eloss, ini_pos.stateVector().m(), qp, context_) << "\t"
+              << "Resulting state vector:" << prop.transpose();
 
       // perform the propagation (assuming that mass is conserved...)
       StateVector vec(prop, ini_pos.stateVector().m());
@@ -166,4 +259,173 @@ namespace hector {
     for (auto& part : beam)
       propagate(part, s_max);
   }
+
+  void Propagator::propagate(ParticlesBatch& batch, double s_max) const {
+    auto compiled = std::atomic_load(&compiled_);
+    if (!compiled || compiled->s_min != batch.s() || compiled->s_max != s_max ||
+        compiled->beamline.revision() != beamline_->revision()) {
+      compiled = std::make_shared<const Compiled>(beamline_, context_, batch.s(), s_max);
+      std::atomic_store(&compiled_, compiled);
+    }
+    propagate(batch, compiled->beamline);
+  }
+
+  CompiledBeamline Propagator::compile(const std::vector<double>& stations, double s_min, double s_max) const {
+    return CompiledBeamline(beamline_, context_, stations, s_min, s_max);
+  }
+
+  void Propagator::checkCompiled(const CompiledBeamline& cbl) const {
+    if (cbl.beamline() != beamline_)
+      throw H_ERROR << "Compiled beamline does not correspond to the propagator beamline.";
+    if (cbl.context() != context_)
+      throw H_ERROR << "Beamline was compiled for another propagation context.";
+    if (cbl.revision() != beamline_->revision())
+      throw H_ERROR << "Beamline was modified after its compilation.";
+  }
+
+  void Propagator::propagate(Particle& part, const CompiledBeamline& cbl) const {
+    const auto status = tryPropagate(part, cbl);
+    if (status.stopped())
+      throwStopped(status);
+  }
+
+  PropagationStatus Propagator::tryPropagate(Particle& part, const CompiledBeamline& cbl) const {
+    checkCompiled(cbl);
+    PropagationStatus status;
+    part.clear();
+    if (part.firstS() != cbl.sMin())
+      throw H_ERROR << "Particle starting at s = " << part.firstS() << " m cannot be propagated through a beamline"
+                    << " compiled from s = " << cbl.sMin() << " m.";
+
+    const double mass = part.mass();
+    const auto mats = cbl.matrices(context_.energyLoss(part.lastStateVector().energy()), mass, part.charge());
+    const auto& apertures = cbl.apertures();
+    Vector vec = part.lastStateVector().vector();
+    for (size_t i = 0; i < cbl.segments().size(); ++i) {
+      const auto& seg = cbl.segments().at(i);
+      const bool check_aper = seg.aperture_element != nullptr;
+      if (check_aper) {
+        const TwoVector pos_in(vec[StateVector::X], vec[StateVector::Y]);
+        if (!apertures.contains(seg.first, pos_in)) {
+          status.element = seg.aperture_id;
+          status.at_entrance = true;
+          status.s = seg.s_begin;
+          status.position = pos_in;
+          break;
+        }
+      }
+      vec = mats->at(i) * vec;
+      part.addPosition(seg.s_end, StateVector(vec, mass));
+      const TwoVector pos_out(vec[StateVector::X], vec[StateVector::Y]);
+      if (check_aper && !apertures.contains(seg.first, pos_out)) {
+        status.element = seg.aperture_id;
+        status.at_entrance = false;
+        status.s = seg.s_end;
+        status.position = pos_out;
+        break;
+      }
+    }
+    part.setStopped(status.stopped());
+    return status;
+  }
+
+  void Propagator::propagate(ParticlesBatch& batch, const CompiledBeamline& cbl) const {
+    checkCompiled(cbl);
+    batch.resetStops();
+    if (batch.s() != cbl.sMin())
+      throw H_ERROR << "Batch at s = " << batch.s() << " m cannot be propagated through a beamline"
+                    << " compiled from s = " << cbl.sMin() << " m.";
+    auto states = batch.states();
+
+    // sort the particles by kinematics, for the ones sharing the same transfer matrices to be contiguous
+    std::vector<double> elosses(batch.size());
+    std::vector<size_t> order(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+      elosses[i] = context_.energyLoss(states(StateVector::E, i));
+      order[i] = i;
+    }
+    const auto kinematics = [&](size_t i) { return std::make_tuple(elosses[i], batch.mass(i), batch.charge(i)); };
+    const auto kinematics_sorter = [&](size_t lhs, size_t rhs) { return kinematics(lhs) < kinematics(rhs); };
+    if (!std::is_sorted(order.begin(), order.end(), kinematics_sorter))  // e.g. momentum loss-smeared particles
+      std::sort(order.begin(), order.end(), kinematics_sorter);
+    // split the batch into groups of particles sharing the same kinematics
+    std::vector<std::pair<size_t, size_t> > groups;  // range of each group in the sorted list
+    size_t max_group_size = 0;
+    for (size_t begin = 0; begin < order.size();) {
+      size_t end = begin + 1;
+      while (end < order.size() && kinematics(order[end]) == kinematics(order[begin]))
+        ++end;
+      groups.emplace_back(begin, end);
+      max_group_size = std::max(max_group_size, end - begin);
+      begin = end;
+    }
+
+    const auto& segments = cbl.segments();
+    const auto& elements = cbl.elements();
+    const auto& apertures = cbl.apertures();
+    double last_s = batch.s();
+    std::vector<size_t> ids;  // batch index of each column in the block
+    // the states are transported from the block to the scratch one, then both blocks are swapped
+    ParticlesBatch::StatesBlock block(6, max_group_size), scratch(6, max_group_size);
+    const auto transport = [&block, &scratch](const Matrix& mat, size_t num) {
+      scratch.leftCols(num).noalias() = mat * block.leftCols(num);
+      block.swap(scratch);
+    };
+    // contiguous transverse coordinates of the alive particles, and their acceptance in an aperture
+    Eigen::ArrayXd xs(max_group_size), ys(max_group_size), accepted(max_group_size);
+    for (const auto& group : groups) {
+      ids.assign(order.begin() + group.first, order.begin() + group.second);
+      const double eloss = elosses[ids[0]], mass = batch.mass(ids[0]);
+      const int charge = batch.charge(ids[0]);
+      // fusing the matrices of a segment costs one 6x6 matrix product per element, i.e. as much as applying the
+      // element matrices to 6 particles ; smaller groups are transported through the (cached) element matrices,
+      // unless the fused matrices are already available for their kinematics
+      auto mats = cbl.findMatrices(eloss, mass, charge);
+      if (!mats && ids.size() >= 6)
+        mats = cbl.matrices(eloss, mass, charge);
+      for (size_t j = 0; j < ids.size(); ++j)
+        block.col(j) = states.col(ids[j]);
+
+      size_t num_alive = ids.size();  // alive particles are kept in the first columns of the block
+      // flag the particles not contained in an element aperture, and move them out of the alive block
+      const auto drop_stopped = [&](size_t aper_id, const element::ElementPtr& elem, double s_stop) {
+        if (num_alive == 0)
+          return;
+        xs.head(num_alive) = block.row(StateVector::X).head(num_alive).transpose();
+        ys.head(num_alive) = block.row(StateVector::Y).head(num_alive).transpose();
+        apertures.contains(aper_id, xs.data(), ys.data(), num_alive, accepted.data());
+        if (accepted.head(num_alive).minCoeff() > 0.)
+          return;
+        for (size_t j = 0; j < num_alive;) {
+          if (accepted[j] > 0.) {
+            ++j;
+            continue;
+          }
+          states.col(ids[j]) = block.col(j);
+          batch.stop(ids[j], elem, s_stop);
+          --num_alive;
+          block.col(j) = block.col(num_alive);
+          accepted[j] = accepted[num_alive];
+          ids[j] = ids[num_alive];
+        }
+      };
+      for (size_t i = 0; i < segments.size() && num_alive > 0; ++i) {
+        const auto& seg = segments.at(i);
+        const auto& elem = seg.aperture_element;
+        if (elem)
+          drop_stopped(seg.first, elem, seg.s_begin);
+        if (mats)
+          transport(mats->at(i), num_alive);
+        else
+          for (size_t j = seg.first; j < seg.last; ++j)
+            transport(elements.at(j)->cachedMatrix(eloss, mass, charge, context_), num_alive);
+        last_s = std::max(last_s, seg.s_end);
+        if (elem)
+          drop_stopped(seg.first, elem, seg.s_end);
+      }
+      for (size_t j = 0; j < num_alive; ++j)
+        states.col(ids[j]) = block.col(j);
+    }
+    batch.setS(last_s);
+  }
 }  // namespace hector
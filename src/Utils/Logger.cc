@@ -0,0 +1,110 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <iostream>
+
+#include "Hector/Utils/Logger.h"
+
+namespace hector {
+  Logger::Logger()
+      : slots_(new Slot[queue_size]),
+        enqueue_pos_(0),
+        dequeue_pos_(0),
+        num_written_(0),
+        os_(&std::cerr),
+        async_(false) {
+    for (size_t i = 0; i < queue_size; ++i)
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  Logger::~Logger() { setAsynchronous(false); }
+
+  Logger& Logger::get() {
+    static Logger logger;
+    return logger;
+  }
+
+  void Logger::setOutput(std::ostream& os) {
+    flush();
+    os_ = &os;
+  }
+
+  void Logger::setAsynchronous(bool async) {
+    if (async == async_)
+      return;
+    async_ = async;
+    if (async)
+      writer_ = std::thread(&Logger::run, this);
+    else if (writer_.joinable())
+      writer_.join();  // the writer thread empties the queue before returning
+  }
+
+  void Logger::write(std::string message) {
+    if (!async_) {
+      *os_ << message << std::flush;
+      return;
+    }
+    // bounded multi-producer queue: claim the next free slot, fill it, then publish it to the writer
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      auto& slot = slots_[pos % queue_size];
+      const size_t seq = slot.sequence.load(std::memory_order_acquire);
+      if (seq == pos) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          slot.message = std::move(message);
+          slot.sequence.store(pos + 1, std::memory_order_release);
+          return;
+        }
+      } else if (seq < pos) {  // queue is full, wait for the writer
+        std::this_thread::yield();
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      } else
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+
+  void Logger::flush() {
+    if (async_) {
+      const size_t num_queued = enqueue_pos_.load(std::memory_order_acquire);
+      while (num_written_.load(std::memory_order_acquire) < num_queued)
+        std::this_thread::yield();
+    }
+    os_->flush();
+  }
+
+  void Logger::run() {
+    // single consumer: only this thread moves the dequeue position
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      auto& slot = slots_[pos % queue_size];
+      if (slot.sequence.load(std::memory_order_acquire) == pos + 1) {
+        *os_ << slot.message;
+        slot.message.clear();
+        slot.sequence.store(pos + queue_size, std::memory_order_release);
+        dequeue_pos_.store(++pos, std::memory_order_relaxed);
+        num_written_.store(pos, std::memory_order_release);
+        continue;
+      }
+      os_->flush();
+      if (!async_ && pos == enqueue_pos_.load(std::memory_order_acquire))
+        return;
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+}  // namespace hector
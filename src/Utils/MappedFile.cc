@@ -0,0 +1,89 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+#include "Hector/Utils/MappedFile.h"
+
+namespace hector {
+  MappedFile::MappedFile(const std::string& filename) {
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+      return;
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+      size_ = st.st_size;
+      open_ = true;
+      if (size_ > 0) {
+        int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+        flags |= MAP_POPULATE;  // map all pages at once rather than faulting on each one while reading
+#endif
+        void* addr = ::mmap(nullptr, size_, PROT_READ, flags, fd, 0);
+        if (addr != MAP_FAILED) {
+          ::madvise(addr, size_, MADV_SEQUENTIAL);
+          data_ = static_cast<const char*>(addr);
+          mapped_ = true;
+        }
+      }
+    }
+    ::close(fd);
+    if (mapped_ || (open_ && size_ == 0))
+      return;
+    // fallback to a plain reading of the file
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open())
+      return;
+    buffer_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+    open_ = true;
+  }
+
+  MappedFile::MappedFile(MappedFile&& rhs) noexcept { *this = std::move(rhs); }
+
+  MappedFile& MappedFile::operator=(MappedFile&& rhs) noexcept {
+    if (this == &rhs)
+      return *this;
+    close();
+    mapped_ = std::exchange(rhs.mapped_, false);
+    open_ = std::exchange(rhs.open_, false);
+    size_ = std::exchange(rhs.size_, 0);
+    buffer_ = std::move(rhs.buffer_);
+    data_ = mapped_ ? rhs.data_ : buffer_.data();
+    rhs.data_ = nullptr;
+    rhs.buffer_.clear();
+    return *this;
+  }
+
+  void MappedFile::close() {
+    if (mapped_)
+      ::munmap(const_cast<char*>(data_), size_);
+    buffer_.clear();
+    mapped_ = open_ = false;
+    data_ = nullptr;
+    size_ = 0;
+  }
+}  // namespace hector
@@ -23,21 +23,23 @@
 #include "Hector/Utils/String.h"
 
 namespace hector {
-  StateVector::StateVector() : Vector(6, 0), m_(0.) {
-    (*this)[K] = 1.;
-    (*this)[E] = Parameters::get().beamEnergy();
+  StateVector::StateVector() : m_(0.) { (*this)[K] = 1.; }
+
+  StateVector::StateVector(const PropagationContext& ctx) : StateVector() {
+    (*this)[E] = ctx.beamEnergy();
+    m_ = ctx.beamParticlesMass();
   }
 
   StateVector::StateVector(const Vector& vec, double mass) : Vector(vec), m_(mass) {}
 
-  StateVector::StateVector(const LorentzVector& mom, const TwoVector& pos) : Vector(6, 1), m_(mom.m()) {
+  StateVector::StateVector(const LorentzVector& mom, const TwoVector& pos) : m_(mom.m()) {
     setPosition(pos);
     setMomentum(mom);
     (*this)[K] = 1.;
   }
 
   StateVector::StateVector(const TwoVector& pos, const TwoVector& ang, double energy, double kick)
-      : Vector(6, 1), m_(0.) {
+      : m_(0.) {
     setPosition(pos);
     setAngles(ang);
     if (energy < 0.)
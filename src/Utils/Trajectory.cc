@@ -0,0 +1,61 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "Hector/Utils/Trajectory.h"
+
+namespace hector {
+  namespace {
+    bool lower_s(const Trajectory::value_type& rec, double s) { return rec.first < s; }
+    bool upper_s(double s, const Trajectory::value_type& rec) { return s < rec.first; }
+  }  // namespace
+
+  std::pair<Trajectory::iterator, bool> Trajectory::insert(const value_type& rec) {
+    if (empty() || rbegin()->first < rec.first) {  // most frequent case: trajectory built along s
+      vector::emplace_back(rec);
+      return std::make_pair(end() - 1, true);
+    }
+    auto it = lower_bound(rec.first);
+    if (it != end() && it->first == rec.first)
+      return std::make_pair(it, false);
+    return std::make_pair(vector::insert(it, rec), true);
+  }
+
+  Trajectory::iterator Trajectory::find(double s) {
+    auto it = lower_bound(s);
+    return it != end() && it->first == s ? it : end();
+  }
+
+  Trajectory::const_iterator Trajectory::find(double s) const {
+    auto it = lower_bound(s);
+    return it != end() && it->first == s ? it : end();
+  }
+
+  Trajectory::iterator Trajectory::lower_bound(double s) { return std::lower_bound(begin(), end(), s, lower_s); }
+
+  Trajectory::const_iterator Trajectory::lower_bound(double s) const {
+    return std::lower_bound(begin(), end(), s, lower_s);
+  }
+
+  Trajectory::iterator Trajectory::upper_bound(double s) { return std::upper_bound(begin(), end(), s, upper_s); }
+
+  Trajectory::const_iterator Trajectory::upper_bound(double s) const {
+    return std::upper_bound(begin(), end(), s, upper_s);
+  }
+}  // namespace hector
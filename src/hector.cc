@@ -21,7 +21,6 @@
 #include "Hector/Beamline.h"
 #include "Hector/Exception.h"
 #include "Hector/IO/TwissHandler.h"
-#include "Hector/ParticleStoppedException.h"
 #include "Hector/Propagator.h"
 #include "Hector/Utils/ArgsParser.h"
 #include "Hector/Utils/BeamProducer.h"
@@ -46,6 +45,7 @@ int main(int argc, char* argv[]) {
                      });
 
   hector::io::Twiss parser(twiss_file.c_str(), ip.c_str(), max_s, min_s);
+  parser.applyHeaderParameters();
   parser.printInfo();
   H_INFO.log([&](auto& log) {
     log << "\n"
@@ -85,10 +85,9 @@ int main(int argc, char* argv[]) {
       hector::Particle p = gun.shoot();
       p.setCharge(+1);
       try {
-        prop.propagate(p, 203.826);
-      } catch (const hector::ParticleStoppedException& e) {
-        stopping_elements[e.stoppingElement()->name()]++;
-        continue;
+        const auto status = prop.tryPropagate(p, 203.826);
+        if (status.stopped())
+          stopping_elements[parser.beamline()->elements().at(status.element)->name()]++;
       } catch (const hector::Exception& e) {
         e.dump(std::cerr);
       }
@@ -0,0 +1,91 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef Hector_test_TestUtils_h
+#define Hector_test_TestUtils_h
+
+#include <functional>
+#include <memory>
+#include <random>
+
+#include "Hector/Apertures/Rectangular.h"
+#include "Hector/Beamline.h"
+#include "Hector/Elements/Drift.h"
+#include "Hector/Elements/Quadrupole.h"
+#include "Hector/Parameters.h"
+#include "Hector/Particle.h"
+
+namespace hector {
+  /// Fixtures common to several tests
+  namespace test {
+    /// Build a line of cells made of a 5 m drift and a 3 m quadrupole, of alternating polarities
+    /// \param[in] num_cells Number of drift-quadrupole cells
+    /// \param[in] aperture Half-size of the quadrupoles square apertures (m, none if negative)
+    /// \param[in] aperture_period Only the last quadrupole of each group of this many cells holds an aperture
+    /// \param[in] last_drift Close the line with a 5 m drift after the last quadrupole
+    inline std::unique_ptr<Beamline> fodoBeamline(unsigned short num_cells,
+                                                  double aperture = 2.e-3,
+                                                  unsigned short aperture_period = 1,
+                                                  bool last_drift = true) {
+      std::unique_ptr<Beamline> bl(new Beamline(num_cells * 10.));
+      double s = 0.;
+      for (unsigned short i = 0; i < num_cells; ++i) {
+        bl->add(std::make_shared<element::Drift>("drift" + std::to_string(i), s, 5.));
+        s += 5.;
+        element::ElementPtr quad;
+        if (i % 2 == 0)
+          quad = std::make_shared<element::HorizontalQuadrupole>("quad" + std::to_string(i), s, 3., -2.e-2);
+        else
+          quad = std::make_shared<element::VerticalQuadrupole>("quad" + std::to_string(i), s, 3., +2.e-2);
+        if (aperture > 0. && i % aperture_period == aperture_period - 1u)
+          quad->setAperture(std::make_shared<aperture::Rectangular>(aperture, aperture));
+        bl->add(quad);
+        s += 3.;
+      }
+      if (last_drift)
+        bl->add(std::make_shared<element::Drift>("last_drift", s, 5.));
+      return bl;
+    }
+
+    /// Generate beam particles at s = 0, with Gaussian-distributed positions and angles
+    /// \param[in] num_part Number of particles
+    /// \param[in] xi Momentum loss of a particle given its index (none if not set)
+    /// \param[in] sigma_pos Width of the horizontal and vertical positions distributions (m)
+    /// \param[in] sigma_ang Width of the horizontal and vertical angles distributions (rad)
+    inline Particles gaussianParticles(size_t num_part,
+                                       const std::function<double(size_t)>& xi = nullptr,
+                                       double sigma_pos = 5.e-4,
+                                       double sigma_ang = 5.e-5) {
+      std::default_random_engine gen(42);
+      std::normal_distribution<double> pos(0., sigma_pos), ang(0., sigma_ang);
+      Particles parts;
+      parts.reserve(num_part);
+      for (size_t i = 0; i < num_part; ++i) {
+        StateVector sv(TwoVector(pos(gen), pos(gen)), TwoVector(ang(gen), ang(gen)));
+        if (xi)
+          sv.setXi(xi(i));
+        Particle part(StateVector(sv.vector(), Parameters::get().beamParticlesMass()));
+        part.setCharge(+1);
+        parts.emplace_back(part);
+      }
+      return parts;
+    }
+  }  // namespace test
+}  // namespace hector
+
+#endif
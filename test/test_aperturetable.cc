@@ -0,0 +1,86 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <random>
+
+#include "Hector/Apertures/ApertureTable.h"
+#include "Hector/Apertures/Circular.h"
+#include "Hector/Apertures/RectElliptic.h"
+#include "Hector/Apertures/Rectangular.h"
+
+using namespace std;
+
+namespace {
+  /// Aperture implementation not known to the table
+  class Diamond : public hector::aperture::Aperture {
+  public:
+    explicit Diamond(double size)
+        : hector::aperture::Aperture(hector::aperture::anOctagonalAperture, hector::TwoVector(0., 0.), {size}) {}
+    hector::aperture::AperturePtr clone() const override { return hector::aperture::AperturePtr(new Diamond(*this)); }
+    bool contains(const hector::TwoVector& pos) const override { return fabs(pos.x()) + fabs(pos.y()) < p(0); }
+    hector::TwoVector limits() const override { return hector::TwoVector(p(0), p(0)); }
+  };
+}  // namespace
+
+/// \test Compare the flattened apertures acceptance to the one of each aperture object
+int main() {
+  const hector::TwoVector offset(2.e-4, -1.e-4);
+  const hector::aperture::Rectangular rect(2.e-3, 1.e-3, offset);
+  const hector::aperture::Elliptic ell(2.e-3, 1.e-3, offset);
+  const hector::aperture::Circular circ(1.5e-3, offset);
+  const hector::aperture::RectElliptic rect_ell(1.5e-3, 1.e-3, 2.e-3, 1.2e-3, offset);
+  const Diamond diamond(2.e-3);
+  const vector<const hector::aperture::Aperture*> apertures{&rect, nullptr, &ell, &circ, &rect_ell, &diamond};
+  const hector::aperture::ApertureTable table(apertures);
+
+  if (table.size() != apertures.size() || table.restricted(1) ||
+      table.shape(0) != hector::aperture::ApertureTable::Shape::flat ||
+      table.shape(5) != hector::aperture::ApertureTable::Shape::generic) {
+    cerr << "Invalid apertures table content." << endl;
+    return 1;
+  }
+
+  const size_t num_pos = 10000;
+  std::default_random_engine gen(42);
+  std::uniform_real_distribution<double> flat(-2.5e-3, 2.5e-3);
+  vector<double> xs(num_pos), ys(num_pos), accepted(num_pos);
+  for (size_t j = 0; j < num_pos; ++j)
+    xs[j] = flat(gen), ys[j] = flat(gen);
+
+  for (size_t i = 0; i < apertures.size(); ++i) {
+    table.contains(i, xs.data(), ys.data(), num_pos, accepted.data());
+    size_t num_accepted = 0;
+    for (size_t j = 0; j < num_pos; ++j) {
+      const hector::TwoVector pos(xs[j], ys[j]);
+      const bool in = apertures[i] ? apertures[i]->contains(pos) : true;
+      if (table.contains(i, pos) != in || (accepted[j] > 0.) != in) {
+        cerr << "Acceptance differs for aperture " << i << " at position " << pos << "." << endl;
+        return 1;
+      }
+      num_accepted += in;
+    }
+    if (apertures[i] && (num_accepted == 0 || num_accepted == num_pos)) {
+      cerr << "Aperture " << i << " is not tested: " << num_accepted << " position(s) accepted." << endl;
+      return 1;
+    }
+  }
+
+  cout << "Passed" << endl;
+  return 0;
+}
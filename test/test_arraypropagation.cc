@@ -0,0 +1,115 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <iostream>
+#include <random>
+
+#include "Hector/Apertures/Circular.h"
+#include "Hector/Beamline.h"
+#include "Hector/Elements/Drift.h"
+#include "Hector/Elements/Quadrupole.h"
+#include "Hector/ParallelPropagator.h"
+#include "Hector/Parameters.h"
+
+using namespace std;
+
+/// \test Propagate particles given as plain arrays to a list of stations, and compare their states to the ones
+/// obtained with the individual propagation of each particle
+int main() {
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+
+  hector::Beamline bl(60.);
+  for (unsigned short i = 0; i < 6; ++i) {
+    bl.add(std::make_shared<hector::element::Drift>("drift" + to_string(i), i * 10., 7.));
+    auto quad =
+        std::make_shared<hector::element::HorizontalQuadrupole>("quad" + to_string(i), i * 10. + 7., 3., -2.e-2);
+    quad->setAperture(std::make_shared<hector::aperture::Circular>(1.5e-3));
+    bl.add(quad);
+  }
+  const vector<double> stations = {55., 8.5, 20., 0.};  // unsorted, one inside an element, one never reached
+
+  const size_t num_part = 500;
+  std::default_random_engine gen(42);
+  std::normal_distribution<double> pos(0., 5.e-4), ang(0., 5.e-5);
+  const double mass = hector::Parameters::get().beamParticlesMass();
+  vector<double> states, masses(num_part, mass);
+  vector<int> charges(num_part, +1);
+  for (size_t i = 0; i < num_part; ++i) {
+    const hector::StateVector sv(
+        hector::StateVector(hector::TwoVector(pos(gen), pos(gen)), hector::TwoVector(ang(gen), ang(gen))).vector(),
+        mass);
+    states.insert(states.end(), sv.vector().data(), sv.vector().data() + 6);
+  }
+
+  // reference: individual propagation of each particle
+  hector::Propagator serial(&bl);
+  serial.setStations(stations);
+  vector<hector::Particle> parts;
+  vector<int> serial_losses;
+  for (size_t i = 0; i < num_part; ++i) {
+    parts.emplace_back(hector::StateVector(hector::Vector(Eigen::Map<const hector::Vector6d>(&states[6 * i])), mass));
+    parts.back().setCharge(+1);
+    serial_losses.emplace_back(serial.tryPropagate(parts.back(), 55.).element);
+    if (serial_losses.back() < 0 && parts.back().positions().find(55.) == parts.back().positions().end()) {
+      cerr << "Surviving particle " << i << " was not recorded at the last station." << endl;
+      return 1;
+    }
+  }
+
+  for (unsigned short num_threads : {1, 3}) {
+    const hector::ParallelPropagator prop(&bl, num_threads, 16);
+    for (bool defaults : {false, true}) {
+      vector<double> out(num_part * stations.size() * 6);
+      vector<int> losses(num_part);
+      const size_t num_stopped = prop.propagate(num_part,
+                                                states.data(),
+                                                defaults ? nullptr : masses.data(),
+                                                defaults ? nullptr : charges.data(),
+                                                stations,
+                                                out.data(),
+                                                losses.data());
+      if (num_stopped == 0 || num_stopped == num_part) {
+        cerr << "Invalid number of stopped particles: " << num_stopped << "." << endl;
+        return 1;
+      }
+      for (size_t i = 0; i < num_part; ++i) {
+        if (losses.at(i) != serial_losses.at(i)) {
+          cerr << "Particle " << i << " is stopped at element " << losses.at(i) << " instead of "
+               << serial_losses.at(i) << "." << endl;
+          return 1;
+        }
+        const auto& traj = parts.at(i).positions();
+        for (size_t j = 0; j < stations.size(); ++j) {
+          const double* sv = &out[6 * (i * stations.size() + j)];
+          const auto it = traj.find(stations.at(j));
+          const bool reached = it != traj.end();
+          if (reached != !std::isnan(sv[0]) ||
+              (reached && it->second.vector() != Eigen::Map<const hector::Vector6d>(sv))) {
+            cerr << "State of particle " << i << " at s = " << stations.at(j) << " m differs from the individual"
+                 << " propagation (" << num_threads << " threads)." << endl;
+            return 1;
+          }
+        }
+      }
+    }
+  }
+
+  cout << "Passed" << endl;
+  return 0;
+}
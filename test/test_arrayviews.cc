@@ -0,0 +1,83 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <iostream>
+
+#include "Hector/Apertures/Circular.h"
+#include "Hector/Apertures/RectElliptic.h"
+#include "Hector/Beamline.h"
+#include "Hector/BeamlineTable.h"
+#include "Hector/Elements/Drift.h"
+#include "Hector/Elements/Quadrupole.h"
+#include "Hector/Parameters.h"
+
+using namespace std;
+
+/// \test Check the columnar views of a beamline elements properties
+int main() {
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+
+  hector::Beamline bl(60.);
+  for (unsigned short i = 0; i < 6; ++i) {
+    bl.add(std::make_shared<hector::element::Drift>("drift" + to_string(i), i * 10., 7.));
+    auto quad =
+        std::make_shared<hector::element::HorizontalQuadrupole>("quad" + to_string(i), i * 10. + 7., 3., -2.e-2 * i);
+    if (i % 2 == 0)
+      quad->setAperture(std::make_shared<hector::aperture::Circular>(1.5e-3, hector::TwoVector(1.e-4 * i, 0.)));
+    else
+      quad->setAperture(std::make_shared<hector::aperture::RectElliptic>(2.e-2, 1.5e-2, 2.2e-2, 1.8e-2));
+    quad->setBeta(hector::TwoVector(100. + i, 50. - i));
+    quad->setDispersion(hector::TwoVector(1.e-2 * i, -1.e-3 * i));
+    bl.add(quad);
+  }
+
+  //--- beamline table
+
+  const hector::BeamlineTable table(bl);
+  if (table.size() != bl.elements().size()) {
+    cerr << "Invalid number of elements in the table: " << table.size() << "." << endl;
+    return 1;
+  }
+  typedef hector::BeamlineTable T;
+  for (size_t i = 0; i < table.size(); ++i) {
+    const auto& elem = bl.elements().at(i);
+    const auto& aper = elem->aperture();
+    bool valid = table.names().at(i) == elem->name() && table.types().at(i) == elem->type() &&
+                 table.column(T::s)[i] == elem->s() && table.column(T::length)[i] == elem->length() &&
+                 table.column(T::magneticStrength)[i] == elem->magneticStrength() &&
+                 table.column(T::betaX)[i] == elem->beta().x() && table.column(T::betaY)[i] == elem->beta().y() &&
+                 table.column(T::dispersionX)[i] == elem->dispersion().x() &&
+                 table.column(T::dispersionY)[i] == elem->dispersion().y() &&
+                 table.apertureTypes().at(i) == (aper ? aper->type() : hector::aperture::anInvalidAperture);
+    if (aper) {
+      valid &= table.column(T::apertureX)[i] == aper->x() && table.column(T::apertureY)[i] == aper->y();
+      for (size_t j = 0; j < 4; ++j)
+        valid &= j < aper->parameters().size() ? table.column((T::Column)(T::apertureP1 + j))[i] == aper->p(j)
+                                               : std::isnan(table.column((T::Column)(T::apertureP1 + j))[i]);
+    } else
+      valid &= std::isnan(table.column(T::apertureP1)[i]) && std::isnan(table.column(T::apertureX)[i]);
+    if (!valid) {
+      cerr << "Properties of element " << elem->name() << " differ in the table." << endl;
+      return 1;
+    }
+  }
+
+  cout << "Passed" << endl;
+  return 0;
+}
@@ -0,0 +1,91 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <random>
+
+#include "Hector/Parameters.h"
+#include "Hector/ParticleStoppedException.h"
+#include "Hector/ParticlesBatch.h"
+#include "Hector/Propagator.h"
+#include "TestUtils.h"
+
+using namespace std;
+
+/// \test Compare the batch propagation of particles to their individual propagation
+int main() {
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+
+  const auto bl = hector::test::fodoBeamline(10);
+  const double s_max = 85.;
+
+  std::default_random_engine gen(1);
+  std::normal_distribution<double> xi(0., 0.01);
+  auto parts = hector::test::gaussianParticles(1000, [&gen, &xi](size_t i) {
+    const double xi_group = fabs(xi(gen)) < 0.02 ? 0. : 0.02;
+    return i % 10 == 0 ? 1.e-5 * (i + 1) : xi_group;  // two large kinematics groups, and single particles
+  });
+
+  hector::Propagator prop(bl.get());
+  hector::ParticlesBatch batch(parts);
+  prop.propagate(batch, s_max);
+  if (batch.s() != s_max) {
+    cerr << "Batch was propagated up to s = " << batch.s() << " m instead of " << s_max << " m." << endl;
+    return 1;
+  }
+
+  size_t num_stopped = 0;
+  for (size_t i = 0; i < parts.size(); ++i) {
+    bool stopped = false;
+    try {
+      prop.propagate(parts.at(i), s_max);
+    } catch (const hector::ParticleStoppedException&) {
+      stopped = true;
+    }
+    if (stopped != batch.stopped(i)) {
+      cerr << "Particle " << i << " stopped status differs between individual and batch propagations." << endl;
+      return 1;
+    }
+    if (stopped) {
+      ++num_stopped;
+      continue;
+    }
+    const auto diff = (parts.at(i).lastStateVector().vector() - batch.stateVector(i).vector()).norm();
+    if (diff > 1.e-12) {
+      cerr << "Particle " << i << " final state differs between individual and batch propagations: " << diff << endl;
+      return 1;
+    }
+  }
+  if (num_stopped == 0 || num_stopped == parts.size()) {
+    cerr << "Apertures are not tested: " << num_stopped << " particle(s) stopped." << endl;
+    return 1;
+  }
+
+  // a second batch is propagated through the beamline compiled for the first one
+  hector::ParticlesBatch batch2(parts);
+  prop.propagate(batch2, s_max);
+  for (size_t i = 0; i < parts.size(); ++i)
+    if (batch2.stopped(i) != batch.stopped(i) ||
+        (!batch.stopped(i) && batch2.stateVector(i).vector() != batch.stateVector(i).vector())) {
+      cerr << "Particle " << i << " differs between two propagations of the same batch." << endl;
+      return 1;
+    }
+
+  cout << "Passed" << endl;
+  return 0;
+}
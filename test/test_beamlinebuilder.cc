@@ -0,0 +1,119 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+#include "Hector/Beamline.h"
+#include "Hector/BeamlineBuilder.h"
+#include "Hector/Elements/Drift.h"
+#include "Hector/Elements/Marker.h"
+#include "Hector/Elements/Quadrupole.h"
+#include "Hector/Parameters.h"
+
+using namespace std;
+
+/// Lattice with markers and elements nested in others, in increasing s order
+hector::element::Elements lattice() {
+  hector::element::Elements out;
+  double s = 0.;
+  for (unsigned short i = 0; i < 40; ++i) {
+    const string id = to_string(i);
+    out.emplace_back(std::make_shared<hector::element::HorizontalQuadrupole>("MQ." + id, s, 10., 1.e-2));
+    out.emplace_back(std::make_shared<hector::element::Marker>("MKR." + id, s, 0.));
+    if (i % 2 == 0) {  // element inside the quadrupole, itself containing another one
+      out.emplace_back(std::make_shared<hector::element::Drift>("DRIFT." + id, s + 2., 5.));
+      out.emplace_back(std::make_shared<hector::element::VerticalQuadrupole>("MQV." + id, s + 3., 1., 1.e-2));
+    }
+    if (i % 3 == 0)  // element crossing the quadrupole exit
+      out.emplace_back(std::make_shared<hector::element::Drift>("DRIFT.X" + id, s + 8.5, 3.));
+    if (i % 4 == 0)  // element re-added
+      out.emplace_back(std::make_shared<hector::element::Marker>("MKR." + id, s + 1., 0.));
+    s += 12.;
+  }
+  return out;
+}
+
+/// \test Compare the bulk beamline construction to successive element insertions
+int main() {
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+  hector::Parameters::get().setCorrectBeamlineOverlaps(true);
+
+  const auto ip = std::make_shared<hector::element::Marker>("IP5", 0., 0.);
+  hector::Beamline ref(500., ip);
+  for (const auto& elem : lattice())
+    ref.add(elem);
+
+  auto elements = lattice();
+  std::shuffle(elements.begin(), elements.end(), std::default_random_engine(42));
+  hector::BeamlineBuilder builder(ref);  // properties only, without elements
+  builder.reserve(elements.size());
+  for (const auto& elem : elements)
+    builder.add(elem);
+  const auto bl = builder.build();
+  if (builder.size() != 0 || bl->maxLength() != ref.maxLength()) {
+    cerr << "Invalid builder state after the beamline production." << endl;
+    return 1;
+  }
+
+  if (bl->elements().size() != ref.elements().size()) {
+    cerr << "Invalid number of elements: " << bl->elements().size() << " != " << ref.elements().size() << "." << endl;
+    return 1;
+  }
+  for (size_t i = 0; i < ref.elements().size(); ++i) {
+    const auto &elem = bl->elements().at(i), &ref_elem = ref.elements().at(i);
+    if (elem->name() != ref_elem->name() || elem->s() != ref_elem->s() || elem->length() != ref_elem->length()) {
+      cerr << "Invalid element at position " << i << ": " << elem->name() << " (s=" << elem->s()
+           << ", l=" << elem->length() << ") != " << ref_elem->name() << " (s=" << ref_elem->s()
+           << ", l=" << ref_elem->length() << ")." << endl;
+      return 1;
+    }
+  }
+  // split elements must keep their total length
+  if (std::fabs(bl->get("MQ.2/1")->length() + bl->get("MQ.2/2")->length() + bl->get("DRIFT.2/1")->length() +
+                bl->get("DRIFT.2/2")->length() + bl->get("MQV.2")->length() - 10.) > 1.e-12) {
+    cerr << "Invalid lengths for the split elements." << endl;
+    return 1;
+  }
+  if (bl->get("MKR.4")->s() != 48.) {
+    cerr << "Re-added element was not skipped." << endl;
+    return 1;
+  }
+
+  // sequenced beamline without gaps
+  const auto seq = hector::Beamline::sequencedBeamline(bl.get());
+  double pos = 0.;
+  for (const auto& elem : *seq) {
+    if (elem->type() == hector::element::aMarker)
+      continue;
+    if (elem->s() > pos + 1.e-12) {
+      cerr << "Gap found in the sequenced beamline at s = " << pos << " m." << endl;
+      return 1;
+    }
+    pos = std::max(pos, elem->s() + elem->length());
+  }
+  if (seq->find("^drift:").empty()) {
+    cerr << "No drift added in the sequenced beamline." << endl;
+    return 1;
+  }
+
+  cout << "Passed" << endl;
+  return 0;
+}
@@ -0,0 +1,87 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+
+#include "Hector/Apertures/Circular.h"
+#include "Hector/Beamline.h"
+#include "Hector/Elements/Drift.h"
+#include "Hector/Elements/Marker.h"
+#include "Hector/Elements/Quadrupole.h"
+#include "Hector/Parameters.h"
+#include "Hector/Propagator.h"
+
+using namespace std;
+
+/// \test Check the apertures checked by a propagator follow the modifications of its beamline
+int main() {
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+
+  hector::Beamline bl(50.);
+  bl.add(std::make_shared<hector::element::Marker>("IP", 0., 0.));
+  bl.add(std::make_shared<hector::element::Drift>("drift1", 0., 10.));
+  auto quad = std::make_shared<hector::element::HorizontalQuadrupole>("quad1", 10., 3., -1.e-2);
+  quad->setAperture(std::make_shared<hector::aperture::Circular>(1.e-3));
+  bl.add(quad);
+  bl.add(std::make_shared<hector::element::Drift>("drift2", 13., 10.));
+  bl.add(std::make_shared<hector::element::Marker>("end", 23., 0.));
+
+  const hector::Propagator prop(&bl);
+  const auto propagate = [&prop](double s_max) {
+    const hector::StateVector sv(hector::TwoVector(2.e-4, 0.), hector::TwoVector(0., 0.));
+    hector::Particle part(hector::StateVector(sv.vector(), prop.context().beamParticlesMass()));
+    part.setCharge(+1);
+    return prop.tryPropagate(part, s_max);
+  };
+  if (propagate(30.).stopped()) {
+    cerr << "Particle stopped in the nominal beamline." << endl;
+    return 1;
+  }
+
+  // misaligned elements: the particle is now outside the quadrupole aperture
+  bl.offsetElementsAfter(5., hector::TwoVector(1.5e-3, 0.));
+  auto status = propagate(30.);
+  if (status.survived() || bl.elements().at(status.element) != quad || !status.at_entrance) {
+    cerr << "Aperture offset is not propagated to the propagator." << endl;
+    return 1;
+  }
+  bl.offsetElementsAfter(5., hector::TwoVector(-1.5e-3, 0.));
+  if (propagate(30.).stopped()) {
+    cerr << "Aperture offset is not reverted in the propagator." << endl;
+    return 1;
+  }
+
+  // element added after the propagator construction, with a closed aperture
+  auto collimator = std::make_shared<hector::element::Drift>("collimator", 25., 1.);
+  collimator->setAperture(std::make_shared<hector::aperture::Circular>(1.e-4));
+  bl.add(collimator);
+  bl.add(std::make_shared<hector::element::Marker>("end2", 28., 0.));
+  status = propagate(30.);
+  if (status.survived() || bl.elements().at(status.element) != collimator) {
+    cerr << "Aperture of an added element is not checked by the propagator." << endl;
+    return 1;
+  }
+  if (prop.apertures()->size() != bl.elements().size()) {
+    cerr << "Apertures table is not rebuilt for the new beamline: " << prop.apertures()->size()
+         << " != " << bl.elements().size() << "." << endl;
+    return 1;
+  }
+
+  cout << "Passed" << endl;
+  return 0;
+}
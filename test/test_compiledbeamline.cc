@@ -0,0 +1,139 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <random>
+
+#include "Hector/Parameters.h"
+#include "Hector/ParticleStoppedException.h"
+#include "Hector/ParticlesBatch.h"
+#include "Hector/Propagator.h"
+#include "TestUtils.h"
+
+using namespace std;
+
+/// \test Compare the propagation of particles through a compiled beamline to their element-by-element propagation
+int main() {
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+
+  const auto bl = hector::test::fodoBeamline(20, 2.e-3, 5);  // only a few apertures along the line
+  const double s_max = 165., s_station = 42.;
+
+  const hector::Propagator prop(bl.get());
+  const auto cbl = prop.compile({s_station});
+  // 4 apertures, each surrounded by fused segments, and one additional split at the station
+  if (cbl.segments().size() != 10 || cbl.sMax() != s_max) {
+    cerr << "Invalid compiled beamline: " << cbl.segments().size() << " segment(s) up to s = " << cbl.sMax() << " m."
+         << endl;
+    return 1;
+  }
+
+  std::default_random_engine gen(1);
+  std::normal_distribution<double> xi(0., 0.01);
+  auto parts = hector::test::gaussianParticles(1000, [&gen, &xi](size_t) {
+    return fabs(xi(gen)) < 0.02 ? 0. : 0.02;  // only two kinematics groups
+  });
+
+  hector::ParticlesBatch batch(parts);
+  prop.propagate(batch, cbl);
+
+  size_t num_stopped = 0;
+  for (size_t i = 0; i < parts.size(); ++i) {
+    auto part_cmp = parts.at(i);
+    bool stopped = false, stopped_cmp = false;
+    try {
+      prop.propagate(parts.at(i), s_max);
+    } catch (const hector::ParticleStoppedException&) {
+      stopped = true;
+    }
+    try {
+      prop.propagate(part_cmp, cbl);
+    } catch (const hector::ParticleStoppedException&) {
+      stopped_cmp = true;
+    }
+    if (stopped != stopped_cmp || stopped != batch.stopped(i)) {
+      cerr << "Particle " << i << " stopped status differs between element-by-element and compiled propagations."
+           << endl;
+      return 1;
+    }
+    if (stopped) {
+      ++num_stopped;
+      continue;
+    }
+    const auto& ref = parts.at(i);
+    const auto diff = (ref.lastStateVector().vector() - part_cmp.lastStateVector().vector()).norm() +
+                      (ref.lastStateVector().vector() - batch.stateVector(i).vector()).norm() +
+                      (ref.stateVectorAt(45.).vector() - part_cmp.stateVectorAt(45.).vector()).norm();  // station exit
+    if (diff > 1.e-12) {
+      cerr << "Particle " << i << " state differs between element-by-element and compiled propagations: " << diff
+           << endl;
+      return 1;
+    }
+  }
+  if (num_stopped == 0 || num_stopped == parts.size()) {
+    cerr << "Apertures are not tested: " << num_stopped << " particle(s) stopped." << endl;
+    return 1;
+  }
+
+  {  // compilation starting inside a quadrupole whose aperture is checked: only its downstream part is traversed
+    const double s_min = 38.5;
+    const auto cbl_in = prop.compile({s_station}, s_min);
+    const auto& first = cbl_in.elements().front();
+    if (first->name() != "quad4" || first->s() != s_min || first->length() != 1.5 ||
+        cbl_in.segments().front().aperture_element != bl->get("quad4")) {
+      cerr << "Element holding the first position was not compiled from this position." << endl;
+      return 1;
+    }
+    hector::Particles parts_in;
+    for (const auto& part : parts) {
+      auto sv = part.firstStateVector();
+      sv.setPosition(sv.position() * 4.);  // some particles outside of the aperture of the quadrupole
+      parts_in.emplace_back(sv, s_min);
+      parts_in.rbegin()->setCharge(+1);
+    }
+    hector::ParticlesBatch batch_in(parts_in);
+    prop.propagate(batch_in, cbl_in);
+    size_t num_stopped_in = 0;
+    for (size_t i = 0; i < parts_in.size(); ++i) {
+      auto ref = parts_in.at(i), part_cmp = parts_in.at(i);
+      const auto status = prop.tryPropagate(ref, s_max), status_cmp = prop.tryPropagate(part_cmp, cbl_in);
+      if (status.stopped() != status_cmp.stopped() || status.stopped() != batch_in.stopped(i) ||
+          status.element != status_cmp.element) {
+        cerr << "Particle " << i << " stopped status differs when propagated from s = " << s_min << " m." << endl;
+        return 1;
+      }
+      if (status.stopped()) {
+        num_stopped_in += status.element == status_cmp.element && bl->elements().at(status.element)->name() == "quad4";
+        continue;
+      }
+      const auto diff = (ref.lastStateVector().vector() - part_cmp.lastStateVector().vector()).norm() +
+                        (ref.lastStateVector().vector() - batch_in.stateVector(i).vector()).norm();
+      if (diff > 1.e-12) {
+        cerr << "Particle " << i << " state differs when propagated from s = " << s_min << " m: " << diff << endl;
+        return 1;
+      }
+    }
+    if (num_stopped_in == 0) {
+      cerr << "Aperture of the partially traversed quadrupole is not tested." << endl;
+      return 1;
+    }
+  }
+
+  cout << "Passed" << endl;
+  return 0;
+}
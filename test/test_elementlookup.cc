@@ -0,0 +1,136 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <random>
+#include <regex>
+
+#include "Hector/Beamline.h"
+#include "Hector/Elements/Drift.h"
+#include "Hector/Elements/Marker.h"
+#include "Hector/Elements/Quadrupole.h"
+#include "Hector/Parameters.h"
+
+using namespace std;
+
+/// \test Compare the indexed elements lookup to a scan of the full beamline
+int main() {
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+
+  hector::Beamline bl(500.);
+  double s = 0.;
+  for (unsigned short i = 0; i < 50; ++i) {
+    bl.add(std::make_shared<hector::element::Drift>("DRIFT." + to_string(i), s, 4.));
+    if (i % 5 == 0)  // zero-length elements sharing their position with the drift
+      bl.add(std::make_shared<hector::element::Marker>("MKR." + to_string(i) + ".B1", s, 0.));
+    s += 4.;
+    bl.add(std::make_shared<hector::element::HorizontalQuadrupole>("MQ." + to_string(i) + "R5.B1", s, 3., 1.e-2));
+    s += 5.;  // leave a gap after each quadrupole
+  }
+  const auto& elements = bl.elements();
+
+  // lookup by (part of) name
+  vector<string> names{"MQ.1", "R5.B1", ".B1", "DRIFT.4", "MKR.45", "T.1", "Q"};
+  for (const auto& elem : elements)
+    names.emplace_back(elem->name());
+  for (const auto& name : names) {
+    const auto ref = std::find_if(elements.begin(), elements.end(), [&name](const auto& elem) {
+      return elem->name().find(name) != string::npos;
+    });
+    if (ref == elements.end() || bl.get(name) != *ref) {
+      cerr << "Invalid element retrieved for name \"" << name << "\"." << endl;
+      return 1;
+    }
+  }
+
+  // lookup by s-position
+  std::default_random_engine gen(42);
+  std::uniform_real_distribution<double> flat(0., s);
+  vector<double> positions{0., 4., 7., 8.};
+  for (unsigned short i = 0; i < 1000; ++i)
+    positions.emplace_back(flat(gen));
+  size_t num_found = 0;
+  for (const auto& pos : positions) {
+    const auto ref = std::find_if(elements.begin(), elements.end(), [&pos](const auto& elem) {
+      return elem->s() <= pos && elem->s() + elem->length() >= pos;
+    });
+    if (ref == elements.end())  // gap between two elements
+      continue;
+    ++num_found;
+    if (bl.get(pos) != *ref) {
+      cerr << "Invalid element retrieved at s = " << pos << " m." << endl;
+      return 1;
+    }
+  }
+  if (num_found == 0 || num_found == positions.size()) {
+    cerr << "Gaps are not tested: " << num_found << " position(s) found." << endl;
+    return 1;
+  }
+
+  // lookup by regular expression, repeated to use the cached results
+  for (unsigned short i = 0; i < 2; ++i)
+    for (const auto& pattern : {"^MQ\\.[0-9]+R5", "MKR", "\\.4[0-9]$"}) {
+      hector::element::Elements ref;
+      for (const auto& elem : elements)
+        if (std::regex_search(elem->name(), std::regex(pattern)))
+          ref.emplace_back(elem);
+      if (ref.empty() || bl.find(pattern) != ref) {
+        cerr << "Invalid elements found for pattern \"" << pattern << "\"." << endl;
+        return 1;
+      }
+    }
+
+  // index refreshed once the beamline is modified
+  bl.add(std::make_shared<hector::element::Marker>("XRPH.A", s + 1., 0.));
+  if (bl.get("XRPH") != *elements.rbegin() || bl.get(s + 1.) != *elements.rbegin() || bl.find("XRPH").size() != 1) {
+    cerr << "Lookup index is not updated after an element addition." << endl;
+    return 1;
+  }
+
+  // ...or once its elements are renamed, moved, or replaced in place
+  const auto revision = bl.revision();
+  bl.get("MQ.3R5")->setName("MQ.3L5.B1");
+  if (bl.revision() == revision || bl.get("MQ.3L5") != bl.get(32.) || !bl.find("MQ\\.3R5").empty()) {
+    cerr << "Lookup index is not updated after an element renaming." << endl;
+    return 1;
+  }
+  bl.get("XRPH")->offsetS(10.);
+  if (bl.get(s + 11.) != bl.get("XRPH") || bl.get(s + 11.)->s() != s + 11.) {
+    cerr << "Lookup index is not updated after an element displacement." << endl;
+    return 1;
+  }
+  bl.elements().back() = std::make_shared<hector::element::Marker>("XRPV.A", s + 11., 0.);
+  if (bl.get("XRPV") != bl.elements().back() || bl.get(s + 11.)->name() != "XRPV.A") {
+    cerr << "Lookup index is not updated after an element replacement." << endl;
+    return 1;
+  }
+
+  // clones of the beamline elements (e.g. partial elements along a propagation) do not affect its revision
+  const auto last_revision = bl.revision();
+  const auto last_change = hector::element::Element::lastBeamlineChange();
+  auto partial = bl.get("MQ.3L5")->clone();
+  partial->setS(partial->s() + 0.5);
+  partial->setLength(0.5 * partial->length());
+  if (bl.revision() != last_revision || hector::element::Element::lastBeamlineChange() != last_change) {
+    cerr << "Beamline revision is affected by the modification of an element clone." << endl;
+    return 1;
+  }
+
+  cout << "Passed" << endl;
+  return 0;
+}
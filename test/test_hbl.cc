@@ -0,0 +1,263 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+#include "Hector/Apertures/Circular.h"
+#include "Hector/Apertures/RectElliptic.h"
+#include "Hector/Apertures/Rectangular.h"
+#include "Hector/Beamline.h"
+#include "Hector/BeamlineBuilder.h"
+#include "Hector/CompiledBeamline.h"
+#include "Hector/Elements/Dipole.h"
+#include "Hector/Elements/Kicker.h"
+#include "Hector/Elements/Marker.h"
+#include "Hector/Elements/Quadrupole.h"
+#include "Hector/IO/HBLFileHandler.h"
+#include "Hector/IO/HBLFileStructures.h"
+#include "Hector/Parameters.h"
+#include "Hector/PropagationContext.h"
+
+using namespace std;
+
+/// \test Write a beamline into an HBL file and check all its properties are retrieved when parsed back
+int main() {
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+  hector::Parameters::get().setCorrectBeamlineOverlaps(true);
+
+  const auto ip = std::make_shared<hector::element::Marker>("IP5", 0., 0.);
+  hector::BeamlineBuilder builder(hector::Beamline(200., ip));
+  builder.add(ip);
+  double s = 5.;
+  for (unsigned short i = 0; i < 10; ++i) {
+    const string id = to_string(i);
+    hector::element::ElementPtr quad;
+    if (i % 2 == 0)
+      quad = std::make_shared<hector::element::HorizontalQuadrupole>("MQ." + id, s, 3., -1.e-2);
+    else
+      quad = std::make_shared<hector::element::VerticalQuadrupole>("MQ." + id, s, 3., 1.e-2);
+    quad->setAperture(std::make_shared<hector::aperture::RectElliptic>(2.e-2, 1.5e-2, 2.2e-2, 1.8e-2));
+    quad->setBeta(hector::TwoVector(100. + i, 50. - i));
+    quad->setDispersion(hector::TwoVector(1.e-2 * i, -1.e-3 * i));
+    quad->setRelativePosition(hector::TwoVector(1.e-4 * i, 2.e-4));
+    quad->setAngles(hector::TwoVector(1.e-6, -1.e-6 * i));
+    builder.add(quad);
+    // kicker nested in the quadrupole, splitting it into two parts
+    builder.add(std::make_shared<hector::element::HorizontalKicker>("MCBH." + id, s + 1., 0.5, 1.e-6));
+    auto dipole = std::make_shared<hector::element::SectorDipole>("MB." + id, s + 5., 4., 1.e-3);
+    dipole->setAperture(std::make_shared<hector::aperture::Circular>(2.e-2, hector::TwoVector(1.e-3, 0.)));
+    builder.add(dipole);
+    auto monitor = std::make_shared<hector::element::Drift>("BPM." + id, hector::element::aMonitor, s + 10., 0.);
+    monitor->setAperture(std::make_shared<hector::aperture::Rectangular>(3.e-2, 3.e-2));
+    builder.add(monitor);
+    s += 15.;
+  }
+  const auto raw = builder.build();
+  raw->setInteractionPoint(ip);
+  const auto bl = hector::Beamline::sequencedBeamline(raw.get());
+
+  const string filename = "test_hbl.hbl";
+  hector::io::HBL::write(bl.get(), filename);
+  const hector::io::HBL reader(filename);
+  const auto* parsed = reader.beamline();
+  if (parsed->elements().size() != bl->elements().size() || parsed->maxLength() != bl->maxLength()) {
+    cerr << "Invalid number of elements or length retrieved." << endl;
+    return 1;
+  }
+  if (!parsed->interactionPoint() || parsed->interactionPoint()->name() != "IP5") {
+    cerr << "Interaction point was not retrieved." << endl;
+    return 1;
+  }
+  size_t num_drifts = 0, num_parents = 0;
+  for (size_t i = 0; i < bl->elements().size(); ++i) {
+    const auto &ref = bl->elements().at(i), &elem = parsed->elements().at(i);
+    if (*elem != *ref || elem->angles() != ref->angles() || elem->beta() != ref->beta() ||
+        elem->dispersion() != ref->dispersion() || elem->relativePosition() != ref->relativePosition() ||
+        (ref->aperture() && elem->aperture()->type() != ref->aperture()->type())) {
+      cerr << "Element " << i << " (" << ref->name() << ") differs after parsing:\n\t" << ref << "\n\t" << elem << endl;
+      return 1;
+    }
+    if (ref->parentElement()) {
+      if (!elem->parentElement() || *elem->parentElement() != *ref->parentElement()) {
+        cerr << "Parent element of " << ref->name() << " was not retrieved." << endl;
+        return 1;
+      }
+      ++num_parents;
+    }
+    num_drifts += ref->type() == hector::element::aDrift;
+  }
+  if (num_drifts == 0 || num_parents == 0) {
+    cerr << "Beamline holds no drifts or split elements to check." << endl;
+    return 1;
+  }
+  const double kicker_s = bl->get("MCBH.3")->s() + 0.1;
+  if (parsed->get("MCBH.3")->name() != "MCBH.3" || parsed->get(kicker_s)->name() != bl->get(kicker_s)->name()) {
+    cerr << "Elements lookup index was not built." << endl;
+    return 1;
+  }
+
+  if (reader.matrices()) {
+    cerr << "Transfer matrices retrieved although none were stored." << endl;
+    return 1;
+  }
+  {  // nominal particle transfer matrices embedded in the file
+    const hector::PropagationContext ctx;
+    hector::io::HBL::write(bl.get(), filename, ctx);
+    const hector::io::HBL reader_mats(filename);
+    const auto* mats = reader_mats.matrices();
+    if (!mats || mats->context != ctx || mats->elements.size() != bl->elements().size() ||
+        !mats->segments_matrices || mats->segments_matrices->size() != mats->segments.size()) {
+      cerr << "Transfer matrices were not retrieved." << endl;
+      return 1;
+    }
+    const double h = 1.e-3;
+    for (size_t i = 0; i < bl->elements().size(); ++i) {
+      const auto& ref = bl->elements().at(i);
+      const auto& elem = reader_mats.beamline()->elements().at(i);
+      const auto mat = ref->matrix(mats->eloss, mats->mass, mats->charge, ctx);
+      const auto mat_h = ref->matrix(mats->eloss + h, mats->mass, mats->charge, ctx);
+      if (mats->elements.at(i) != mat || (mats->derivatives.at(i) - (mat_h - mat) / h).norm() > 1.e-3 ||
+          (mats->elementMatrix(i, mats->eloss + h) - mat_h).norm() > 1.e-6) {
+        cerr << "Transfer matrix or derivative of element " << ref->name() << " differs after parsing." << endl;
+        return 1;
+      }
+      // elements caches are seeded, no matrix is computed (and inserted) for the nominal particle
+      const size_t num_cached = elem->matrixCache().size();
+      if (elem->cachedMatrix(mats->eloss, mats->mass, mats->charge, ctx) != mat ||
+          elem->matrixCache().size() != num_cached || num_cached == 0) {
+        cerr << "Matrix cache of element " << ref->name() << " was not seeded." << endl;
+        return 1;
+      }
+    }
+    const hector::CompiledBeamline cbl(reader_mats.beamline(), ctx);
+    if (!reader_mats.provideMatrices(cbl) ||
+        cbl.findMatrices(mats->eloss, mats->mass, mats->charge) != mats->segments_matrices ||
+        *mats->segments_matrices !=
+            *hector::CompiledBeamline(bl.get(), ctx).matrices(mats->eloss, mats->mass, mats->charge)) {
+      cerr << "Transport segments matrices were not provided to the compiled beamline." << endl;
+      return 1;
+    }
+    if (reader_mats.provideMatrices(hector::CompiledBeamline(reader_mats.beamline(), ctx.withBeamEnergy(6000.)))) {
+      cerr << "Transport segments matrices were provided for another context." << endl;
+      return 1;
+    }
+  }
+  {  // elements matrices are optional
+    const hector::PropagationContext ctx;
+    hector::io::HBL::write(bl.get(), filename, ctx, false);
+    const hector::io::HBL reader_segments(filename);
+    const auto* mats = reader_segments.matrices();
+    if (!mats || !mats->elements.empty() || !mats->segments_matrices ||
+        reader_segments.beamline()->elements().front()->matrixCache().size() != 0 ||
+        !reader_segments.provideMatrices(hector::CompiledBeamline(reader_segments.beamline(), ctx))) {
+      cerr << "Transport segments matrices were not retrieved without the elements matrices." << endl;
+      return 1;
+    }
+    // version 2.0.2 files only hold the segments matrices, behind a header without derivatives step
+    string content;
+    {
+      ifstream in(filename, ios::binary);
+      content.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+    hector::io::HBLHeaderV2 hdr;
+    memcpy(&hdr, content.data(), sizeof(hdr));
+    const size_t step_pos = hdr.matrices_offset + offsetof(hector::io::HBLMatricesHeader, eloss_step);
+    content.erase(step_pos, sizeof(double));
+    hdr.version = 202;
+    hdr.matrices_size -= sizeof(double);
+    memcpy(content.data(), &hdr, sizeof(hdr));
+    {
+      ofstream out(filename, ios::binary);
+      out << content;
+    }
+    const hector::io::HBL reader_v202(filename);
+    if (!reader_v202.matrices() || !reader_v202.matrices()->elements.empty() ||
+        *reader_v202.matrices()->segments_matrices != *mats->segments_matrices) {
+      cerr << "Version 2.0.2 file transfer matrices were not retrieved." << endl;
+      return 1;
+    }
+  }
+  {  // version 2.0.1 files always hold the elements matrices
+    hector::io::HBL::write(bl.get(), filename, hector::PropagationContext());
+    fstream file(filename, ios::binary | ios::in | ios::out);
+    hector::io::HBLHeaderV2 hdr;
+    file.read(reinterpret_cast<char*>(&hdr), sizeof(hdr));
+    const uint16_t version = 201;
+    file.seekp(offsetof(hector::io::HBLHeaderV2, version));
+    file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    const uint32_t reserved = 0;  // in place of the elements matrices flag
+    file.seekp(hdr.matrices_offset + offsetof(hector::io::HBLMatricesHeader, element_matrices));
+    file.write(reinterpret_cast<const char*>(&reserved), sizeof(reserved));
+  }
+  const hector::io::HBL reader_v201(filename);
+  if (!reader_v201.matrices() || reader_v201.matrices()->elements.size() != bl->elements().size()) {
+    cerr << "Version 2.0.1 file transfer matrices were not retrieved." << endl;
+    return 1;
+  }
+  {  // version 2.0.0 files hold no matrices block location in their header
+    fstream file(filename, ios::binary | ios::in | ios::out);
+    const uint16_t version = 200, header_size = 64;
+    file.seekp(offsetof(hector::io::HBLHeaderV2, version));
+    file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    file.write(reinterpret_cast<const char*>(&header_size), sizeof(header_size));
+  }
+  const hector::io::HBL reader_v200(filename);
+  if (reader_v200.matrices() || reader_v200.beamline()->elements().size() != bl->elements().size()) {
+    cerr << "Version 2.0.0 file was not parsed." << endl;
+    return 1;
+  }
+
+  {  // files written in the former, version 1, format are still parsed
+    ofstream out(filename, ios::binary);
+    hector::io::HBLHeader hdr{};
+    hdr.magic = 0x464c4248;
+    hdr.version = 100;
+    hdr.num_elements = 2;
+    out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    hector::io::HBLElement quad;
+    quad.element_type = hector::element::anHorizontalQuadrupole;
+    strcpy(quad.element_name, "MQ.1");
+    quad.element_s = 1.;
+    quad.element_length = 3.;
+    quad.element_magnetic_strength = -1.e-2;
+    quad.aperture_type = hector::aperture::aRectangularAperture;
+    quad.aperture_p1 = quad.aperture_p2 = 2.e-2;
+    hector::io::HBLElement marker;
+    marker.element_type = hector::element::aMarker;
+    strcpy(marker.element_name, "IP5");
+    marker.aperture_type = hector::aperture::anInvalidAperture;
+    out.write(reinterpret_cast<const char*>(&marker), sizeof(marker));
+    out.write(reinterpret_cast<const char*>(&quad), sizeof(quad));
+  }
+  const hector::io::HBL reader_v1(filename);
+  if (reader_v1.beamline()->elements().size() != 2 || reader_v1.beamline()->get("MQ.1")->s() != 1. ||
+      !reader_v1.beamline()->get("MQ.1")->aperture()) {
+    cerr << "Version 1 file was not parsed." << endl;
+    return 1;
+  }
+  std::remove(filename.c_str());
+
+  cout << "Passed" << endl;
+  return 0;
+}
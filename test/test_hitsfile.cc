@@ -0,0 +1,130 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "Hector/IO/HitsFile.h"
+#include "Hector/Parameters.h"
+#include "Hector/ParticlesBatch.h"
+#include "Hector/Propagator.h"
+#include "Hector/Utils/MappedFile.h"
+#include "TestUtils.h"
+
+using namespace std;
+
+/// \test Write the hits of particles propagated to scoring stations into a columnar file, and read them back
+int main() {
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+
+  const auto bl = hector::test::fodoBeamline(10);
+  const vector<double> stations = {40., 85.};  // in a drift, and at the exit of the line
+
+  const hector::ParticlesBatch initial(hector::test::gaussianParticles(1000));
+  const hector::Propagator prop(bl.get());
+  vector<hector::ParticlesBatch> finals;
+  for (const auto& station : stations) {
+    finals.emplace_back(initial);
+    prop.propagate(finals.back(), station);
+  }
+  if (finals.back().numAlive() == 0 || finals.back().numAlive() == initial.size()) {
+    cerr << "Unexpected number of particles reaching the last station: " << finals.back().numAlive() << "." << endl;
+    return 1;
+  }
+
+  hector::io::Hit extra;
+  extra.particle = 1ull << 40;
+  extra.station = 1;
+  extra.x = 1.e-3;
+  extra.theta_y = -2.e-5;
+  extra.energy0 = 6500.;
+
+  const string filename = "test_hitsfile.hits";
+  size_t raw_size = 0;
+  for (bool compress : {false, true}) {
+    {
+      hector::io::HitsWriter writer(filename, stations, compress, 300);  // last chunk is only partially filled
+      for (unsigned int i = 0; i < stations.size(); ++i)
+        writer.add(i, 0, initial, finals.at(i));
+      extra.loss_element = writer.lossElement("extra_element");
+      writer.add(extra);
+      if (writer.size() != stations.size() * initial.size() + 1) {
+        cerr << "Invalid number of hits written: " << writer.size() << "." << endl;
+        return 1;
+      }
+    }
+    const size_t file_size = hector::MappedFile(filename).size();
+    if (!compress)
+      raw_size = file_size;
+    else if (file_size >= raw_size) {
+      cerr << "Compressed hits file is not smaller than the raw one: " << file_size << " >= " << raw_size << "."
+           << endl;
+      return 1;
+    }
+
+    const hector::io::HitsReader reader(filename);
+    if (reader.size() != stations.size() * initial.size() + 1 || reader.numChunks() != 7 ||
+        reader.stations() != stations) {
+      cerr << "Invalid hits file index: " << reader.size() << " hits in " << reader.numChunks() << " chunks." << endl;
+      return 1;
+    }
+    const auto hits = reader.read();
+    size_t num_scanned = 0;
+    reader.scan([&](const hector::io::HitsChunk& chunk) {
+      for (size_t i = 0; i < chunk.size(); ++i, ++num_scanned)
+        if (chunk.particles()[i] != hits.at(num_scanned).particle ||
+            chunk.values(hector::io::hitX)[i] != hits.at(num_scanned).x)
+          num_scanned = hits.size() + 1;
+    });
+    if (num_scanned != hits.size()) {
+      cerr << "Scanned hits differ from the read ones." << endl;
+      return 1;
+    }
+    for (size_t i = 0; i < stations.size() * initial.size(); ++i) {
+      const auto& hit = hits.at(i);
+      const size_t id = i % initial.size();
+      const auto& final = finals.at(i / initial.size());
+      const auto sv0 = initial.stateVector(id), sv = final.stateVector(id);
+      const string loss = final.stopped(id) ? final.stoppingElement(id)->name() : "";
+      if (hit.particle != id || hit.station != i / initial.size() || hit.x0 != sv0.x() || hit.theta_x0 != sv0.Tx() ||
+          hit.y0 != sv0.y() || hit.theta_y0 != sv0.Ty() || hit.energy0 != sv0.energy() || hit.x != sv.x() ||
+          hit.theta_x != sv.Tx() || hit.y != sv.y() || hit.theta_y != sv.Ty() ||
+          (hit.loss_element < 0 ? "" : reader.lossElements().at(hit.loss_element)) != loss) {
+        cerr << "Hit " << i << " (compression: " << compress << ") differs from the propagated particle." << endl;
+        return 1;
+      }
+    }
+    const auto& last = hits.back();
+    if (last.particle != extra.particle || last.station != extra.station || last.x != extra.x ||
+        last.theta_y != extra.theta_y || last.energy0 != extra.energy0 ||
+        reader.lossElements().at(last.loss_element) != "extra_element") {
+      cerr << "Single hit was not retrieved (compression: " << compress << ")." << endl;
+      return 1;
+    }
+  }
+  std::remove(filename.c_str());
+
+  if (std::ifstream("/dev/full")) {  // a writer failing to complete its file on destruction only logs the failure
+    hector::io::HitsWriter writer("/dev/full", stations);
+    writer.add(hector::io::Hit{});
+  }
+
+  cout << "Passed" << endl;
+  return 0;
+}
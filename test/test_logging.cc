@@ -0,0 +1,87 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// debugging messages are compiled out, as in an optimised build
+#define HECTOR_LOGGING_FLOOR info
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Hector/Exception.h"
+#include "Hector/Parameters.h"
+#include "Hector/Utils/Logger.h"
+
+using namespace std;
+
+namespace {
+  size_t num_formatted = 0;
+  /// Count the number of times a message argument is evaluated
+  size_t formatted() { return ++num_formatted; }
+}  // namespace
+
+/// \test Check the log messages filtering and their asynchronous writing
+int main() {
+  ostringstream os;
+  auto& logger = hector::Logger::get();
+  logger.setOutput(os);
+
+  // run threshold and compile-time floor
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::warning);
+  H_INFO << "Filtered message " << formatted() << ".";
+  H_WARNING << "Logged message " << formatted() << ".";
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::debug);
+  H_DEBUG << "Compiled out message " << formatted() << ".";
+  if (num_formatted != 1 || os.str().find("Logged message 1.") == string::npos ||
+      os.str().find("message 2") != string::npos) {
+    cerr << "Invalid log messages filtering: " << num_formatted << " message(s) formatted." << endl;
+    return 1;
+  }
+
+  // concurrent writing through the background thread
+  os.str("");
+  logger.setAsynchronous(true);
+  const size_t num_threads = 4, num_messages = 2 * hector::Logger::queue_size;
+  vector<thread> threads;
+  for (size_t i = 0; i < num_threads; ++i)
+    threads.emplace_back([i]() {
+      for (size_t j = 0; j < num_messages; ++j)
+        H_WARNING << "thread" << i << ":" << j << ";";
+    });
+  for (auto& thr : threads)
+    thr.join();
+  logger.flush();
+  const string out = os.str();
+  for (size_t i = 0; i < num_threads; ++i) {
+    size_t pos = 0;
+    for (size_t j = 0; j < num_messages; ++j) {
+      pos = out.find("thread" + to_string(i) + ":" + to_string(j) + ";", pos);
+      if (pos == string::npos) {
+        cerr << "Message " << j << " of thread " << i << " is missing or out of order." << endl;
+        return 1;
+      }
+    }
+  }
+  logger.setAsynchronous(false);
+  logger.setOutput(cerr);
+
+  cout << "Passed" << endl;
+  return 0;
+}
@@ -0,0 +1,108 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+
+#include "Hector/Elements/Quadrupole.h"
+#include "Hector/PropagationContext.h"
+
+using namespace std;
+
+/// \test Check the retrieval and invalidation of transfer matrices from the elements cache
+int main() {
+  hector::element::HorizontalQuadrupole quad("quad", 0., 3., -1.e-2);
+  const hector::PropagationContext ctx;
+  const double mp = ctx.beamParticlesMass();
+
+  const auto mat1 = quad.cachedMatrix(0., mp, +1, ctx);
+  const auto mat2 = quad.cachedMatrix(0., mp, +1, ctx);
+  if (quad.matrixCache().size() != 1 || mat1 != mat2) {
+    cerr << "Failed to retrieve the cached matrix." << endl;
+    return 1;
+  }
+  if (quad.matrixCache().misses() != 1 || quad.matrixCache().hits() != 1) {
+    cerr << "Cache retrievals were not counted." << endl;
+    return 1;
+  }
+  if (mat1 != quad.matrix(0., mp, +1, ctx)) {
+    cerr << "Cached matrix differs from the computed one." << endl;
+    return 1;
+  }
+
+  // close kinematics never share a matrix, whatever the order in which they are requested
+  const double eloss1 = 12.3456789, eloss2 = eloss1 + 1.e-7;
+  const auto mat_eloss1 = quad.cachedMatrix(eloss1, mp, +1, ctx), mat_eloss2 = quad.cachedMatrix(eloss2, mp, +1, ctx);
+  if (mat_eloss1 != quad.matrix(eloss1, mp, +1, ctx) || mat_eloss2 != quad.matrix(eloss2, mp, +1, ctx) ||
+      mat_eloss1 == mat_eloss2) {
+    cerr << "Cached matrix was computed for another energy loss." << endl;
+    return 1;
+  }
+
+  quad.setMagneticStrength(-2.e-2);  // changing the element properties drops its cache
+  if (quad.matrixCache().size() != 0 || quad.cachedMatrix(0., mp, +1, ctx) == mat1) {
+    cerr << "Cache was not invalidated after a magnetic strength update." << endl;
+    return 1;
+  }
+
+  const auto mat3 = quad.cachedMatrix(10., mp, +1, ctx);
+  const size_t num_cached = quad.matrixCache().size();
+  const auto ctx_7tev = ctx.withBeamEnergy(7000.);  // new run parameters are new keys in the cache
+  const auto mat4 = quad.cachedMatrix(10., mp, +1, ctx_7tev);
+  if (quad.matrixCache().size() != num_cached + 1 || mat4 != quad.matrix(10., mp, +1, ctx_7tev) || mat4 == mat3) {
+    cerr << "Cached matrix was computed for other run parameters." << endl;
+    return 1;
+  }
+
+  for (size_t i = 0; i < 2 * hector::element::MatrixCache::max_size; ++i)
+    quad.cachedMatrix(i * 1., mp, +1, ctx);
+  if (quad.matrixCache().size() != hector::element::MatrixCache::max_size) {
+    cerr << "Cache is not bounded to " << hector::element::MatrixCache::max_size << " matrices." << endl;
+    return 1;
+  }
+
+  {  // smeared kinematics never evict the nominal matrix, and are no longer stored once never reused
+    hector::element::HorizontalQuadrupole quad_smear("quad_smear", 0., 3., -1.e-2);
+    const auto& cache = quad_smear.matrixCache();
+    quad_smear.cachedMatrix(0., mp, +1, ctx);
+    for (size_t i = 1; i <= hector::element::MatrixCache::max_consecutive_misses; ++i)
+      quad_smear.cachedMatrix(i * 0.1, mp, +1, ctx);
+    const auto num_hits = cache.hits();
+    quad_smear.cachedMatrix(0., mp, +1, ctx);
+    if (cache.hits() != num_hits + 1) {
+      cerr << "Nominal matrix was evicted from the cache." << endl;
+      return 1;
+    }
+    quad_smear.cachedMatrix(1000., mp, +1, ctx);
+    quad_smear.cachedMatrix(1000., mp, +1, ctx);
+    if (cache.hits() != num_hits + 1 || cache.size() != hector::element::MatrixCache::max_size) {
+      cerr << "Matrix was stored although the cached ones were never reused." << endl;
+      return 1;
+    }
+    // reusing a stored matrix resumes the storage of new ones
+    quad_smear.cachedMatrix((hector::element::MatrixCache::max_consecutive_misses - 1) * 0.1, mp, +1, ctx);
+    quad_smear.cachedMatrix(1000., mp, +1, ctx);
+    quad_smear.cachedMatrix(1000., mp, +1, ctx);
+    if (cache.hits() != num_hits + 3) {
+      cerr << "Matrices storage was not resumed once a cached matrix was reused." << endl;
+      return 1;
+    }
+  }
+
+  cout << "Passed" << endl;
+  return 0;
+}
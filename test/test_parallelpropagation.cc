@@ -0,0 +1,97 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <random>
+
+#include "Hector/Apertures/Circular.h"
+#include "Hector/Beamline.h"
+#include "Hector/Elements/Drift.h"
+#include "Hector/Elements/Quadrupole.h"
+#include "Hector/ParallelPropagator.h"
+#include "Hector/Parameters.h"
+#include "Hector/ParticleStoppedException.h"
+
+using namespace std;
+
+/// \test Check that the multithreaded propagation of particles matches their serial propagation
+int main() {
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+
+  hector::Beamline bl(60.);
+  for (unsigned short i = 0; i < 6; ++i) {
+    bl.add(std::make_shared<hector::element::Drift>("drift" + to_string(i), i * 10., 7.));
+    auto quad =
+        std::make_shared<hector::element::HorizontalQuadrupole>("quad" + to_string(i), i * 10. + 7., 3., -2.e-2);
+    quad->setAperture(std::make_shared<hector::aperture::Circular>(1.5e-3));
+    bl.add(quad);
+  }
+
+  std::default_random_engine gen(42);
+  std::normal_distribution<double> pos(0., 5.e-4), ang(0., 5.e-5);
+  hector::Particles parts;
+  for (unsigned short i = 0; i < 500; ++i) {
+    hector::StateVector sv(hector::TwoVector(pos(gen), pos(gen)), hector::TwoVector(ang(gen), ang(gen)));
+    hector::Particle part(hector::StateVector(sv.vector(), hector::Parameters::get().beamParticlesMass()));
+    part.setCharge(+1);
+    parts.emplace_back(part);
+  }
+  const auto initial_parts = parts;
+  auto parallel_parts = parts;
+
+  hector::ParallelPropagator prop(&bl, 4, 7);
+  const size_t num_stopped = prop.propagate(parallel_parts, 60.);
+
+  size_t num_serial_stopped = 0;
+  for (size_t i = 0; i < parts.size(); ++i) {
+    bool stopped = false;
+    try {
+      prop.hector::Propagator::propagate(parts.at(i), 60.);
+    } catch (const hector::ParticleStoppedException&) {
+      stopped = true;
+      ++num_serial_stopped;
+    }
+    const auto &ser = parts.at(i), &par = parallel_parts.at(i);
+    if (stopped != par.stopped() || std::distance(ser.begin(), ser.end()) != std::distance(par.begin(), par.end()) ||
+        ser.lastS() != par.lastS() || ser.lastStateVector().vector() != par.lastStateVector().vector()) {
+      cerr << "Particle " << i << " differs between serial and parallel propagations." << endl;
+      return 1;
+    }
+  }
+  if (num_stopped != num_serial_stopped || num_stopped == 0 || num_stopped == parts.size()) {
+    cerr << "Invalid number of stopped particles: " << num_stopped << " (serial: " << num_serial_stopped << ")."
+         << endl;
+    return 1;
+  }
+
+  // worker threads are kept alive between propagations, and shared with the copies of the propagator
+  const hector::ParallelPropagator prop_copy(prop);
+  for (unsigned short run = 0; run < 4; ++run) {
+    auto run_parts = initial_parts;
+    const size_t run_stopped = (run % 2 == 0 ? prop : prop_copy).propagate(run_parts, 60.);
+    for (size_t i = 0; i < run_parts.size(); ++i)
+      if (run_stopped != num_stopped ||
+          run_parts.at(i).lastStateVector().vector() != parallel_parts.at(i).lastStateVector().vector()) {
+        cerr << "Particle " << i << " differs in the successive parallel propagation #" << run << "." << endl;
+        return 1;
+      }
+  }
+
+  cout << "Passed" << endl;
+  return 0;
+}
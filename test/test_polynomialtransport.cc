@@ -0,0 +1,126 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <random>
+
+#include "Hector/Beamline.h"
+#include "Hector/Elements/Drift.h"
+#include "Hector/Elements/Quadrupole.h"
+#include "Hector/Parameters.h"
+#include "Hector/PolynomialTransport.h"
+#include "Hector/Utils/Kinematics.h"
+
+using namespace std;
+
+/// \test Compare the parametric transport of particles to a station to their exact propagation
+int main() {
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+
+  hector::Beamline bl(200.);
+  double s = 0.;
+  for (unsigned short i = 0; i < 20; ++i) {
+    bl.add(std::make_shared<hector::element::Drift>("drift" + to_string(i), s, 5.));
+    s += 5.;
+    if (i % 2 == 0)
+      bl.add(std::make_shared<hector::element::HorizontalQuadrupole>("quad" + to_string(i), s, 3., -2.e-2));
+    else
+      bl.add(std::make_shared<hector::element::VerticalQuadrupole>("quad" + to_string(i), s, 3., +2.e-2));
+    s += 3.;
+  }
+  const double s_station = 150.;
+
+  const hector::Propagator prop(&bl);
+  hector::PolynomialTransport::Domain domain;
+  domain.pos_min = hector::TwoVector(-1.e-3, -1.e-3);
+  domain.pos_max = hector::TwoVector(+1.e-3, +1.e-3);
+  domain.ang_min = hector::TwoVector(-1.e-4, -1.e-4);
+  domain.ang_max = hector::TwoVector(+1.e-4, +1.e-4);
+  domain.xi_min = 0.;
+  domain.xi_max = 0.1;
+  const hector::PolynomialTransport poly(prop, s_station, domain, 6);
+  const auto& bound = poly.errorBound();
+  const double pos_bound = std::max(bound[hector::StateVector::X], bound[hector::StateVector::Y]);
+  if (pos_bound > 1.e-6) {
+    cerr << "Transport not accurately modelled: maximal position deviation of " << pos_bound << " m." << endl;
+    return 1;
+  }
+
+  std::default_random_engine gen(1);
+  std::uniform_real_distribution<double> pos(-1.e-3, 1.e-3), ang(-1.e-4, 1.e-4), xi(0., 0.1);
+  const double mass = prop.context().beamParticlesMass();
+  for (unsigned short i = 0; i < 100; ++i) {
+    const hector::StateVector sv(hector::TwoVector(pos(gen), pos(gen)),
+                                 hector::TwoVector(ang(gen), ang(gen)),
+                                 hector::xi_to_e(xi(gen), prop.context().beamEnergy()));
+    hector::Particle part(hector::StateVector(sv.vector(), mass)), part_ref(part);
+    part.setCharge(+1);
+    part_ref.setCharge(+1);
+    poly.propagate(part);
+    prop.propagate(part_ref, s_station);
+    const hector::Vector diff =
+        (part.stateVectorAt(s_station).vector() - part_ref.stateVectorAt(s_station).vector()).cwiseAbs();
+    if (diff.maxCoeff() > 1.e-6 || diff[hector::StateVector::X] > 2. * bound[hector::StateVector::X]) {
+      cerr << "Particle " << i << " state at the station differs from the exact propagation: " << diff.transpose()
+           << endl;
+      return 1;
+    }
+  }
+  if (poly.numFallbacks() != 0) {
+    cerr << poly.numFallbacks() << " particle(s) inside the fitted domain were propagated with the exact propagator."
+         << endl;
+    return 1;
+  }
+
+  // outside the fitted domain, the exact propagation is used
+  const hector::StateVector sv_out(hector::TwoVector(), hector::TwoVector(), prop.context().beamEnergy() * 0.8);
+  hector::Particle part_out(hector::StateVector(sv_out.vector(), mass));
+  part_out.setCharge(+1);
+  auto part_out_ref = part_out;
+  poly.propagate(part_out);
+  prop.propagate(part_out_ref, s_station);
+  if (poly.numFallbacks() != 1 || part_out.lastStateVector().vector() != part_out_ref.lastStateVector().vector()) {
+    cerr << "Particle outside the fitted domain was not propagated with the exact propagator." << endl;
+    return 1;
+  }
+
+  // other particle species than the beam ones are propagated with the exact propagator
+  const hector::StateVector sv_in(hector::TwoVector(1.e-4, -2.e-4), hector::TwoVector(), prop.context().beamEnergy());
+  if (!poly.contains(hector::StateVector(sv_in.vector(), mass)) ||
+      !poly.contains(hector::StateVector(sv_in.vector(), mass), +1)) {
+    cerr << "Beam particle was not found inside the fitted domain." << endl;
+    return 1;
+  }
+  for (const auto& species : {std::make_pair(mass, +2), std::make_pair(2. * mass, +1)}) {
+    hector::Particle part_species(hector::StateVector(sv_in.vector(), species.first));
+    part_species.setCharge(species.second);
+    auto part_species_ref = part_species;
+    const auto num_fallbacks = poly.numFallbacks();
+    poly.propagate(part_species);
+    prop.propagate(part_species_ref, s_station);
+    if (poly.numFallbacks() != num_fallbacks + 1 ||
+        part_species.lastStateVector().vector() != part_species_ref.lastStateVector().vector()) {
+      cerr << "Particle of mass " << species.first << " GeV and charge " << species.second
+           << " was not propagated with the exact propagator." << endl;
+      return 1;
+    }
+  }
+
+  cout << "Passed" << endl;
+  return 0;
+}
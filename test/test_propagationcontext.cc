@@ -0,0 +1,107 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <thread>
+
+#include "Hector/Beamline.h"
+#include "Hector/Elements/Drift.h"
+#include "Hector/Elements/Quadrupole.h"
+#include "Hector/Parameters.h"
+#include "Hector/Propagator.h"
+
+using namespace std;
+
+/// \test Check the propagation of particles through one beamline with several concurrent run configurations
+int main() {
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+  hector::Parameters::get().setUseRelativeEnergy(true);
+
+  hector::Beamline bl(50.);
+  bl.add(std::make_shared<hector::element::Drift>("drift1", 0., 10.));
+  bl.add(std::make_shared<hector::element::HorizontalQuadrupole>("quad1", 10., 3., -2.e-2));
+  bl.add(std::make_shared<hector::element::Drift>("drift2", 13., 10.));
+  bl.add(std::make_shared<hector::element::VerticalQuadrupole>("quad2", 23., 3., +2.e-2));
+  bl.add(std::make_shared<hector::element::Drift>("drift3", 26., 10.));
+  const double s_max = 36.;
+
+  const hector::PropagationContext ctx_lo = hector::PropagationContext().withBeamEnergy(6500.),
+                                   ctx_hi = ctx_lo.withBeamEnergy(7000.);
+  if (ctx_lo == ctx_hi || ctx_lo != hector::PropagationContext().withBeamEnergy(6500.)) {
+    cerr << "Invalid comparison of propagation contexts." << endl;
+    return 1;
+  }
+
+  // both configurations are cached side by side
+  const auto& quad = *bl.elements().at(1);
+  const double mp = ctx_lo.beamParticlesMass();
+  const auto mat_lo = quad.cachedMatrix(100., mp, +1, ctx_lo), mat_hi = quad.cachedMatrix(100., mp, +1, ctx_hi);
+  if (mat_lo == mat_hi || quad.matrixCache().size() != 2 || quad.cachedMatrix(100., mp, +1, ctx_lo) != mat_lo) {
+    cerr << "Transfer matrices are not computed for each propagation context." << endl;
+    return 1;
+  }
+
+  hector::StateVector sv(hector::TwoVector(1.e-4, -1.e-4), hector::TwoVector(1.e-5, 2.e-5), 6400.);
+  hector::Particle part_lo(hector::StateVector(sv.vector(), mp), 0.), part_hi(part_lo);
+  part_lo.setCharge(+1);
+  part_hi.setCharge(+1);
+
+  const hector::Propagator prop_lo(&bl, ctx_lo), prop_hi(&bl, ctx_hi);
+  thread thr_lo([&]() { prop_lo.propagate(part_lo, s_max); }), thr_hi([&]() { prop_hi.propagate(part_hi, s_max); });
+  thr_lo.join();
+  thr_hi.join();
+
+  // the global run parameters are not used anymore once the propagators are built
+  const size_t num_cached = quad.matrixCache().size();
+  hector::Parameters::get().setBeamEnergy(1000.);
+  hector::Particle part_ref(part_lo.firstStateVector(), 0.);
+  part_ref.setCharge(+1);
+  prop_lo.propagate(part_ref, s_max);
+
+  if (part_lo.lastStateVector().vector() == part_hi.lastStateVector().vector()) {
+    cerr << "Particle propagation is insensitive to the beam energy." << endl;
+    return 1;
+  }
+  if (part_lo.lastStateVector().vector() != part_ref.lastStateVector().vector()) {
+    cerr << "Particle propagation is sensitive to the global run parameters." << endl;
+    return 1;
+  }
+  if (quad.matrixCache().size() != num_cached || quad.cachedMatrix(100., mp, +1, ctx_lo) != mat_lo) {
+    cerr << "Cached transfer matrices are sensitive to the global run parameters." << endl;
+    return 1;
+  }
+
+  // particles built for a context only use its beam properties, and a null charge follows the propagator context
+  const hector::Particle beam_part(ctx_hi);
+  if (beam_part.firstStateVector().energy() != ctx_hi.beamEnergy() || beam_part.mass() != ctx_hi.beamParticlesMass() ||
+      beam_part.charge() != ctx_hi.beamParticlesCharge() ||
+      hector::StateVector(ctx_lo).energy() != ctx_lo.beamEnergy()) {
+    cerr << "Beam particle is not built from the propagation context." << endl;
+    return 1;
+  }
+  hector::Particle part_beam_charge(part_lo.firstStateVector(), 0.);
+  prop_lo.propagate(part_beam_charge, s_max);
+  if (part_beam_charge.charge() != 0 ||
+      part_beam_charge.lastStateVector().vector() != part_ref.lastStateVector().vector()) {
+    cerr << "Particle of null charge is not propagated with the beam particles charge." << endl;
+    return 1;
+  }
+
+  cout << "Passed" << endl;
+  return 0;
+}
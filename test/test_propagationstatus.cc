@@ -0,0 +1,77 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+
+#include "Hector/Parameters.h"
+#include "Hector/ParticleStoppedException.h"
+#include "Hector/Propagator.h"
+#include "TestUtils.h"
+
+using namespace std;
+
+/// \test Compare the non-throwing loss reporting to the stopped particles exceptions
+int main() {
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+
+  const auto bl = hector::test::fodoBeamline(10, 1.e-3, 1, false);
+  const double s_max = 80.;
+
+  const hector::Propagator prop(bl.get());
+  const auto cbl = prop.compile();
+  const auto parts = hector::test::gaussianParticles(500);
+  size_t num_stopped = 0;
+  for (size_t i = 0; i < parts.size(); ++i) {
+    auto part = parts.at(i);
+    auto part_exc = part, part_cmp = part;
+
+    const auto status = prop.tryPropagate(part, s_max), status_cmp = prop.tryPropagate(part_cmp, cbl);
+    hector::element::ElementPtr stopping_elem;
+    try {
+      prop.propagate(part_exc, s_max);
+    } catch (const hector::ParticleStoppedException& e) {
+      stopping_elem = e.stoppingElement();
+    }
+    if (status.stopped() != (stopping_elem != nullptr) || status.stopped() != part.stopped()) {
+      cerr << "Particle " << i << " stopped status differs from the exceptions-based propagation." << endl;
+      return 1;
+    }
+    if (status.survived())
+      continue;
+    ++num_stopped;
+    const auto& elem = bl->elements().at(status.element);
+    const double s_stop = status.at_entrance ? elem->s() : elem->s() + elem->length();
+    if (elem != stopping_elem || status.s != s_stop || elem->aperture()->contains(status.position)) {
+      cerr << "Particle " << i << " stopped at s = " << status.s << " m in \"" << elem->name()
+           << "\" instead of \"" << stopping_elem->name() << "\"." << endl;
+      return 1;
+    }
+    if (status_cmp.element != status.element || status_cmp.at_entrance != status.at_entrance ||
+        (status_cmp.position - status.position).norm() > 1.e-12) {
+      cerr << "Particle " << i << " stopping status differs with the compiled beamline." << endl;
+      return 1;
+    }
+  }
+  if (num_stopped == 0 || num_stopped == 500) {
+    cerr << "Apertures are not tested: " << num_stopped << " particle(s) stopped." << endl;
+    return 1;
+  }
+
+  cout << "Passed" << endl;
+  return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+
+#include "Hector/Parameters.h"
+#include "Hector/ParticleStoppedException.h"
+#include "Hector/Propagator.h"
+#include "TestUtils.h"
+
+using namespace std;
+
+/// \test Check the trajectories recorded with all propagator recording policies
+int main() {
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+
+  const auto bl = hector::test::fodoBeamline(10);
+  const double s_max = 85.;
+  const vector<double> stations = {60., 21.5, 80.};  // unsorted, inside drifts and at an element exit
+
+  hector::Propagator prop_all(bl.get()), prop_final(bl.get()), prop_stations(bl.get());
+  prop_final.setRecording(hector::Propagator::Recording::finalState);
+  prop_stations.setStations(stations);
+
+  const auto parts = hector::test::gaussianParticles(200);
+  size_t num_stopped = 0;
+  for (size_t i = 0; i < parts.size(); ++i) {
+    auto part_all = parts.at(i);
+    auto part_final = part_all, part_stations = part_all;
+    bool stopped_all = false, stopped_final = false, stopped_stations = false;
+    try {
+      prop_all.propagate(part_all, s_max);
+    } catch (const hector::ParticleStoppedException&) {
+      stopped_all = true;
+    }
+    try {
+      prop_final.propagate(part_final, s_max);
+    } catch (const hector::ParticleStoppedException&) {
+      stopped_final = true;
+    }
+    try {
+      prop_stations.propagate(part_stations, s_max);
+    } catch (const hector::ParticleStoppedException&) {
+      stopped_stations = true;
+    }
+    if (stopped_all != stopped_final || stopped_all != stopped_stations) {
+      cerr << "Particle " << i << " stopped status depends on the recording policy." << endl;
+      return 1;
+    }
+    num_stopped += stopped_all;
+    if (std::distance(part_final.begin(), part_final.end()) != 2 || part_final.lastS() != part_all.lastS() ||
+        part_final.lastStateVector().vector() != part_all.lastStateVector().vector()) {
+      cerr << "Particle " << i << " final state is not recorded." << endl;
+      return 1;
+    }
+    size_t num_reached = 0;
+    for (const auto& station : stations) {
+      if (station > part_all.lastS())
+        continue;
+      ++num_reached;
+      const auto diff =
+          (part_stations.stateVectorAt(station).vector() - part_all.stateVectorAt(station).vector()).norm();
+      if (diff > 1.e-15) {
+        cerr << "Particle " << i << " state at station s = " << station << " m differs from the interpolated one."
+             << endl;
+        return 1;
+      }
+    }
+    if (std::distance(part_stations.begin(), part_stations.end()) != (long)num_reached + 1) {
+      cerr << "Particle " << i << " has unexpected positions recorded with the stations policy." << endl;
+      return 1;
+    }
+  }
+  if (num_stopped == 0 || num_stopped == 200) {
+    cerr << "Apertures are not tested: " << num_stopped << " particle(s) stopped." << endl;
+    return 1;
+  }
+
+  cout << "Passed" << endl;
+  return 0;
+}
@@ -12,7 +12,7 @@ def main(argv):
     parser = pyhector.Twissparser(argv[0], 'IP5', 250.)
     print 'Twiss file generated on:', parser.header['production_date']
     #parser.beamline.offsetElementsAfter(120., pyhector.TwoVector(-0.097, 0.))
-    prop = pyhector.Propagator(parser.beamline)
+    prop = pyhector.Propagator(parser.beamline, parser.context)
     #print parser.beamline.elements
     rps = parser.beamline.find('XRPH\.')
     #print [rp.name for rp in rps]
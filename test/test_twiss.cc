@@ -0,0 +1,197 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include "Hector/Apertures/Aperture.h"
+#include "Hector/Beamline.h"
+#include "Hector/Elements/Element.h"
+#include "Hector/IO/TwissHandler.h"
+#include "Hector/Parameters.h"
+
+using namespace std;
+
+/// \test Parse a small MAD-X Twiss file (with Windows line endings) and check the beamline content
+int main() {
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+
+  const string filename = "test_twiss.tfs";
+  {
+    ofstream out(filename, ios::binary);
+    out << "@ NAME             %05s \"TWISS\"\r\n"
+        << "@ ORIGIN           %16s \"5.02.07 Linux 64\"\r\n"
+        << "@ ENERGY           %le                 7000\r\n"
+        << "@ LENGTH           %le                  100\r\n"
+        << "* NAME KEYWORD S L K0L K1L HKICK VKICK BETX BETY X Y DX DY APERTYPE APER_1 APER_2 APER_3 APER_4\r\n"
+        << "$ %s %s %le %le %le %le %le %le %le %le %le %le %le %le %s %le %le %le %le\r\n"
+        << " \"MQ.UP\" \"QUADRUPOLE\" 2 3 0 0.01 0 0 100 50 0 0 0 0 \"NONE\" 0 0 0 0\r\n"
+        << " \"IP5\" \"MARKER\" 10 0 0 0 0 0 0.55 0.55 0 0 0 0 \"NONE\" 0 0 0 0\r\n"
+        << " \"DRIFT_0\" \"DRIFT\" 10 2 0 0 0 0 1 1 0 0 0 0 \"NONE\" 0 0 0 0\r\n"
+        << "\r\n"
+        << " \"MQ.1R5.B1\" \"QUADRUPOLE\" 12 3 0 +1.5e-2 0 0 120.5 80.25 1e-4 -2e-4 0.5 0 "
+        << "\"RECTELLIPSE\" 0.02 0.015 0.02 0.02\r\n"
+        << " \"MCBH.1\" \"HKICKER\" 16 0.5 0 0 0 0 1 1 0 0 0 0 \"NONE\" 0 0 0 0\r\n"
+        << " \"MCBH.2\" \"HKICKER\" 17 0.5 0 0 2.5e-6 0 1 1 0 0 0 0 \"NONE\" 0 0 0 0\r\n"
+        << " \"MB.A2R5.B1\" \"SBEND\" 20 10 1e-3 0 0 0 1 1 0 0 0 0 \"ELLIPSE\" 0.022 0.018 0 0\r\n"
+        << " \"BPM 1\" \"MONITOR\" 31 0 0 0 0 0 1 1 0 0 0 0 \"CIRCLE\" 0.03 0 0 0\r\n"
+        << " \"MQ.FAR\" \"QUADRUPOLE\" 200 3 0 -0.01 0 0 1 1 0 0 0 0 \"NONE\" 0 0 0 0\r\n"
+        << " \"MQ.FARTHER\" \"QUADRUPOLE\" 300 3 0 -0.01 0 0 1 1 0 0 0 0 \"NONE\" 0 0 0 0\r\n";
+  }
+
+  hector::io::Twiss twiss(filename, "IP5");
+  const auto* bl = twiss.rawBeamline();
+
+  const auto strings = twiss.headerStrings();
+  const auto floats = twiss.headerFloats();
+  if (strings.at("name") != "TWISS" || strings.at("origin") != "5.02.07 Linux 64" || floats.at("energy") != 7000. ||
+      bl->maxLength() != 100.) {
+    cerr << "Invalid header content." << endl;
+    return 1;
+  }
+  // the header beam properties are only propagated through the parser context, unless explicitly requested
+  const double run_energy = hector::Parameters::get().beamEnergy();
+  if (run_energy == 7000. || twiss.context().beamEnergy() != 7000.) {
+    cerr << "Header beam properties were not propagated through the parser context only." << endl;
+    return 1;
+  }
+
+  // drifts, null kickers, and elements outside the beamline range (except the first one after) are not kept
+  const vector<string> names{"IP5", "MQ.1R5.B1", "MCBH.2", "MB.A2R5.B1", "BPM 1", "MQ.FAR"};
+  if (bl->elements().size() != names.size()) {
+    cerr << "Invalid number of elements: " << bl->elements().size() << " != " << names.size() << "." << endl;
+    return 1;
+  }
+  for (size_t i = 0; i < names.size(); ++i)
+    if (bl->elements().at(i)->name() != names.at(i)) {
+      cerr << "Invalid element at position " << i << ": " << bl->elements().at(i)->name() << "." << endl;
+      return 1;
+    }
+
+  const auto& quad = bl->get("MQ.1R5.B1");
+  if (quad->type() != hector::element::anHorizontalQuadrupole || quad->s() != 2. || quad->length() != 3. ||
+      std::fabs(quad->magneticStrength() + 5.e-3) > 1.e-15 || quad->beta().x() != 120.5 ||
+      quad->beta().y() != 80.25 || quad->dispersion().x() != 0.5 || quad->relativePosition().y() != -2.e-4) {
+    cerr << "Invalid quadrupole properties." << endl;
+    return 1;
+  }
+  if (!quad->aperture() || quad->aperture()->type() != hector::aperture::aRectEllipticAperture ||
+      quad->aperture()->p(1) != 0.015 || quad->aperture()->x() != 1.e-4) {
+    cerr << "Invalid quadrupole aperture." << endl;
+    return 1;
+  }
+  const auto& kicker = bl->get("MCBH.2");
+  if (kicker->type() != hector::element::anHorizontalKicker || kicker->magneticStrength() != 2.5e-6) {
+    cerr << "Invalid kicker properties." << endl;
+    return 1;
+  }
+  const auto& dipole = bl->get("MB.A2R5.B1");
+  if (dipole->type() != hector::element::aSectorDipole || dipole->magneticStrength() != 1.e-4 ||
+      !dipole->aperture() || dipole->aperture()->type() != hector::aperture::anEllipticAperture) {
+    cerr << "Invalid dipole properties." << endl;
+    return 1;
+  }
+  const auto& monitor = bl->get("BPM 1");
+  if (monitor->type() != hector::element::aMonitor || monitor->s() != 21. || !monitor->aperture() ||
+      monitor->aperture()->p(0) != 0.03 || monitor->aperture()->p(1) != 0.03) {
+    cerr << "Invalid monitor properties." << endl;
+    return 1;
+  }
+
+  // beamlines stored in the cache directory once parsed, then retrieved from there
+  const string cache_dir = "test_twiss_cache";
+  hector::Parameters::get().setTwissCacheDirectory(cache_dir);
+  const auto num_images = [&cache_dir]() {
+    return std::distance(filesystem::directory_iterator(cache_dir), filesystem::directory_iterator());
+  };
+  const auto same = [](const hector::Beamline* lhs, const hector::Beamline* rhs) {
+    if (lhs->elements().size() != rhs->elements().size() || lhs->maxLength() != rhs->maxLength() ||
+        lhs->interactionPoint()->name() != rhs->interactionPoint()->name())
+      return false;
+    for (size_t i = 0; i < lhs->elements().size(); ++i)
+      if (*lhs->elements().at(i) != *rhs->elements().at(i) ||
+          lhs->elements().at(i)->beta() != rhs->elements().at(i)->beta())
+        return false;
+    return true;
+  };
+  for (unsigned short i = 0; i < 2; ++i) {
+    hector::io::Twiss cached(filename, "IP5");
+    if (num_images() != 1 || !same(cached.rawBeamline(), bl) || !same(cached.beamline(), twiss.beamline()) ||
+        cached.headerStrings() != strings || cached.headerFloats() != floats) {
+      cerr << "Invalid beamline retrieved with the cache enabled (pass " << i << ")." << endl;
+      return 1;
+    }
+  }
+  if (hector::Parameters::get().beamEnergy() != run_energy) {
+    cerr << "Cached header beam properties were propagated to the run parameters." << endl;
+    return 1;
+  }
+  twiss.applyHeaderParameters();
+  if (hector::Parameters::get().beamEnergy() != 7000.) {
+    cerr << "Header beam properties were not applied to the run parameters." << endl;
+    return 1;
+  }
+  hector::Parameters::get().setBeamEnergy(run_energy);
+  hector::io::Twiss shorter(filename, "IP5", 50.);  // another set of parsing options
+  if (num_images() != 2 || shorter.rawBeamline()->maxLength() != 55.) {
+    cerr << "Parsing options are not accounted for in the cache." << endl;
+    return 1;
+  }
+  {  // modified file content
+    ofstream out(filename, ios::binary | ios::app);
+    out << " \"MQ.LAST\" \"QUADRUPOLE\" 400 3 0 -0.01 0 0 1 1 0 0 0 0 \"NONE\" 0 0 0 0\r\n";
+  }
+  hector::io::Twiss modified(filename, "IP5");
+  if (num_images() != 3) {
+    cerr << "File content is not accounted for in the cache." << endl;
+    return 1;
+  }
+  {  // corrupted images are parsed again from the Twiss file, and rewritten
+    vector<string> corrupted;
+    for (const auto& entry : filesystem::directory_iterator(cache_dir)) {
+      fstream image(entry.path(), ios::binary | ios::in | ios::out);
+      image.seekp(filesystem::file_size(entry.path()) / 2);
+      image.write("\xde\xad\xbe\xef", 4);
+      image.close();
+      ifstream in(entry.path(), ios::binary);
+      corrupted.emplace_back(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+    hector::io::Twiss reparsed(filename, "IP5");
+    size_t num_rewritten = 0;
+    for (const auto& entry : filesystem::directory_iterator(cache_dir)) {
+      ifstream in(entry.path(), ios::binary);
+      num_rewritten += find(corrupted.begin(),
+                            corrupted.end(),
+                            string(istreambuf_iterator<char>(in), istreambuf_iterator<char>())) == corrupted.end();
+    }
+    if (!same(reparsed.beamline(), modified.beamline()) || num_images() != 3 || num_rewritten != 1) {
+      cerr << "Corrupted cache image was not parsed again and rewritten." << endl;
+      return 1;
+    }
+  }
+  filesystem::remove_all(cache_dir);
+  std::remove(filename.c_str());
+
+  cout << "Passed" << endl;
+  return 0;
+}
@@ -0,0 +1,89 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <random>
+#include <regex>
+
+#include "Hector/Beamline.h"
+#include "Hector/Elements/ElementType.h"
+#include "Hector/IO/TwissHandler.h"
+
+using namespace std;
+
+/// \test Compare the Twiss element name matchers to the regular expressions they replace
+int main() {
+  const vector<pair<regex, hector::element::Type> > patterns{
+      {regex("DRIFT\\_[0-9]+"), hector::element::aDrift},
+      {regex("M[B,Q]\\w+\\d?\\.\\w?\\d[L,R]\\d(\\.B[1,2])?"), hector::element::aGenericQuadrupole},
+      {regex("MB\\.[A-Z][0-9]{1,2}[L,R][0-9]\\.B[1,2]"), hector::element::aSectorDipole},
+      {regex("MB[A-Z0-9]{2,3}\\.*[B,R][0-9]"), hector::element::aRectangularDipole},
+      {regex("IP[0-9]"), hector::element::aMarker},
+      {regex("BPM.+"), hector::element::aMonitor},
+      {regex("T[C,A].*\\.\\d[L,R]\\d\\.?(B[1-9])?"), hector::element::aRectangularCollimator}};
+  const auto reference = [&patterns](const string& name) {
+    for (const auto& pattern : patterns)
+      if (regex_match(name, pattern.first))
+        return pattern.second;
+    return hector::element::anInvalidElement;
+  };
+
+  vector<string> names{"DRIFT_0",     "DRIFT_123",   "DRIFT_",        "DRIFT_1A",      "XDRIFT_1",   "MQXA.1R5",
+                       "MQY.A4L5.B1", "MQML.10R5.B2", "MQ.12R5.B1",   "MQW.5R5.B3",    "MB.A8R5.B1", "MB.B12L5.B2",
+                       "MB.A123R5.B1", "MB.a8R5.B1",  "MBXW.A4R5",     "MBRC.4R5.B1",   "MBW..B1",    "MBWB.R4",
+                       "MBX.4L5",     "MBRD.4R5.B2", "IP5",           "IP",            "IP10",       "BPM",
+                       "BPM.1R5.B1",  "BPMSW.1L5",   "TCL.4R5.B1",    "TCL.5R5.",      "TCTPH.4L5.B1", "TAN.4R5",
+                       "TAXN.4R5.B9", "TCL.4R5.B0",  "TC.4R5",        "TC,4R5.4R5",    "T,X.1L1B2",  "TCP.D6L7.B1",
+                       "M,QX.1R5",    "MBAB.,7",     "MQX.A1,1",      "BPM\n",         "TC\n.4R5",   ""};
+  const size_t num_handcrafted = names.size();
+  // random combinations of the characters found in the patterns
+  const string alphabet = "MBQTCAIPDRFLT_.,0123456789abSWX";
+  std::default_random_engine gen(42);
+  std::uniform_int_distribution<size_t> length(1, 14), character(0, alphabet.size() - 1);
+  for (size_t i = 0; i < 200000; ++i) {
+    string name(length(gen), ' ');
+    for (auto& c : name)
+      c = alphabet[character(gen)];
+    names.emplace_back(name);
+  }
+  // random mutations of the handcrafted names
+  for (size_t i = 0; i < num_handcrafted; ++i)
+    for (size_t j = 0; j < 1000; ++j) {
+      string name = names[i];
+      if (name.empty())
+        continue;
+      name[std::uniform_int_distribution<size_t>(0, name.size() - 1)(gen)] = alphabet[character(gen)];
+      names.emplace_back(name);
+    }
+
+  size_t num_matched = 0;
+  for (const auto& name : names) {
+    const auto ref = reference(name), type = hector::io::Twiss::findElementTypeByName(name);
+    if (type != ref) {
+      cerr << "Invalid type retrieved for name \"" << name << "\": " << type << " instead of " << ref << "." << endl;
+      return 1;
+    }
+    num_matched += (ref != hector::element::anInvalidElement);
+  }
+  if (num_matched < 1000) {
+    cerr << "Only " << num_matched << " names were classified." << endl;
+    return 1;
+  }
+  cout << "Passed" << endl;
+  return 0;
+}
@@ -0,0 +1,106 @@
+/*
+ *  Hector: a beamline propagation tool
+ *  Copyright (C) 2016-2023  Laurent Forthomme
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "Hector/Apertures/Aperture.h"
+#include "Hector/Beamline.h"
+#include "Hector/Elements/Element.h"
+#include "Hector/IO/TwissHandler.h"
+#include "Hector/Parameters.h"
+#include "Hector/Utils/String.h"
+
+using namespace std;
+
+/// \test Parse a large MAD-X Twiss file on several threads, and compare the beamlines to the ones of a serial parsing
+int main() {
+  hector::Parameters::get().setLoggingThreshold(hector::ExceptionType::fatal);
+
+  const string filename = "test_twissparallel.tfs";
+  const size_t num_cells = 4000;
+  {
+    ofstream out(filename, ios::binary);
+    out << "@ NAME             %05s \"TWISS\"\n"
+        << "@ ENERGY           %le                 6500\n"
+        << "@ LENGTH           %le                40000\n"
+        << "* NAME KEYWORD S L K0L K1L HKICK VKICK BETX BETY X Y DX DY APERTYPE APER_1 APER_2 APER_3 APER_4\n"
+        << "$ %s %s %le %le %le %le %le %le %le %le %le %le %le %le %s %le %le %le %le\n";
+    for (size_t i = 0; i < num_cells; ++i) {
+      const double s = 10. * i, phase = 1.e-2 * s;
+      const string id = to_string(i), optics = hector::format(" %.10g %.10g %.10g %.10g %.10g 0 ",
+                                                               100. + 80. * sin(phase),
+                                                               100. + 80. * cos(phase),
+                                                               1.e-4 * sin(3. * phase),
+                                                               -1.e-4 * cos(2. * phase),
+                                                               0.5 * sin(phase));
+      out << hector::format(" \"DRIFT_%zu\" \"DRIFT\" %.10g 1 0 0 0 0", i, s) << optics << "\"NONE\" 0 0 0 0\n"
+          << hector::format(" \"MQ.%zu\" \"QUADRUPOLE\" %.10g 3 0 %g 0 0", i, s + 1., i % 2 == 0 ? 8.e-3 : -8.e-3)
+          << optics << "\"RECTELLIPSE\" 0.02 0.015 0.02 0.02\n"
+          << hector::format(" \"MCBH.%zu\" \"HKICKER\" %.10g 0.5 0 0 %g 0", i, s + 4., i % 3 == 0 ? 0. : 1.e-6)
+          << optics << "\"NONE\" 0 0 0 0\n"
+          << hector::format(" \"MB.%zu\" \"SBEND\" %.10g 4 1e-3 0 0 0", i, s + 4.5) << optics
+          << "\"ELLIPSE\" 0.022 0.018 0 0\n"
+          << hector::format(
+                 " \"%s\" \"MARKER\" %.10g 0 0 0 0 0", (i == num_cells / 3 ? "IP5" : "MKR." + id).c_str(), s + 8.5)
+          << optics << "\"NONE\" 0 0 0 0\n"
+          << hector::format(" \"BPM.%zu\" \"MONITOR\" %.10g 0 0 0 0 0", i, s + 9.) << optics
+          << "\"CIRCLE\" 0.03 0 0 0\n";
+      if (i % 100 == 0)
+        out << "\n";
+    }
+  }
+
+  const auto same = [](const hector::Beamline* lhs, const hector::Beamline* rhs) {
+    if (lhs->elements().size() != rhs->elements().size() || lhs->maxLength() != rhs->maxLength() ||
+        lhs->interactionPoint()->name() != rhs->interactionPoint()->name())
+      return false;
+    for (size_t i = 0; i < lhs->elements().size(); ++i) {
+      const auto &el1 = lhs->elements().at(i), &el2 = rhs->elements().at(i);
+      if (*el1 != *el2 || el1->beta() != el2->beta() || el1->dispersion() != el2->dispersion() ||
+          el1->relativePosition() != el2->relativePosition() || !el1->aperture() != !el2->aperture() ||
+          (el1->aperture() && el1->aperture()->parameters() != el2->aperture()->parameters()))
+        return false;
+    }
+    return true;
+  };
+  // full beamline, beamline ending before the file does, and beamline starting upstream from the interaction point
+  for (const auto& range : vector<pair<double, double> >{{-1., 0.}, {5000., 0.}, {5000., -2000.}}) {
+    hector::Parameters::get().setTwissParsingThreads(1);
+    const hector::io::Twiss serial(filename, "IP5", range.first, range.second);
+    if (serial.rawBeamline()->elements().size() < 100) {
+      cerr << "Too few elements parsed: " << serial.rawBeamline()->elements().size() << "." << endl;
+      return 1;
+    }
+    for (unsigned short num_threads : {2, 3, 4, 7}) {
+      hector::Parameters::get().setTwissParsingThreads(num_threads);
+      const hector::io::Twiss parallel(filename, "IP5", range.first, range.second);
+      if (!same(serial.rawBeamline(), parallel.rawBeamline()) || !same(serial.beamline(), parallel.beamline())) {
+        cerr << "Beamline parsed on " << num_threads << " threads differs from the serial one (s in [" << range.second
+             << ", " << range.first << "] m)." << endl;
+        return 1;
+      }
+    }
+  }
+  std::remove(filename.c_str());
+
+  cout << "Passed" << endl;
+  return 0;
+}